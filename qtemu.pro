@@ -30,6 +30,13 @@ message("Generating Makefile for QtEmu... $$escape_expand(\\n)")
 QT += core gui widgets network
 message("Building with Qt v$$QT_VERSION")
 
+# zstd is optional, the archives are compressed with zlib without it
+packagesExist(libzstd) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+    DEFINES += QTEMU_HAS_ZSTD
+}
+
 lessThan(QT_MAJOR_VERSION, 5) {
     warning(" >>> You're trying to build with Qt 4")
     warning(" >>> This version of QtEmu requires Qt 5")
@@ -57,7 +64,9 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES +=  src/main.cpp\
             src/components/customfilter.cpp \
+            src/components/sparkline.cpp \
             src/mainwindow.cpp \
+            src/consolewindow.cpp \
             src/helpwidget.cpp \
             src/aboutwidget.cpp \
             src/configwindow.cpp \
@@ -65,6 +74,17 @@ SOURCES +=  src/main.cpp\
             src/machine.cpp \
             src/newmachine/machinepage.cpp \
             src/utils/systemutils.cpp \
+            src/utils/hosttopology.cpp \
+            src/utils/hostutils.cpp \
+            src/utils/errorreporter.cpp \
+            src/utils/machinecloner.cpp \
+            src/utils/qemuimgjobrunner.cpp \
+            src/utils/templatelibrary.cpp \
+            src/utils/clonewizard.cpp \
+            src/utils/mediacopier.cpp \
+            src/utils/machineeventlog.cpp \
+            src/utils/consolebuffer.cpp \
+            src/utils/metricsseries.cpp \
             src/newmachine/generalpage.cpp \
             src/newmachine/hardwarepage.cpp \
             src/newmachine/acceleratorpage.cpp \
@@ -73,6 +93,14 @@ SOURCES +=  src/main.cpp\
             src/newmachine/conclusionpage.cpp \
             src/machineconfig/machineconfigwindow.cpp \
             src/utils/logger.cpp \
+            src/machineloader.cpp \
+            src/metricssampler.cpp \
+            src/metricsexporter.cpp \
+            src/controlserver.cpp \
+            src/launchscheduler.cpp \
+            src/autostartmanager.cpp \
+            src/machinesupervisor.cpp \
+            src/machineregistry.cpp \
             src/machineutils.cpp \
             src/machineconfig/machineconfiggeneral.cpp \
             src/machineconfig/machineconfighardware.cpp \
@@ -83,11 +111,15 @@ SOURCES +=  src/main.cpp\
             src/machineconfig/machineconfigaccel.cpp \
             src/utils/newdiskwizard.cpp \
             src/qemu.cpp \
+            src/qemucapabilities.cpp \
+            src/qmpclient.cpp \
             src/machineconfig/machineconfiggeneraltabs.cpp \
             src/machineconfig/machineconfighardwaretabs.cpp \
+            src/machineconfig/machineconfighistory.cpp \
             src/utils/firstrunwizard.cpp \
             src/boot.cpp \
             src/media.cpp \
+            src/networkinterface.cpp \
             src/export-import/export.cpp \
             src/export-import/exportgeneralpage.cpp \
             src/export-import/exportmediapage.cpp \
@@ -96,16 +128,30 @@ SOURCES +=  src/main.cpp\
             src/export-import/importdestinationpage.cpp \
             src/export-import/exportdetailspage.cpp \
             src/export-import/importdetailspage.cpp \
-            src/export-import/importmediapage.cpp
+            src/export-import/importmediapage.cpp \
+            src/export-import/machinearchive.cpp
 
 HEADERS  += src/mainwindow.h \
             src/components/customfilter.h \
+            src/components/sparkline.h \
+            src/consolewindow.h \
             src/helpwidget.h \
             src/aboutwidget.h \
             src/configwindow.h \
             src/machinewizard.h \
             src/machine.h \
             src/utils/systemutils.h \
+            src/utils/hosttopology.h \
+            src/utils/hostutils.h \
+            src/utils/errorreporter.h \
+            src/utils/machinecloner.h \
+            src/utils/qemuimgjobrunner.h \
+            src/utils/templatelibrary.h \
+            src/utils/clonewizard.h \
+            src/utils/mediacopier.h \
+            src/utils/machineeventlog.h \
+            src/utils/consolebuffer.h \
+            src/utils/metricsseries.h \
             src/newmachine/generalpage.h \
             src/newmachine/machinepage.h \
             src/newmachine/hardwarepage.h \
@@ -115,6 +161,14 @@ HEADERS  += src/mainwindow.h \
             src/newmachine/conclusionpage.h \
             src/machineconfig/machineconfigwindow.h \
             src/utils/logger.h \
+            src/machineloader.h \
+            src/metricssampler.h \
+            src/metricsexporter.h \
+            src/controlserver.h \
+            src/launchscheduler.h \
+            src/autostartmanager.h \
+            src/machinesupervisor.h \
+            src/machineregistry.h \
             src/machineutils.h \
             src/machineconfig/machineconfiggeneral.h \
             src/machineconfig/machineconfighardware.h \
@@ -125,11 +179,15 @@ HEADERS  += src/mainwindow.h \
             src/machineconfig/machineconfigaccel.h \
             src/utils/newdiskwizard.h \
             src/qemu.h \
+            src/qemucapabilities.h \
+            src/qmpclient.h \
             src/machineconfig/machineconfiggeneraltabs.h \
             src/machineconfig/machineconfighardwaretabs.h \
+            src/machineconfig/machineconfighistory.h \
             src/utils/firstrunwizard.h \
             src/boot.h \
             src/media.h \
+            src/networkinterface.h \
             src/export-import/export.h \
             src/export-import/exportgeneralpage.h \
             src/export-import/exportmediapage.h \
@@ -138,7 +196,8 @@ HEADERS  += src/mainwindow.h \
             src/export-import/importdestinationpage.h \
             src/export-import/exportdetailspage.h \
             src/export-import/importdetailspage.h \
-            src/export-import/importmediapage.h
+            src/export-import/importmediapage.h \
+            src/export-import/machinearchive.h
 
 OTHER_FILES += \
     CHANGELOG \
@@ -0,0 +1,733 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "autostartmanager.h"
+
+// Time between two readiness checks
+static const int PROBE_INTERVAL = 1000;
+
+// Time to wait for an answer in the port or the guest agent
+static const int PROBE_TIMEOUT = 800;
+
+// Time a port must stay open when the guest doesn't send anything
+static const int TCP_GRACE_PERIOD = 500;
+
+// Time to wait until a machine is ready, in seconds
+static const int DEFAULT_READY_TIMEOUT = 300;
+
+/**
+ * @brief Autostart manager
+ * @param launchScheduler, scheduler used to start the machines
+ * @param parent, parent object
+ *
+ * Start the machines marked to start with QtEmu.
+ * The machines are grouped in boot groups and a group
+ * can depend on other groups. A machine is started when
+ * all the machines of the groups it depends on are ready,
+ * so the independent groups are started in parallel.
+ * A machine is ready when QEMU is running, when a TCP port
+ * accepts connections or when the guest agent answers
+ */
+AutostartManager::AutostartManager(LaunchScheduler *launchScheduler, QObject *parent) : QObject(parent)
+{
+    this->m_launchScheduler = launchScheduler;
+    this->m_running = false;
+
+    this->m_probeTimer = new QTimer(this);
+    this->m_probeTimer->setInterval(PROBE_INTERVAL);
+    connect(m_probeTimer, &QTimer::timeout,
+            this, &AutostartManager::probeMachines);
+
+    connect(m_launchScheduler, &LaunchScheduler::launchStateChanged,
+            this, &AutostartManager::machineLaunchStateChanged);
+
+    qDebug() << "AutostartManager created";
+}
+
+AutostartManager::~AutostartManager()
+{
+    qDebug() << "AutostartManager destroyed";
+}
+
+/**
+ * @brief Add a loaded machine
+ * @param machine, machine
+ *
+ * Add a machine that can be started. The machine
+ * has a guest agent channel if its readiness needs it
+ */
+void AutostartManager::addMachine(Machine *machine)
+{
+    BootConfig config = AutostartManager::bootConfig(machine->getUuid());
+    machine->setGuestAgent(config.readiness == AutostartManager::GuestAgent);
+
+    this->m_machines.append(machine);
+}
+
+/**
+ * @brief Remove a machine
+ * @param machineUuid, uuid of the machine
+ *
+ * Remove a machine that is deleted. If it's
+ * waiting in the boot, it fails and the machines
+ * that depend on it are skipped
+ */
+void AutostartManager::removeMachine(const QUuid &machineUuid)
+{
+    QMutableListIterator<QPointer<Machine>> machine(this->m_machines);
+    while (machine.hasNext()) {
+        QPointer<Machine> nextMachine = machine.next();
+        if (nextMachine.isNull() || nextMachine->getUuid() == machineUuid) {
+            machine.remove();
+        }
+    }
+
+    int index = this->nodeIndex(machineUuid);
+    if (index == -1) {
+        return;
+    }
+
+    BootStates state = this->m_nodes.at(index).state;
+    if (state == AutostartManager::Pending || state == AutostartManager::Probing) {
+        this->setNodeState(index, AutostartManager::Failed, tr("The machine was removed"));
+        this->advance();
+    }
+}
+
+/**
+ * @brief Set the function that loads the machines
+ * @param loader, function that loads a machine from its registry entry
+ *
+ * Without loader only the added machines can be started
+ */
+void AutostartManager::setMachineLoader(MachineLoader loader)
+{
+    this->m_machineLoader = loader;
+}
+
+/**
+ * @brief Start the autostart machines
+ *
+ * Read the autostart config of the registry
+ * and start the machines whose groups don't
+ * depend on other groups
+ */
+void AutostartManager::start()
+{
+    if (this->m_running) {
+        return;
+    }
+
+    QString error;
+    MachineRegistry *registry = MachineRegistry::instance();
+    if (!registry->isLoaded() && !registry->load(error)) {
+        Logger::logQtemuError(tr("Cannot start the autostart machines: %1").arg(error));
+        return;
+    }
+
+    this->m_nodes.clear();
+    foreach (const QJsonObject &entry, registry->machines()) {
+        BootConfig config = AutostartManager::bootConfig(entry);
+        if (!config.enabled) {
+            continue;
+        }
+
+        BootNode node;
+        node.machineUuid = QUuid(entry["uuid"].toString());
+        node.name = entry["name"].toString();
+        // A machine without group is alone in its group
+        node.group = config.group.isEmpty() ? node.machineUuid.toString() : config.group;
+        node.config = config;
+        node.entry = entry;
+        node.state = AutostartManager::Pending;
+        node.dependents = 0;
+        this->m_nodes.append(node);
+    }
+
+    if (this->m_nodes.isEmpty()) {
+        return;
+    }
+
+    this->m_running = true;
+    Logger::logQtemuAction(QString("Starting %1 autostart machines").arg(this->m_nodes.size()));
+
+    // The groups needed by other machines are started first
+    for (int i = 0; i < this->m_nodes.size(); ++i) {
+        foreach (const QString &group, this->m_nodes.at(i).config.after) {
+            foreach (int index, this->groupNodes(group)) {
+                ++this->m_nodes[index].dependents;
+            }
+        }
+    }
+
+    QSet<QString> cyclicGroups = this->cyclicGroups();
+    for (int i = 0; i < this->m_nodes.size(); ++i) {
+        if (cyclicGroups.contains(this->m_nodes.at(i).group)) {
+            this->setNodeState(i, AutostartManager::Failed,
+                               tr("The dependencies of the boot group %1 have a cycle").arg(this->m_nodes.at(i).group));
+        }
+    }
+
+    this->advance();
+}
+
+/**
+ * @brief Get if the autostart machines are being started
+ * @return true if there are machines not ready yet
+ *
+ * Get if the autostart machines are being started
+ */
+bool AutostartManager::isRunning() const
+{
+    return m_running;
+}
+
+/**
+ * @brief Get the autostart config of a machine
+ * @param entry, entry of the machine in the registry
+ * @return autostart config
+ *
+ * The config is stored in the autostart object of the entry.
+ * Ex: {"enabled": true, "group": "database", "after": ["network"],
+ *      "ready": "tcp", "host": "127.0.0.1", "port": 5432, "timeout": 300}
+ */
+AutostartManager::BootConfig AutostartManager::bootConfig(const QJsonObject &entry)
+{
+    QJsonObject autostart = entry["autostart"].toObject();
+
+    BootConfig config;
+    config.enabled = autostart["enabled"].toBool(false);
+    config.group = autostart["group"].toString().trimmed();
+    foreach (const QJsonValue &group, autostart["after"].toArray()) {
+        if (!group.toString().trimmed().isEmpty()) {
+            config.after.append(group.toString().trimmed());
+        }
+    }
+
+    QString readiness = autostart["ready"].toString();
+    if (readiness == AutostartManager::readinessName(AutostartManager::TCPPort)) {
+        config.readiness = AutostartManager::TCPPort;
+    } else if (readiness == AutostartManager::readinessName(AutostartManager::GuestAgent)) {
+        config.readiness = AutostartManager::GuestAgent;
+    } else {
+        config.readiness = AutostartManager::QMPRunning;
+    }
+
+    config.host = autostart["host"].toString("127.0.0.1");
+    config.port = autostart["port"].toInt(0);
+    config.timeout = autostart["timeout"].toInt(DEFAULT_READY_TIMEOUT);
+
+    return config;
+}
+
+/**
+ * @brief Get the autostart config of a machine
+ * @param machineUuid, uuid of the machine
+ * @return autostart config
+ *
+ * Get the autostart config of a machine of the registry
+ */
+AutostartManager::BootConfig AutostartManager::bootConfig(const QUuid &machineUuid)
+{
+    return AutostartManager::bootConfig(MachineRegistry::instance()->machine(machineUuid));
+}
+
+/**
+ * @brief Save the autostart config of a machine
+ * @param machineUuid, uuid of the machine
+ * @param config, autostart config
+ * @param error, description of the problem
+ * @return true if the config is saved
+ *
+ * Save the autostart config in the entry of the machine in the registry
+ */
+bool AutostartManager::setBootConfig(const QUuid &machineUuid,
+                                     const AutostartManager::BootConfig &config,
+                                     QString &error)
+{
+    QJsonObject autostart;
+    autostart["enabled"] = config.enabled;
+    autostart["group"] = config.group.trimmed();
+    autostart["after"] = QJsonArray::fromStringList(config.after);
+    autostart["ready"] = AutostartManager::readinessName(config.readiness);
+    autostart["host"] = config.host.trimmed();
+    autostart["port"] = config.port;
+    autostart["timeout"] = config.timeout;
+
+    QJsonObject autostartUpdate;
+    autostartUpdate["uuid"] = machineUuid.toString();
+    autostartUpdate["autostart"] = autostart;
+
+    return MachineRegistry::instance()->updateMachine(autostartUpdate, error);
+}
+
+/**
+ * @brief Get the name of a boot state
+ * @param state, state of the machine
+ * @return name of the state
+ *
+ * Get the name of a boot state
+ */
+QString AutostartManager::stateName(AutostartManager::BootStates state)
+{
+    switch (state) {
+        case AutostartManager::Pending:
+            return "pending";
+        case AutostartManager::Starting:
+            return "starting";
+        case AutostartManager::Probing:
+            return "probing";
+        case AutostartManager::Ready:
+            return "ready";
+        case AutostartManager::Failed:
+            return "failed";
+        case AutostartManager::Skipped:
+            return "skipped";
+    }
+
+    return QString();
+}
+
+/**
+ * @brief Get the name of a readiness condition
+ * @param readiness, readiness condition
+ * @return name of the condition, stored in the registry
+ *
+ * Get the name of a readiness condition
+ */
+QString AutostartManager::readinessName(AutostartManager::Readiness readiness)
+{
+    switch (readiness) {
+        case AutostartManager::QMPRunning:
+            return "qmp";
+        case AutostartManager::TCPPort:
+            return "tcp";
+        case AutostartManager::GuestAgent:
+            return "agent";
+    }
+
+    return QString();
+}
+
+/**
+ * @brief Start the machines whose dependencies are ready
+ *
+ * Start the pending machines when all the machines
+ * of the groups they depend on are ready. If one of
+ * those machines failed, the machine is skipped
+ */
+void AutostartManager::advance()
+{
+    if (!this->m_running) {
+        return;
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (int i = 0; i < this->m_nodes.size(); ++i) {
+            if (this->m_nodes.at(i).state != AutostartManager::Pending) {
+                continue;
+            }
+
+            bool waiting = false;
+            QString failedGroup;
+            foreach (const QString &group, this->m_nodes.at(i).config.after) {
+                QList<int> nodes = this->groupNodes(group);
+                if (nodes.isEmpty()) {
+                    failedGroup = group;
+                }
+
+                foreach (int index, nodes) {
+                    BootStates state = this->m_nodes.at(index).state;
+                    if (state == AutostartManager::Failed || state == AutostartManager::Skipped) {
+                        failedGroup = group;
+                    } else if (state != AutostartManager::Ready) {
+                        waiting = true;
+                    }
+                }
+            }
+
+            if (!failedGroup.isEmpty()) {
+                this->setNodeState(i, AutostartManager::Skipped,
+                                   tr("The boot group %1 isn't ready").arg(failedGroup));
+                changed = true;
+            } else if (!waiting) {
+                this->launchNode(i);
+                changed = true;
+            }
+        }
+    }
+
+    foreach (const BootNode &node, this->m_nodes) {
+        if (node.state == AutostartManager::Pending ||
+            node.state == AutostartManager::Starting ||
+            node.state == AutostartManager::Probing) {
+            return;
+        }
+    }
+
+    this->m_running = false;
+    this->m_probeTimer->stop();
+
+    int readyMachines = 0;
+    foreach (const BootNode &node, this->m_nodes) {
+        if (node.state == AutostartManager::Ready) {
+            ++readyMachines;
+        }
+    }
+    Logger::logQtemuAction(QString("Autostart finished, %1 of %2 machines ready")
+                           .arg(readyMachines).arg(this->m_nodes.size()));
+
+    emit(finished());
+}
+
+/**
+ * @brief Check the machines that aren't ready yet
+ *
+ * Check the readiness condition of the started machines.
+ * A machine that is stopped or isn't ready in time fails
+ */
+void AutostartManager::probeMachines()
+{
+    bool probing = false;
+
+    for (int i = 0; i < this->m_nodes.size(); ++i) {
+        const BootNode &node = this->m_nodes.at(i);
+        if (node.state != AutostartManager::Probing) {
+            continue;
+        }
+
+        if (node.machine.isNull() || node.machine->getState() == Machine::Stopped) {
+            this->setNodeState(i, AutostartManager::Failed,
+                               tr("The machine was stopped before it was ready"));
+            continue;
+        }
+
+        if (node.probeTime.hasExpired(static_cast<qint64>(node.config.timeout) * 1000)) {
+            this->setNodeState(i, AutostartManager::Failed,
+                               tr("The machine isn't ready after %1 seconds").arg(node.config.timeout));
+            continue;
+        }
+
+        probing = true;
+        this->probeNode(i);
+    }
+
+    if (!probing) {
+        this->m_probeTimer->stop();
+    }
+
+    this->advance();
+}
+
+/**
+ * @brief State of the launch of a machine changed
+ * @param machineUuid, uuid of the machine
+ * @param state, state of the launch
+ * @param message, description of the state
+ *
+ * When a machine is started, wait until it's ready
+ */
+void AutostartManager::machineLaunchStateChanged(const QUuid machineUuid,
+                                                 LaunchScheduler::LaunchStates state,
+                                                 const QString &message)
+{
+    int index = this->nodeIndex(machineUuid);
+    if (index == -1 || this->m_nodes.at(index).state != AutostartManager::Starting) {
+        return;
+    }
+
+    if (state == LaunchScheduler::Started) {
+        this->m_nodes[index].probeTime.start();
+        this->setNodeState(index, AutostartManager::Probing,
+                           tr("Waiting until the machine is ready"));
+        this->m_probeTimer->start();
+        this->probeNode(index);
+    } else if (state == LaunchScheduler::Failed || state == LaunchScheduler::Cancelled) {
+        this->setNodeState(index, AutostartManager::Failed,
+                           message.isEmpty() ? tr("The machine wasn't started") : message);
+        this->advance();
+    }
+}
+
+/**
+ * @brief Get the position of a machine
+ * @param machineUuid, uuid of the machine
+ * @return position of the machine, -1 if it isn't an autostart machine
+ *
+ * Get the position of a machine
+ */
+int AutostartManager::nodeIndex(const QUuid &machineUuid) const
+{
+    for (int i = 0; i < this->m_nodes.size(); ++i) {
+        if (this->m_nodes.at(i).machineUuid == machineUuid) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Get the machines of a group
+ * @param group, name of the group
+ * @return positions of the machines of the group
+ *
+ * Get the machines of a group
+ */
+QList<int> AutostartManager::groupNodes(const QString &group) const
+{
+    QList<int> nodes;
+    for (int i = 0; i < this->m_nodes.size(); ++i) {
+        if (this->m_nodes.at(i).group == group) {
+            nodes.append(i);
+        }
+    }
+
+    return nodes;
+}
+
+/**
+ * @brief Get the groups that depend on themselves
+ * @return groups in a dependency cycle
+ *
+ * Remove the groups without dependencies until nothing
+ * changes. The remaining groups are in a cycle or
+ * depend on a group in a cycle
+ */
+QSet<QString> AutostartManager::cyclicGroups() const
+{
+    QHash<QString, QSet<QString>> dependencies;
+    foreach (const BootNode &node, this->m_nodes) {
+        QSet<QString> &groupDependencies = dependencies[node.group];
+        foreach (const QString &group, node.config.after) {
+            // The unknown groups are reported when the machine is started
+            if (!this->groupNodes(group).isEmpty()) {
+                groupDependencies.insert(group);
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        foreach (const QString &group, dependencies.keys()) {
+            if (dependencies.contains(group) && dependencies.value(group).isEmpty()) {
+                dependencies.remove(group);
+                for (auto it = dependencies.begin(); it != dependencies.end(); ++it) {
+                    it.value().remove(group);
+                }
+                changed = true;
+            }
+        }
+    }
+
+    return QSet<QString>(dependencies.keyBegin(), dependencies.keyEnd());
+}
+
+/**
+ * @brief Find a loaded machine
+ * @param machineUuid, uuid of the machine
+ * @return machine, nullptr if it isn't loaded
+ *
+ * Find a loaded machine
+ */
+Machine *AutostartManager::loadedMachine(const QUuid &machineUuid) const
+{
+    foreach (const QPointer<Machine> &machine, this->m_machines) {
+        if (!machine.isNull() && machine->getUuid() == machineUuid) {
+            return machine;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Start a machine
+ * @param index, position of the machine
+ *
+ * Start a machine through the launch scheduler.
+ * A machine that is already running is only checked
+ */
+void AutostartManager::launchNode(int index)
+{
+    BootNode &node = this->m_nodes[index];
+
+    QString error;
+    Machine *machine = this->loadedMachine(node.machineUuid);
+    if (machine == nullptr && this->m_machineLoader) {
+        machine = this->m_machineLoader(node.entry, error);
+    }
+
+    if (machine == nullptr) {
+        this->setNodeState(index, AutostartManager::Failed,
+                           error.isEmpty() ? tr("The machine isn't loaded") : error);
+        return;
+    }
+
+    if (node.config.readiness == AutostartManager::TCPPort &&
+        (node.config.port < 1 || node.config.port > 65535)) {
+        this->setNodeState(index, AutostartManager::Failed, tr("There isn't any port to check"));
+        return;
+    }
+
+    node.machine = machine;
+
+    if (machine->getState() != Machine::Stopped) {
+        node.probeTime.start();
+        this->setNodeState(index, AutostartManager::Probing,
+                           tr("Waiting until the machine is ready"));
+        this->m_probeTimer->start();
+        return;
+    }
+
+    this->setNodeState(index, AutostartManager::Starting, QString());
+    this->m_launchScheduler->enqueue(machine, this->m_nodes.at(index).dependents);
+}
+
+/**
+ * @brief Check if a machine is ready
+ * @param index, position of the machine
+ *
+ * Check the readiness condition of a machine
+ * without blocking. Only one check is done at a time
+ */
+void AutostartManager::probeNode(int index)
+{
+    BootNode &node = this->m_nodes[index];
+    if (!node.probeSocket.isNull() || node.machine.isNull()) {
+        return;
+    }
+
+    QUuid machineUuid = node.machineUuid;
+
+    if (node.config.readiness == AutostartManager::QMPRunning) {
+        QMPClient *machineQMPClient = node.machine->getQMPClient();
+        if (!machineQMPClient->isReady()) {
+            return;
+        }
+
+        machineQMPClient->execute("query-status", QJsonObject(), [=](const QJsonObject &response) {
+            this->probeFinished(machineUuid,
+                                response["return"].toObject()["status"].toString() == "running");
+        });
+    } else if (node.config.readiness == AutostartManager::TCPPort) {
+        QTcpSocket *socket = new QTcpSocket(this);
+        node.probeSocket = socket;
+
+        // With user mode networking QEMU accepts the connection itself
+        // and closes it at once if nothing listens in the guest
+        auto portReady = [=]() {
+            if (socket->state() != QAbstractSocket::ConnectedState) {
+                return;
+            }
+            socket->abort();
+            socket->deleteLater();
+            this->probeFinished(machineUuid, true);
+        };
+
+        connect(socket, &QTcpSocket::connected,
+                this, [=]() {
+            QTimer::singleShot(TCP_GRACE_PERIOD, socket, portReady);
+        });
+        connect(socket, &QTcpSocket::readyRead,
+                this, portReady);
+        connect(socket, &QTcpSocket::disconnected,
+                socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::errorOccurred,
+                socket, &QObject::deleteLater);
+        QTimer::singleShot(PROBE_TIMEOUT + TCP_GRACE_PERIOD, socket, &QObject::deleteLater);
+
+        socket->connectToHost(node.config.host, static_cast<quint16>(node.config.port));
+    } else {
+        QLocalSocket *socket = new QLocalSocket(this);
+        node.probeSocket = socket;
+
+        connect(socket, &QLocalSocket::connected,
+                this, [=]() {
+            socket->write("{\"execute\": \"guest-ping\"}\n");
+        });
+        // The agent answers {"return": {}} when the guest is running
+        connect(socket, &QLocalSocket::readyRead,
+                this, [=]() {
+            while (socket->canReadLine()) {
+                QJsonObject response = QJsonDocument::fromJson(socket->readLine()).object();
+                if (response.contains("return")) {
+                    socket->abort();
+                    socket->deleteLater();
+                    this->probeFinished(machineUuid, true);
+                    return;
+                }
+            }
+        });
+        connect(socket, &QLocalSocket::errorOccurred,
+                socket, &QObject::deleteLater);
+        QTimer::singleShot(PROBE_TIMEOUT, socket, &QObject::deleteLater);
+
+        socket->connectToServer(node.machine->getGuestAgentSocketPath());
+    }
+}
+
+/**
+ * @brief Result of a readiness check
+ * @param machineUuid, uuid of the machine
+ * @param ready, true if the machine is ready
+ *
+ * Mark the machine as ready and start the
+ * machines that depend on it
+ */
+void AutostartManager::probeFinished(const QUuid &machineUuid, bool ready)
+{
+    int index = this->nodeIndex(machineUuid);
+    if (!ready || index == -1 || this->m_nodes.at(index).state != AutostartManager::Probing) {
+        return;
+    }
+
+    this->setNodeState(index, AutostartManager::Ready, QString());
+    this->advance();
+}
+
+/**
+ * @brief Change the state of a machine
+ * @param index, position of the machine
+ * @param state, new state
+ * @param message, description of the state
+ *
+ * Change the state of a machine and notify it
+ */
+void AutostartManager::setNodeState(int index, AutostartManager::BootStates state,
+                                    const QString &message)
+{
+    BootNode &node = this->m_nodes[index];
+    node.state = state;
+
+    if (state == AutostartManager::Ready) {
+        Logger::logQtemuAction(QString("Autostart machine %1 is ready").arg(node.name));
+    } else if (state == AutostartManager::Failed || state == AutostartManager::Skipped) {
+        Logger::logQtemuError(QString("Autostart machine %1 not started: %2").arg(node.name, message));
+    }
+
+    emit(bootStateChanged(node.machineUuid, state, message));
+}
@@ -0,0 +1,142 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef AUTOSTARTMANAGER_H
+#define AUTOSTARTMANAGER_H
+
+// Qt
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QUuid>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+// C++ standard library
+#include <functional>
+
+// Local
+#include "machine.h"
+#include "machineregistry.h"
+#include "launchscheduler.h"
+#include "utils/logger.h"
+
+class AutostartManager : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit AutostartManager(LaunchScheduler *launchScheduler, QObject *parent = nullptr);
+        ~AutostartManager();
+
+        enum BootStates {
+            Pending, Starting, Probing, Ready, Failed, Skipped
+        };
+
+        enum Readiness {
+            QMPRunning, TCPPort, GuestAgent
+        };
+
+        struct BootConfig {
+            bool enabled = false;
+            QString group;
+            QStringList after;
+            AutostartManager::Readiness readiness = AutostartManager::QMPRunning;
+            QString host;
+            int port = 0;
+            int timeout = 0;
+        };
+
+        typedef std::function<Machine *(const QJsonObject &entry, QString &error)> MachineLoader;
+
+        void addMachine(Machine *machine);
+        void removeMachine(const QUuid &machineUuid);
+        void setMachineLoader(MachineLoader loader);
+
+        void start();
+        bool isRunning() const;
+
+        static AutostartManager::BootConfig bootConfig(const QJsonObject &entry);
+        static AutostartManager::BootConfig bootConfig(const QUuid &machineUuid);
+        static bool setBootConfig(const QUuid &machineUuid,
+                                  const AutostartManager::BootConfig &config,
+                                  QString &error);
+        static QString stateName(AutostartManager::BootStates state);
+        static QString readinessName(AutostartManager::Readiness readiness);
+
+    signals:
+        void bootStateChanged(const QUuid machineUuid,
+                              AutostartManager::BootStates state,
+                              const QString &message);
+        void finished();
+
+    public slots:
+
+    private slots:
+        void advance();
+        void probeMachines();
+        void machineLaunchStateChanged(const QUuid machineUuid,
+                                       LaunchScheduler::LaunchStates state,
+                                       const QString &message);
+
+    protected:
+
+    private:
+        struct BootNode {
+            QUuid machineUuid;
+            QString name;
+            QString group;
+            BootConfig config;
+            QJsonObject entry;
+            QPointer<Machine> machine;
+            BootStates state;
+            int dependents;
+            QElapsedTimer probeTime;
+            QPointer<QIODevice> probeSocket;
+        };
+
+        LaunchScheduler *m_launchScheduler;
+        MachineLoader m_machineLoader;
+        QList<QPointer<Machine>> m_machines;
+
+        QList<BootNode> m_nodes;
+        QTimer *m_probeTimer;
+        bool m_running;
+
+        // Methods
+        int nodeIndex(const QUuid &machineUuid) const;
+        QList<int> groupNodes(const QString &group) const;
+        QSet<QString> cyclicGroups() const;
+        Machine *loadedMachine(const QUuid &machineUuid) const;
+        void launchNode(int index);
+        void probeNode(int index);
+        void probeFinished(const QUuid &machineUuid, bool ready);
+        void setNodeState(int index, AutostartManager::BootStates state,
+                          const QString &message);
+};
+
+#endif // AUTOSTARTMANAGER_H
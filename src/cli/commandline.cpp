@@ -0,0 +1,697 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "commandline.h"
+
+// Time to wait for the answers of QEMU and the daemon, in milliseconds
+static const int QMP_TIMEOUT = 2000;
+static const int DAEMON_TIMEOUT = 10000;
+
+/**
+ * @brief Connect a QMP client with a machine
+ * @param client, QMP client
+ * @param entry, entry of the machine in the registry
+ *
+ * Connect a QMP client with a machine without waiting for QEMU
+ */
+static void connectQMPClient(QMPClient *client, const QJsonObject &entry)
+{
+    client->setMaxRetries(0);
+
+#ifdef Q_OS_WIN
+    Q_UNUSED(entry)
+
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    QString monitorHostName = settings.value("qemuMonitorHost", "localhost").toString();
+    quint16 monitorPort = static_cast<quint16>(settings.value("qemuMonitorPort", 6000).toInt());
+    settings.endGroup();
+
+    client->connectToMachine(monitorHostName, monitorPort);
+#else
+    client->connectToMachine(QDir(entry["path"].toString()).filePath("qmp.sock"));
+#endif
+}
+
+/**
+ * @brief Command line interface
+ * @param parent, parent object
+ *
+ * Drive the machines without the graphical interface.
+ * The state of the machines is asked to QEMU through
+ * QMP, so the machines started by the graphical interface
+ * or the daemon are seen in the same way
+ */
+CommandLine::CommandLine(QObject *parent) : QObject(parent),
+    m_out(stdout), m_err(stderr)
+{
+    qDebug() << "CommandLine created";
+}
+
+CommandLine::~CommandLine()
+{
+    qDebug() << "CommandLine destroyed";
+}
+
+/**
+ * @brief Run a command
+ * @param arguments, arguments of the application
+ * @return exit code
+ *
+ * Parse the arguments and run the command
+ */
+int CommandLine::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Drive the QtEmu machines without the graphical interface"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", tr("list, status, start, stop, clone, export or daemon"));
+    parser.addPositionalArgument("arguments", tr("Arguments of the command"), "[arguments...]");
+
+    QCommandLineOption jsonOption("json", tr("Write the output in JSON format"));
+    QCommandLineOption foregroundOption("foreground", tr("Run the machine in this process until it's stopped"));
+    QCommandLineOption forceOption("force", tr("Quit QEMU instead of sending the power down event"));
+    QCommandLineOption fullOption("full", tr("Copy the disks instead of creating a linked clone"));
+    parser.addOption(jsonOption);
+    parser.addOption(foregroundOption);
+    parser.addOption(forceOption);
+    parser.addOption(fullOption);
+
+    if (!parser.parse(arguments)) {
+        this->m_err << parser.errorText() << "\n";
+        return 2;
+    }
+
+    if (parser.isSet("help")) {
+        this->m_out << parser.helpText();
+        return 0;
+    }
+
+    if (parser.isSet("version")) {
+        this->m_out << QCoreApplication::applicationName() << " "
+                    << QCoreApplication::applicationVersion() << "\n";
+        return 0;
+    }
+
+    QStringList positionalArguments = parser.positionalArguments();
+    QString command = positionalArguments.value(0);
+    int argumentCount = positionalArguments.size() - 1;
+
+    if (command == "list" && argumentCount == 0) {
+        return this->listMachines(parser.isSet(jsonOption));
+    } else if (command == "status" && argumentCount == 1) {
+        return this->showStatus(positionalArguments.at(1), parser.isSet(jsonOption));
+    } else if (command == "start" && argumentCount == 1) {
+        return this->startMachine(positionalArguments.at(1), parser.isSet(foregroundOption));
+    } else if (command == "stop" && argumentCount == 1) {
+        return this->stopMachine(positionalArguments.at(1), parser.isSet(forceOption));
+    } else if (command == "clone" && argumentCount == 2) {
+        return this->cloneMachine(positionalArguments.at(1), positionalArguments.at(2), parser.isSet(fullOption));
+    } else if (command == "export" && argumentCount == 2) {
+        return this->exportMachine(positionalArguments.at(1), positionalArguments.at(2));
+    } else if (command == "daemon" && argumentCount == 0) {
+        return this->runDaemon();
+    }
+
+    this->m_err << tr("Usage:") << "\n"
+                << "  qtemu-cli list [--json]\n"
+                << "  qtemu-cli status <machine> [--json]\n"
+                << "  qtemu-cli start <machine> [--foreground]\n"
+                << "  qtemu-cli stop <machine> [--force]\n"
+                << "  qtemu-cli clone <machine> <name> [--full]\n"
+                << "  qtemu-cli export <machine> <archive>\n"
+                << "  qtemu-cli daemon\n";
+
+    return 2;
+}
+
+/**
+ * @brief List the machines
+ * @param json, true to write the list in JSON format
+ * @return exit code
+ *
+ * List the machines of the registry with their state
+ */
+int CommandLine::listMachines(bool json)
+{
+    QString error;
+    MachineRegistry *registry = MachineRegistry::instance();
+    if (!registry->load(error)) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    QList<QJsonObject> entries = registry->machines();
+    QHash<QUuid, QString> states = this->machineStates(entries);
+
+    if (json) {
+        QJsonArray machines;
+        foreach (const QJsonObject &entry, entries) {
+            QJsonObject machine;
+            machine["uuid"] = entry["uuid"];
+            machine["name"] = entry["name"];
+            machine["state"] = states.value(QUuid(entry["uuid"].toString()));
+            machines.append(machine);
+        }
+        this->m_out << QJsonDocument(machines).toJson(QJsonDocument::Indented);
+        return 0;
+    }
+
+    foreach (const QJsonObject &entry, entries) {
+        this->m_out << entry["name"].toString().leftJustified(30) << " "
+                    << states.value(QUuid(entry["uuid"].toString())).leftJustified(10) << " "
+                    << entry["uuid"].toString() << "\n";
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Show the status of a machine
+ * @param machine, name or uuid of the machine
+ * @param json, true to write the status in JSON format
+ * @return exit code, 0 if the machine is running
+ *
+ * Show the state and the paths of a machine
+ */
+int CommandLine::showStatus(const QString &machine, bool json)
+{
+    QString error;
+    QJsonObject entry = ControlServer::findMachineEntry(machine, error);
+    if (entry.isEmpty()) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    QString state = this->machineStates(QList<QJsonObject>() << entry).value(QUuid(entry["uuid"].toString()));
+
+    QJsonObject status;
+    status["uuid"] = entry["uuid"];
+    status["name"] = entry["name"];
+    status["state"] = state;
+    status["path"] = entry["path"];
+    status["configpath"] = entry["configpath"];
+
+    if (json) {
+        this->m_out << QJsonDocument(status).toJson(QJsonDocument::Indented);
+    } else {
+        this->m_out << tr("Name") << ": " << status["name"].toString() << "\n"
+                    << tr("UUID") << ": " << status["uuid"].toString() << "\n"
+                    << tr("State") << ": " << state << "\n"
+                    << tr("Path") << ": " << status["path"].toString() << "\n";
+    }
+
+    return state == "stopped" ? 3 : 0;
+}
+
+/**
+ * @brief Start a machine
+ * @param machine, name or uuid of the machine
+ * @param foreground, true to run QEMU in this process
+ * @return exit code
+ *
+ * Ask the daemon or the graphical interface to start the
+ * machine, so QEMU keeps running when this process is
+ * finished. In the foreground, the output of QEMU is
+ * written in the standard output
+ */
+int CommandLine::startMachine(const QString &machine, bool foreground)
+{
+    QString error;
+    QJsonObject entry = ControlServer::findMachineEntry(machine, error);
+    if (entry.isEmpty()) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    if (this->machineStates(QList<QJsonObject>() << entry).value(QUuid(entry["uuid"].toString())) != "stopped") {
+        this->m_err << tr("The machine %1 is already running").arg(entry["name"].toString()) << "\n";
+        return 1;
+    }
+
+    if (foreground) {
+        Machine *newMachine = this->loadMachine(entry, error);
+        if (newMachine == nullptr) {
+            this->m_err << error << "\n";
+            return 1;
+        }
+
+        return this->runForeground(newMachine);
+    }
+
+    QJsonObject params;
+    params["machine"] = entry["uuid"];
+    params["timeout"] = DAEMON_TIMEOUT;
+
+    QJsonObject response = this->callControlServer("machine.start", params, error);
+    if (!error.isEmpty()) {
+        this->m_err << error << "\n"
+                    << tr("Start the daemon with qtemu-cli daemon or use --foreground") << "\n";
+        return 1;
+    }
+
+    if (response.contains("error")) {
+        this->m_err << response["error"].toObject()["message"].toString() << "\n";
+        return 1;
+    }
+
+    this->m_out << tr("Machine %1 started").arg(entry["name"].toString()) << "\n";
+
+    return 0;
+}
+
+/**
+ * @brief Stop a machine
+ * @param machine, name or uuid of the machine
+ * @param force, true to quit QEMU
+ * @return exit code
+ *
+ * Send the power down event to the machine through QMP,
+ * whatever process started it. The process that owns the
+ * machine is asked first, so its supervisor knows that
+ * the machine must not be restarted
+ */
+int CommandLine::stopMachine(const QString &machine, bool force)
+{
+    QString error;
+    QJsonObject entry = ControlServer::findMachineEntry(machine, error);
+    if (entry.isEmpty()) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    QJsonObject params;
+    params["machine"] = entry["uuid"];
+    params["force"] = force;
+    params["wait"] = false;
+
+    QJsonObject response = this->callControlServer("machine.stop", params, error);
+    if (error.isEmpty() && response.contains("result")) {
+        return 0;
+    }
+    error.clear();
+
+    QMPClient client;
+    QEventLoop loop;
+    bool stopped = false;
+
+    connect(&client, &QMPClient::ready,
+            &loop, [&]() {
+        client.execute(force ? "quit" : "system_powerdown", QJsonObject(),
+                       [&](const QJsonObject &response) {
+            stopped = response.contains("return");
+            error = response["error"].toObject()["desc"].toString();
+            loop.quit();
+        });
+    });
+    connect(&client, &QMPClient::disconnected,
+            &loop, &QEventLoop::quit);
+    QTimer::singleShot(QMP_TIMEOUT, &loop, &QEventLoop::quit);
+
+    connectQMPClient(&client, entry);
+    loop.exec();
+
+    if (!stopped) {
+        this->m_err << (error.isEmpty() ? tr("The machine %1 isn't running").arg(entry["name"].toString())
+                                        : error) << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Clone a machine
+ * @param machine, name or uuid of the machine
+ * @param cloneName, name of the new machine
+ * @param fullClone, true to copy the disks
+ * @return exit code
+ *
+ * Clone a stopped machine
+ */
+int CommandLine::cloneMachine(const QString &machine, const QString &cloneName, bool fullClone)
+{
+    QString error;
+    QJsonObject entry = ControlServer::findMachineEntry(machine, error);
+    if (entry.isEmpty()) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    if (this->machineStates(QList<QJsonObject>() << entry).value(QUuid(entry["uuid"].toString())) != "stopped") {
+        this->m_err << tr("Stop the machine before cloning it") << "\n";
+        return 1;
+    }
+
+    Machine *sourceMachine = this->loadMachine(entry, error);
+    if (sourceMachine == nullptr) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    QEMU *QEMUObject = new QEMU(this);
+    Machine *newMachine = new Machine(this);
+    MachineCloner cloner(sourceMachine, newMachine, QEMUObject->QEMUImgJobs());
+    connect(&cloner, &MachineCloner::progressChanged,
+            this, &CommandLine::printProgress);
+
+    if (!cloner.start(cloneName.trimmed(), !fullClone)) {
+        this->m_err << cloner.errorString() << "\n";
+        return 1;
+    }
+
+    if (!cloner.isFinished()) {
+        QEventLoop loop;
+        bool success = false;
+        connect(&cloner, &MachineCloner::finished,
+                &loop, [&](bool cloneSuccess) {
+            success = cloneSuccess;
+            loop.quit();
+        });
+        loop.exec();
+        this->m_err << "\n";
+
+        if (!success) {
+            this->m_err << cloner.errorString() << "\n";
+            return 1;
+        }
+    }
+
+    this->m_out << tr("Machine %1 cloned as %2").arg(sourceMachine->getName(), newMachine->getName())
+                << " " << newMachine->getUuid().toString() << "\n";
+
+    return 0;
+}
+
+/**
+ * @brief Export a machine
+ * @param machine, name or uuid of the machine
+ * @param archivePath, path of the new archive
+ * @return exit code
+ *
+ * Export a stopped machine and all its media to an archive
+ */
+int CommandLine::exportMachine(const QString &machine, const QString &archivePath)
+{
+    QString error;
+    QJsonObject entry = ControlServer::findMachineEntry(machine, error);
+    if (entry.isEmpty()) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    if (this->machineStates(QList<QJsonObject>() << entry).value(QUuid(entry["uuid"].toString())) != "stopped") {
+        this->m_err << tr("Stop the machine before exporting it") << "\n";
+        return 1;
+    }
+
+    Machine *exportedMachine = this->loadMachine(entry, error);
+    if (exportedMachine == nullptr) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    // The media are stored in the archive by name
+    QJsonObject machineJSON = exportedMachine->getMachineJSON();
+    QJsonArray media = machineJSON["media"].toArray();
+    QList<ArchiveDisk> disks;
+    for (int i = 0; i < media.size(); ++i) {
+        QJsonObject mediaObject = media.at(i).toObject();
+        QFileInfo mediaInfo(mediaObject["path"].toString());
+        if (!mediaInfo.exists()) {
+            continue;
+        }
+
+        ArchiveDisk disk;
+        disk.name = mediaInfo.fileName();
+        disk.path = mediaInfo.absoluteFilePath();
+        disks.append(disk);
+
+        mediaObject["path"] = disk.name;
+        media[i] = mediaObject;
+    }
+    machineJSON["media"] = media;
+
+    MachineArchiveJob *job = MachineArchive::exportMachine(QFileInfo(archivePath).absoluteFilePath(),
+                                                           machineJSON, disks);
+
+    QEventLoop loop;
+    bool success = false;
+    connect(job, &MachineArchiveJob::progressChanged,
+            this, [&](qint64 bytesProcessed, qint64 totalBytes) {
+        this->printProgress(totalBytes > 0 ? bytesProcessed * 100.0 / totalBytes : 0);
+    });
+    connect(job, &MachineArchiveJob::finished,
+            &loop, [&](bool archiveSuccess) {
+        success = archiveSuccess;
+        error = job->errorString();
+        loop.quit();
+    });
+    loop.exec();
+    this->m_err << "\n";
+
+    if (!success) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    this->m_out << tr("Machine %1 exported to %2").arg(exportedMachine->getName(), archivePath) << "\n";
+
+    return 0;
+}
+
+/**
+ * @brief Run the daemon
+ * @return exit code
+ *
+ * Run the daemon until the process is finished
+ */
+int CommandLine::runDaemon()
+{
+    MachineDaemon daemon;
+    QString error;
+    if (!daemon.listen(error)) {
+        this->m_err << error << "\n";
+        return 1;
+    }
+
+    this->m_err << tr("Listening in %1").arg(ControlServer::socketPath()) << "\n";
+    this->m_err.flush();
+
+    return QCoreApplication::exec();
+}
+
+/**
+ * @brief Get the state of the machines
+ * @param entries, entries of the machines in the registry
+ * @return state of every machine by uuid
+ *
+ * Ask all the machines their state at the same time.
+ * A machine without QMP server is stopped
+ */
+QHash<QUuid, QString> CommandLine::machineStates(const QList<QJsonObject> &entries)
+{
+    QHash<QUuid, QString> states;
+    QEventLoop loop;
+    int pendingMachines = 0;
+
+    foreach (const QJsonObject &entry, entries) {
+        QUuid machineUuid(entry["uuid"].toString());
+        states.insert(machineUuid, "stopped");
+
+#ifndef Q_OS_WIN
+        if (!QFile::exists(CommandLine::QMPSocketPath(entry))) {
+            continue;
+        }
+#endif
+
+        QMPClient *client = new QMPClient(&loop);
+        ++pendingMachines;
+
+        connect(client, &QMPClient::ready,
+                &loop, [&, client, machineUuid]() {
+            client->execute("query-status", QJsonObject(), [&, client, machineUuid](const QJsonObject &response) {
+                // Ex: running, paused, shutdown...
+                states.insert(machineUuid, response["return"].toObject()["status"].toString());
+                client->disconnectFromMachine();
+                if (--pendingMachines == 0) {
+                    loop.quit();
+                }
+            });
+        });
+        connect(client, &QMPClient::disconnected,
+                &loop, [&]() {
+            if (--pendingMachines == 0) {
+                loop.quit();
+            }
+        });
+
+        connectQMPClient(client, entry);
+    }
+
+    if (pendingMachines > 0) {
+        QTimer::singleShot(QMP_TIMEOUT, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    return states;
+}
+
+/**
+ * @brief Call a method of the control server
+ * @param method, name of the method
+ * @param params, params of the method
+ * @param error, description of the error if the server cannot be reached
+ * @return JSON-RPC response of the server
+ *
+ * Call a method of the control server, in the daemon
+ * or in the graphical interface, and wait for the response
+ */
+QJsonObject CommandLine::callControlServer(const QString &method, const QJsonObject &params, QString &error)
+{
+    QLocalSocket socket;
+    socket.connectToServer(ControlServer::socketPath());
+    if (!socket.waitForConnected(QMP_TIMEOUT)) {
+        error = tr("Neither the daemon nor the graphical interface is running");
+        return QJsonObject();
+    }
+
+    QJsonObject request;
+    request["jsonrpc"] = "2.0";
+    request["id"] = 1;
+    request["method"] = method;
+    request["params"] = params;
+
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact));
+    socket.write("\n");
+    socket.flush();
+
+    QByteArray response;
+    while (!response.contains('\n')) {
+        if (!socket.waitForReadyRead(DAEMON_TIMEOUT + QMP_TIMEOUT)) {
+            error = tr("The daemon doesn't answer");
+            return QJsonObject();
+        }
+        response.append(socket.readAll());
+    }
+
+    return QJsonDocument::fromJson(response.left(response.indexOf('\n'))).object();
+}
+
+/**
+ * @brief Load a machine
+ * @param entry, entry of the machine in the registry
+ * @param error, description of the error
+ * @return machine, nullptr if the config cannot be read
+ *
+ * Load the config of a machine
+ */
+Machine *CommandLine::loadMachine(const QJsonObject &entry, QString &error)
+{
+    QString machineConfigPath = entry["configpath"].toString();
+    QJsonObject machineJSON = MachineUtils::parseMachineFile(machineConfigPath, error);
+    if (!error.isEmpty()) {
+        return nullptr;
+    }
+
+    Machine *machine = new Machine(this);
+    MachineUtils::fillMachineObject(machine, machineJSON, machineConfigPath);
+
+    return machine;
+}
+
+/**
+ * @brief Run a machine in this process
+ * @param machine, machine
+ * @return exit code
+ *
+ * Run the machine and write the output of QEMU
+ * until the machine is stopped
+ */
+int CommandLine::runForeground(Machine *machine)
+{
+    QEMU *QEMUObject = new QEMU(this);
+    if (QEMUObject->isSearchingBinaries()) {
+        QEventLoop searchLoop;
+        connect(QEMUObject, &QEMU::QEMUBinariesSearchFinished,
+                &searchLoop, &QEventLoop::quit);
+        searchLoop.exec();
+    }
+
+    if (QEMUObject->QEMUBinaries().isEmpty()) {
+        this->m_err << tr("QEMU binary not found") << "\n";
+        this->m_err.flush();
+        return 1;
+    }
+
+    qint64 lastSequence = machine->getConsole()->lastSequence();
+    connect(machine->getConsole(), &ConsoleBuffer::chunkAppended,
+            this, [&]() {
+        foreach (const ConsoleChunk &chunk, machine->getConsole()->chunksSince(lastSequence)) {
+            QTextStream &stream = chunk.channel == ConsoleBuffer::StandardOut ? this->m_out : this->m_err;
+            stream << QString::fromUtf8(chunk.data);
+            stream.flush();
+            lastSequence = chunk.sequence;
+        }
+    });
+
+    QEventLoop loop;
+    connect(machine, &Machine::machineStateChangedSignal,
+            &loop, [&](Machine::States newState) {
+        if (newState == Machine::Stopped) {
+            loop.quit();
+        }
+    });
+
+    machine->runMachine(QEMUObject);
+    if (machine->getProcessId() <= 0) {
+        return 1;
+    }
+
+    loop.exec();
+
+    return 0;
+}
+
+/**
+ * @brief Print the progress of a job
+ * @param progress, progress from 0 to 100
+ *
+ * Print the progress in the same line of the error output
+ */
+void CommandLine::printProgress(double progress)
+{
+    this->m_err << "\r" << QString::number(static_cast<int>(progress)).rightJustified(3) << "%";
+    this->m_err.flush();
+}
+
+/**
+ * @brief Get the path of the QMP socket
+ * @param entry, entry of the machine in the registry
+ * @return path of the socket
+ *
+ * Get the path of the QMP socket of a machine
+ */
+QString CommandLine::QMPSocketPath(const QJsonObject &entry)
+{
+    return QDir::toNativeSeparators(QDir(entry["path"].toString()).filePath("qmp.sock"));
+}
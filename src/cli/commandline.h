@@ -0,0 +1,88 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+// Qt
+#include <QObject>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+// Local
+#include "machinedaemon.h"
+#include "../controlserver.h"
+#include "../machine.h"
+#include "../machineutils.h"
+#include "../machineregistry.h"
+#include "../qmpclient.h"
+#include "../qemu.h"
+#include "../utils/machinecloner.h"
+#include "../export-import/machinearchive.h"
+
+class CommandLine : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit CommandLine(QObject *parent = nullptr);
+        ~CommandLine();
+
+        int run(const QStringList &arguments);
+
+    signals:
+
+    public slots:
+
+    protected:
+
+    private:
+        QTextStream m_out;
+        QTextStream m_err;
+
+        // Commands
+        int listMachines(bool json);
+        int showStatus(const QString &machine, bool json);
+        int startMachine(const QString &machine, bool foreground);
+        int stopMachine(const QString &machine, bool force);
+        int cloneMachine(const QString &machine, const QString &cloneName, bool fullClone);
+        int exportMachine(const QString &machine, const QString &archivePath);
+        int runDaemon();
+
+        // Methods
+        QHash<QUuid, QString> machineStates(const QList<QJsonObject> &entries);
+        QJsonObject callControlServer(const QString &method, const QJsonObject &params, QString &error);
+        Machine *loadMachine(const QJsonObject &entry, QString &error);
+        int runForeground(Machine *machine);
+        void printProgress(double progress);
+
+        static QString QMPSocketPath(const QJsonObject &entry);
+};
+
+#endif // COMMANDLINE_H
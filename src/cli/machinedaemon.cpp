@@ -0,0 +1,115 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machinedaemon.h"
+
+/**
+ * @brief Machine daemon
+ * @param parent, parent object
+ *
+ * Process without user interface that owns the QEMU
+ * processes of the machines started from the command line.
+ * The machines are controlled through the control server
+ * and started through the launch scheduler. The autostart
+ * machines are started when the daemon starts and the
+ * machines that fail are restarted by the supervisor
+ */
+MachineDaemon::MachineDaemon(QObject *parent) : QObject(parent)
+{
+    this->m_QEMUObject = new QEMU(this);
+
+    this->m_launchScheduler = new LaunchScheduler(m_QEMUObject, this);
+
+    this->m_controlServer = new ControlServer(m_QEMUObject, this);
+    this->m_controlServer->setLaunchScheduler(m_launchScheduler);
+    this->m_controlServer->setMachineLoader([=](const QJsonObject &entry, QString &error) {
+        return this->loadMachine(entry, error);
+    });
+
+    this->m_machineSupervisor = new MachineSupervisor(m_QEMUObject, this);
+
+    this->m_autostartManager = new AutostartManager(m_launchScheduler, this);
+    this->m_autostartManager->setMachineLoader([=](const QJsonObject &entry, QString &error) {
+        return this->loadMachine(entry, error);
+    });
+
+    this->m_metricsSampler = new MetricsSampler(this);
+    this->m_metricsExporter = new MetricsExporter(this);
+    connect(m_metricsSampler, &MetricsSampler::machineSampled,
+            m_metricsExporter, &MetricsExporter::machineSampled);
+
+    qDebug() << "MachineDaemon created";
+}
+
+MachineDaemon::~MachineDaemon()
+{
+    qDebug() << "MachineDaemon destroyed";
+}
+
+/**
+ * @brief Listen for requests
+ * @param error, description of the error
+ * @return true if the socket is open
+ *
+ * Open the socket of the control server and
+ * start the autostart machines
+ */
+bool MachineDaemon::listen(QString &error)
+{
+    if (!this->m_controlServer->listen(error)) {
+        return false;
+    }
+
+    this->m_autostartManager->start();
+
+    return true;
+}
+
+/**
+ * @brief Load a machine
+ * @param entry, entry of the machine in the registry
+ * @param error, description of the error
+ * @return machine, nullptr if it cannot be loaded
+ *
+ * Load the config of a machine the first time it's used
+ */
+Machine *MachineDaemon::loadMachine(const QJsonObject &entry, QString &error)
+{
+    QUuid machineUuid(entry["uuid"].toString());
+    if (this->m_machines.contains(machineUuid)) {
+        return this->m_machines.value(machineUuid);
+    }
+
+    QString machineConfigPath = entry["configpath"].toString();
+    QJsonObject machineJSON = MachineUtils::parseMachineFile(machineConfigPath, error);
+    if (!error.isEmpty()) {
+        return nullptr;
+    }
+
+    Machine *newMachine = new Machine(this);
+    MachineUtils::fillMachineObject(newMachine, machineJSON, machineConfigPath);
+    this->m_machines.insert(machineUuid, newMachine);
+    this->m_metricsSampler->addMachine(newMachine);
+    this->m_metricsExporter->addMachine(newMachine);
+    this->m_machineSupervisor->addMachine(newMachine);
+
+    return newMachine;
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINEDAEMON_H
+#define MACHINEDAEMON_H
+
+// Qt
+#include <QObject>
+#include <QHash>
+#include <QUuid>
+#include <QJsonObject>
+#include <QDebug>
+
+// Local
+#include "../machine.h"
+#include "../machineutils.h"
+#include "../qemu.h"
+#include "../controlserver.h"
+#include "../launchscheduler.h"
+#include "../autostartmanager.h"
+#include "../machinesupervisor.h"
+#include "../metricssampler.h"
+#include "../metricsexporter.h"
+
+class MachineDaemon : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MachineDaemon(QObject *parent = nullptr);
+        ~MachineDaemon();
+
+        bool listen(QString &error);
+
+    signals:
+
+    public slots:
+
+    private slots:
+
+    protected:
+
+    private:
+        QEMU *m_QEMUObject;
+        ControlServer *m_controlServer;
+        LaunchScheduler *m_launchScheduler;
+        AutostartManager *m_autostartManager;
+        MachineSupervisor *m_machineSupervisor;
+        QHash<QUuid, Machine *> m_machines;
+        MetricsSampler *m_metricsSampler;
+        MetricsExporter *m_metricsExporter;
+
+        // Methods
+        Machine *loadMachine(const QJsonObject &entry, QString &error);
+};
+
+#endif // MACHINEDAEMON_H
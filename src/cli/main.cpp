@@ -0,0 +1,73 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Qt
+#include <QCoreApplication>
+#include <QSettings>
+#include <QDir>
+#include <QTextStream>
+
+// Local
+#include "commandline.h"
+#include "../utils/errorreporter.h"
+#include "../utils/logger.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication qtemuApp(argc, argv);
+    qtemuApp.setApplicationName("QtEmu");
+    qtemuApp.setApplicationVersion("2.2");
+    qtemuApp.setOrganizationName("QtEmu");
+    qtemuApp.setOrganizationDomain("https://www.qtemu.org");
+
+    QSettings settings;
+
+    // Data folder. Same folder than the graphical interface
+    settings.beginGroup("DataFolder");
+    if (!settings.contains("QtEmuData")) {
+        QString dataDirectoryPath = QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/");
+        QString dataDirectoryLogs = QDir::toNativeSeparators(dataDirectoryPath + "logs");
+
+        QDir dataDirectory;
+        dataDirectory.mkpath(dataDirectoryLogs);
+
+        settings.setValue("QtEmuData", dataDirectoryPath);
+        settings.setValue("QtEmuLogs", dataDirectoryLogs);
+    }
+    settings.endGroup();
+    settings.sync();
+
+    // Errors are written in the error output instead of dialogs
+    ErrorReporter::setHandler([](const QString &title, const QString &text,
+                                 ErrorReporter::Severity severity) {
+        Q_UNUSED(severity)
+
+        QTextStream errorStream(stderr);
+        errorStream << title << ": " << ErrorReporter::plainText(text) << "\n";
+    });
+
+    CommandLine commandLine;
+    int exitCode = commandLine.run(qtemuApp.arguments());
+
+    // Write the pending messages
+    Logger::shutdown();
+
+    return exitCode;
+}
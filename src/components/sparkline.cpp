@@ -0,0 +1,158 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "sparkline.h"
+
+// Width of the text with the last value
+static const int TEXT_WIDTH = 110;
+
+/**
+ * @brief Small chart of the last values
+ * @param parent, parent widget
+ *
+ * Line with the last values of a metric, without axes,
+ * and the text of the last value at the right
+ */
+Sparkline::Sparkline(QWidget *parent) : QWidget(parent)
+{
+    this->m_capacity = 0;
+    this->m_minimumRange = 0;
+    this->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+
+    qDebug() << "Sparkline created";
+}
+
+Sparkline::~Sparkline()
+{
+    qDebug() << "Sparkline destroyed";
+}
+
+/**
+ * @brief Set the values of the chart
+ * @param values, values, the oldest first
+ * @param capacity, maximum number of values. The chart
+ * fills from the right while there are less values
+ *
+ * Set the values of the chart
+ */
+void Sparkline::setValues(const QVector<double> &values, int capacity)
+{
+    this->m_values = values;
+    this->m_capacity = qMax(capacity, static_cast<int>(values.size()));
+    this->update();
+}
+
+/**
+ * @brief Set the minimum range of the chart
+ * @param range, value shown at the top when all the values are lower
+ *
+ * Set the minimum range, so small changes
+ * don't fill the whole chart. Ex: 100 for percentages
+ */
+void Sparkline::setMinimumRange(double range)
+{
+    this->m_minimumRange = range;
+}
+
+/**
+ * @brief Set the text of the last value
+ * @param text, text of the last value
+ *
+ * Set the text of the last value
+ */
+void Sparkline::setText(const QString &text)
+{
+    this->m_text = text;
+    this->update();
+}
+
+/**
+ * @brief Remove the values and the text
+ *
+ * Remove the values and the text
+ */
+void Sparkline::clear()
+{
+    this->m_values.clear();
+    this->m_text.clear();
+    this->update();
+}
+
+/**
+ * @brief Get the preferred size
+ * @return preferred size of the chart
+ *
+ * Get the preferred size of the chart
+ */
+QSize Sparkline::sizeHint() const
+{
+    return QSize(120 + TEXT_WIDTH, this->fontMetrics().height() + 6);
+}
+
+/**
+ * @brief Paint the chart
+ * @param event, paint event
+ *
+ * Paint the line of the values and the text of the last value
+ */
+void Sparkline::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QRectF chartRect(0.5, 1.5, qMax(10, this->width() - TEXT_WIDTH) - 1.0, this->height() - 3.0);
+
+    painter.setPen(this->palette().color(QPalette::Mid));
+    painter.drawLine(chartRect.bottomLeft(), chartRect.bottomRight());
+
+    if (this->m_values.size() > 1) {
+        double maxValue = this->m_minimumRange;
+        foreach (double value, this->m_values) {
+            maxValue = qMax(maxValue, value);
+        }
+        if (maxValue <= 0) {
+            maxValue = 1;
+        }
+
+        double step = chartRect.width() / qMax(1, this->m_capacity - 1);
+        double x = chartRect.right() - step * (this->m_values.size() - 1);
+
+        QPainterPath path;
+        for (int i = 0; i < this->m_values.size(); ++i) {
+            QPointF point(x + step * i,
+                          chartRect.bottom() - chartRect.height() * this->m_values.at(i) / maxValue);
+            if (i == 0) {
+                path.moveTo(point);
+            } else {
+                path.lineTo(point);
+            }
+        }
+
+        painter.setPen(QPen(this->palette().color(QPalette::Highlight), 1.5));
+        painter.drawPath(path);
+    }
+
+    painter.setPen(this->palette().color(QPalette::Text));
+    painter.drawText(QRectF(chartRect.right() + 8, 0, TEXT_WIDTH - 8, this->height()),
+                     Qt::AlignLeft | Qt::AlignVCenter, this->m_text);
+}
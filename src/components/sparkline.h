@@ -0,0 +1,57 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SPARKLINE_H
+#define SPARKLINE_H
+
+// Qt
+#include <QWidget>
+#include <QPainter>
+#include <QPainterPath>
+#include <QVector>
+
+#include <QDebug>
+
+class Sparkline: public QWidget {
+    Q_OBJECT
+
+    public:
+        Sparkline(QWidget *parent = nullptr);
+        ~Sparkline() override;
+
+        void setValues(const QVector<double> &values, int capacity);
+        void setMinimumRange(double range);
+        void setText(const QString &text);
+        void clear();
+
+        QSize sizeHint() const override;
+
+    protected:
+        void paintEvent(QPaintEvent *event) override;
+
+    private:
+        QVector<double> m_values;
+        int m_capacity;
+        double m_minimumRange;
+        QString m_text;
+
+};
+
+#endif // SPARKLINE_H
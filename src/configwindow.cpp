@@ -39,6 +39,9 @@ ConfigWindow::ConfigWindow(QEMU *QEMUGlobalObject, QWidget *parent) : QWidget(pa
     this->setMinimumSize(640, 520);
 
     this->m_QEMUObject = QEMUGlobalObject;
+    // The binaries are searched in the background
+    connect(m_QEMUObject, &QEMU::QEMUBinariesChanged,
+            this, &ConfigWindow::insertBinariesInTree);
 
     this->createGeneralPage();
     this->createUpdatePage();
@@ -220,6 +223,106 @@ void ConfigWindow::createGeneralPage()
     m_machinePathGroup->setLayout(m_groupLayout);
     m_machinePathGroup->setFlat(false);
 
+    m_logSeverityLabel = new QLabel(tr("Log level") + ":", this);
+    m_logSeverityComboBox = new QComboBox(this);
+    m_logSeverityComboBox->addItem(tr("Debug"), Logger::Debug);
+    m_logSeverityComboBox->addItem(tr("Information"), Logger::Info);
+    m_logSeverityComboBox->addItem(tr("Warning"), Logger::Warning);
+    m_logSeverityComboBox->addItem(tr("Error"), Logger::Error);
+    m_logSeverityComboBox->setToolTip(tr("Messages below this level aren't written in the QtEmu log"));
+
+    m_logSeverityLayout = new QHBoxLayout();
+    m_logSeverityLayout->setAlignment(Qt::AlignLeft);
+    m_logSeverityLayout->addWidget(m_logSeverityLabel);
+    m_logSeverityLayout->addWidget(m_logSeverityComboBox);
+
+    m_controlServerCheckBox = new QCheckBox(tr("Control the machines from scripts"), this);
+    m_controlServerCheckBox->setToolTip(tr("JSON-RPC server in the qtemu.sock socket of the QtEmu data folder"));
+
+    m_metricsIntervalLabel = new QLabel(tr("Resource usage interval") + ":", this);
+    m_metricsIntervalSpinBox = new QSpinBox(this);
+    m_metricsIntervalSpinBox->setMinimum(500);
+    m_metricsIntervalSpinBox->setMaximum(60000);
+    m_metricsIntervalSpinBox->setSingleStep(500);
+    m_metricsIntervalSpinBox->setSuffix(" ms");
+    m_metricsIntervalSpinBox->setToolTip(tr("Time between two samples of the resource usage of the running machines"));
+
+    m_metricsIntervalLayout = new QHBoxLayout();
+    m_metricsIntervalLayout->setAlignment(Qt::AlignLeft);
+    m_metricsIntervalLayout->addWidget(m_metricsIntervalLabel);
+    m_metricsIntervalLayout->addWidget(m_metricsIntervalSpinBox);
+
+    m_metricsHTTPCheckBox = new QCheckBox(this);
+    m_metricsHTTPCheckBox->setToolTip(tr("Expose the metrics of the machines in /metrics for Prometheus"));
+
+    m_metricsAddressLineEdit = new QLineEdit(this);
+    m_metricsAddressLineEdit->setPlaceholderText("127.0.0.1");
+
+    m_metricsPortSpinBox = new QSpinBox(this);
+    m_metricsPortSpinBox->setMinimum(1);
+    m_metricsPortSpinBox->setMaximum(65535);
+
+    connect(m_metricsHTTPCheckBox, &QAbstractButton::toggled,
+            m_metricsAddressLineEdit, &QWidget::setEnabled);
+    connect(m_metricsHTTPCheckBox, &QAbstractButton::toggled,
+            m_metricsPortSpinBox, &QWidget::setEnabled);
+
+    m_metricsTextfileLineEdit = new QLineEdit(this);
+    m_metricsTextfileLineEdit->setPlaceholderText("/var/lib/node_exporter/textfile/qtemu.prom");
+    m_metricsTextfileLineEdit->setToolTip(tr("File for the textfile collector of node_exporter. Empty to disable it"));
+
+    m_metricsExportLayout = new QFormLayout();
+    m_metricsExportLayout->addRow(tr("HTTP endpoint") + ":", m_metricsHTTPCheckBox);
+    m_metricsExportLayout->addRow(tr("Address") + ":", m_metricsAddressLineEdit);
+    m_metricsExportLayout->addRow(tr("Port") + ":", m_metricsPortSpinBox);
+    m_metricsExportLayout->addRow(tr("Textfile") + ":", m_metricsTextfileLineEdit);
+
+    m_metricsGroupLayout = new QVBoxLayout();
+    m_metricsGroupLayout->setAlignment(Qt::AlignTop);
+    m_metricsGroupLayout->addItem(m_metricsIntervalLayout);
+    m_metricsGroupLayout->addItem(m_metricsExportLayout);
+
+    m_metricsGroup = new QGroupBox(tr("Metrics"), this);
+    m_metricsGroup->setLayout(m_metricsGroupLayout);
+    m_metricsGroup->setFlat(false);
+
+    m_launchConcurrencySpinBox = new QSpinBox(this);
+    m_launchConcurrencySpinBox->setMinimum(1);
+    m_launchConcurrencySpinBox->setMaximum(64);
+    m_launchConcurrencySpinBox->setToolTip(tr("Machines booting at the same time"));
+
+    m_launchStaggerSpinBox = new QSpinBox(this);
+    m_launchStaggerSpinBox->setMinimum(0);
+    m_launchStaggerSpinBox->setMaximum(60000);
+    m_launchStaggerSpinBox->setSingleStep(100);
+    m_launchStaggerSpinBox->setSuffix(" ms");
+    m_launchStaggerSpinBox->setToolTip(tr("Time between the start of two machines"));
+
+    m_launchMemoryReserveSpinBox = new QSpinBox(this);
+    m_launchMemoryReserveSpinBox->setMinimum(0);
+    m_launchMemoryReserveSpinBox->setMaximum(1048576);
+    m_launchMemoryReserveSpinBox->setSingleStep(256);
+    m_launchMemoryReserveSpinBox->setSuffix(" MiB");
+    m_launchMemoryReserveSpinBox->setToolTip(tr("Memory of the host that is never given to the machines"));
+
+    m_launchMaxLoadSpinBox = new QDoubleSpinBox(this);
+    m_launchMaxLoadSpinBox->setMinimum(0);
+    m_launchMaxLoadSpinBox->setMaximum(64);
+    m_launchMaxLoadSpinBox->setSingleStep(0.1);
+    m_launchMaxLoadSpinBox->setDecimals(1);
+    m_launchMaxLoadSpinBox->setSpecialValueText(tr("No limit"));
+    m_launchMaxLoadSpinBox->setToolTip(tr("Load average per CPU above which the machines wait to be started"));
+
+    m_launchGroupLayout = new QFormLayout();
+    m_launchGroupLayout->addRow(tr("Concurrent starts") + ":", m_launchConcurrencySpinBox);
+    m_launchGroupLayout->addRow(tr("Interval") + ":", m_launchStaggerSpinBox);
+    m_launchGroupLayout->addRow(tr("Reserved memory") + ":", m_launchMemoryReserveSpinBox);
+    m_launchGroupLayout->addRow(tr("Maximum load") + ":", m_launchMaxLoadSpinBox);
+
+    m_launchGroup = new QGroupBox(tr("Start of several machines"), this);
+    m_launchGroup->setLayout(m_launchGroupLayout);
+    m_launchGroup->setFlat(false);
+
     m_generalPageLayout = new QVBoxLayout();
     m_generalPageLayout->setAlignment(Qt::AlignTop);
     m_generalPageLayout->addWidget(m_machinePathGroup);
@@ -227,6 +330,10 @@ void ConfigWindow::createGeneralPage()
     m_generalPageLayout->addItem(m_machineSocketLayout);
     m_generalPageLayout->addItem(m_machinePortSocketLayout);
 #endif
+    m_generalPageLayout->addItem(m_logSeverityLayout);
+    m_generalPageLayout->addWidget(m_controlServerCheckBox);
+    m_generalPageLayout->addWidget(m_metricsGroup);
+    m_generalPageLayout->addWidget(m_launchGroup);
 
     m_generalPageWidget = new QWidget(this);
     m_generalPageWidget->setLayout(m_generalPageLayout);
@@ -444,10 +551,22 @@ void ConfigWindow::createQEMUPage()
     m_binaryLayout->addWidget(m_binariesPathToolButton);
     m_binaryLayout->addWidget(m_searchBinariesToolButton);
 
+    m_QEMUImgJobsLabel = new QLabel(tr("Parallel qemu-img jobs") + ":", this);
+    m_QEMUImgJobsSpinBox = new QSpinBox(this);
+    m_QEMUImgJobsSpinBox->setMinimum(1);
+    m_QEMUImgJobsSpinBox->setMaximum(16);
+    m_QEMUImgJobsSpinBox->setToolTip(tr("Maximum number of qemu-img operations running at the same time"));
+
+    m_QEMUImgJobsLayout = new QHBoxLayout();
+    m_QEMUImgJobsLayout->setAlignment(Qt::AlignLeft);
+    m_QEMUImgJobsLayout->addWidget(m_QEMUImgJobsLabel);
+    m_QEMUImgJobsLayout->addWidget(m_QEMUImgJobsSpinBox);
+
     m_QEMULayout = new QVBoxLayout();
     m_QEMULayout->addItem(m_binaryLabelLayout);
     m_QEMULayout->addItem(m_binaryLayout);
     m_QEMULayout->addWidget(m_binariesTableWidget);
+    m_QEMULayout->addItem(m_QEMUImgJobsLayout);
 
     m_QEMUPageWidget = new QWidget(this);
     m_QEMUPageWidget->setLayout(m_QEMULayout);
@@ -693,10 +812,34 @@ void ConfigWindow::saveSettings()
     settings.setValue("qemuBinaryPath", this->m_binaryPathLineEdit->text());
     this->m_QEMUObject->setQEMUBinaries(this->m_binaryPathLineEdit->text());
     this->m_QEMUObject->setQEMUImgPath(this->m_binaryPathLineEdit->text());
+    settings.setValue("qemuImgJobs", this->m_QEMUImgJobsSpinBox->value());
+    this->m_QEMUObject->QEMUImgJobs()->setMaxJobs(this->m_QEMUImgJobsSpinBox->value());
+
+    // Log
+    settings.setValue("logSeverity", this->m_logSeverityComboBox->currentData().toInt());
+    Logger::setMinimumSeverity(static_cast<Logger::Severity>(this->m_logSeverityComboBox->currentData().toInt()));
+
+    // Control server
+    settings.setValue("controlServer", this->m_controlServerCheckBox->isChecked());
+
+    // Resource usage
+    settings.setValue("metricsInterval", this->m_metricsIntervalSpinBox->value());
+    settings.setValue("metricsHTTP", this->m_metricsHTTPCheckBox->isChecked());
+    settings.setValue("metricsAddress", this->m_metricsAddressLineEdit->text().trimmed());
+    settings.setValue("metricsPort", this->m_metricsPortSpinBox->value());
+    settings.setValue("metricsTextfile", this->m_metricsTextfileLineEdit->text().trimmed());
+
+    // Launch scheduler
+    settings.setValue("launchConcurrency", this->m_launchConcurrencySpinBox->value());
+    settings.setValue("launchStagger", this->m_launchStaggerSpinBox->value());
+    settings.setValue("launchMemoryReserve", this->m_launchMemoryReserveSpinBox->value());
+    settings.setValue("launchMaxLoad", this->m_launchMaxLoadSpinBox->value());
 
     settings.endGroup();
     settings.sync();
 
+    emit(settingsSavedSignal());
+
     this->hide();
 
     qDebug() << "ConfigWindow: settings saved";
@@ -752,6 +895,29 @@ void ConfigWindow::loadSettings()
     this->binaryPathChanged(settings.value("qemuBinaryPath", "").toString());
     this->m_binaryPathLineEdit->setText(settings.value("qemuBinaryPath", "").toString());
     this->insertBinariesInTree();
+    this->m_QEMUImgJobsSpinBox->setValue(settings.value("qemuImgJobs", 2).toInt());
+
+    // Log
+    this->m_logSeverityComboBox->setCurrentIndex(
+                this->m_logSeverityComboBox->findData(settings.value("logSeverity", Logger::Info).toInt()));
+
+    // Control server
+    this->m_controlServerCheckBox->setChecked(settings.value("controlServer", true).toBool());
+
+    // Resource usage
+    this->m_metricsIntervalSpinBox->setValue(settings.value("metricsInterval", 2000).toInt());
+    this->m_metricsHTTPCheckBox->setChecked(settings.value("metricsHTTP", false).toBool());
+    this->m_metricsAddressLineEdit->setText(settings.value("metricsAddress", "127.0.0.1").toString());
+    this->m_metricsPortSpinBox->setValue(settings.value("metricsPort", 9477).toInt());
+    this->m_metricsTextfileLineEdit->setText(settings.value("metricsTextfile", "").toString());
+    this->m_metricsAddressLineEdit->setEnabled(this->m_metricsHTTPCheckBox->isChecked());
+    this->m_metricsPortSpinBox->setEnabled(this->m_metricsHTTPCheckBox->isChecked());
+
+    // Launch scheduler
+    this->m_launchConcurrencySpinBox->setValue(settings.value("launchConcurrency", 4).toInt());
+    this->m_launchStaggerSpinBox->setValue(settings.value("launchStagger", 500).toInt());
+    this->m_launchMemoryReserveSpinBox->setValue(settings.value("launchMemoryReserve", 1024).toInt());
+    this->m_launchMaxLoadSpinBox->setValue(settings.value("launchMaxLoad", 2.0).toDouble());
 
     settings.endGroup();
 }
@@ -50,11 +50,13 @@
 #include <QToolButton>
 #include <QFileDialog>
 #include <QSpinBox>
+#include <QDoubleSpinBox>
 
 #include <QDebug>
 
 // Local
 #include "qemu.h"
+#include "utils/logger.h"
 
 class ConfigWindow : public QWidget {
     Q_OBJECT
@@ -65,11 +67,13 @@ class ConfigWindow : public QWidget {
         ~ConfigWindow();
 
     signals:
+        void settingsSavedSignal();
 
     public slots:
 
     private slots:
         void closeEvent (QCloseEvent *event);
+        void insertBinariesInTree();
         void toggleUpdate(bool updateState);
         void pushStableVersion(bool release);
         void pushBetaVersion(bool release);
@@ -129,6 +133,31 @@ class ConfigWindow : public QWidget {
 
         QSpinBox *m_monitorSocketSpinBox;
 
+        QHBoxLayout *m_logSeverityLayout;
+        QLabel *m_logSeverityLabel;
+        QComboBox *m_logSeverityComboBox;
+
+        QCheckBox *m_controlServerCheckBox;
+
+        QHBoxLayout *m_metricsIntervalLayout;
+        QLabel *m_metricsIntervalLabel;
+        QSpinBox *m_metricsIntervalSpinBox;
+
+        QGroupBox *m_metricsGroup;
+        QVBoxLayout *m_metricsGroupLayout;
+        QFormLayout *m_metricsExportLayout;
+        QCheckBox *m_metricsHTTPCheckBox;
+        QLineEdit *m_metricsAddressLineEdit;
+        QSpinBox *m_metricsPortSpinBox;
+        QLineEdit *m_metricsTextfileLineEdit;
+
+        QGroupBox *m_launchGroup;
+        QFormLayout *m_launchGroupLayout;
+        QSpinBox *m_launchConcurrencySpinBox;
+        QSpinBox *m_launchStaggerSpinBox;
+        QSpinBox *m_launchMemoryReserveSpinBox;
+        QDoubleSpinBox *m_launchMaxLoadSpinBox;
+
         // Update QtEmu page
         QFormLayout *m_updatePageLayout;
         QVBoxLayout *m_updateRadiosLayout;
@@ -193,6 +222,11 @@ class ConfigWindow : public QWidget {
         QLineEdit *m_binaryPathLineEdit;
 
         QLabel *m_QEMUImgLabel;
+        QLabel *m_QEMUImgJobsLabel;
+
+        QSpinBox *m_QEMUImgJobsSpinBox;
+
+        QHBoxLayout *m_QEMUImgJobsLayout;
 
         QTableWidget *m_binariesTableWidget;
 
@@ -208,7 +242,6 @@ class ConfigWindow : public QWidget {
         void createStartPage();
         void createProxyPage();
         void createQEMUPage();
-        void insertBinariesInTree();
 };
 
 #endif // CONFIGWINDOW_H
@@ -0,0 +1,181 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "consolewindow.h"
+
+// Time between two updates of the view. The output that arrives
+// in the meantime is rendered in one go
+static const int RENDER_INTERVAL = 100;
+
+// Lines kept in the view
+static const int MAX_LINES = 5000;
+
+/**
+ * @brief Console of the machine
+ * @param machine, machine
+ * @param parent, parent widget
+ *
+ * Live view of the output of QEMU. Only the output
+ * added since the last update is rendered
+ */
+ConsoleWindow::ConsoleWindow(Machine *machine,
+                             QWidget *parent) : QWidget(parent)
+{
+    this->setWindowTitle(tr("Console") + " - " + machine->getName());
+    this->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
+    this->setWindowFlags(Qt::Window);
+    this->setAttribute(Qt::WA_DeleteOnClose);
+    this->setMinimumSize(640, 400);
+
+    this->m_consoleBuffer = machine->getConsole();
+    this->m_lastSequence = 0;
+    this->m_standardOutDecoder = QStringDecoder(QStringDecoder::Utf8);
+    this->m_standardErrorDecoder = QStringDecoder(QStringDecoder::Utf8);
+
+    this->m_standardErrorFormat.setForeground(Qt::red);
+    this->m_infoFormat.setForeground(this->palette().brush(QPalette::Disabled, QPalette::Text));
+    this->m_infoFormat.setFontItalic(true);
+
+    m_consoleTextEdit = new QPlainTextEdit(this);
+    m_consoleTextEdit->setReadOnly(true);
+    m_consoleTextEdit->setUndoRedoEnabled(false);
+    m_consoleTextEdit->setLineWrapMode(QPlainTextEdit::NoWrap);
+    m_consoleTextEdit->setMaximumBlockCount(MAX_LINES);
+    m_consoleTextEdit->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    m_followCheckBox = new QCheckBox(tr("Follow the output"), this);
+    m_followCheckBox->setChecked(true);
+
+    m_clearButton = new QPushButton(QIcon::fromTheme("edit-clear"), tr("Clear"), this);
+    connect(m_clearButton, &QAbstractButton::clicked,
+            this, &ConsoleWindow::clearConsole);
+
+    m_closeButton = new QPushButton(QIcon::fromTheme("window-close",
+                                                     QIcon(QPixmap(":/images/icons/breeze/32x32/window-close.svg"))),
+                                    tr("Close"), this);
+    connect(m_closeButton, &QAbstractButton::clicked,
+            this, &QWidget::close);
+
+    m_buttonsLayout = new QHBoxLayout();
+    m_buttonsLayout->addWidget(m_followCheckBox);
+    m_buttonsLayout->addStretch();
+    m_buttonsLayout->addWidget(m_clearButton);
+    m_buttonsLayout->addWidget(m_closeButton);
+
+    m_mainLayout = new QVBoxLayout();
+    m_mainLayout->addWidget(m_consoleTextEdit);
+    m_mainLayout->addItem(m_buttonsLayout);
+
+    this->setLayout(m_mainLayout);
+
+    m_renderTimer = new QTimer(this);
+    m_renderTimer->setSingleShot(true);
+    m_renderTimer->setInterval(RENDER_INTERVAL);
+    connect(m_renderTimer, &QTimer::timeout,
+            this, &ConsoleWindow::renderChunks);
+
+    connect(m_consoleBuffer, &ConsoleBuffer::chunkAppended,
+            this, &ConsoleWindow::scheduleRender);
+    // The machine is gone, nothing more to show
+    connect(m_consoleBuffer, &QObject::destroyed,
+            this, &QWidget::close);
+
+    this->renderChunks();
+
+    qDebug() << "ConsoleWindow created";
+}
+
+ConsoleWindow::~ConsoleWindow()
+{
+    qDebug() << "ConsoleWindow destroyed";
+}
+
+/**
+ * @brief New output available
+ *
+ * Update the view after a short time, so the chunks
+ * that arrive together are rendered at once
+ */
+void ConsoleWindow::scheduleRender()
+{
+    if (!this->m_renderTimer->isActive()) {
+        this->m_renderTimer->start();
+    }
+}
+
+/**
+ * @brief Render the new output
+ *
+ * Add the chunks of the buffer that aren't
+ * in the view yet
+ */
+void ConsoleWindow::renderChunks()
+{
+    bool truncated = false;
+    QList<ConsoleChunk> chunks = this->m_consoleBuffer->chunksSince(this->m_lastSequence, &truncated);
+    if (chunks.isEmpty()) {
+        return;
+    }
+
+    QScrollBar *scrollBar = this->m_consoleTextEdit->verticalScrollBar();
+    int scrollPosition = scrollBar->value();
+
+    QTextCursor cursor(this->m_consoleTextEdit->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+
+    if (truncated && this->m_lastSequence > 0) {
+        cursor.insertText(tr("[Output dropped, the console buffer is full]") + "\n", this->m_infoFormat);
+    }
+
+    foreach (const ConsoleChunk &chunk, chunks) {
+        if (chunk.channel == ConsoleBuffer::StandardError) {
+            cursor.insertText(ConsoleBuffer::cleanText(this->m_standardErrorDecoder.decode(chunk.data)),
+                              this->m_standardErrorFormat);
+        } else if (chunk.channel == ConsoleBuffer::Info) {
+            cursor.insertText(QString::fromUtf8(chunk.data), this->m_infoFormat);
+        } else {
+            cursor.insertText(ConsoleBuffer::cleanText(this->m_standardOutDecoder.decode(chunk.data)),
+                              this->m_standardOutFormat);
+        }
+    }
+
+    cursor.endEditBlock();
+    this->m_lastSequence = chunks.last().sequence;
+
+    if (this->m_followCheckBox->isChecked()) {
+        scrollBar->setValue(scrollBar->maximum());
+    } else {
+        scrollBar->setValue(scrollPosition);
+    }
+}
+
+/**
+ * @brief Clear the view
+ *
+ * Clear the view. Only the output that arrives
+ * later is shown
+ */
+void ConsoleWindow::clearConsole()
+{
+    this->m_consoleTextEdit->clear();
+    this->m_lastSequence = this->m_consoleBuffer->lastSequence();
+}
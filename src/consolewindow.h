@@ -0,0 +1,85 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CONSOLEWINDOW_H
+#define CONSOLEWINDOW_H
+
+// Qt
+#include <QWidget>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QCheckBox>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QStringDecoder>
+#include <QScrollBar>
+#include <QFontDatabase>
+#include <QTimer>
+#include <QDebug>
+
+// Local
+#include "machine.h"
+#include "utils/consolebuffer.h"
+
+class ConsoleWindow : public QWidget {
+    Q_OBJECT
+
+    public:
+        explicit ConsoleWindow(Machine *machine,
+                               QWidget *parent = nullptr);
+        ~ConsoleWindow();
+
+    signals:
+
+    public slots:
+
+    private slots:
+        void scheduleRender();
+        void renderChunks();
+        void clearConsole();
+
+    protected:
+
+    private:
+        QVBoxLayout *m_mainLayout;
+        QHBoxLayout *m_buttonsLayout;
+
+        QPlainTextEdit *m_consoleTextEdit;
+
+        QCheckBox *m_followCheckBox;
+        QPushButton *m_clearButton;
+        QPushButton *m_closeButton;
+
+        QTimer *m_renderTimer;
+
+        ConsoleBuffer *m_consoleBuffer;
+        qint64 m_lastSequence;
+
+        QStringDecoder m_standardOutDecoder;
+        QStringDecoder m_standardErrorDecoder;
+
+        QTextCharFormat m_standardOutFormat;
+        QTextCharFormat m_standardErrorFormat;
+        QTextCharFormat m_infoFormat;
+};
+
+#endif // CONSOLEWINDOW_H
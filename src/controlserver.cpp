@@ -0,0 +1,1030 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "controlserver.h"
+
+// Maximum size of a request. A batch to control hundreds
+// of machines is a few dozens of KiB
+static const int MAX_REQUEST_SIZE = 1024 * 1024;
+
+/**
+ * @brief Control server
+ * @param QEMUObject, QEMU object used to start the machines
+ * @param parent, parent object
+ *
+ * JSON-RPC 2.0 server in a local socket to control the
+ * machines from scripts. Requests and responses are one
+ * JSON document per line. Requests can be pipelined and the
+ * responses are written as soon as every operation is
+ * finished, also the responses of a batch, so they must be
+ * matched by id. The clients can subscribe to the state
+ * changes of the machines, sent as notifications.
+ * With a launch scheduler, the machines are started
+ * through its queue
+ */
+ControlServer::ControlServer(QEMU *QEMUObject, QObject *parent) : QObject(parent)
+{
+    this->m_QEMUObject = QEMUObject;
+    this->m_nextOperationId = 0;
+
+    this->m_server = new QLocalServer(this);
+    this->m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection,
+            this, &ControlServer::newConnection);
+
+    qDebug() << "ControlServer created";
+}
+
+ControlServer::~ControlServer()
+{
+    this->close();
+
+    qDebug() << "ControlServer destroyed";
+}
+
+/**
+ * @brief Listen for requests
+ * @param error, description of the error
+ * @return true if the socket is open
+ *
+ * Open the local socket. A socket left by
+ * a process that crashed is removed
+ */
+bool ControlServer::listen(QString &error)
+{
+    QString serverPath = ControlServer::socketPath();
+
+    if (ControlServer::serverRunning()) {
+        error = tr("Another QtEmu process is listening in %1").arg(serverPath);
+        return false;
+    }
+
+    QLocalServer::removeServer(serverPath);
+    if (!this->m_server->listen(serverPath)) {
+        error = this->m_server->errorString();
+        return false;
+    }
+
+    Logger::logQtemuAction("QtEmu control server listening in " + serverPath);
+
+    return true;
+}
+
+/**
+ * @brief Check if a control server is running
+ * @return true if a QtEmu process is listening in the socket
+ *
+ * Check if a QtEmu process is listening in the socket
+ */
+bool ControlServer::serverRunning()
+{
+    QLocalSocket runningServer;
+    runningServer.connectToServer(ControlServer::socketPath());
+
+    return runningServer.waitForConnected(100);
+}
+
+/**
+ * @brief Close the server
+ *
+ * Close the server and disconnect all the clients
+ */
+void ControlServer::close()
+{
+    this->m_server->close();
+    this->m_pendingOperations.clear();
+
+    foreach (QLocalSocket *socket, this->m_clients.keys()) {
+        socket->disconnect(this);
+        socket->abort();
+        socket->deleteLater();
+    }
+    this->m_clients.clear();
+}
+
+/**
+ * @brief Load the settings
+ *
+ * Open or close the server as it's configured
+ * in the graphical interface
+ */
+void ControlServer::loadSettings()
+{
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    bool enabled = settings.value("controlServer", true).toBool();
+    settings.endGroup();
+
+    if (enabled && !this->isListening()) {
+        QString error;
+        if (!this->listen(error)) {
+            Logger::logQtemuAction("QtEmu control server not available: " + error);
+        }
+    } else if (!enabled && this->isListening()) {
+        this->close();
+    }
+}
+
+/**
+ * @brief Get if the server is listening
+ * @return true if the server is listening
+ *
+ * Get if the server is listening
+ */
+bool ControlServer::isListening() const
+{
+    return this->m_server->isListening();
+}
+
+/**
+ * @brief Add a machine
+ * @param machine, machine
+ *
+ * The machine can be controlled by the clients.
+ * The machines are found by uuid when they're used,
+ * the uuid can be set after the machine is added
+ */
+void ControlServer::addMachine(Machine *machine)
+{
+    if (machine == nullptr || this->m_machines.contains(machine)) {
+        return;
+    }
+
+    this->m_machines.append(machine);
+
+    connect(machine, &Machine::machineStateChangedSignal,
+            this, [=](Machine::States newState) {
+        this->machineStateChanged(machine, newState);
+    });
+    connect(machine, &Machine::machineStartFailedSignal,
+            this, &ControlServer::machineStartFailed);
+}
+
+/**
+ * @brief Remove a machine
+ * @param machineUuid, uuid of the machine
+ *
+ * Remove a machine, usually because it's deleted
+ */
+void ControlServer::removeMachine(const QUuid &machineUuid)
+{
+    QMutableListIterator<QPointer<Machine>> machine(this->m_machines);
+    while (machine.hasNext()) {
+        QPointer<Machine> nextMachine = machine.next();
+        if (nextMachine.isNull()) {
+            machine.remove();
+        } else if (nextMachine->getUuid() == machineUuid) {
+            nextMachine->disconnect(this);
+            machine.remove();
+        }
+    }
+
+    foreach (const PendingOperation &operation, this->takePendingOperations(machineUuid)) {
+        this->sendError(operation.socket, operation.requestId,
+                        ControlServer::MachineNotFound, tr("The machine was removed"));
+    }
+}
+
+/**
+ * @brief Set the machine loader
+ * @param loader, function that loads a machine of the registry
+ *
+ * The loader is called the first time a client uses
+ * a machine that isn't added to the server
+ */
+void ControlServer::setMachineLoader(MachineLoader loader)
+{
+    this->m_machineLoader = loader;
+}
+
+/**
+ * @brief Set the launch scheduler
+ * @param launchScheduler, scheduler used to start the machines
+ *
+ * The machines are started through the queue of the scheduler,
+ * so a script can start many machines without overloading the host
+ */
+void ControlServer::setLaunchScheduler(LaunchScheduler *launchScheduler)
+{
+    if (!this->m_launchScheduler.isNull()) {
+        this->m_launchScheduler->disconnect(this);
+    }
+
+    this->m_launchScheduler = launchScheduler;
+    if (launchScheduler != nullptr) {
+        connect(launchScheduler, &LaunchScheduler::launchStateChanged,
+                this, &ControlServer::machineLaunchStateChanged);
+    }
+}
+
+/**
+ * @brief Get the path of the socket
+ * @return path of the socket
+ *
+ * Get the path of the socket, in the QtEmu data folder
+ */
+QString ControlServer::socketPath()
+{
+    QSettings settings;
+    settings.beginGroup("DataFolder");
+    QString dataDirectoryPath = settings.value("QtEmuData",
+                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
+    settings.endGroup();
+
+    return QDir::toNativeSeparators(QDir(dataDirectoryPath).filePath("qtemu.sock"));
+}
+
+/**
+ * @brief Find a machine in the registry
+ * @param machine, name or uuid of the machine
+ * @param error, description of the error
+ * @return entry of the machine in the registry, empty if it isn't found
+ *
+ * Find a machine by uuid or by name, ignoring the case
+ */
+QJsonObject ControlServer::findMachineEntry(const QString &machine, QString &error)
+{
+    MachineRegistry *registry = MachineRegistry::instance();
+    if (!registry->isLoaded() && !registry->load(error)) {
+        return QJsonObject();
+    }
+
+    QUuid machineUuid(machine);
+    if (!machineUuid.isNull() && registry->contains(machineUuid)) {
+        return registry->machine(machineUuid);
+    }
+
+    QList<QJsonObject> matches;
+    foreach (const QJsonObject &entry, registry->machines()) {
+        if (entry["name"].toString().compare(machine, Qt::CaseInsensitive) == 0) {
+            matches.append(entry);
+        }
+    }
+
+    if (matches.isEmpty()) {
+        error = tr("The machine %1 doesn't exist").arg(machine);
+        return QJsonObject();
+    }
+
+    if (matches.size() > 1) {
+        error = tr("There are %1 machines called %2, use the uuid").arg(matches.size()).arg(machine);
+        return QJsonObject();
+    }
+
+    return matches.first();
+}
+
+/**
+ * @brief Get the status of a machine
+ * @param machine, machine
+ * @return status of the machine in JSON format
+ *
+ * Get the state, the process and the uptime of a machine
+ */
+QJsonObject ControlServer::machineStatus(Machine *machine)
+{
+    QJsonObject status;
+    status["uuid"] = machine->getUuid().toString();
+    status["name"] = machine->getName();
+    status["state"] = ControlServer::stateName(machine->getState());
+    status["pid"] = static_cast<double>(machine->getProcessId());
+    status["uptime"] = static_cast<double>(machine->getUptime() / 1000);
+
+    return status;
+}
+
+/**
+ * @brief Get the name of a state
+ * @param state, state of a machine
+ * @return name of the state
+ *
+ * Get the name of a state, as it's sent to the clients
+ */
+QString ControlServer::stateName(Machine::States state)
+{
+    switch (state) {
+        case Machine::Started:
+            return "started";
+        case Machine::Paused:
+            return "paused";
+        case Machine::Saved:
+            return "saved";
+        default:
+            return "stopped";
+    }
+}
+
+/**
+ * @brief New connection
+ *
+ * Read the requests of the new client
+ */
+void ControlServer::newConnection()
+{
+    while (this->m_server->hasPendingConnections()) {
+        QLocalSocket *socket = this->m_server->nextPendingConnection();
+
+        Client client;
+        client.subscribed = false;
+        this->m_clients.insert(socket, client);
+
+        connect(socket, &QLocalSocket::readyRead,
+                this, [=]() {
+            this->readRequests(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected,
+                this, [=]() {
+            this->m_clients.remove(socket);
+
+            QMutableListIterator<PendingOperation> operations(this->m_pendingOperations);
+            while (operations.hasNext()) {
+                if (operations.next().socket == socket) {
+                    operations.remove();
+                }
+            }
+
+            socket->deleteLater();
+        });
+    }
+}
+
+/**
+ * @brief Read the requests of a client
+ * @param socket, socket of the client
+ *
+ * Process every complete line. A line can
+ * contain a request or a batch of requests
+ */
+void ControlServer::readRequests(QLocalSocket *socket)
+{
+    if (!this->m_clients.contains(socket)) {
+        return;
+    }
+
+    QByteArray buffer = this->m_clients.value(socket).buffer + socket->readAll();
+
+    if (buffer.size() > MAX_REQUEST_SIZE && !buffer.contains('\n')) {
+        socket->abort();
+        return;
+    }
+
+    QList<QByteArray> lines;
+    int newLinePos = buffer.indexOf('\n');
+    while (newLinePos != -1) {
+        QByteArray line = buffer.left(newLinePos).trimmed();
+        buffer.remove(0, newLinePos + 1);
+        if (!line.isEmpty()) {
+            lines.append(line);
+        }
+        newLinePos = buffer.indexOf('\n');
+    }
+    this->m_clients[socket].buffer = buffer;
+
+    foreach (const QByteArray &line, lines) {
+        QJsonParseError parseError;
+        QJsonDocument request = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError) {
+            this->sendError(socket, QJsonValue(QJsonValue::Null),
+                            ControlServer::ParseError, parseError.errorString());
+            continue;
+        }
+
+        QJsonArray batch;
+        if (request.isArray()) {
+            batch = request.array();
+            if (batch.isEmpty()) {
+                this->sendError(socket, QJsonValue(QJsonValue::Null),
+                                ControlServer::InvalidRequest, tr("Empty batch"));
+            }
+        } else {
+            batch.append(request.object());
+        }
+
+        foreach (const QJsonValue &batchRequest, batch) {
+            // The client can be disconnected while it's answered
+            if (!this->m_clients.contains(socket)) {
+                return;
+            }
+            this->processRequest(socket, batchRequest);
+        }
+    }
+}
+
+/**
+ * @brief Process a request
+ * @param socket, socket of the client
+ * @param request, request of the client
+ *
+ * Check the request and call the method.
+ * The notifications, requests without id, aren't answered
+ */
+void ControlServer::processRequest(QLocalSocket *socket, const QJsonValue &request)
+{
+    if (!request.isObject()) {
+        this->sendError(socket, QJsonValue(QJsonValue::Null),
+                        ControlServer::InvalidRequest, tr("The request must be an object"));
+        return;
+    }
+
+    QJsonObject requestObject = request.toObject();
+    QJsonValue requestId = requestObject.contains("id") ? requestObject["id"]
+                                                        : QJsonValue(QJsonValue::Undefined);
+
+    if (requestObject["jsonrpc"].toString() != "2.0" || !requestObject["method"].isString()) {
+        this->sendError(socket, requestId.isUndefined() ? QJsonValue(QJsonValue::Null) : requestId,
+                        ControlServer::InvalidRequest, tr("Invalid JSON-RPC 2.0 request"));
+        return;
+    }
+
+    if (requestObject.contains("params") && !requestObject["params"].isObject()) {
+        this->sendError(socket, requestId,
+                        ControlServer::InvalidParams, tr("The params must be an object"));
+        return;
+    }
+
+    this->callMethod(socket, requestId,
+                     requestObject["method"].toString(),
+                     requestObject["params"].toObject());
+}
+
+/**
+ * @brief Call a method
+ * @param socket, socket of the client
+ * @param requestId, id of the request
+ * @param method, name of the method
+ * @param params, params of the method
+ *
+ * Methods: machine.list, events.subscribe, events.unsubscribe,
+ * launch.status, launch.cancel and the methods of a machine
+ */
+void ControlServer::callMethod(QLocalSocket *socket, const QJsonValue &requestId,
+                               const QString &method, const QJsonObject &params)
+{
+    if (method.startsWith("machine.") && method != "machine.list") {
+        this->callMachineMethod(socket, requestId, method, params);
+        return;
+    }
+
+    QString error;
+
+    if (method == "machine.list") {
+        MachineRegistry *registry = MachineRegistry::instance();
+        if (!registry->isLoaded() && !registry->load(error)) {
+            this->sendError(socket, requestId, ControlServer::OperationFailed, error);
+            return;
+        }
+
+        QJsonArray machines;
+        foreach (const QJsonObject &entry, registry->machines()) {
+            Machine *machine = this->loadedMachine(QUuid(entry["uuid"].toString()));
+            if (machine != nullptr) {
+                machines.append(ControlServer::machineStatus(machine));
+                continue;
+            }
+
+            QJsonObject status;
+            status["uuid"] = entry["uuid"];
+            status["name"] = entry["name"];
+            status["state"] = ControlServer::stateName(Machine::Stopped);
+            status["pid"] = 0;
+            status["uptime"] = 0;
+            machines.append(status);
+        }
+
+        this->sendResult(socket, requestId, machines);
+    } else if (method == "events.subscribe") {
+        QSet<QUuid> subscribedMachines;
+        foreach (const QJsonValue &machineName, params["machines"].toArray()) {
+            QJsonObject entry = ControlServer::findMachineEntry(machineName.toString(), error);
+            if (entry.isEmpty()) {
+                this->sendError(socket, requestId, ControlServer::MachineNotFound, error);
+                return;
+            }
+            subscribedMachines.insert(QUuid(entry["uuid"].toString()));
+        }
+
+        Client &client = this->m_clients[socket];
+        client.subscribed = true;
+        client.subscribedMachines = subscribedMachines;
+
+        this->sendResult(socket, requestId, true);
+    } else if (method == "launch.status") {
+        if (this->m_launchScheduler.isNull()) {
+            this->sendError(socket, requestId,
+                            ControlServer::MethodNotFound, tr("There isn't any launch scheduler"));
+            return;
+        }
+
+        QJsonObject launchStatus;
+        launchStatus["pending"] = this->m_launchScheduler->pendingLaunches();
+        launchStatus["finished"] = this->m_launchScheduler->finishedLaunches();
+        launchStatus["total"] = this->m_launchScheduler->totalLaunches();
+
+        this->sendResult(socket, requestId, launchStatus);
+    } else if (method == "launch.cancel") {
+        if (this->m_launchScheduler.isNull()) {
+            this->sendError(socket, requestId,
+                            ControlServer::MethodNotFound, tr("There isn't any launch scheduler"));
+            return;
+        }
+
+        // Without machine, all the machines of the queue
+        if (params.contains("machine")) {
+            QJsonObject entry = ControlServer::findMachineEntry(params["machine"].toString(), error);
+            if (entry.isEmpty()) {
+                this->sendError(socket, requestId, ControlServer::MachineNotFound, error);
+                return;
+            }
+            // A machine that is already starting isn't cancelled
+            bool launchCancelled = this->m_launchScheduler->cancel(QUuid(entry["uuid"].toString()));
+            this->sendResult(socket, requestId, launchCancelled);
+        } else {
+            this->m_launchScheduler->cancelAll();
+            this->sendResult(socket, requestId, true);
+        }
+    } else if (method == "events.unsubscribe") {
+        Client &client = this->m_clients[socket];
+        client.subscribed = false;
+        client.subscribedMachines.clear();
+
+        this->sendResult(socket, requestId, true);
+    } else {
+        this->sendError(socket, requestId,
+                        ControlServer::MethodNotFound, tr("Unknown method %1").arg(method));
+    }
+}
+
+/**
+ * @brief Call a method of a machine
+ * @param socket, socket of the client
+ * @param requestId, id of the request
+ * @param method, name of the method
+ * @param params, params of the method
+ *
+ * Methods: machine.status, machine.start, machine.stop,
+ * machine.pause, machine.resume and machine.reset.
+ *
+ * Params: machine, name or uuid. wait, false to answer
+ * when the operation is sent to QEMU instead of when the
+ * machine reaches the new state. timeout, in milliseconds,
+ * to stop waiting. force, to quit QEMU in machine.stop.
+ * priority, position in the queue of the launch scheduler
+ */
+void ControlServer::callMachineMethod(QLocalSocket *socket, const QJsonValue &requestId,
+                                      const QString &method, const QJsonObject &params)
+{
+    if (!params["machine"].isString()) {
+        this->sendError(socket, requestId,
+                        ControlServer::InvalidParams, tr("The machine param is required"));
+        return;
+    }
+
+    QString error;
+    Machine *machine = this->findMachine(params["machine"].toString(), error);
+    if (machine == nullptr) {
+        this->sendError(socket, requestId, ControlServer::MachineNotFound, error);
+        return;
+    }
+
+    bool wait = params["wait"].toBool(true);
+    int timeout = params["timeout"].toInt(0);
+    Machine::States state = machine->getState();
+
+    if (method == "machine.status") {
+        this->sendResult(socket, requestId, ControlServer::machineStatus(machine));
+        return;
+    }
+
+    if (method == "machine.start") {
+        if (state != Machine::Stopped) {
+            this->sendError(socket, requestId, ControlServer::InvalidState,
+                            tr("The machine %1 is already running").arg(machine->getName()));
+            return;
+        }
+
+        if (!this->m_launchScheduler.isNull()) {
+            if (this->m_launchScheduler->contains(machine->getUuid())) {
+                this->sendError(socket, requestId, ControlServer::InvalidState,
+                                tr("The machine %1 is already queued").arg(machine->getName()));
+                return;
+            }
+
+            if (wait) {
+                this->waitForState(socket, requestId, machine, Machine::Started, timeout);
+            }
+
+            this->m_launchScheduler->enqueue(machine, params["priority"].toInt(0));
+
+            if (!wait) {
+                this->sendResult(socket, requestId, ControlServer::machineStatus(machine));
+            }
+            return;
+        }
+
+        if (wait) {
+            this->waitForState(socket, requestId, machine, Machine::Started, timeout);
+        }
+
+        if (this->m_QEMUObject->isSearchingBinaries()) {
+            // The machine is started when the search of the binaries ends
+            QPointer<QLocalSocket> socketPointer = socket;
+            QPointer<Machine> machinePointer = machine;
+            QMetaObject::Connection *binariesConnection = new QMetaObject::Connection();
+            *binariesConnection = connect(m_QEMUObject, &QEMU::QEMUBinariesSearchFinished,
+                                          this, [=]() {
+                disconnect(*binariesConnection);
+                delete binariesConnection;
+                if (!machinePointer.isNull()) {
+                    this->startMachine(socketPointer, requestId, machinePointer, wait);
+                }
+            });
+        } else {
+            this->startMachine(socket, requestId, machine, wait);
+        }
+        return;
+    }
+
+    if (state == Machine::Stopped) {
+        this->sendError(socket, requestId, ControlServer::InvalidState,
+                        tr("The machine %1 isn't running").arg(machine->getName()));
+        return;
+    }
+
+    if (method == "machine.stop") {
+        if (machine->getQMPClient()->state() == QMPClient::Disconnected) {
+            this->sendError(socket, requestId, ControlServer::OperationFailed,
+                            tr("The machine %1 isn't connected").arg(machine->getName()));
+            return;
+        }
+
+        if (wait) {
+            this->waitForState(socket, requestId, machine, Machine::Stopped, timeout);
+        }
+
+        machine->stopMachine(params["force"].toBool());
+    } else if (method == "machine.pause" || method == "machine.resume") {
+        bool pause = method == "machine.pause";
+        if (state != (pause ? Machine::Started : Machine::Paused)) {
+            this->sendError(socket, requestId, ControlServer::InvalidState,
+                            pause ? tr("The machine %1 isn't started").arg(machine->getName())
+                                  : tr("The machine %1 isn't paused").arg(machine->getName()));
+            return;
+        }
+
+        if (wait) {
+            this->waitForState(socket, requestId, machine,
+                               pause ? Machine::Paused : Machine::Started, timeout);
+        }
+
+        machine->getQMPClient()->execute(pause ? "stop" : "cont");
+    } else if (method == "machine.reset") {
+        wait = false;
+        machine->getQMPClient()->execute("system_reset");
+    } else {
+        this->sendError(socket, requestId,
+                        ControlServer::MethodNotFound, tr("Unknown method %1").arg(method));
+        return;
+    }
+
+    if (!wait) {
+        this->sendResult(socket, requestId, ControlServer::machineStatus(machine));
+    }
+}
+
+/**
+ * @brief Get a machine added to the server
+ * @param machineUuid, uuid of the machine
+ * @return machine, nullptr if it isn't added
+ *
+ * Get a machine added to the server
+ */
+Machine *ControlServer::loadedMachine(const QUuid &machineUuid) const
+{
+    foreach (const QPointer<Machine> &machine, this->m_machines) {
+        if (!machine.isNull() && machine->getUuid() == machineUuid) {
+            return machine;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Find a machine
+ * @param machine, name or uuid of the machine
+ * @param error, description of the error
+ * @return machine, nullptr if it isn't found
+ *
+ * Find a machine and load it if it's needed
+ */
+Machine *ControlServer::findMachine(const QString &machine, QString &error)
+{
+    QJsonObject entry = ControlServer::findMachineEntry(machine, error);
+    if (entry.isEmpty()) {
+        return nullptr;
+    }
+
+    Machine *machineObject = this->loadedMachine(QUuid(entry["uuid"].toString()));
+    if (machineObject != nullptr) {
+        return machineObject;
+    }
+
+    if (!this->m_machineLoader) {
+        error = tr("The machine %1 isn't loaded yet").arg(entry["name"].toString());
+        return nullptr;
+    }
+
+    Machine *newMachine = this->m_machineLoader(entry, error);
+    if (newMachine != nullptr) {
+        this->addMachine(newMachine);
+    }
+
+    return newMachine;
+}
+
+/**
+ * @brief Start a machine
+ * @param socket, socket of the client
+ * @param requestId, id of the request
+ * @param machine, machine
+ * @param wait, true if the request is answered when the machine is started
+ *
+ * Start a machine with the QEMU binaries found.
+ * The request fails if there isn't any binary
+ * or the process cannot be started
+ */
+void ControlServer::startMachine(QLocalSocket *socket, const QJsonValue &requestId,
+                                 Machine *machine, bool wait)
+{
+    QString error;
+    if (this->m_QEMUObject->QEMUBinaries().isEmpty()) {
+        error = tr("QEMU binary not found");
+    } else {
+        machine->runMachine(this->m_QEMUObject);
+        if (machine->getProcessId() <= 0) {
+            error = tr("The machine %1 cannot be started").arg(machine->getName());
+        }
+    }
+
+    if (!error.isEmpty()) {
+        if (wait) {
+            this->machineStartFailed(machine->getUuid(), error);
+        } else {
+            this->sendError(socket, requestId, ControlServer::OperationFailed, error);
+        }
+        return;
+    }
+
+    if (!wait) {
+        this->sendResult(socket, requestId, ControlServer::machineStatus(machine));
+    }
+}
+
+/**
+ * @brief Answer a request when the machine reaches a state
+ * @param socket, socket of the client
+ * @param requestId, id of the request
+ * @param machine, machine
+ * @param targetState, state of the machine
+ * @param timeout, milliseconds to wait, 0 to wait until the state changes
+ *
+ * Answer a request when the machine reaches a state
+ */
+void ControlServer::waitForState(QLocalSocket *socket, const QJsonValue &requestId,
+                                 Machine *machine, Machine::States targetState, int timeout)
+{
+    PendingOperation operation;
+    operation.operationId = ++this->m_nextOperationId;
+    operation.socket = socket;
+    operation.requestId = requestId;
+    operation.machineUuid = machine->getUuid();
+    operation.targetState = targetState;
+    this->m_pendingOperations.append(operation);
+
+    if (timeout <= 0) {
+        return;
+    }
+
+    int operationId = operation.operationId;
+    QTimer::singleShot(timeout, this, [=]() {
+        for (int i = 0; i < this->m_pendingOperations.size(); ++i) {
+            if (this->m_pendingOperations.at(i).operationId == operationId) {
+                PendingOperation pendingOperation = this->m_pendingOperations.takeAt(i);
+                this->sendError(pendingOperation.socket, pendingOperation.requestId,
+                                ControlServer::Timeout, tr("The operation timed out"));
+                return;
+            }
+        }
+    });
+}
+
+/**
+ * @brief State of a machine changed
+ * @param machine, machine
+ * @param newState, new state of the machine
+ *
+ * Notify the subscribed clients and answer
+ * the operations waiting for the state
+ */
+void ControlServer::machineStateChanged(Machine *machine, Machine::States newState)
+{
+    QJsonObject status = ControlServer::machineStatus(machine);
+    this->notifySubscribers(machine->getUuid(), "machine.stateChanged", status);
+
+    // Every operation ends when the machine is stopped
+    QList<PendingOperation> finishedOperations = this->takePendingOperations(machine->getUuid(), newState);
+    if (newState == Machine::Stopped) {
+        finishedOperations.append(this->takePendingOperations(machine->getUuid()));
+    }
+
+    foreach (const PendingOperation &operation, finishedOperations) {
+        if (operation.targetState == newState) {
+            this->sendResult(operation.socket, operation.requestId, status);
+        } else {
+            this->sendError(operation.socket, operation.requestId, ControlServer::OperationFailed,
+                            tr("The machine %1 stopped").arg(machine->getName()));
+        }
+    }
+}
+
+/**
+ * @brief A machine cannot be started
+ * @param machineUuid, uuid of the machine
+ * @param error, description of the error
+ *
+ * Answer the operations waiting for the machine
+ */
+void ControlServer::machineStartFailed(const QUuid &machineUuid, const QString &error)
+{
+    foreach (const PendingOperation &operation, this->takePendingOperations(machineUuid, Machine::Started)) {
+        this->sendError(operation.socket, operation.requestId,
+                        ControlServer::OperationFailed, error);
+    }
+}
+
+/**
+ * @brief State of the launch of a machine changed
+ * @param machineUuid, uuid of the machine
+ * @param state, state of the launch
+ * @param message, description of the state
+ *
+ * Notify the subscribed clients. The start operations
+ * fail if the launch fails or it's cancelled
+ */
+void ControlServer::machineLaunchStateChanged(const QUuid &machineUuid,
+                                              LaunchScheduler::LaunchStates state,
+                                              const QString &message)
+{
+    QJsonObject launchStatus;
+    launchStatus["uuid"] = machineUuid.toString();
+    launchStatus["launch"] = LaunchScheduler::stateName(state);
+    launchStatus["message"] = message;
+    this->notifySubscribers(machineUuid, "machine.launchStateChanged", launchStatus);
+
+    if (state != LaunchScheduler::Failed && state != LaunchScheduler::Cancelled) {
+        return;
+    }
+
+    foreach (const PendingOperation &operation, this->takePendingOperations(machineUuid, Machine::Started)) {
+        this->sendError(operation.socket, operation.requestId, ControlServer::OperationFailed,
+                        message.isEmpty() ? tr("The start was cancelled") : message);
+    }
+}
+
+/**
+ * @brief Notify the subscribed clients
+ * @param machineUuid, uuid of the machine
+ * @param method, name of the notification
+ * @param params, params of the notification
+ *
+ * Send a notification to the clients subscribed to the machine
+ */
+void ControlServer::notifySubscribers(const QUuid &machineUuid, const QString &method, const QJsonObject &params)
+{
+    QJsonObject notification;
+    notification["jsonrpc"] = "2.0";
+    notification["method"] = method;
+    notification["params"] = params;
+
+    QHashIterator<QLocalSocket *, Client> clients(this->m_clients);
+    while (clients.hasNext()) {
+        clients.next();
+        if (clients.value().subscribed &&
+            (clients.value().subscribedMachines.isEmpty() ||
+             clients.value().subscribedMachines.contains(machineUuid))) {
+            this->sendMessage(clients.key(), notification);
+        }
+    }
+}
+
+/**
+ * @brief Take the pending operations of a machine
+ * @param machineUuid, uuid of the machine
+ * @param targetState, state waited by the operations, -1 for all the operations
+ * @return operations removed from the pending list
+ *
+ * The operations are removed before answering them,
+ * a client can be disconnected while it's answered
+ */
+QList<ControlServer::PendingOperation> ControlServer::takePendingOperations(const QUuid &machineUuid,
+                                                                            int targetState)
+{
+    QList<PendingOperation> operations;
+
+    QMutableListIterator<PendingOperation> pendingOperations(this->m_pendingOperations);
+    while (pendingOperations.hasNext()) {
+        const PendingOperation &operation = pendingOperations.next();
+        if (operation.machineUuid == machineUuid &&
+            (targetState == -1 || operation.targetState == targetState)) {
+            operations.append(operation);
+            pendingOperations.remove();
+        }
+    }
+
+    return operations;
+}
+
+/**
+ * @brief Send the result of a request
+ * @param socket, socket of the client
+ * @param requestId, id of the request
+ * @param result, result of the method
+ *
+ * Send the result of a request. Notifications aren't answered
+ */
+void ControlServer::sendResult(QLocalSocket *socket, const QJsonValue &requestId, const QJsonValue &result)
+{
+    if (requestId.isUndefined()) {
+        return;
+    }
+
+    QJsonObject response;
+    response["jsonrpc"] = "2.0";
+    response["id"] = requestId;
+    response["result"] = result;
+
+    this->sendMessage(socket, response);
+}
+
+/**
+ * @brief Send the error of a request
+ * @param socket, socket of the client
+ * @param requestId, id of the request
+ * @param code, code of the error
+ * @param message, description of the error
+ *
+ * Send the error of a request. Notifications aren't answered
+ */
+void ControlServer::sendError(QLocalSocket *socket, const QJsonValue &requestId,
+                              int code, const QString &message)
+{
+    if (requestId.isUndefined()) {
+        return;
+    }
+
+    QJsonObject error;
+    error["code"] = code;
+    error["message"] = message;
+
+    QJsonObject response;
+    response["jsonrpc"] = "2.0";
+    response["id"] = requestId;
+    response["error"] = error;
+
+    this->sendMessage(socket, response);
+}
+
+/**
+ * @brief Send a message
+ * @param socket, socket of the client
+ * @param message, message in JSON format
+ *
+ * Send a message, one per line
+ */
+void ControlServer::sendMessage(QLocalSocket *socket, const QJsonObject &message)
+{
+    if (socket == nullptr || socket->state() != QLocalSocket::ConnectedState) {
+        return;
+    }
+
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
@@ -0,0 +1,148 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+// Qt
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QHash>
+#include <QSet>
+#include <QUuid>
+#include <QTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QSettings>
+#include <QDir>
+#include <QDebug>
+
+// C++ standard library
+#include <functional>
+
+// Local
+#include "machine.h"
+#include "machineregistry.h"
+#include "qemu.h"
+#include "launchscheduler.h"
+
+class ControlServer : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit ControlServer(QEMU *QEMUObject, QObject *parent = nullptr);
+        ~ControlServer();
+
+        enum ErrorCodes {
+            ParseError      = -32700,
+            InvalidRequest  = -32600,
+            MethodNotFound  = -32601,
+            InvalidParams   = -32602,
+            MachineNotFound = -32000,
+            InvalidState    = -32001,
+            OperationFailed = -32002,
+            Timeout         = -32003
+        };
+
+        typedef std::function<Machine *(const QJsonObject &entry, QString &error)> MachineLoader;
+
+        bool listen(QString &error);
+        void close();
+        bool isListening() const;
+
+        void addMachine(Machine *machine);
+        void removeMachine(const QUuid &machineUuid);
+        void setMachineLoader(MachineLoader loader);
+        void setLaunchScheduler(LaunchScheduler *launchScheduler);
+
+        static QString socketPath();
+        static bool serverRunning();
+        static QJsonObject findMachineEntry(const QString &machine, QString &error);
+        static QJsonObject machineStatus(Machine *machine);
+        static QString stateName(Machine::States state);
+
+    signals:
+
+    public slots:
+        void loadSettings();
+
+    private slots:
+        void newConnection();
+
+    protected:
+
+    private:
+        struct Client {
+            QByteArray buffer;
+            bool subscribed;
+            // Empty to receive the events of all the machines
+            QSet<QUuid> subscribedMachines;
+        };
+
+        // Operation answered when the machine reaches the state
+        struct PendingOperation {
+            int operationId;
+            QPointer<QLocalSocket> socket;
+            QJsonValue requestId;
+            QUuid machineUuid;
+            Machine::States targetState;
+        };
+
+        QLocalServer *m_server;
+        QEMU *m_QEMUObject;
+        QPointer<LaunchScheduler> m_launchScheduler;
+        QList<QPointer<Machine>> m_machines;
+        MachineLoader m_machineLoader;
+
+        QHash<QLocalSocket *, Client> m_clients;
+        QList<PendingOperation> m_pendingOperations;
+        int m_nextOperationId;
+
+        // Methods
+        void readRequests(QLocalSocket *socket);
+        void processRequest(QLocalSocket *socket, const QJsonValue &request);
+        void callMethod(QLocalSocket *socket, const QJsonValue &requestId,
+                        const QString &method, const QJsonObject &params);
+        void callMachineMethod(QLocalSocket *socket, const QJsonValue &requestId,
+                               const QString &method, const QJsonObject &params);
+        Machine *loadedMachine(const QUuid &machineUuid) const;
+        Machine *findMachine(const QString &machine, QString &error);
+        void startMachine(QLocalSocket *socket, const QJsonValue &requestId,
+                          Machine *machine, bool wait);
+        void waitForState(QLocalSocket *socket, const QJsonValue &requestId,
+                          Machine *machine, Machine::States targetState, int timeout);
+        void machineStateChanged(Machine *machine, Machine::States newState);
+        void machineStartFailed(const QUuid &machineUuid, const QString &error);
+        void machineLaunchStateChanged(const QUuid &machineUuid,
+                                       LaunchScheduler::LaunchStates state,
+                                       const QString &message);
+        void notifySubscribers(const QUuid &machineUuid, const QString &method, const QJsonObject &params);
+        QList<PendingOperation> takePendingOperations(const QUuid &machineUuid, int targetState = -1);
+
+        void sendResult(QLocalSocket *socket, const QJsonValue &requestId, const QJsonValue &result);
+        void sendError(QLocalSocket *socket, const QJsonValue &requestId, int code, const QString &message);
+        void sendMessage(QLocalSocket *socket, const QJsonObject &message);
+};
+
+#endif // CONTROLSERVER_H
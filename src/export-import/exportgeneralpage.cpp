@@ -27,6 +27,17 @@ ExportGeneralPage::ExportGeneralPage(QWidget *parent) : QWizardPage(parent)
 
     m_infoLabel = new QLabel(tr("Select the folder where the machine has to be exported."));
 
+    m_folderRadio = new QRadioButton(tr("Export to a folder"));
+    m_folderRadio->setChecked(true);
+    m_archiveRadio = new QRadioButton(tr("Export to a single .qtemu archive"));
+
+    connect(m_archiveRadio, &QAbstractButton::toggled,
+            this, &ExportGeneralPage::exportArchiveToggle);
+
+    m_formatLayout = new QVBoxLayout();
+    m_formatLayout->addWidget(m_folderRadio);
+    m_formatLayout->addWidget(m_archiveRadio);
+
     m_destinationLineEdit = new QLineEdit();
     m_destinationButton = new QPushButton(QIcon::fromTheme("folder-symbolic",
                                                            QIcon(QPixmap(":/images/icons/breeze/32x32/folder-symbolic.svg"))),
@@ -41,10 +52,12 @@ ExportGeneralPage::ExportGeneralPage(QWidget *parent) : QWizardPage(parent)
     m_destinationLayout->addWidget(m_destinationButton);
 
     this->registerField("destination*", m_destinationLineEdit);
+    this->registerField("exportArchive", m_archiveRadio);
 
     m_mainLayout = new QVBoxLayout();
     m_mainLayout->setAlignment(Qt::AlignCenter);
     m_mainLayout->addWidget(m_infoLabel);
+    m_mainLayout->addItem(m_formatLayout);
     m_mainLayout->addItem(m_destinationLayout);
 
     this->setLayout(m_mainLayout);
@@ -60,10 +73,23 @@ ExportGeneralPage::~ExportGeneralPage()
 /**
  * @brief Select the destination of the machine
  *
- * Select the destination folder for the machine
+ * Select the destination folder or archive for the machine
  */
 void ExportGeneralPage::selectExportDestination()
 {
+    if (this->m_archiveRadio->isChecked()) {
+        QString archivePath = QFileDialog::getSaveFileName(this, tr("Select the archive"),
+                                                           QDir::homePath(),
+                                                           tr("QtEmu archive (*.qtemu)"));
+        if (!archivePath.isEmpty()) {
+            if (!archivePath.endsWith(".qtemu")) {
+                archivePath.append(".qtemu");
+            }
+            this->m_destinationLineEdit->setText(QDir::toNativeSeparators(archivePath));
+        }
+        return;
+    }
+
     QString exportPath = QFileDialog::getExistingDirectory(this, tr("Select the export folder"),
                                                            QDir::homePath(),
                                                            QFileDialog::ShowDirsOnly |
@@ -73,3 +99,21 @@ void ExportGeneralPage::selectExportDestination()
         this->m_destinationLineEdit->setText(QDir::toNativeSeparators(exportPath));
     }
 }
+
+/**
+ * @brief Change the export format
+ * @param archive, true if the machine is exported to an archive
+ *
+ * Change the export format. The destination is cleared because
+ * a folder isn't a valid archive and vice versa
+ */
+void ExportGeneralPage::exportArchiveToggle(bool archive)
+{
+    if (archive) {
+        this->m_infoLabel->setText(tr("Select the archive where the machine has to be exported."));
+    } else {
+        this->m_infoLabel->setText(tr("Select the folder where the machine has to be exported."));
+    }
+
+    this->m_destinationLineEdit->clear();
+}
@@ -27,6 +27,7 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QRadioButton>
 #include <QFileDialog>
 
 #include <QDebug>
@@ -44,10 +45,12 @@ class ExportGeneralPage: public QWizardPage {
 
     private slots:
         void selectExportDestination();
+        void exportArchiveToggle(bool archive);
 
     protected:
 
     private:
+        QVBoxLayout *m_formatLayout;
         QHBoxLayout *m_destinationLayout;
         QVBoxLayout *m_mainLayout;
 
@@ -55,6 +58,9 @@ class ExportGeneralPage: public QWizardPage {
 
         QLineEdit *m_destinationLineEdit;
 
+        QRadioButton *m_folderRadio;
+        QRadioButton *m_archiveRadio;
+
         QPushButton *m_destinationButton;
 };
 
@@ -57,12 +57,34 @@ ExportMediaPage::ExportMediaPage(Machine *machine,
         m_mediaItem->setCheckState(0, Qt::Checked);
     }
 
+    this->m_totalBytes = 0;
+    this->m_finishedBytes = 0;
+    this->m_copyCancelled = false;
+    this->m_copyFinished = false;
+    this->m_archiveJob = nullptr;
+
+    m_copyProgressBar = new QProgressBar(this);
+    m_copyProgressBar->setRange(0, 1000);
+    m_copyProgressBar->setTextVisible(false);
+
+    m_cancelCopyButton = new QPushButton(tr("Cancel copy"), this);
+    connect(m_cancelCopyButton, &QAbstractButton::clicked,
+            this, &ExportMediaPage::cancelCopy);
+
     m_mediaLayout = new QHBoxLayout();
     m_mediaLayout->addWidget(m_machineMediaTree);
 
+    m_copyLayout = new QHBoxLayout();
+    m_copyLayout->addWidget(m_copyProgressBar);
+    m_copyLayout->addWidget(m_cancelCopyButton);
+
     m_mainLayout = new QVBoxLayout();
     m_mainLayout->addWidget(m_mediaTitleLabel);
     m_mainLayout->addItem(m_mediaLayout);
+    m_mainLayout->addItem(m_copyLayout);
+
+    m_copyProgressBar->setVisible(false);
+    m_cancelCopyButton->setVisible(false);
 
     this->setLayout(m_mainLayout);
 
@@ -71,14 +93,49 @@ ExportMediaPage::ExportMediaPage(Machine *machine,
 
 ExportMediaPage::~ExportMediaPage()
 {
+    // The wizard is closed while the media is being copied
+    foreach (MediaCopyJob *job, this->m_copyJobs) {
+        disconnect(job, nullptr, this, nullptr);
+        job->cancel();
+    }
+
+    if (this->m_archiveJob != nullptr) {
+        disconnect(this->m_archiveJob, nullptr, this, nullptr);
+        this->m_archiveJob->cancel();
+    }
+
     qDebug() << "ExportMediaPage destroyed";
 }
 
+/**
+ * @brief Validate the page
+ * @return true when the media is copied
+ *
+ * Copy the selected media in parallel. The page is
+ * validated again when all the copies are finished
+ */
 bool ExportMediaPage::validatePage()
 {
+    if (!this->m_copyJobs.isEmpty() || this->m_archiveJob != nullptr) {
+        return false;
+    }
+
+    if (this->m_copyFinished) {
+        return true;
+    }
+
+    if (field("exportArchive").toBool()) {
+        this->exportArchive();
+        return false;
+    }
+
     QString machineDestinationPath = field("destination").toString();
 
     this->m_machineExport->removeAllMedia();
+    this->m_failedMedia.clear();
+    this->m_copyCancelled = false;
+    this->m_totalBytes = 0;
+    this->m_finishedBytes = 0;
 
     QTreeWidgetItemIterator it(this->m_machineMediaTree);
     while (*it) {
@@ -92,15 +149,132 @@ bool ExportMediaPage::validatePage()
 
             this->m_machineExport->addMedia(media);
 
-            if (!QFile::copy(oldMediaPath, newMediaPath)) {
-                SystemUtils::showMessage(tr("Qtemu - Critical error"),
-                                         tr("<p>Cannot export the media: </p>") + media->name(),
-                                         QMessageBox::Critical);
-            }
+            MediaCopyJob *job = MediaCopier::copy(oldMediaPath, newMediaPath);
+            QString mediaName = media->name();
+            this->m_copyJobs.append(job);
+            this->m_totalBytes += job->totalBytes();
+
+            connect(job, &MediaCopyJob::progressChanged,
+                    this, &ExportMediaPage::updateCopyProgress);
+            connect(job, &MediaCopyJob::finished,
+                    this, [=](bool success) {
+                this->copyJobFinished(job, mediaName, success);
+            });
         }
         ++it;
     }
 
+    if (this->m_copyJobs.isEmpty()) {
+        this->saveExportedMachine();
+        return true;
+    }
+
+    this->m_machineMediaTree->setEnabled(false);
+    this->m_copyProgressBar->setValue(0);
+    this->m_copyProgressBar->setVisible(true);
+    this->m_cancelCopyButton->setEnabled(true);
+    this->m_cancelCopyButton->setVisible(true);
+
+    return false;
+}
+
+/**
+ * @brief A copy is finished
+ * @param job, job of the copy
+ * @param mediaName, name of the copied media
+ * @param success, true if the media is copied
+ *
+ * When all the copies are finished, save the
+ * exported machine and finish the wizard
+ */
+void ExportMediaPage::copyJobFinished(MediaCopyJob *job, const QString &mediaName, bool success)
+{
+    this->m_copyJobs.removeOne(job);
+    this->m_finishedBytes += job->totalBytes();
+
+    if (!success && !job->isCancelled()) {
+        this->m_failedMedia.append(mediaName + ": " + job->errorString());
+    }
+
+    this->updateCopyProgress();
+
+    if (!this->m_copyJobs.isEmpty()) {
+        return;
+    }
+
+    this->m_machineMediaTree->setEnabled(true);
+    this->m_copyProgressBar->setVisible(false);
+    this->m_cancelCopyButton->setVisible(false);
+
+    if (this->m_copyCancelled) {
+        return;
+    }
+
+    if (!this->m_failedMedia.isEmpty()) {
+        SystemUtils::showMessage(tr("Qtemu - Critical error"),
+                                 tr("<p>Cannot export the media: </p>") +
+                                 this->m_failedMedia.join("<br>"),
+                                 QMessageBox::Critical);
+    }
+
+    this->saveExportedMachine();
+    this->wizard()->accept();
+}
+
+/**
+ * @brief Cancel the copy
+ *
+ * Cancel all the copies. The partial files are removed
+ */
+void ExportMediaPage::cancelCopy()
+{
+    this->m_copyCancelled = true;
+    this->m_cancelCopyButton->setEnabled(false);
+
+    foreach (MediaCopyJob *job, this->m_copyJobs) {
+        job->cancel();
+    }
+
+    if (this->m_archiveJob != nullptr) {
+        this->m_archiveJob->cancel();
+    }
+}
+
+/**
+ * @brief Update the progress of the copy
+ *
+ * Update the progress bar with the bytes copied by all the jobs
+ */
+void ExportMediaPage::updateCopyProgress()
+{
+    if (this->m_totalBytes <= 0) {
+        return;
+    }
+
+    if (this->m_archiveJob != nullptr) {
+        this->m_copyProgressBar->setValue(static_cast<int>(this->m_archiveJob->bytesProcessed() * 1000 /
+                                                           this->m_totalBytes));
+        return;
+    }
+
+    qint64 bytesCopied = this->m_finishedBytes;
+    foreach (MediaCopyJob *job, this->m_copyJobs) {
+        bytesCopied += job->bytesCopied();
+    }
+
+    this->m_copyProgressBar->setValue(static_cast<int>(bytesCopied * 1000 / this->m_totalBytes));
+}
+
+/**
+ * @brief Save the exported machine
+ *
+ * Save the configuration of the machine with the media
+ * in the destination folder
+ */
+void ExportMediaPage::saveExportedMachine()
+{
+    QString machineDestinationPath = field("destination").toString();
+
     QString machineDestionation =
             QDir::toNativeSeparators(machineDestinationPath + "/" + this->m_machineExport->getName().toLower().replace(" ", "_") + ".json");
 
@@ -108,5 +282,87 @@ bool ExportMediaPage::validatePage()
     this->m_machineExport->setConfigPath(machineDestionation);
     this->m_machineExport->saveMachine();
 
-    return true;
+    this->m_copyFinished = true;
+}
+
+/**
+ * @brief Export the machine to an archive
+ *
+ * Write the configuration of the machine and the selected
+ * media in a single compressed archive. The media of the
+ * archive is referenced by name
+ */
+void ExportMediaPage::exportArchive()
+{
+    QString archivePath = field("destination").toString();
+
+    this->m_machineExport->removeAllMedia();
+    this->m_copyCancelled = false;
+    this->m_totalBytes = 0;
+
+    QList<ArchiveDisk> disks;
+
+    QTreeWidgetItemIterator it(this->m_machineMediaTree);
+    while (*it) {
+        if ((*it)->checkState(0) == Qt::Checked) {
+            QVariant mediaVariant = (*it)->data(1, Qt::UserRole);
+            Media *media = mediaVariant.value<Media *>();
+            media->setPath((*it)->text(0));
+
+            this->m_machineExport->addMedia(media);
+
+            ArchiveDisk disk;
+            disk.name = (*it)->text(0);
+            disk.path = QDir::toNativeSeparators((*it)->data(0, Qt::UserRole).toString());
+            disks.append(disk);
+
+            this->m_totalBytes += QFileInfo(disk.path).size();
+        }
+        ++it;
+    }
+
+    this->m_archiveJob = MachineArchive::exportMachine(archivePath,
+                                                       this->m_machineExport->getMachineJSON(),
+                                                       disks);
+
+    connect(this->m_archiveJob, &MachineArchiveJob::progressChanged,
+            this, &ExportMediaPage::updateCopyProgress);
+    connect(this->m_archiveJob, &MachineArchiveJob::finished,
+            this, &ExportMediaPage::archiveJobFinished);
+
+    this->m_machineMediaTree->setEnabled(false);
+    this->m_copyProgressBar->setValue(0);
+    this->m_copyProgressBar->setVisible(true);
+    this->m_cancelCopyButton->setEnabled(true);
+    this->m_cancelCopyButton->setVisible(true);
+}
+
+/**
+ * @brief The archive is written
+ * @param success, true if the archive is written
+ *
+ * Finish the wizard if the archive is written
+ */
+void ExportMediaPage::archiveJobFinished(bool success)
+{
+    QString errorString = this->m_archiveJob->errorString();
+    this->m_archiveJob = nullptr;
+
+    this->m_machineMediaTree->setEnabled(true);
+    this->m_copyProgressBar->setVisible(false);
+    this->m_cancelCopyButton->setVisible(false);
+
+    if (this->m_copyCancelled) {
+        return;
+    }
+
+    if (!success) {
+        SystemUtils::showMessage(tr("Qtemu - Critical error"),
+                                 tr("<p>Cannot export the machine: </p>") + errorString,
+                                 QMessageBox::Critical);
+        return;
+    }
+
+    this->m_copyFinished = true;
+    this->wizard()->accept();
 }
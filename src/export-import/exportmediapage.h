@@ -26,9 +26,14 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTreeWidget>
+#include <QProgressBar>
+#include <QPushButton>
 
 // Local
 #include "../machine.h"
+#include "../utils/systemutils.h"
+#include "../utils/mediacopier.h"
+#include "machinearchive.h"
 
 class ExportMediaPage: public QWizardPage {
     Q_OBJECT
@@ -43,21 +48,39 @@ class ExportMediaPage: public QWizardPage {
     public slots:
 
     private slots:
+        void cancelCopy();
+        void updateCopyProgress();
+        void archiveJobFinished(bool success);
 
     protected:
 
     private:
         QVBoxLayout *m_mainLayout;
         QHBoxLayout *m_mediaLayout;
+        QHBoxLayout *m_copyLayout;
 
         QTreeWidget *m_machineMediaTree;
         QTreeWidgetItem *m_mediaItem;
 
         QLabel *m_mediaTitleLabel;
 
+        QProgressBar *m_copyProgressBar;
+        QPushButton *m_cancelCopyButton;
+
+        QList<MediaCopyJob *> m_copyJobs;
+        MachineArchiveJob *m_archiveJob;
+        QStringList m_failedMedia;
+        qint64 m_totalBytes;
+        qint64 m_finishedBytes;
+        bool m_copyCancelled;
+        bool m_copyFinished;
+
         Machine *m_machineExport;
 
         bool validatePage();
+        void copyJobFinished(MediaCopyJob *job, const QString &mediaName, bool success);
+        void saveExportedMachine();
+        void exportArchive();
 
 };
 
@@ -82,7 +82,13 @@ void ImportDetailsPage::initializePage()
     QString machineConfigFile = field("configFilePath").toString();
     QString machineDestinationPath = field("machineDestinationPath").toString();
 
-    QJsonObject machineJSON = MachineUtils::readMachineFile(machineConfigFile);
+    QJsonObject machineJSON;
+    if (MachineArchive::isArchive(machineConfigFile)) {
+        QString error;
+        machineJSON = MachineArchive::readManifest(machineConfigFile, error)["machine"].toObject();
+    } else {
+        machineJSON = MachineUtils::readMachineFile(machineConfigFile);
+    }
 
     if (machineJSON.isEmpty()) {
         // TODO: Show message
@@ -31,6 +31,7 @@
 // Local
 #include "../machine.h"
 #include "../machineutils.h"
+#include "machinearchive.h"
 
 class ImportDetailsPage : public QWizardPage {
     Q_OBJECT
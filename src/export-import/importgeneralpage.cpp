@@ -25,7 +25,7 @@ ImportGeneralPage::ImportGeneralPage(QWidget *parent) : QWizardPage(parent)
 {
     this->setTitle(tr("Machine import wizard"));
 
-    m_infoLabel = new QLabel(tr("Select the machine configuration file."));
+    m_infoLabel = new QLabel(tr("Select the machine configuration file or archive."));
 
     m_machineConfigLineEdit = new QLineEdit();
     m_machineConfigButton = new QPushButton(QIcon::fromTheme("folder-symbolic",
@@ -67,7 +67,7 @@ void ImportGeneralPage::selectMachineConfigFile()
     QString machineConfigFile = QFileDialog::getOpenFileName(this,
                                                              tr("Open machine config file"),
                                                              QDir::homePath(),
-                                                             tr("Config file (*.json)"));
+                                                             tr("Config file or archive (*.json *.qtemu)"));
 
     if (!machineConfigFile.isEmpty()) {
         this->m_machineConfigLineEdit->setText(QDir::toNativeSeparators(machineConfigFile));
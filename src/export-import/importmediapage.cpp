@@ -41,12 +41,34 @@ ImportMediaPage::ImportMediaPage(Machine *machine,
     m_machineMediaTree->setHeaderLabels(header);
     m_machineMediaTree->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Minimum);
 
+    this->m_totalBytes = 0;
+    this->m_finishedBytes = 0;
+    this->m_copyCancelled = false;
+    this->m_copyFinished = false;
+    this->m_archiveJob = nullptr;
+
+    m_copyProgressBar = new QProgressBar(this);
+    m_copyProgressBar->setRange(0, 1000);
+    m_copyProgressBar->setTextVisible(false);
+
+    m_cancelCopyButton = new QPushButton(tr("Cancel copy"), this);
+    connect(m_cancelCopyButton, &QAbstractButton::clicked,
+            this, &ImportMediaPage::cancelCopy);
+
     m_mediaLayout = new QHBoxLayout();
     m_mediaLayout->addWidget(m_machineMediaTree);
 
+    m_copyLayout = new QHBoxLayout();
+    m_copyLayout->addWidget(m_copyProgressBar);
+    m_copyLayout->addWidget(m_cancelCopyButton);
+
     m_mainLayout = new QVBoxLayout();
     m_mainLayout->addWidget(m_infoLabel);
     m_mainLayout->addItem(m_mediaLayout);
+    m_mainLayout->addItem(m_copyLayout);
+
+    m_copyProgressBar->setVisible(false);
+    m_cancelCopyButton->setVisible(false);
 
     this->setLayout(m_mainLayout);
 
@@ -55,6 +77,17 @@ ImportMediaPage::ImportMediaPage(Machine *machine,
 
 ImportMediaPage::~ImportMediaPage()
 {
+    // The wizard is closed while the media is being copied
+    foreach (MediaCopyJob *job, this->m_copyJobs) {
+        disconnect(job, nullptr, this, nullptr);
+        job->cancel();
+    }
+
+    if (this->m_archiveJob != nullptr) {
+        disconnect(this->m_archiveJob, nullptr, this, nullptr);
+        this->m_archiveJob->cancel();
+    }
+
     qDebug() << "ImportMediaPage destroyed";
 }
 
@@ -79,20 +112,34 @@ void ImportMediaPage::initializePage()
     }
 }
 
+/**
+ * @brief Validate the page
+ * @return true when the machine is imported
+ *
+ * Copy the selected media in parallel. The page is
+ * validated again when all the copies are finished
+ */
 bool ImportMediaPage::validatePage()
 {
-    QString machineDestinationPath = field("machineDestinationPath").toString();
-    QString machineConfigFilePath = field("configFilePath").toString();
+    if (!this->m_copyJobs.isEmpty() || this->m_archiveJob != nullptr) {
+        return false;
+    }
 
-    QFileInfo machineConfigFileInfo(machineConfigFilePath);
+    if (this->m_copyFinished) {
+        return true;
+    }
 
-    QString machineConfigFilePathNew =
-            QDir::toNativeSeparators(machineDestinationPath + "/" + machineConfigFileInfo.fileName());
+    QString machineDestinationPath = field("machineDestinationPath").toString();
+    QString machineConfigFilePath = field("configFilePath").toString();
+    bool archive = MachineArchive::isArchive(machineConfigFilePath);
+    QHash<QString, QString> archiveDestinations;
 
-    // Move the selected media
+    // Copy the selected media
     this->m_machine->removeAllMedia();
-
-    bool machineImported = true;
+    this->m_failedMedia.clear();
+    this->m_copyCancelled = false;
+    this->m_totalBytes = 0;
+    this->m_finishedBytes = 0;
 
     QTreeWidgetItemIterator it(this->m_machineMediaTree);
     while (*it) {
@@ -107,34 +154,205 @@ bool ImportMediaPage::validatePage()
 
             this->m_machine->addMedia(media);
 
-            if (!QFile::copy(oldMediaPath, newMediaPath)) {
-                machineImported = false;
-                SystemUtils::showMessage(tr("Qtemu - Critical error"),
-                                         tr("<p>Cannot import the media: </p>") + media->name(),
-                                         QMessageBox::Critical);
+            // The media of an archive is extracted in a single job
+            if (archive) {
+                archiveDestinations.insert((*it)->text(0), newMediaPath);
+                ++it;
+                continue;
             }
+
+            MediaCopyJob *job = MediaCopier::copy(oldMediaPath, newMediaPath);
+            QString mediaName = media->name();
+            this->m_copyJobs.append(job);
+            this->m_totalBytes += job->totalBytes();
+
+            connect(job, &MediaCopyJob::progressChanged,
+                    this, &ImportMediaPage::updateCopyProgress);
+            connect(job, &MediaCopyJob::finished,
+                    this, [=](bool success) {
+                this->copyJobFinished(job, mediaName, success);
+            });
         }
         ++it;
     }
 
-    if (!machineImported) {
-        return false;
+    if (archive && !archiveDestinations.isEmpty()) {
+        this->m_archiveJob = MachineArchive::importMachine(machineConfigFilePath, archiveDestinations);
+
+        connect(this->m_archiveJob, &MachineArchiveJob::progressChanged,
+                this, [=](qint64 bytesProcessed, qint64 totalBytes) {
+            if (totalBytes > 0) {
+                this->m_copyProgressBar->setValue(static_cast<int>(bytesProcessed * 1000 / totalBytes));
+            }
+        });
+        connect(this->m_archiveJob, &MachineArchiveJob::finished,
+                this, &ImportMediaPage::archiveJobFinished);
+    } else if (this->m_copyJobs.isEmpty()) {
+        return this->saveImportedMachine();
+    }
+
+    this->m_machineMediaTree->setEnabled(false);
+    this->m_copyProgressBar->setValue(0);
+    this->m_copyProgressBar->setVisible(true);
+    this->m_cancelCopyButton->setEnabled(true);
+    this->m_cancelCopyButton->setVisible(true);
+
+    return false;
+}
+
+/**
+ * @brief A copy is finished
+ * @param job, job of the copy
+ * @param mediaName, name of the copied media
+ * @param success, true if the media is copied
+ *
+ * When all the copies are finished, save the
+ * imported machine and finish the wizard
+ */
+void ImportMediaPage::copyJobFinished(MediaCopyJob *job, const QString &mediaName, bool success)
+{
+    this->m_copyJobs.removeOne(job);
+    this->m_finishedBytes += job->totalBytes();
+
+    if (!success && !job->isCancelled()) {
+        this->m_failedMedia.append(mediaName + ": " + job->errorString());
+    }
+
+    this->updateCopyProgress();
+
+    if (!this->m_copyJobs.isEmpty()) {
+        return;
+    }
+
+    this->m_machineMediaTree->setEnabled(true);
+    this->m_copyProgressBar->setVisible(false);
+    this->m_cancelCopyButton->setVisible(false);
+
+    if (this->m_copyCancelled) {
+        return;
+    }
+
+    if (!this->m_failedMedia.isEmpty()) {
+        SystemUtils::showMessage(tr("Qtemu - Critical error"),
+                                 tr("<p>Cannot import the media: </p>") +
+                                 this->m_failedMedia.join("<br>"),
+                                 QMessageBox::Critical);
+        return;
+    }
+
+    if (this->saveImportedMachine()) {
+        this->wizard()->accept();
     }
+}
+
+/**
+ * @brief Cancel the copy
+ *
+ * Cancel all the copies. The partial files are removed
+ */
+void ImportMediaPage::cancelCopy()
+{
+    this->m_copyCancelled = true;
+    this->m_cancelCopyButton->setEnabled(false);
+
+    foreach (MediaCopyJob *job, this->m_copyJobs) {
+        job->cancel();
+    }
+
+    if (this->m_archiveJob != nullptr) {
+        this->m_archiveJob->cancel();
+    }
+}
+
+/**
+ * @brief Update the progress of the copy
+ *
+ * Update the progress bar with the bytes copied by all the jobs
+ */
+void ImportMediaPage::updateCopyProgress()
+{
+    if (this->m_totalBytes <= 0) {
+        return;
+    }
+
+    qint64 bytesCopied = this->m_finishedBytes;
+    foreach (MediaCopyJob *job, this->m_copyJobs) {
+        bytesCopied += job->bytesCopied();
+    }
+
+    this->m_copyProgressBar->setValue(static_cast<int>(bytesCopied * 1000 / this->m_totalBytes));
+}
+
+/**
+ * @brief Save the imported machine
+ * @return true if the machine is saved
+ *
+ * Save the machine in the destination folder and
+ * add it to the machines file and to the list
+ */
+bool ImportMediaPage::saveImportedMachine()
+{
+    QString machineDestinationPath = field("machineDestinationPath").toString();
+    QString machineConfigFilePath = field("configFilePath").toString();
+
+    QFileInfo machineConfigFileInfo(machineConfigFilePath);
+
+    // The configuration of an archive is named after the machine
+    QString machineConfigFileName = machineConfigFileInfo.fileName();
+    if (MachineArchive::isArchive(machineConfigFilePath)) {
+        machineConfigFileName = this->m_machine->getName().toLower().replace(" ", "_") + ".json";
+    }
+
+    QString machineConfigFilePathNew =
+            QDir::toNativeSeparators(machineDestinationPath + "/" + machineConfigFileName);
 
     this->m_machine->setPath(machineDestinationPath);
     this->m_machine->setConfigPath(machineConfigFilePathNew);
     this->m_machine->setUuid(QUuid::createUuid());
 
-    machineImported = this->m_machine->saveMachine();
+    bool machineImported = this->m_machine->saveMachine();
 
     // Write the new machine in machines file (the file with all the machines)
     this->m_machine->insertMachineConfigFile();
 
     this->insertVMList();
 
+    this->m_copyFinished = machineImported;
+
     return machineImported;
 }
 
+/**
+ * @brief The media of the archive is extracted
+ * @param success, true if the media is extracted
+ *
+ * Save the imported machine and finish the wizard
+ */
+void ImportMediaPage::archiveJobFinished(bool success)
+{
+    QString errorString = this->m_archiveJob->errorString();
+    this->m_archiveJob = nullptr;
+
+    this->m_machineMediaTree->setEnabled(true);
+    this->m_copyProgressBar->setVisible(false);
+    this->m_cancelCopyButton->setVisible(false);
+
+    if (this->m_copyCancelled) {
+        return;
+    }
+
+    if (!success) {
+        SystemUtils::showMessage(tr("Qtemu - Critical error"),
+                                 tr("<p>Cannot import the media: </p>") + errorString,
+                                 QMessageBox::Critical);
+        return;
+    }
+
+    if (this->saveImportedMachine()) {
+        this->wizard()->accept();
+    }
+}
+
 void ImportMediaPage::insertVMList()
 {
     QListWidgetItem *machine = new QListWidgetItem(this->m_machine->getName(), this->m_osList);
@@ -27,11 +27,16 @@
 #include <QLabel>
 #include <QTreeWidget>
 #include <QListWidget>
+#include <QProgressBar>
+#include <QPushButton>
 
 #include <QDebug>
 
 // Local
 #include "../machine.h"
+#include "../utils/systemutils.h"
+#include "../utils/mediacopier.h"
+#include "machinearchive.h"
 
 class ImportMediaPage: public QWizardPage {
     Q_OBJECT
@@ -47,11 +52,15 @@ class ImportMediaPage: public QWizardPage {
     public slots:
 
     private slots:
+        void cancelCopy();
+        void updateCopyProgress();
+        void archiveJobFinished(bool success);
 
     protected:
 
     private:
         QHBoxLayout *m_mediaLayout;
+        QHBoxLayout *m_copyLayout;
         QVBoxLayout *m_mainLayout;
 
         QTreeWidget *m_machineMediaTree;
@@ -59,6 +68,17 @@ class ImportMediaPage: public QWizardPage {
 
         QLabel *m_infoLabel;
 
+        QProgressBar *m_copyProgressBar;
+        QPushButton *m_cancelCopyButton;
+
+        QList<MediaCopyJob *> m_copyJobs;
+        MachineArchiveJob *m_archiveJob;
+        QStringList m_failedMedia;
+        qint64 m_totalBytes;
+        qint64 m_finishedBytes;
+        bool m_copyCancelled;
+        bool m_copyFinished;
+
         QListWidget *m_osList;
 
         Machine *m_machine;
@@ -67,6 +87,8 @@ class ImportMediaPage: public QWizardPage {
         void initializePage();
         bool validatePage();
         void insertVMList();
+        void copyJobFinished(MediaCopyJob *job, const QString &mediaName, bool success);
+        bool saveImportedMachine();
 };
 
 #endif // IMPORTMEDIAPAGE_H
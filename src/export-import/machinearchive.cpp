@@ -0,0 +1,763 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machinearchive.h"
+
+// GNU
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#ifdef QTEMU_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+/*
+ * Layout of a .qtemu archive:
+ *
+ *   "QTEMUARC", version, manifest size, manifest (JSON)
+ *   For every disk of the manifest, in order:
+ *     Chunk records: type, offset, raw size, stored size,
+ *                    codec, SHA-256 of the raw data, data
+ *     End of disk record
+ *
+ * The chunks are compressed independently, so they can be
+ * compressed and decompressed in parallel. Holes and zero
+ * chunks aren't stored
+ */
+static const char ARCHIVE_MAGIC[] = "QTEMUARC";
+static const int ARCHIVE_MAGIC_SIZE = 8;
+static const quint32 ARCHIVE_VERSION = 1;
+static const quint32 CHUNK_SIZE = 4 * 1024 * 1024;
+static const quint32 MAX_MANIFEST_SIZE = 16 * 1024 * 1024;
+static const int CHECKSUM_SIZE = 32;
+static const int ZSTD_LEVEL = 3;
+
+/**
+ * @brief Machine archive job
+ * @param archivePath, path of the archive
+ * @param parent, parent object
+ *
+ * Export or import of a machine archive. The archive is
+ * processed in a thread and reports the progress with signals
+ */
+MachineArchiveJob::MachineArchiveJob(const QString &archivePath,
+                                     QObject *parent) : QObject(parent)
+{
+    this->m_archivePath = archivePath;
+    this->m_bytesProcessed = 0;
+    this->m_totalBytes = 0;
+    this->m_cancelled = false;
+
+    qDebug() << "MachineArchiveJob created";
+}
+
+MachineArchiveJob::~MachineArchiveJob()
+{
+    qDebug() << "MachineArchiveJob destroyed";
+}
+
+/**
+ * @brief Get the path of the archive
+ * @return path of the archive
+ *
+ * Get the path of the archive
+ */
+QString MachineArchiveJob::archivePath() const
+{
+    return m_archivePath;
+}
+
+/**
+ * @brief Get the processed bytes
+ * @return bytes of the disks processed, holes included
+ *
+ * Get the processed bytes
+ */
+qint64 MachineArchiveJob::bytesProcessed() const
+{
+    return m_bytesProcessed;
+}
+
+/**
+ * @brief Get the size of the disks
+ * @return size of all the disks
+ *
+ * Get the size of the disks
+ */
+qint64 MachineArchiveJob::totalBytes() const
+{
+    return m_totalBytes;
+}
+
+/**
+ * @brief Get the error of the job
+ * @return description of the problem
+ *
+ * Get the error of the job
+ */
+QString MachineArchiveJob::errorString() const
+{
+    return m_errorString;
+}
+
+/**
+ * @brief Get if the job is cancelled
+ * @return true if the job is cancelled
+ *
+ * Get if the job is cancelled
+ */
+bool MachineArchiveJob::isCancelled() const
+{
+    return m_cancelled;
+}
+
+/**
+ * @brief Cancel the job
+ *
+ * Cancel the job. The job stops after the current chunks
+ * and the partial files are removed
+ */
+void MachineArchiveJob::cancel()
+{
+    this->m_cancelled = true;
+}
+
+/**
+ * @brief Update the progress of the job
+ * @param bytesProcessed, bytes processed
+ * @param totalBytes, size of all the disks
+ *
+ * Update the progress of the job
+ */
+void MachineArchiveJob::updateProgress(qint64 bytesProcessed, qint64 totalBytes)
+{
+    this->m_bytesProcessed = bytesProcessed;
+    this->m_totalBytes = totalBytes;
+
+    emit(progressChanged(this->m_bytesProcessed, this->m_totalBytes));
+}
+
+/**
+ * @brief Finish the job
+ * @param success, true if the archive is processed
+ * @param errorString, description of the problem
+ *
+ * Finish the job. The job is deleted later
+ */
+void MachineArchiveJob::finishArchive(bool success, const QString &errorString)
+{
+    this->m_errorString = errorString;
+
+    qDebug() << "Machine archive processed" << this->m_archivePath << success;
+
+    emit(finished(success));
+
+    this->deleteLater();
+}
+
+MachineArchive::MachineArchive()
+{
+    qDebug() << "MachineArchive created";
+}
+
+MachineArchive::~MachineArchive()
+{
+    qDebug() << "MachineArchive destroyed";
+}
+
+/**
+ * @brief Export a machine to an archive
+ * @param archivePath, path of the new archive
+ * @param machineJSON, data of the machine
+ * @param disks, disks included in the archive
+ * @return job, deleted when the archive is written
+ *
+ * Write the archive in a thread
+ */
+MachineArchiveJob *MachineArchive::exportMachine(const QString &archivePath,
+                                                 const QJsonObject &machineJSON,
+                                                 const QList<ArchiveDisk> &disks)
+{
+    MachineArchiveJob *job = new MachineArchiveJob(archivePath);
+
+    return MachineArchive::startJob(job, [=](MachineArchiveJob *archiveJob, QString &error) {
+        return MachineArchive::writeArchive(archivePath, machineJSON, disks, archiveJob->m_cancelled,
+                                            [archiveJob](qint64 bytesProcessed, qint64 totalBytes) {
+            QMetaObject::invokeMethod(archiveJob, "updateProgress", Qt::QueuedConnection,
+                                      Q_ARG(qint64, bytesProcessed),
+                                      Q_ARG(qint64, totalBytes));
+        }, error);
+    });
+}
+
+/**
+ * @brief Import a machine from an archive
+ * @param archivePath, path of the archive
+ * @param destinations, path of every disk to extract, by name
+ * @return job, deleted when the disks are extracted
+ *
+ * Extract the disks of the archive in a thread
+ */
+MachineArchiveJob *MachineArchive::importMachine(const QString &archivePath,
+                                                 const QHash<QString, QString> &destinations)
+{
+    MachineArchiveJob *job = new MachineArchiveJob(archivePath);
+
+    return MachineArchive::startJob(job, [=](MachineArchiveJob *archiveJob, QString &error) {
+        return MachineArchive::readArchive(archivePath, destinations, archiveJob->m_cancelled,
+                                           [archiveJob](qint64 bytesProcessed, qint64 totalBytes) {
+            QMetaObject::invokeMethod(archiveJob, "updateProgress", Qt::QueuedConnection,
+                                      Q_ARG(qint64, bytesProcessed),
+                                      Q_ARG(qint64, totalBytes));
+        }, error);
+    });
+}
+
+/**
+ * @brief Check if a file is a machine archive
+ * @param path, path of the file
+ * @return true if the file starts with the archive magic
+ *
+ * Check if a file is a machine archive
+ */
+bool MachineArchive::isArchive(const QString &path)
+{
+    QFile archiveFile(path);
+    if (!archiveFile.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    return archiveFile.read(ARCHIVE_MAGIC_SIZE) == QByteArray(ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE);
+}
+
+/**
+ * @brief Read the manifest of an archive
+ * @param archivePath, path of the archive
+ * @param error, description of the problem
+ * @return manifest, empty if the archive cannot be read
+ *
+ * Read the manifest of an archive. The manifest has the
+ * data of the machine and the list of disks
+ */
+QJsonObject MachineArchive::readManifest(const QString &archivePath, QString &error)
+{
+    QJsonObject manifest;
+
+    QFile archiveFile(archivePath);
+    if (!archiveFile.open(QFile::ReadOnly)) {
+        error = archiveFile.errorString();
+        return manifest;
+    }
+
+    QDataStream stream(&archiveFile);
+    MachineArchive::readHeader(stream, manifest, error);
+
+    return manifest;
+}
+
+/**
+ * @brief Write an archive
+ * @param archivePath, path of the new archive
+ * @param machineJSON, data of the machine
+ * @param disks, disks included in the archive
+ * @param cancelled, true when the job must stop
+ * @param progress, function called with the processed bytes
+ * @param error, description of the problem
+ * @return true if the archive is written
+ *
+ * Write the manifest and stream the data regions of every
+ * disk. The archive only replaces the destination when
+ * it's complete
+ */
+bool MachineArchive::writeArchive(const QString &archivePath, const QJsonObject &machineJSON,
+                                  const QList<ArchiveDisk> &disks, const std::atomic_bool &cancelled,
+                                  ProgressCallback progress, QString &error)
+{
+    QJsonArray disksArray;
+    qint64 totalBytes = 0;
+    foreach (const ArchiveDisk &disk, disks) {
+        QJsonObject diskObject;
+        diskObject["name"] = disk.name;
+        diskObject["size"] = QFileInfo(disk.path).size();
+        disksArray.append(diskObject);
+
+        totalBytes += QFileInfo(disk.path).size();
+    }
+
+    QJsonObject manifest;
+    manifest["version"]   = static_cast<int>(ARCHIVE_VERSION);
+    manifest["chunkSize"] = static_cast<int>(CHUNK_SIZE);
+    manifest["machine"]   = machineJSON;
+    manifest["disks"]     = disksArray;
+
+    QSaveFile archiveFile(archivePath);
+    if (!archiveFile.open(QFile::WriteOnly)) {
+        error = archiveFile.errorString();
+        return false;
+    }
+
+    QByteArray manifestData = QJsonDocument(manifest).toJson(QJsonDocument::Compact);
+
+    QDataStream stream(&archiveFile);
+    stream.writeRawData(ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE);
+    stream << ARCHIVE_VERSION;
+    stream << static_cast<quint32>(manifestData.size());
+    stream.writeRawData(manifestData.constData(), manifestData.size());
+
+    int batchSize = MachineArchive::threadPool()->maxThreadCount() * 2;
+    qint64 processedBytes = 0;
+
+    foreach (const ArchiveDisk &disk, disks) {
+        QFile diskFile(disk.path);
+        if (!diskFile.open(QFile::ReadOnly | QFile::Unbuffered)) {
+            error = QObject::tr("Cannot open %1: %2").arg(disk.path, diskFile.errorString());
+            archiveFile.cancelWriting();
+            return false;
+        }
+
+        qint64 diskSize = diskFile.size();
+        qint64 offset = 0;
+
+        while (offset < diskSize) {
+            if (cancelled) {
+                error = QObject::tr("The export has been cancelled");
+                archiveFile.cancelWriting();
+                return false;
+            }
+
+            std::vector<ArchiveChunk> chunks;
+            while (static_cast<int>(chunks.size()) < batchSize && offset < diskSize) {
+                qint64 dataStart = offset;
+                qint64 dataEnd = diskSize;
+#ifdef Q_OS_LINUX
+                // Skip the holes of sparse images
+                off_t nextData = ::lseek(diskFile.handle(), offset, SEEK_DATA);
+                if (nextData < 0 && errno == ENXIO) {
+                    offset = diskSize;
+                    break;
+                } else if (nextData >= 0) {
+                    dataStart = nextData;
+                    off_t nextHole = ::lseek(diskFile.handle(), dataStart, SEEK_HOLE);
+                    if (nextHole >= 0) {
+                        dataEnd = nextHole;
+                    }
+                }
+#endif
+                qint64 length = qMin<qint64>(CHUNK_SIZE, dataEnd - dataStart);
+
+                ArchiveChunk chunk;
+                chunk.offset = dataStart;
+                chunk.rawSize = static_cast<quint32>(length);
+                chunk.codec = MachineArchive::Stored;
+                chunk.valid = false;
+
+                if (!diskFile.seek(dataStart)) {
+                    error = diskFile.errorString();
+                    archiveFile.cancelWriting();
+                    return false;
+                }
+                chunk.raw = diskFile.read(length);
+                if (chunk.raw.size() != length) {
+                    error = QObject::tr("Cannot read %1: %2").arg(disk.path, diskFile.errorString());
+                    archiveFile.cancelWriting();
+                    return false;
+                }
+
+                offset = dataStart + length;
+
+                if (!MediaCopier::isZeroBlock(chunk.raw.constData(), chunk.raw.size())) {
+                    chunks.push_back(chunk);
+                }
+            }
+
+            MachineArchive::processChunks(chunks, true);
+
+            for (const ArchiveChunk &chunk : chunks) {
+                stream << static_cast<quint8>(MachineArchive::Chunk);
+                stream << static_cast<quint64>(chunk.offset);
+                stream << chunk.rawSize;
+                stream << static_cast<quint32>(chunk.stored.size());
+                stream << chunk.codec;
+                stream.writeRawData(chunk.checksum.constData(), CHECKSUM_SIZE);
+                stream.writeRawData(chunk.stored.constData(), chunk.stored.size());
+            }
+
+            if (stream.status() != QDataStream::Ok) {
+                error = archiveFile.errorString();
+                archiveFile.cancelWriting();
+                return false;
+            }
+
+            progress(processedBytes + offset, totalBytes);
+        }
+
+        stream << static_cast<quint8>(MachineArchive::EndOfDisk);
+        processedBytes += diskSize;
+    }
+
+    if (!archiveFile.commit()) {
+        error = archiveFile.errorString();
+        return false;
+    }
+
+    progress(totalBytes, totalBytes);
+
+    return true;
+}
+
+/**
+ * @brief Read an archive
+ * @param archivePath, path of the archive
+ * @param destinations, path of every disk to extract, by name
+ * @param cancelled, true when the job must stop
+ * @param progress, function called with the processed bytes
+ * @param error, description of the problem
+ * @return true if the disks are extracted
+ *
+ * Stream the archive and write the chunks of the selected
+ * disks in their destination. Every chunk is checked with
+ * its checksum. If there's a problem, the extracted
+ * disks are removed
+ */
+bool MachineArchive::readArchive(const QString &archivePath, const QHash<QString, QString> &destinations,
+                                 const std::atomic_bool &cancelled, ProgressCallback progress,
+                                 QString &error)
+{
+    QFile archiveFile(archivePath);
+    if (!archiveFile.open(QFile::ReadOnly)) {
+        error = archiveFile.errorString();
+        return false;
+    }
+
+    QDataStream stream(&archiveFile);
+    QJsonObject manifest;
+    if (!MachineArchive::readHeader(stream, manifest, error)) {
+        return false;
+    }
+
+    QJsonArray disksArray = manifest["disks"].toArray();
+    qint64 totalBytes = 0;
+    for (int i = 0; i < disksArray.size(); ++i) {
+        totalBytes += disksArray[i].toObject()["size"].toVariant().toLongLong();
+    }
+
+    int batchSize = MachineArchive::threadPool()->maxThreadCount() * 2;
+    qint64 processedBytes = 0;
+    QStringList extractedDisks;
+    bool extracted = true;
+
+    for (int i = 0; i < disksArray.size() && extracted; ++i) {
+        QJsonObject diskObject = disksArray[i].toObject();
+        qint64 diskSize = diskObject["size"].toVariant().toLongLong();
+        QString destination = destinations.value(diskObject["name"].toString());
+
+        // The disks that aren't selected are skipped
+        QFile diskFile(destination);
+        bool extractDisk = !destination.isEmpty();
+        if (extractDisk) {
+            if (!diskFile.open(QFile::WriteOnly | QFile::Truncate) || !diskFile.resize(diskSize)) {
+                error = QObject::tr("Cannot create %1: %2").arg(destination, diskFile.errorString());
+                extracted = false;
+                break;
+            }
+            extractedDisks.append(destination);
+        }
+
+        bool endOfDisk = false;
+        while (!endOfDisk && extracted) {
+            if (cancelled) {
+                error = QObject::tr("The import has been cancelled");
+                extracted = false;
+                break;
+            }
+
+            std::vector<ArchiveChunk> chunks;
+            while (static_cast<int>(chunks.size()) < batchSize) {
+                quint8 record;
+                stream >> record;
+
+                if (stream.status() == QDataStream::Ok && record == MachineArchive::EndOfDisk) {
+                    endOfDisk = true;
+                    break;
+                }
+
+                ArchiveChunk chunk;
+                quint64 chunkOffset;
+                quint32 storedSize;
+                stream >> chunkOffset >> chunk.rawSize >> storedSize >> chunk.codec;
+                chunk.offset = chunkOffset;
+                chunk.valid = false;
+
+                if (stream.status() != QDataStream::Ok || record != MachineArchive::Chunk ||
+                    chunk.rawSize > CHUNK_SIZE || storedSize > CHUNK_SIZE * 2 ||
+                    chunk.offset + chunk.rawSize > static_cast<quint64>(diskSize)) {
+                    error = QObject::tr("The archive is damaged");
+                    extracted = false;
+                    break;
+                }
+
+                chunk.checksum.resize(CHECKSUM_SIZE);
+                stream.readRawData(chunk.checksum.data(), CHECKSUM_SIZE);
+
+                if (extractDisk) {
+                    chunk.stored.resize(storedSize);
+                    stream.readRawData(chunk.stored.data(), storedSize);
+                } else {
+                    stream.skipRawData(storedSize);
+                }
+
+                if (stream.status() != QDataStream::Ok) {
+                    error = QObject::tr("The archive is incomplete");
+                    extracted = false;
+                    break;
+                }
+
+                if (extractDisk) {
+                    chunks.push_back(chunk);
+                }
+            }
+
+            if (!extracted) {
+                break;
+            }
+
+            MachineArchive::processChunks(chunks, false);
+
+            qint64 lastOffset = 0;
+            for (const ArchiveChunk &chunk : chunks) {
+                if (!chunk.valid) {
+                    error = QObject::tr("Wrong checksum in %1 at offset %2")
+                            .arg(destination).arg(chunk.offset);
+                    extracted = false;
+                    break;
+                }
+
+                if (!diskFile.seek(chunk.offset) || diskFile.write(chunk.raw) != chunk.raw.size()) {
+                    error = QObject::tr("Cannot write %1: %2").arg(destination, diskFile.errorString());
+                    extracted = false;
+                    break;
+                }
+
+                lastOffset = chunk.offset + chunk.rawSize;
+            }
+
+            progress(processedBytes + (endOfDisk ? diskSize : lastOffset), totalBytes);
+        }
+
+        if (diskFile.isOpen()) {
+            diskFile.close();
+        }
+        processedBytes += diskSize;
+    }
+
+    if (!extracted) {
+        foreach (const QString &disk, extractedDisks) {
+            QFile::remove(disk);
+        }
+        return false;
+    }
+
+    progress(totalBytes, totalBytes);
+
+    return true;
+}
+
+/**
+ * @brief Read the header of an archive
+ * @param stream, stream of the archive
+ * @param manifest, manifest of the archive
+ * @param error, description of the problem
+ * @return true if the header is valid
+ *
+ * Read the magic, the version and the manifest
+ */
+bool MachineArchive::readHeader(QDataStream &stream, QJsonObject &manifest, QString &error)
+{
+    QByteArray magic(ARCHIVE_MAGIC_SIZE, '\0');
+    stream.readRawData(magic.data(), ARCHIVE_MAGIC_SIZE);
+    if (magic != QByteArray(ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE)) {
+        error = QObject::tr("The file isn't a QtEmu archive");
+        return false;
+    }
+
+    quint32 version;
+    quint32 manifestSize;
+    stream >> version >> manifestSize;
+    if (stream.status() != QDataStream::Ok || version > ARCHIVE_VERSION ||
+        manifestSize > MAX_MANIFEST_SIZE) {
+        error = QObject::tr("The version of the archive isn't supported");
+        return false;
+    }
+
+    QByteArray manifestData(manifestSize, '\0');
+    stream.readRawData(manifestData.data(), manifestSize);
+
+    QJsonParseError parseError;
+    QJsonDocument manifestDocument = QJsonDocument::fromJson(manifestData, &parseError);
+    if (stream.status() != QDataStream::Ok || parseError.error != QJsonParseError::NoError) {
+        error = QObject::tr("The manifest of the archive is damaged");
+        return false;
+    }
+
+    manifest = manifestDocument.object();
+
+    return true;
+}
+
+/**
+ * @brief Compress a chunk
+ * @param chunk, chunk with the raw data
+ *
+ * Compress a chunk with zstd, or zlib if QtEmu is built without zstd.
+ * If the data doesn't compress, the chunk is stored as is
+ */
+void MachineArchive::compressChunk(ArchiveChunk *chunk)
+{
+    chunk->checksum = QCryptographicHash::hash(chunk->raw, QCryptographicHash::Sha256);
+
+#ifdef QTEMU_HAS_ZSTD
+    chunk->stored.resize(static_cast<int>(ZSTD_compressBound(chunk->raw.size())));
+    size_t storedSize = ZSTD_compress(chunk->stored.data(), chunk->stored.size(),
+                                      chunk->raw.constData(), chunk->raw.size(), ZSTD_LEVEL);
+    if (!ZSTD_isError(storedSize)) {
+        chunk->stored.resize(static_cast<int>(storedSize));
+        chunk->codec = MachineArchive::Zstd;
+    } else {
+        chunk->stored.clear();
+    }
+#else
+    chunk->stored = qCompress(chunk->raw);
+    chunk->codec = MachineArchive::Zlib;
+#endif
+
+    if (chunk->stored.isEmpty() || chunk->stored.size() >= chunk->raw.size()) {
+        chunk->stored = chunk->raw;
+        chunk->codec = MachineArchive::Stored;
+    }
+
+    chunk->raw.clear();
+}
+
+/**
+ * @brief Decompress a chunk
+ * @param chunk, chunk with the stored data
+ *
+ * Decompress a chunk and check its checksum
+ */
+void MachineArchive::decompressChunk(ArchiveChunk *chunk)
+{
+    switch (chunk->codec) {
+        case MachineArchive::Stored:
+            chunk->raw = chunk->stored;
+            break;
+        case MachineArchive::Zlib:
+            chunk->raw = qUncompress(chunk->stored);
+            break;
+        case MachineArchive::Zstd:
+#ifdef QTEMU_HAS_ZSTD
+            {
+                chunk->raw.resize(chunk->rawSize);
+                size_t rawSize = ZSTD_decompress(chunk->raw.data(), chunk->raw.size(),
+                                                 chunk->stored.constData(), chunk->stored.size());
+                if (ZSTD_isError(rawSize)) {
+                    chunk->raw.clear();
+                }
+            }
+#endif
+            break;
+    }
+
+    chunk->stored.clear();
+    chunk->valid = chunk->raw.size() == static_cast<int>(chunk->rawSize) &&
+                   QCryptographicHash::hash(chunk->raw, QCryptographicHash::Sha256) == chunk->checksum;
+}
+
+/**
+ * @brief Compress or decompress chunks in parallel
+ * @param chunks, chunks to process
+ * @param compress, true to compress, false to decompress
+ *
+ * Process the chunks in the threads of the pool and
+ * wait until all of them are finished
+ */
+void MachineArchive::processChunks(std::vector<ArchiveChunk> &chunks, bool compress)
+{
+    QSemaphore processedChunks;
+
+    for (ArchiveChunk &chunk : chunks) {
+        ArchiveChunk *chunkPointer = &chunk;
+        MachineArchive::threadPool()->start([chunkPointer, compress, &processedChunks]() {
+            if (compress) {
+                MachineArchive::compressChunk(chunkPointer);
+            } else {
+                MachineArchive::decompressChunk(chunkPointer);
+            }
+            processedChunks.release();
+        });
+    }
+
+    processedChunks.acquire(static_cast<int>(chunks.size()));
+}
+
+/**
+ * @brief Start a job in its own thread
+ * @param job, job of the archive
+ * @param task, function that processes the archive
+ * @return job
+ *
+ * Start a job in its own thread. The chunks are processed
+ * in the pool, so the thread only reads and writes
+ */
+MachineArchiveJob *MachineArchive::startJob(MachineArchiveJob *job,
+                                            std::function<bool(MachineArchiveJob *job, QString &error)> task)
+{
+    QThread *thread = QThread::create([job, task]() {
+        QString error;
+        bool success = task(job, error);
+
+        QMetaObject::invokeMethod(job, "finishArchive", Qt::QueuedConnection,
+                                  Q_ARG(bool, success),
+                                  Q_ARG(QString, error));
+    });
+
+    QObject::connect(thread, &QThread::finished,
+                     thread, &QObject::deleteLater);
+    thread->start();
+
+    return job;
+}
+
+/**
+ * @brief Get the pool of the chunks
+ * @return thread pool
+ *
+ * Get the pool of the chunks, with one thread per core
+ */
+QThreadPool *MachineArchive::threadPool()
+{
+    // Created once even if several jobs start at the same time,
+    // it has one thread per core by default
+    static QThreadPool pool;
+
+    return &pool;
+}
@@ -0,0 +1,139 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINEARCHIVE_H
+#define MACHINEARCHIVE_H
+
+// Qt
+#include <QObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QHash>
+#include <QDebug>
+
+// C++ standard library
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// Local
+#include "../utils/mediacopier.h"
+
+struct ArchiveDisk {
+    QString name;
+    QString path;
+};
+
+class MachineArchiveJob : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MachineArchiveJob(const QString &archivePath,
+                                   QObject *parent = nullptr);
+        ~MachineArchiveJob();
+
+        QString archivePath() const;
+        qint64 bytesProcessed() const;
+        qint64 totalBytes() const;
+        QString errorString() const;
+        bool isCancelled() const;
+
+        void cancel();
+
+    signals:
+        void progressChanged(qint64 bytesProcessed, qint64 totalBytes);
+        void finished(bool success);
+
+    private slots:
+        void updateProgress(qint64 bytesProcessed, qint64 totalBytes);
+        void finishArchive(bool success, const QString &errorString);
+
+    private:
+        friend class MachineArchive;
+
+        QString m_archivePath;
+        qint64 m_bytesProcessed;
+        qint64 m_totalBytes;
+        QString m_errorString;
+        std::atomic_bool m_cancelled;
+};
+
+class MachineArchive {
+
+    public:
+        MachineArchive();
+        ~MachineArchive();
+
+        typedef std::function<void(qint64 bytesProcessed, qint64 totalBytes)> ProgressCallback;
+
+        static MachineArchiveJob *exportMachine(const QString &archivePath,
+                                                const QJsonObject &machineJSON,
+                                                const QList<ArchiveDisk> &disks);
+        static MachineArchiveJob *importMachine(const QString &archivePath,
+                                                const QHash<QString, QString> &destinations);
+
+        static bool isArchive(const QString &path);
+        static QJsonObject readManifest(const QString &archivePath, QString &error);
+
+        static bool writeArchive(const QString &archivePath, const QJsonObject &machineJSON,
+                                 const QList<ArchiveDisk> &disks, const std::atomic_bool &cancelled,
+                                 ProgressCallback progress, QString &error);
+        static bool readArchive(const QString &archivePath, const QHash<QString, QString> &destinations,
+                                const std::atomic_bool &cancelled, ProgressCallback progress,
+                                QString &error);
+
+    private:
+        enum Codecs {
+            Stored = 0, Zstd = 1, Zlib = 2
+        };
+
+        enum Records {
+            EndOfDisk = 0, Chunk = 1
+        };
+
+        struct ArchiveChunk {
+            quint64 offset;
+            quint32 rawSize;
+            quint8 codec;
+            QByteArray raw;
+            QByteArray stored;
+            QByteArray checksum;
+            bool valid;
+        };
+
+        static bool readHeader(QDataStream &stream, QJsonObject &manifest, QString &error);
+        static void compressChunk(ArchiveChunk *chunk);
+        static void decompressChunk(ArchiveChunk *chunk);
+        static void processChunks(std::vector<ArchiveChunk> &chunks, bool compress);
+        static MachineArchiveJob *startJob(MachineArchiveJob *job,
+                                           std::function<bool(MachineArchiveJob *job, QString &error)> task);
+        static QThreadPool *threadPool();
+};
+
+#endif // MACHINEARCHIVE_H
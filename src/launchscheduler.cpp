@@ -0,0 +1,560 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "launchscheduler.h"
+
+// Time between two admission checks while the machines wait
+static const int POLL_INTERVAL = 1000;
+
+// Time to wait for QMP. QEMU can take a while with a big preallocated memory
+static const int START_TIMEOUT = 120000;
+
+/**
+ * @brief Get if a machine uses huge pages
+ * @param machine, machine
+ * @return true if the memory of the machine is in huge pages
+ *
+ * Get if a machine uses huge pages
+ */
+static bool usesHugePages(Machine *machine)
+{
+    return machine->getHugePageSize() > 0 && machine->getMemoryBackend() != "default";
+}
+
+/**
+ * @brief Launch scheduler
+ * @param QEMUObject, QEMU object used to start the machines
+ * @param parent, parent object
+ *
+ * Start many machines without overloading the host.
+ * The machines are started by priority, a few at a time
+ * and with a minimum interval between two starts. A machine
+ * waits until the host has enough free memory and its
+ * CPUs aren't overloaded. A machine is starting until
+ * QEMU answers in the QMP socket, when the memory is
+ * allocated and the disks are opened
+ */
+LaunchScheduler::LaunchScheduler(QEMU *QEMUObject, QObject *parent) : QObject(parent)
+{
+    this->m_QEMUObject = QEMUObject;
+    this->m_nextSequence = 0;
+    this->m_finishedLaunches = 0;
+    this->m_totalLaunches = 0;
+
+    this->m_scheduleTimer = new QTimer(this);
+    this->m_scheduleTimer->setSingleShot(true);
+    connect(m_scheduleTimer, &QTimer::timeout,
+            this, &LaunchScheduler::schedule);
+
+    this->loadSettings();
+
+    qDebug() << "LaunchScheduler created";
+}
+
+LaunchScheduler::~LaunchScheduler()
+{
+    qDebug() << "LaunchScheduler destroyed";
+}
+
+/**
+ * @brief Add a machine to the queue
+ * @param machine, machine to start
+ * @param priority, the machines with higher priority are started first
+ *
+ * Add a machine to the queue. The machines with
+ * the same priority are started in arrival order
+ */
+void LaunchScheduler::enqueue(Machine *machine, int priority)
+{
+    if (machine == nullptr || this->contains(machine->getUuid())) {
+        return;
+    }
+
+    if (machine->getState() != Machine::Stopped) {
+        emit(launchStateChanged(machine->getUuid(), LaunchScheduler::Failed,
+                                tr("The machine is already running")));
+        return;
+    }
+
+    Launch launch;
+    launch.machine = machine;
+    launch.machineUuid = machine->getUuid();
+    launch.priority = priority;
+    launch.sequence = ++this->m_nextSequence;
+
+    int position = 0;
+    while (position < this->m_queue.size() && this->m_queue.at(position).priority >= priority) {
+        ++position;
+    }
+    this->m_queue.insert(position, launch);
+    ++this->m_totalLaunches;
+
+    emit(launchStateChanged(launch.machineUuid, LaunchScheduler::Queued, QString()));
+    this->updateProgress();
+
+    this->m_scheduleTimer->start(0);
+}
+
+/**
+ * @brief Remove a machine from the queue
+ * @param machineUuid, uuid of the machine
+ * @return true if the machine is removed from the queue
+ *
+ * Remove a machine from the queue. A machine
+ * that is already starting cannot be cancelled,
+ * it must be stopped
+ */
+bool LaunchScheduler::cancel(const QUuid &machineUuid)
+{
+    for (int i = 0; i < this->m_queue.size(); ++i) {
+        if (this->m_queue.at(i).machineUuid == machineUuid) {
+            this->m_queue.removeAt(i);
+            ++this->m_finishedLaunches;
+            emit(launchStateChanged(machineUuid, LaunchScheduler::Cancelled, QString()));
+            this->updateProgress();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Remove all the machines from the queue
+ *
+ * Remove all the machines waiting to be started
+ */
+void LaunchScheduler::cancelAll()
+{
+    while (!this->m_queue.isEmpty()) {
+        this->cancel(this->m_queue.last().machineUuid);
+    }
+}
+
+/**
+ * @brief Get if a machine is queued or starting
+ * @param machineUuid, uuid of the machine
+ * @return true if the machine is queued or starting
+ *
+ * Get if a machine is queued or starting
+ */
+bool LaunchScheduler::contains(const QUuid &machineUuid) const
+{
+    foreach (const Launch &launch, this->m_queue + this->m_starting) {
+        if (launch.machineUuid == machineUuid) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the number of machines queued or starting
+ * @return number of machines
+ *
+ * Get the number of machines queued or starting
+ */
+int LaunchScheduler::pendingLaunches() const
+{
+    return this->m_queue.size() + this->m_starting.size();
+}
+
+/**
+ * @brief Get the number of finished launches
+ * @return number of machines started, failed or cancelled
+ *
+ * Get the number of finished launches since the queue was empty
+ */
+int LaunchScheduler::finishedLaunches() const
+{
+    return this->m_finishedLaunches;
+}
+
+/**
+ * @brief Get the number of launches
+ * @return number of machines added to the queue
+ *
+ * Get the number of machines added since the queue was empty
+ */
+int LaunchScheduler::totalLaunches() const
+{
+    return this->m_totalLaunches;
+}
+
+/**
+ * @brief Set the maximum number of machines starting at the same time
+ * @param maxConcurrent, maximum number of machines
+ *
+ * Set the maximum number of machines starting at the same time
+ */
+void LaunchScheduler::setMaxConcurrent(int maxConcurrent)
+{
+    this->m_maxConcurrent = qMax(1, maxConcurrent);
+    this->m_scheduleTimer->start(0);
+}
+
+/**
+ * @brief Set the minimum time between two starts
+ * @param interval, time in milliseconds
+ *
+ * Set the minimum time between two starts
+ */
+void LaunchScheduler::setStaggerInterval(int interval)
+{
+    this->m_staggerInterval = qMax(0, interval);
+}
+
+/**
+ * @brief Set the memory kept free for the host
+ * @param memoryReserve, memory in MiB
+ *
+ * Set the memory that the machines cannot use
+ */
+void LaunchScheduler::setMemoryReserve(int memoryReserve)
+{
+    this->m_memoryReserve = qMax(0, memoryReserve);
+}
+
+/**
+ * @brief Set the maximum load of the host CPUs
+ * @param maxLoad, load average per CPU, 0 to ignore the load
+ *
+ * The machines aren't started while the load is higher
+ */
+void LaunchScheduler::setMaxLoad(double maxLoad)
+{
+    this->m_maxLoad = qMax(0.0, maxLoad);
+}
+
+/**
+ * @brief Get the name of a state
+ * @param state, state of a launch
+ * @return name of the state
+ *
+ * Get the name of a state, as it's sent to the clients
+ */
+QString LaunchScheduler::stateName(LaunchScheduler::LaunchStates state)
+{
+    switch (state) {
+        case LaunchScheduler::Queued:
+            return "queued";
+        case LaunchScheduler::Waiting:
+            return "waiting";
+        case LaunchScheduler::Starting:
+            return "starting";
+        case LaunchScheduler::Started:
+            return "started";
+        case LaunchScheduler::Failed:
+            return "failed";
+        default:
+            return "cancelled";
+    }
+}
+
+/**
+ * @brief Load the settings
+ *
+ * Load the limits of the scheduler
+ */
+void LaunchScheduler::loadSettings()
+{
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    this->setMaxConcurrent(settings.value("launchConcurrency", 4).toInt());
+    this->setStaggerInterval(settings.value("launchStagger", 500).toInt());
+    this->setMemoryReserve(settings.value("launchMemoryReserve", 1024).toInt());
+    this->setMaxLoad(settings.value("launchMaxLoad", 2.0).toDouble());
+    settings.endGroup();
+}
+
+/**
+ * @brief Start the next machines
+ *
+ * Start the first machine of the queue that can be
+ * admitted. A machine that doesn't fit in the host
+ * doesn't block the machines behind it
+ */
+void LaunchScheduler::schedule()
+{
+    QMutableListIterator<QPointer<Machine>> launchedMachine(this->m_launched);
+    while (launchedMachine.hasNext()) {
+        QPointer<Machine> machine = launchedMachine.next();
+        if (machine.isNull() || machine->getState() == Machine::Stopped) {
+            launchedMachine.remove();
+        }
+    }
+
+    // Machines deleted while they were waiting
+    for (int i = this->m_queue.size() - 1; i >= 0; --i) {
+        if (this->m_queue.at(i).machine.isNull()) {
+            QUuid machineUuid = this->m_queue.takeAt(i).machineUuid;
+            ++this->m_finishedLaunches;
+            emit(launchStateChanged(machineUuid, LaunchScheduler::Cancelled, tr("The machine was removed")));
+        }
+    }
+
+    if (this->m_queue.isEmpty()) {
+        this->updateProgress();
+        return;
+    }
+
+    // Called again when a machine is started
+    if (this->m_starting.size() >= this->m_maxConcurrent) {
+        return;
+    }
+
+    if (this->m_QEMUObject->isSearchingBinaries()) {
+        this->m_scheduleTimer->start(POLL_INTERVAL);
+        return;
+    }
+
+    if (this->m_lastLaunch.isValid() && this->m_lastLaunch.elapsed() < this->m_staggerInterval) {
+        this->m_scheduleTimer->start(static_cast<int>(this->m_staggerInterval - this->m_lastLaunch.elapsed()));
+        return;
+    }
+
+    bool rejected = false;
+    int i = 0;
+    while (i < this->m_queue.size()) {
+        QString reason;
+        LaunchScheduler::Admissions admission = this->admit(this->m_queue.at(i), reason);
+
+        if (admission == LaunchScheduler::Admit) {
+            this->launchMachine(this->m_queue.takeAt(i));
+            this->m_scheduleTimer->start(this->m_staggerInterval);
+            return;
+        }
+
+        if (admission == LaunchScheduler::Reject) {
+            QUuid machineUuid = this->m_queue.takeAt(i).machineUuid;
+            ++this->m_finishedLaunches;
+            emit(launchStateChanged(machineUuid, LaunchScheduler::Failed, reason));
+            rejected = true;
+            continue;
+        }
+
+        Launch &launch = this->m_queue[i];
+        if (launch.waitReason != reason) {
+            launch.waitReason = reason;
+            emit(launchStateChanged(launch.machineUuid, LaunchScheduler::Waiting, reason));
+        }
+        ++i;
+    }
+
+    if (!this->m_queue.isEmpty()) {
+        this->m_scheduleTimer->start(POLL_INTERVAL);
+    }
+
+    if (rejected) {
+        this->updateProgress();
+    }
+}
+
+/**
+ * @brief Check if a machine can be started now
+ * @param launch, launch of the machine
+ * @param reason, description of why the machine cannot be started
+ * @return admission of the machine
+ *
+ * The memory of the machine must fit in the free memory
+ * of the host, without the reserve and the memory that
+ * the machines already started haven't used yet. If it
+ * doesn't fit and no machine is starting, it will never fit
+ */
+LaunchScheduler::Admissions LaunchScheduler::admit(const Launch &launch, QString &reason) const
+{
+    Machine *machine = launch.machine;
+    qlonglong neededRAM = machine->getRAM();
+    int hugePageSize = usesHugePages(machine) ? machine->getHugePageSize() : 0;
+
+    qlonglong freeRAM = 0;
+    if (hugePageSize > 0) {
+        freeRAM = static_cast<qlonglong>(HostUtils::getHugePages().value(hugePageSize)) * hugePageSize / 1024;
+    } else {
+        int availableRAM = 0;
+        HostUtils::getAvailableMemory(availableRAM);
+        freeRAM = availableRAM - this->m_memoryReserve;
+    }
+    freeRAM -= this->reservedMemory(hugePageSize);
+
+    if (freeRAM < neededRAM) {
+        if (this->m_starting.isEmpty()) {
+            reason = tr("Not enough free memory, %1 MiB free and %2 MiB needed")
+                     .arg(qMax(0LL, freeRAM)).arg(neededRAM);
+            return LaunchScheduler::Reject;
+        }
+
+        reason = tr("Waiting for %1 MiB of free memory").arg(neededRAM);
+        return LaunchScheduler::Wait;
+    }
+
+    if (this->m_maxLoad > 0) {
+        double loadAverage = HostUtils::getLoadAverage();
+        if (loadAverage >= this->m_maxLoad) {
+            reason = tr("Waiting for the host CPUs, load %1 per CPU").arg(loadAverage, 0, 'f', 2);
+            return LaunchScheduler::Wait;
+        }
+    }
+
+    return LaunchScheduler::Admit;
+}
+
+/**
+ * @brief Get the memory promised to the started machines
+ * @param hugePageSize, size of the huge pages in KiB, 0 for the normal memory
+ * @return memory in MiB
+ *
+ * A machine uses its memory little by little. The memory
+ * that isn't resident yet is reserved for the machine
+ */
+qlonglong LaunchScheduler::reservedMemory(int hugePageSize) const
+{
+    QList<Machine *> machines;
+    foreach (const Launch &launch, this->m_starting) {
+        if (!launch.machine.isNull()) {
+            machines.append(launch.machine);
+        }
+    }
+
+    // The huge pages are reserved by QEMU when they're mapped
+    if (hugePageSize == 0) {
+        foreach (const QPointer<Machine> &machine, this->m_launched) {
+            if (!machine.isNull() && machine->getState() != Machine::Stopped) {
+                machines.append(machine);
+            }
+        }
+    }
+
+    qlonglong reservedRAM = 0;
+    foreach (Machine *machine, machines) {
+        int machineHugePageSize = usesHugePages(machine) ? machine->getHugePageSize() : 0;
+        if (machineHugePageSize != hugePageSize) {
+            continue;
+        }
+
+        qlonglong residentRAM = 0;
+        if (hugePageSize == 0 && !machine->getMetrics()->isEmpty()) {
+            residentRAM = machine->getMetrics()->last().residentMemory / (1024 * 1024);
+        }
+        reservedRAM += qMax(0LL, machine->getRAM() - residentRAM);
+    }
+
+    return reservedRAM;
+}
+
+/**
+ * @brief Start a machine
+ * @param launch, launch of the machine
+ *
+ * Start a machine and wait for QMP
+ */
+void LaunchScheduler::launchMachine(Launch launch)
+{
+    Machine *machine = launch.machine;
+    qint64 sequence = launch.sequence;
+
+    launch.connections.append(connect(machine, &Machine::machineStateChangedSignal,
+                                      this, [=](Machine::States newState) {
+        if (newState == Machine::Stopped) {
+            this->finishLaunch(sequence, LaunchScheduler::Failed,
+                               tr("QEMU finished while the machine was starting"));
+        }
+    }));
+    launch.connections.append(connect(machine, &Machine::machineStartFailedSignal,
+                                      this, [=](const QUuid &machineUuid, const QString &error) {
+        Q_UNUSED(machineUuid)
+        this->finishLaunch(sequence, LaunchScheduler::Failed, error);
+    }));
+    launch.connections.append(connect(machine->getQMPClient(), &QMPClient::ready,
+                                      this, [=]() {
+        this->finishLaunch(sequence, LaunchScheduler::Started, QString());
+    }));
+
+    this->m_starting.append(launch);
+    this->m_lastLaunch.restart();
+
+    emit(launchStateChanged(launch.machineUuid, LaunchScheduler::Starting, QString()));
+
+    // Without QMP the machine is started when the time is over
+    QTimer::singleShot(START_TIMEOUT, this, [=]() {
+        this->finishLaunch(sequence, LaunchScheduler::Started, tr("QMP isn't available"));
+    });
+
+    machine->runMachine(this->m_QEMUObject);
+}
+
+/**
+ * @brief Finish the launch of a machine
+ * @param sequence, sequence of the launch
+ * @param state, final state of the launch
+ * @param message, description of the state
+ *
+ * Finish the launch of a machine and start the next ones
+ */
+void LaunchScheduler::finishLaunch(qint64 sequence, LaunchScheduler::LaunchStates state,
+                                   const QString &message)
+{
+    for (int i = 0; i < this->m_starting.size(); ++i) {
+        if (this->m_starting.at(i).sequence != sequence) {
+            continue;
+        }
+
+        Launch launch = this->m_starting.takeAt(i);
+        foreach (const QMetaObject::Connection &connection, launch.connections) {
+            disconnect(connection);
+        }
+
+        if (state == LaunchScheduler::Started && !launch.machine.isNull()) {
+            this->m_launched.append(launch.machine);
+        }
+
+        ++this->m_finishedLaunches;
+        emit(launchStateChanged(launch.machineUuid, state, message));
+
+        this->updateProgress();
+        this->schedule();
+        return;
+    }
+}
+
+/**
+ * @brief Notify the progress
+ *
+ * Notify the progress and reset the counters
+ * when all the machines are started
+ */
+void LaunchScheduler::updateProgress()
+{
+    if (this->m_totalLaunches == 0) {
+        return;
+    }
+
+    emit(progressChanged(this->m_finishedLaunches, this->m_totalLaunches));
+
+    if (this->m_queue.isEmpty() && this->m_starting.isEmpty()) {
+        this->m_finishedLaunches = 0;
+        this->m_totalLaunches = 0;
+        this->m_scheduleTimer->stop();
+
+        emit(finished());
+    }
+}
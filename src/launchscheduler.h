@@ -0,0 +1,124 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LAUNCHSCHEDULER_H
+#define LAUNCHSCHEDULER_H
+
+// Qt
+#include <QObject>
+#include <QPointer>
+#include <QList>
+#include <QUuid>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QDebug>
+
+// Local
+#include "machine.h"
+#include "qemu.h"
+#include "utils/hostutils.h"
+
+class LaunchScheduler : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit LaunchScheduler(QEMU *QEMUObject, QObject *parent = nullptr);
+        ~LaunchScheduler();
+
+        enum LaunchStates {
+            Queued, Waiting, Starting, Started, Failed, Cancelled
+        };
+
+        void enqueue(Machine *machine, int priority = 0);
+        bool cancel(const QUuid &machineUuid);
+        void cancelAll();
+        bool contains(const QUuid &machineUuid) const;
+
+        int pendingLaunches() const;
+        int finishedLaunches() const;
+        int totalLaunches() const;
+
+        void setMaxConcurrent(int maxConcurrent);
+        void setStaggerInterval(int interval);
+        void setMemoryReserve(int memoryReserve);
+        void setMaxLoad(double maxLoad);
+
+        static QString stateName(LaunchScheduler::LaunchStates state);
+
+    signals:
+        void launchStateChanged(const QUuid machineUuid,
+                                LaunchScheduler::LaunchStates state,
+                                const QString &message);
+        void progressChanged(int finishedLaunches, int totalLaunches);
+        void finished();
+
+    public slots:
+        void loadSettings();
+
+    private slots:
+        void schedule();
+
+    protected:
+
+    private:
+        enum Admissions {
+            Admit, Wait, Reject
+        };
+
+        struct Launch {
+            QPointer<Machine> machine;
+            QUuid machineUuid;
+            int priority;
+            qint64 sequence;
+            QString waitReason;
+            QList<QMetaObject::Connection> connections;
+        };
+
+        QEMU *m_QEMUObject;
+
+        // Queue sorted by priority and by arrival
+        QList<Launch> m_queue;
+        QList<Launch> m_starting;
+        // Machines started by the scheduler that are still running
+        QList<QPointer<Machine>> m_launched;
+
+        QTimer *m_scheduleTimer;
+        QElapsedTimer m_lastLaunch;
+
+        int m_maxConcurrent;
+        int m_staggerInterval;
+        int m_memoryReserve;
+        double m_maxLoad;
+
+        qint64 m_nextSequence;
+        int m_finishedLaunches;
+        int m_totalLaunches;
+
+        // Methods
+        LaunchScheduler::Admissions admit(const Launch &launch, QString &reason) const;
+        qlonglong reservedMemory(int hugePageSize) const;
+        void launchMachine(Launch launch);
+        void finishLaunch(qint64 sequence, LaunchScheduler::LaunchStates state,
+                          const QString &message);
+        void updateProgress();
+};
+
+#endif // LAUNCHSCHEDULER_H
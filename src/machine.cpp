@@ -21,6 +21,15 @@
 // Local
 #include "machine.h"
 
+// Bytes of QEMU output kept in memory for every machine
+static const int CONSOLE_CAPACITY = 512 * 1024;
+
+// Minimum time between two notifications of QEMU errors
+static const int NOTIFICATION_INTERVAL = 5000;
+
+// Characters of an error stored in the event log
+static const int MAX_ERROR_MESSAGE = 1024;
+
 /**
  * @brief Machine object
  * @param parent, parent widget
@@ -30,12 +39,51 @@
 Machine::Machine(QObject *parent) : QObject(parent)
 {
     this->m_machineProcess = new QProcess(this);
-
-#ifdef Q_OS_WIN
-    this->m_machineTcpSocket = new QTcpSocket(this);
-    connect(m_machineTcpSocket, &QTcpSocket::readyRead,
-            this, &Machine::readMachineStandardOut);
-#endif
+    this->m_QMPClient = new QMPClient(this);
+    this->IOThreads = 0;
+    this->CPUPinning = "none";
+    this->memoryBackend = "default";
+    this->hugePageSize = 0;
+    this->memoryPrealloc = false;
+    this->preallocThreads = 1;
+    this->NUMANodes = 0;
+    this->guestAgent = false;
+    this->m_eventLog = nullptr;
+    this->m_console = new ConsoleBuffer(CONSOLE_CAPACITY, this);
+    this->m_pendingNotifications = 0;
+    this->m_startCount = 0;
+    this->m_stopRequested = false;
+    this->m_guestPanicked = false;
+
+    this->m_notificationTimer = new QTimer(this);
+    this->m_notificationTimer->setSingleShot(true);
+    this->m_notificationTimer->setInterval(NOTIFICATION_INTERVAL);
+    connect(m_notificationTimer, &QTimer::timeout,
+            this, &Machine::sendPendingNotifications);
+
+    connect(m_QMPClient, &QMPClient::ready,
+            this, &Machine::QMPReady);
+    connect(m_QMPClient, &QMPClient::stopped,
+            this, &Machine::QMPStopped);
+    connect(m_QMPClient, &QMPClient::resumed,
+            this, &Machine::QMPResumed);
+    connect(m_QMPClient, &QMPClient::commandFailed,
+            this, &Machine::QMPCommandFailed);
+    connect(m_QMPClient, &QMPClient::eventReceived,
+            this, [=](const QString &event, const QJsonObject &data) {
+        QJsonObject eventData;
+        eventData["event"] = event;
+        eventData["data"] = data;
+        this->recordEvent(MachineEventLog::QMPEvent, eventData);
+
+        if (event == "GUEST_PANICKED") {
+            this->m_guestPanicked = true;
+            this->m_console->append(ConsoleBuffer::Info,
+                                    tr("The guest panicked").toUtf8() + '\n');
+        } else if (event == "SHUTDOWN") {
+            this->m_shutdownReason = data["reason"].toString();
+        }
+    });
     connect(m_machineProcess, &QProcess::readyReadStandardOutput,
             this, &Machine::readMachineStandardOut);
     connect(m_machineProcess, &QProcess::readyReadStandardError,
@@ -44,6 +92,8 @@ Machine::Machine(QObject *parent) : QObject(parent)
             this, &Machine::machineStarted);
     connect(m_machineProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, &Machine::machineFinished);
+    connect(m_machineProcess, &QProcess::errorOccurred,
+            this, &Machine::machineProcessError);
 
     qDebug() << "Machine object created";
 }
@@ -183,6 +233,69 @@ void Machine::setConfigPath(const QString &value)
     configPath = value;
 }
 
+/**
+ * @brief Get the path of the QMP socket
+ * @return path of the QMP socket
+ *
+ * Get the path of the QMP socket.
+ * The socket is created by QEMU in the machine folder
+ * Ex: /home/xexio/Vms/Debian/qmp.sock
+ */
+QString Machine::getQMPSocketPath() const
+{
+    return QDir::toNativeSeparators(QDir(path).filePath("qmp.sock"));
+}
+
+/**
+ * @brief Get the path of the guest agent socket
+ * @return path of the socket, name of the pipe in Windows
+ *
+ * Get the path of the socket of the guest agent channel.
+ * Ex: /home/xexio/Vms/Debian/qga.sock
+ */
+QString Machine::getGuestAgentSocketPath() const
+{
+#ifdef Q_OS_WIN
+    return QString("qtemu-qga-%1").arg(this->uuid.toString(QUuid::WithoutBraces));
+#else
+    return QDir::toNativeSeparators(QDir(path).filePath("qga.sock"));
+#endif
+}
+
+/**
+ * @brief Get if the machine has a guest agent channel
+ * @return true if the channel is added to the command
+ *
+ * Get if the machine has a channel for the guest agent
+ */
+bool Machine::getGuestAgent() const
+{
+    return this->guestAgent;
+}
+
+/**
+ * @brief Set if the machine has a guest agent channel
+ * @param value, true to add the channel to the command
+ *
+ * Set if the machine has a channel for the guest agent.
+ * The channel is added the next time the machine starts
+ */
+void Machine::setGuestAgent(bool value)
+{
+    this->guestAgent = value;
+}
+
+/**
+ * @brief Get the QMP client of the machine
+ * @return QMP client
+ *
+ * Get the QMP client used to control the machine
+ */
+QMPClient *Machine::getQMPClient() const
+{
+    return m_QMPClient;
+}
+
 /**
  * @brief Get the machine uuid
  *
@@ -371,6 +484,50 @@ void Machine::setMaxHotCPU(const int &value)
     maxHotCPU = value;
 }
 
+/**
+ * @brief Get the CPU pinning policy of the machine
+ * @return pinning policy. Ex: none, auto, explicit
+ *
+ * Get how the threads of QEMU are placed in the host CPUs
+ */
+QString Machine::getCPUPinning() const
+{
+    return CPUPinning;
+}
+
+/**
+ * @brief Set the CPU pinning policy of the machine
+ * @param value, pinning policy
+ *
+ * Set the CPU pinning policy of the machine
+ */
+void Machine::setCPUPinning(const QString &value)
+{
+    CPUPinning = value;
+}
+
+/**
+ * @brief Get the host CPUs of the explicit pinning
+ * @return list of host CPUs. Ex: 2-5,8
+ *
+ * Get the host CPUs used with the explicit pinning policy
+ */
+QString Machine::getCPUSet() const
+{
+    return CPUSet;
+}
+
+/**
+ * @brief Set the host CPUs of the explicit pinning
+ * @param value, list of host CPUs
+ *
+ * Set the host CPUs of the explicit pinning
+ */
+void Machine::setCPUSet(const QString &value)
+{
+    CPUSet = value;
+}
+
 /**
  * @brief Get the GPU of the machine
  *
@@ -445,6 +602,163 @@ void Machine::setRAM(const qlonglong &value)
     RAM = value;
 }
 
+/**
+ * @brief Get the memory backend of the machine
+ * @return memory backend. Ex: default, memfd, file
+ *
+ * Get the backend that allocates the RAM of the machine
+ */
+QString Machine::getMemoryBackend() const
+{
+    return memoryBackend;
+}
+
+/**
+ * @brief Set the memory backend of the machine
+ * @param value, memory backend
+ *
+ * Set the memory backend of the machine
+ */
+void Machine::setMemoryBackend(const QString &value)
+{
+    memoryBackend = value;
+}
+
+/**
+ * @brief Get the size of the huge pages
+ * @return size of the huge pages in KiB, 0 without huge pages
+ *
+ * Get the size of the huge pages that back the RAM.
+ * Ex: 2048 or 1048576
+ */
+int Machine::getHugePageSize() const
+{
+    return hugePageSize;
+}
+
+/**
+ * @brief Set the size of the huge pages
+ * @param value, size of the huge pages in KiB
+ *
+ * Set the size of the huge pages
+ */
+void Machine::setHugePageSize(const int &value)
+{
+    hugePageSize = value;
+}
+
+/**
+ * @brief Get the path of the memory backend
+ * @return path of the hugetlbfs, empty to find it
+ *
+ * Get the path used by the file memory backend
+ */
+QString Machine::getMemoryPath() const
+{
+    return memoryPath;
+}
+
+/**
+ * @brief Set the path of the memory backend
+ * @param value, path of the hugetlbfs
+ *
+ * Set the path of the memory backend
+ */
+void Machine::setMemoryPath(const QString &value)
+{
+    memoryPath = value;
+}
+
+/**
+ * @brief Get if the RAM is preallocated
+ * @return true if the RAM is preallocated
+ *
+ * Get if the RAM is allocated when the machine starts
+ */
+bool Machine::getMemoryPrealloc() const
+{
+    return memoryPrealloc;
+}
+
+/**
+ * @brief Set if the RAM is preallocated
+ * @param value, true to preallocate the RAM
+ *
+ * Set if the RAM is preallocated
+ */
+void Machine::setMemoryPrealloc(bool value)
+{
+    memoryPrealloc = value;
+}
+
+/**
+ * @brief Get the threads used to preallocate the RAM
+ * @return number of threads
+ *
+ * Get the threads used to preallocate the RAM
+ */
+int Machine::getPreallocThreads() const
+{
+    return preallocThreads;
+}
+
+/**
+ * @brief Set the threads used to preallocate the RAM
+ * @param value, number of threads
+ *
+ * Set the threads used to preallocate the RAM
+ */
+void Machine::setPreallocThreads(const int &value)
+{
+    preallocThreads = value;
+}
+
+/**
+ * @brief Get the guest NUMA nodes
+ * @return number of guest NUMA nodes, 0 without NUMA
+ *
+ * Get the guest NUMA nodes. The RAM is split
+ * between the nodes
+ */
+int Machine::getNUMANodes() const
+{
+    return NUMANodes;
+}
+
+/**
+ * @brief Set the guest NUMA nodes
+ * @param value, number of guest NUMA nodes
+ *
+ * Set the guest NUMA nodes
+ */
+void Machine::setNUMANodes(const int &value)
+{
+    NUMANodes = value;
+}
+
+/**
+ * @brief Get the host nodes of every guest NUMA node
+ * @return host nodes, one entry per guest node. Ex: 0, 1-2
+ *
+ * Get the host nodes where the memory of every
+ * guest node is bound. Empty entries aren't bound
+ */
+QStringList Machine::getNUMAHostNodes() const
+{
+    return NUMAHostNodes;
+}
+
+/**
+ * @brief Set the host nodes of every guest NUMA node
+ * @param value, host nodes
+ *
+ * Set the host nodes of every guest NUMA node
+ */
+void Machine::setNUMAHostNodes(const QStringList &value)
+{
+    NUMAHostNodes = value;
+}
+
 /**
  * @brief Get the audio cards of the machine
  *
@@ -487,6 +801,51 @@ void Machine::setUseNetwork(bool value)
     useNetwork = value;
 }
 
+/**
+ * @brief Get the network cards of the machine
+ * @return network cards
+ *
+ * Get the network cards of the machine
+ */
+QList<NetworkInterface *> Machine::getNetworkInterfaces() const
+{
+    return networkInterfaces;
+}
+
+/**
+ * @brief Add a network card to the machine
+ * @param networkInterface, network card
+ *
+ * Add a network card to the machine
+ */
+void Machine::addNetworkInterface(NetworkInterface *networkInterface)
+{
+    this->networkInterfaces.append(networkInterface);
+}
+
+/**
+ * @brief Get the number of IOThreads of the machine
+ * @return number of IOThreads
+ *
+ * Get the number of IOThreads that service the disks.
+ * With 0 the disks are serviced from the main loop of QEMU
+ */
+int Machine::getIOThreads() const
+{
+    return IOThreads;
+}
+
+/**
+ * @brief Set the number of IOThreads of the machine
+ * @param value, number of IOThreads
+ *
+ * Set the number of IOThreads of the machine
+ */
+void Machine::setIOThreads(const int &value)
+{
+    IOThreads = value;
+}
+
 /**
  * @brief Get the list of media
  * @return media list
@@ -658,6 +1017,17 @@ void Machine::removeAllMedia()
     this->media.clear();
 }
 
+/**
+ * @brief Remove all the network cards
+ *
+ * Remove all the network cards of the machine
+ */
+void Machine::removeAllNetworkInterfaces()
+{
+    qDeleteAll(this->networkInterfaces);
+    this->networkInterfaces.clear();
+}
+
 /**
  * @brief Get all the audio cards separated by commas
  * @return Audio cards separated by commas
@@ -667,7 +1037,7 @@ void Machine::removeAllMedia()
  */
 QString Machine::getAudioLabel()
 {
-    QHash<QString, QString> soundCardsHash = SystemUtils::getSoundCards();
+    QHash<QString, QString> soundCardsHash = HostUtils::getSoundCards();
     QStringList audioCards = this->audio;
     for(int i = 0; i < audioCards.size(); ++i) {
         audioCards.replace(i, soundCardsHash.value(audioCards.at(i)));
@@ -686,7 +1056,7 @@ QString Machine::getAudioLabel()
  */
 QString Machine::getAcceleratorLabel()
 {
-    QHash<QString, QString> acceleratorsHash = SystemUtils::getAccelerators();
+    QHash<QString, QString> acceleratorsHash = HostUtils::getAccelerators();
     QStringList accel = this->accelerator;
     for(int i = 0; i < accel.size(); ++i) {
         accel.replace(i, acceleratorsHash.value(accel.at(i)));
@@ -696,6 +1066,57 @@ QString Machine::getAcceleratorLabel()
     return acceleratorLabel;
 }
 
+/**
+ * @brief Get the placement of the machine in the host CPUs
+ * @return placement of the vCPUs and the emulator threads
+ *
+ * Get the host CPUs where the vCPUs and the
+ * emulator threads are running
+ */
+QString Machine::getCPUPlacementLabel()
+{
+    if (this->CPUPinning != "auto" && this->CPUPinning != "explicit") {
+        return tr("Not pinned");
+    }
+
+    if (this->m_pinnedCPUs.isEmpty()) {
+        return this->CPUPinning == "auto" ? tr("Automatic")
+                                          : tr("Host CPUs %1").arg(this->CPUSet);
+    }
+
+    QStringList vCPUs;
+    QMapIterator<int, int> placementIterator(this->m_vCPUPlacement);
+    while (placementIterator.hasNext()) {
+        placementIterator.next();
+        vCPUs.append(QString("%1 -> %2").arg(placementIterator.key()).arg(placementIterator.value()));
+    }
+
+    return tr("vCPU %1\nEmulator -> %2")
+           .arg(vCPUs.join(", "))
+           .arg(HostTopology::formatCPUList(this->m_pinnedCPUs));
+}
+
+/**
+ * @brief Get the network cards separated by new lines
+ * @return network cards of the machine
+ *
+ * Get the network cards separated by new lines
+ * Ex: virtio-net-pci (tap0)
+ */
+QString Machine::getNetworkLabel()
+{
+    if (!this->useNetwork || this->networkInterfaces.isEmpty()) {
+        return tr("no");
+    }
+
+    QStringList networkLabel;
+    foreach (NetworkInterface *networkInterface, this->networkInterfaces) {
+        networkLabel.append(networkInterface->label());
+    }
+
+    return networkLabel.join("\n");
+}
+
 /**
  * @brief Run the machine in QEMU
  *
@@ -703,6 +1124,38 @@ QString Machine::getAcceleratorLabel()
  */
 void Machine::runMachine(QEMU *QEMUGlobalObject)
 {
+    int sockets = this->socketCount;
+    int cores = this->coresSocket;
+    int threads = this->threadsCore;
+    int maxCPUs = this->maxHotCPU;
+    QString topologyError;
+    if (!MachineUtils::resolveCPUTopology(this->CPUCount, sockets, cores,
+                                          threads, maxCPUs, topologyError)) {
+        ErrorReporter::report(tr("QEMU - CPU topology"),
+                              tr("<p>Cannot start the machine</p><p>%1</p>").arg(topologyError),
+                              ErrorReporter::Critical);
+        emit(machineStartFailedSignal(this->uuid, topologyError));
+        return;
+    }
+
+    QString pinningError;
+    if (!MachineUtils::checkCPUPinning(this, pinningError)) {
+        ErrorReporter::report(tr("QEMU - CPU pinning"),
+                              tr("<p>Cannot start the machine</p><p>%1</p>").arg(pinningError),
+                              ErrorReporter::Critical);
+        emit(machineStartFailedSignal(this->uuid, pinningError));
+        return;
+    }
+
+    QString memoryError;
+    if (!MachineUtils::checkMemoryBackend(this, memoryError)) {
+        ErrorReporter::report(tr("QEMU - Memory"),
+                              tr("<p>Cannot start the machine</p><p>%1</p>").arg(memoryError),
+                              ErrorReporter::Critical);
+        emit(machineStartFailedSignal(this->uuid, memoryError));
+        return;
+    }
+
     QStringList args = this->generateMachineCommand();
 
     QString program;
@@ -720,45 +1173,38 @@ void Machine::runMachine(QEMU *QEMUGlobalObject)
     #endif
 
     if (program.isEmpty()) {
-        SystemUtils::showMessage(tr("QEMU - Binary not found"),
-                                 tr("QEMU binary not found"),
-                                 QMessageBox::Information);
+        ErrorReporter::report(tr("QEMU - Binary not found"),
+                              tr("QEMU binary not found"),
+                              ErrorReporter::Information);
     }
 
     // Log QEMU command in the logs file to help the debug process
     Logger::logQtemuAction(program + ' ' + args.join(' '));
 
-    this->m_machineProcess->start(program, args);
-#ifdef Q_OS_WIN
-    QSettings settings;
-    settings.beginGroup("Configuration");
+    QJsonObject launchData;
+    launchData["program"] = program;
+    launchData["arguments"] = QJsonArray::fromStringList(args);
+    this->recordEvent(MachineEventLog::Launch, launchData);
 
-    QString monitorHostName = settings.value("qemuMonitorHost", "localhost").toString();
-    quint16 monitorSocket = static_cast<quint16>(settings.value("qemuMonitorPort", 6000).toInt());
+    this->m_runTimer.start();
 
-    this->m_machineTcpSocket->connectToHost(monitorHostName, monitorSocket, QIODevice::ReadWrite);
-#endif
+    this->m_console->append(ConsoleBuffer::Info,
+                            tr("QEMU started on %1").arg(QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss")).toUtf8() + '\n');
+
+    this->m_machineProcess->start(program, args);
 }
 
 /**
  * @brief Stop the machine
+ * @param force, true to quit QEMU without waiting for the guest
  *
- * Stop the machine
+ * Send the ACPI power down event to the machine.
+ * The state changes when QEMU is finished
  */
-void Machine::stopMachine()
+void Machine::stopMachine(bool force)
 {
-#ifdef Q_OS_WIN
-    if (this->m_machineTcpSocket->state() != QAbstractSocket::ConnectedState) {
-        this->failConnectMachine();
-    } else {
-        this->m_machineTcpSocket->write(qPrintable("system_powerdown\n"));
-    }
-#else
-    this->m_machineProcess->write(qPrintable("system_reset\n"));
-#endif
-    this->state = Machine::Stopped;
-
-    emit(machineStateChangedSignal(Machine::Stopped));
+    this->m_stopRequested = true;
+    this->sendQMPCommand(force ? "quit" : "system_powerdown");
 }
 
 /**
@@ -768,15 +1214,7 @@ void Machine::stopMachine()
  */
 void Machine::resetMachine()
 {
-#ifdef Q_OS_WIN
-    if (this->m_machineTcpSocket->state() != QAbstractSocket::ConnectedState) {
-        this->failConnectMachine();
-    } else {
-        this->m_machineTcpSocket->write(qPrintable("system_reset\n"));
-    }
-#else
-    this->m_machineProcess->write(qPrintable("system_reset\n"));
-#endif
+    this->sendQMPCommand("system_reset");
 }
 
 /**
@@ -784,83 +1222,72 @@ void Machine::resetMachine()
  *
  * If the machine is started, paused it
  * If the machine if paused, started it
+ *
+ * The state changes when QEMU sends the STOP
+ * or RESUME event
  */
 void Machine::pauseMachine()
 {
     if (state == Machine::Started) {
-
-#ifdef Q_OS_WIN
-        if (this->m_machineTcpSocket->state() != QAbstractSocket::ConnectedState) {
-            this->failConnectMachine();
-        } else {
-            this->m_machineTcpSocket->write(qPrintable("stop\n"));
-        }
-#else
-        this->m_machineProcess->write(qPrintable("stop\n"));
-#endif
-        this->state = Machine::Paused;
-
-        emit(machineStateChangedSignal(Machine::Paused));
+        this->sendQMPCommand("stop");
     } else if (state == Machine::Paused) {
-
-#ifdef Q_OS_WIN
-        if (this->m_machineTcpSocket->state() != QAbstractSocket::ConnectedState) {
-            this->failConnectMachine();
-        } else {
-            this->m_machineTcpSocket->write(qPrintable("cont\n"));
-        }
-#else
-        this->m_machineProcess->write(qPrintable("cont\n"));
-#endif
-        this->state = Machine::Started;
-
-        emit(machineStateChangedSignal(Machine::Started));
+        this->sendQMPCommand("cont");
     }
 }
 
 /**
- * @brief Read standard output
+ * @brief Send a command to the machine
+ * @param command, QMP command
  *
- * Read the machine standard output
+ * Send a command to the machine through QMP
  */
-void Machine::readMachineStandardOut()
+void Machine::sendQMPCommand(const QString &command)
 {
-    QByteArray rawStandardOut;
-    rawStandardOut = this->m_machineProcess->readAllStandardOutput();
-    QString standardOut = rawStandardOut;
-    QStringList splitStandardOut = standardOut.split("[K");
-    QString cleanStandardOut = splitStandardOut.last().remove(QRegularExpression("\\[[KD]."));
-    // Remove space characters, included \r \t \n
-    cleanStandardOut = cleanStandardOut.simplified();
-
-    if (cleanStandardOut.isEmpty() ||
-        cleanStandardOut.contains("(qemu)") ||
-        cleanStandardOut.contains("monitor")) {
+    if (this->m_QMPClient->state() == QMPClient::Disconnected) {
+        this->failConnectMachine();
         return;
     }
 
-    SystemUtils::showMessage(tr("QEMU - Standard Out"),
-                             cleanStandardOut,
-                             QMessageBox::Information);
+    this->m_QMPClient->execute(command);
 }
 
 /**
- * @brief Read error output
+ * @brief Read standard output
  *
- * Read the machine error output
+ * Read the machine standard output into the console
  */
-void Machine::readMachineErrorOut()
+void Machine::readMachineStandardOut()
 {
-    QByteArray rawErrorOutput;
+    this->m_console->append(ConsoleBuffer::StandardOut,
+                            this->m_machineProcess->readAllStandardOutput());
+}
 
-    rawErrorOutput = this->m_machineProcess->readAllStandardError();
-    QString errorOutput = rawErrorOutput;
+/**
+ * @brief Read error output
+ *
+ * Read the machine error output, keep it in the console
+ * and notify it without flooding the user
+ */
+void Machine::readMachineErrorOut()
+{
+    QByteArray rawErrorOutput = this->m_machineProcess->readAllStandardError();
+    if (rawErrorOutput.isEmpty()) {
+        return;
+    }
+
+    this->m_console->append(ConsoleBuffer::StandardError, rawErrorOutput);
+
+    QString errorOutput = ConsoleBuffer::cleanText(QString::fromUtf8(rawErrorOutput)).trimmed();
     if (errorOutput.isEmpty()) {
         return;
-    }   
-    SystemUtils::showMessage(tr("QEMU - Error Out"),
-                             errorOutput,
-                             QMessageBox::Critical);
+    }
+
+    QJsonObject errorData;
+    errorData["source"] = "stderr";
+    errorData["message"] = errorOutput.left(MAX_ERROR_MESSAGE);
+    this->recordEvent(MachineEventLog::Error, errorData);
+
+    this->notifyConsoleError(errorOutput);
 }
 
 /**
@@ -870,20 +1297,267 @@ void Machine::readMachineErrorOut()
  */
 void Machine::machineStarted()
 {
+    this->m_metrics.clear();
+    ++this->m_startCount;
+    this->m_stopRequested = false;
+    this->m_guestPanicked = false;
+    this->m_shutdownReason.clear();
     this->state = Machine::Started;
     emit(machineStateChangedSignal(Machine::Started));
+
+    QJsonObject stateData;
+    stateData["state"] = "started";
+    stateData["pid"] = static_cast<double>(this->m_machineProcess->processId());
+    this->recordEvent(MachineEventLog::State, stateData);
+
+#ifdef Q_OS_WIN
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    QString monitorHostName = settings.value("qemuMonitorHost", "localhost").toString();
+    quint16 monitorPort = static_cast<quint16>(settings.value("qemuMonitorPort", 6000).toInt());
+    settings.endGroup();
+
+    this->m_QMPClient->connectToMachine(monitorHostName, monitorPort);
+#else
+    this->m_QMPClient->connectToMachine(this->getQMPSocketPath());
+#endif
 }
 
 /**
  * @brief Machine finished
  *
- * Emit a signal when the machine is finished
+ * Emit a signal when the machine is finished with
+ * the cause. A stop asked from QtEmu or from the host
+ * isn't a failure, even if the guest panicked before
  */
 void Machine::machineFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
     qDebug() << "Exit code: " << exitCode << " exit status: " << exitStatus;
+    this->m_QMPClient->disconnectFromMachine();
+    this->m_vCPUThreads.clear();
     this->state = Machine::Stopped;
     emit(machineStateChangedSignal(Machine::Stopped));
+
+    Machine::ExitCauses cause = Machine::GuestShutdown;
+    if (this->m_stopRequested) {
+        cause = Machine::StopRequested;
+    } else if (this->m_guestPanicked) {
+        cause = Machine::GuestPanic;
+    } else if (exitStatus == QProcess::CrashExit) {
+        cause = Machine::ProcessCrash;
+    } else if (exitCode != 0) {
+        cause = Machine::ProcessFailure;
+    } else if (this->m_shutdownReason.startsWith("host-")) {
+        // quit, SIGTERM or the QEMU window closed
+        cause = Machine::StopRequested;
+    }
+
+    qint64 duration = this->m_runTimer.isValid() ? this->m_runTimer.elapsed() : 0;
+
+    QJsonObject exitData;
+    exitData["exitCode"] = exitCode;
+    exitData["exitStatus"] = exitStatus == QProcess::NormalExit ? "normal" : "crash";
+    exitData["cause"] = Machine::exitCauseName(cause);
+    exitData["duration"] = static_cast<double>(duration);
+    this->recordEvent(MachineEventLog::Exit, exitData);
+    if (this->m_eventLog != nullptr) {
+        this->m_eventLog->flush();
+    }
+
+    this->m_console->append(ConsoleBuffer::Info,
+                            tr("QEMU finished with exit code %1").arg(exitCode).toUtf8() + '\n');
+
+    if (!this->m_pinnedCPUs.isEmpty()) {
+        HostTopology::releaseCPUs(this->uuid);
+        this->m_pinnedCPUs.clear();
+        this->m_vCPUPlacement.clear();
+        emit(machineCPUPlacementChangedSignal(this->uuid));
+    }
+
+    emit(machineExitedSignal(this->uuid, cause, exitCode, duration));
+}
+
+/**
+ * @brief Error of the QEMU process
+ * @param error, error of the process
+ *
+ * Notify when QEMU cannot be started. The other
+ * errors end with the process finished
+ */
+void Machine::machineProcessError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart) {
+        return;
+    }
+
+    QString errorString = this->m_machineProcess->errorString();
+
+    QJsonObject errorData;
+    errorData["source"] = "process";
+    errorData["message"] = errorString;
+    this->recordEvent(MachineEventLog::Error, errorData);
+
+    this->m_console->append(ConsoleBuffer::Info,
+                            tr("QEMU cannot be started: %1").arg(errorString).toUtf8() + '\n');
+
+    emit(machineStartFailedSignal(this->uuid, errorString));
+}
+
+/**
+ * @brief QMP connection ready
+ *
+ * Pin the threads of QEMU and ask for the current
+ * status of the machine to keep the state synchronized
+ */
+void Machine::QMPReady()
+{
+    this->pinThreads();
+
+    this->m_QMPClient->execute("query-cpus-fast", QJsonObject(),
+                               [=](const QJsonObject &response) {
+        this->m_vCPUThreads.clear();
+        foreach (const QJsonValue &vCPU, response["return"].toArray()) {
+            this->m_vCPUThreads.append(static_cast<qint64>(vCPU.toObject()["thread-id"].toDouble()));
+        }
+    });
+
+    this->m_QMPClient->execute("query-status", QJsonObject(),
+                               [=](const QJsonObject &response) {
+        QJsonObject status = response["return"].toObject();
+        if (status.isEmpty()) {
+            return;
+        }
+
+        if (status["running"].toBool()) {
+            this->QMPResumed();
+        } else {
+            this->QMPStopped();
+        }
+    });
+}
+
+/**
+ * @brief Pin the threads of QEMU to the host CPUs
+ *
+ * Every vCPU thread, found with query-cpus-fast, is pinned
+ * to one host CPU. The emulator threads and the IOThreads
+ * can run in all the host CPUs of the machine
+ */
+void Machine::pinThreads()
+{
+#ifdef Q_OS_LINUX
+    if (this->CPUPinning == "explicit") {
+        this->m_pinnedCPUs = HostTopology::parseCPUList(this->CPUSet);
+        HostTopology::reserveCPUs(this->uuid, this->m_pinnedCPUs);
+    } else if (this->CPUPinning == "auto") {
+        this->m_pinnedCPUs = HostTopology::reserveCPUs(this->uuid, this->CPUCount);
+    } else {
+        return;
+    }
+
+    if (this->m_pinnedCPUs.isEmpty()) {
+        Logger::logQtemuError(tr("There aren't enough free host CPUs to pin the machine %1").arg(this->name));
+
+        QJsonObject errorData;
+        errorData["source"] = "pinning";
+        errorData["message"] = tr("There aren't enough free host CPUs to pin the machine");
+        this->recordEvent(MachineEventLog::Error, errorData);
+        return;
+    }
+
+    this->m_QMPClient->execute("query-cpus-fast", QJsonObject(),
+                               [=](const QJsonObject &response) {
+        QJsonArray vCPUs = response["return"].toArray();
+        qint64 processId = this->m_machineProcess->processId();
+        if (vCPUs.isEmpty() || processId <= 0) {
+            return;
+        }
+
+        QList<qint64> vCPUThreads;
+        this->m_vCPUPlacement.clear();
+        for (int i = 0; i < vCPUs.size(); ++i) {
+            QJsonObject vCPU = vCPUs.at(i).toObject();
+            int vCPUIndex = vCPU["cpu-index"].toInt();
+            qint64 threadId = static_cast<qint64>(vCPU["thread-id"].toDouble());
+            int hostCPU = this->m_pinnedCPUs.at(vCPUIndex % this->m_pinnedCPUs.size());
+
+            vCPUThreads.append(threadId);
+            if (HostTopology::setThreadAffinity(threadId, QList<int>() << hostCPU)) {
+                this->m_vCPUPlacement.insert(vCPUIndex, hostCPU);
+            }
+        }
+
+        foreach (qint64 threadId, HostTopology::getProcessThreads(processId)) {
+            if (!vCPUThreads.contains(threadId)) {
+                HostTopology::setThreadAffinity(threadId, this->m_pinnedCPUs);
+            }
+        }
+
+        Logger::logQtemuAction(QString("Machine %1 pinned to the host CPUs %2")
+                               .arg(this->name)
+                               .arg(HostTopology::formatCPUList(this->m_pinnedCPUs)));
+
+        emit(machineCPUPlacementChangedSignal(this->uuid));
+    });
+#endif
+}
+
+/**
+ * @brief Machine stopped by QEMU
+ *
+ * QEMU sends the STOP event when the execution is paused
+ */
+void Machine::QMPStopped()
+{
+    if (this->state == Machine::Paused ||
+        this->m_machineProcess->state() != QProcess::Running) {
+        return;
+    }
+
+    this->state = Machine::Paused;
+    emit(machineStateChangedSignal(Machine::Paused));
+
+    QJsonObject stateData;
+    stateData["state"] = "paused";
+    this->recordEvent(MachineEventLog::State, stateData);
+}
+
+/**
+ * @brief Machine resumed by QEMU
+ *
+ * QEMU sends the RESUME event when the execution is continued
+ */
+void Machine::QMPResumed()
+{
+    if (this->state == Machine::Started ||
+        this->m_machineProcess->state() != QProcess::Running) {
+        return;
+    }
+
+    this->state = Machine::Started;
+    emit(machineStateChangedSignal(Machine::Started));
+
+    QJsonObject stateData;
+    stateData["state"] = "resumed";
+    this->recordEvent(MachineEventLog::State, stateData);
+}
+
+/**
+ * @brief QMP command failed
+ * @param command, command sent to QEMU
+ * @param error, description of the error
+ *
+ * Log the command that QEMU cannot execute
+ */
+void Machine::QMPCommandFailed(const QString &command, const QString &error)
+{
+    Logger::logQtemuError(QString("%1: QMP command %2 failed: %3").arg(this->name, command, error));
+
+    QJsonObject errorData;
+    errorData["source"] = "qmp";
+    errorData["command"] = command;
+    errorData["message"] = error;
+    this->recordEvent(MachineEventLog::Error, errorData);
 }
 
 /**
@@ -899,12 +1573,14 @@ QStringList Machine::generateMachineCommand()
     #ifdef Q_OS_WIN
     QSettings settings;
     settings.beginGroup("Configuration");
-    qemuCommand << "-monitor" << QString("tcp:%1:%2,server,nowait")
-                                        .arg(settings.value("qemuMonitorHost", "localhost").toString())
-                                        .arg(settings.value("qemuMonitorPort", 6000).toInt());
+    qemuCommand << "-qmp" << QString("tcp:%1:%2,server=on,wait=off")
+                                    .arg(settings.value("qemuMonitorHost", "localhost").toString())
+                                    .arg(settings.value("qemuMonitorPort", 6000).toInt());
     settings.endGroup();
     #else
-    qemuCommand << "-monitor" << "stdio";
+    // Commas must be doubled inside the QEMU option
+    qemuCommand << "-qmp" << QString("unix:%1,server=on,wait=off")
+                                    .arg(this->getQMPSocketPath().replace(",", ",,"));
     #endif
 
     qemuCommand << "-name";
@@ -970,8 +1646,7 @@ QStringList Machine::generateMachineCommand()
         }
     }
 
-    qemuCommand << "-m";
-    qemuCommand << QString::number(this->RAM);
+    qemuCommand << this->generateMemoryCommand();
 
     qemuCommand << "-k";
     qemuCommand << this->keyboard;
@@ -984,6 +1659,17 @@ QStringList Machine::generateMachineCommand()
 
     QString cpuArgs(QString::number(this->CPUCount));
 
+    int sockets = this->socketCount;
+    int cores = this->coresSocket;
+    int threads = this->threadsCore;
+    int maxCPUs = this->maxHotCPU;
+    QString topologyError;
+    if (MachineUtils::resolveCPUTopology(this->CPUCount, sockets, cores,
+                                         threads, maxCPUs, topologyError) && sockets > 0) {
+        cpuArgs.append(QString(",sockets=%1,cores=%2,threads=%3,maxcpus=%4")
+                       .arg(sockets).arg(cores).arg(threads).arg(maxCPUs));
+    }
+
     qemuCommand << "-smp";
     qemuCommand << cpuArgs;
 
@@ -993,68 +1679,303 @@ QStringList Machine::generateMachineCommand()
     qemuCommand << "-pidfile";
     qemuCommand << pipe;
 
+    // Channel of the guest agent, used to know when the guest is ready
+    if (this->guestAgent) {
+        #ifdef Q_OS_WIN
+        qemuCommand << "-chardev" << QString("pipe,id=qga0,path=%1").arg(this->getGuestAgentSocketPath());
+        #else
+        qemuCommand << "-chardev" << QString("socket,id=qga0,path=%1,server=on,wait=off")
+                                             .arg(this->getGuestAgentSocketPath().replace(",", ",,"));
+        #endif
+        qemuCommand << "-device" << "virtio-serial";
+        qemuCommand << "-device" << "virtserialport,chardev=qga0,name=org.qemu.guest_agent.0";
+    }
+
     // Network
-    if (this->useNetwork) {
-        qemuCommand << "-net";
-        qemuCommand << "nic";
+    qemuCommand << this->generateNetworkCommand();
 
-        qemuCommand << "-net";
-        qemuCommand << "user";
-    } else {
-        qemuCommand << "-net";
-        qemuCommand << "none";
+    qemuCommand << this->generateMediaCommand();
+
+    qDebug() << "Command " << qemuCommand;
+
+    return qemuCommand;
+}
+
+/**
+ * @brief Generate the memory options
+ * @return memory options of the QEMU command
+ *
+ * Without backend options the RAM is allocated by QEMU.
+ * Otherwise every guest NUMA node gets its own memory
+ * backend, with huge pages and bound to the host nodes
+ */
+QStringList Machine::generateMemoryCommand()
+{
+    QStringList memoryCommand;
+    memoryCommand << "-m" << QString::number(this->RAM);
+
+    int nodes = qMax(1, this->NUMANodes);
+    bool hugePages = this->hugePageSize > 0 && this->memoryBackend != "default";
+
+    if (this->memoryBackend == "default" && nodes == 1 && !this->memoryPrealloc) {
+        return memoryCommand;
     }
 
-    for (int i = 0; i < media.size(); ++i) {
-        QString driveInterface("-");
-        driveInterface.append(media.at(i)->driveInterface());
+    QString backend = "memory-backend-ram";
+    if (this->memoryBackend == "memfd") {
+        backend = "memory-backend-memfd";
+    } else if (this->memoryBackend == "file") {
+        backend = "memory-backend-file";
+    }
 
-        qemuCommand << driveInterface;
-        qemuCommand << QDir::toNativeSeparators(media.at(i)->path());
+    QString hugePageSize = this->hugePageSize >= 1048576 ? QString("%1G").arg(this->hugePageSize / 1048576)
+                                                         : QString("%1M").arg(this->hugePageSize / 1024);
+
+    QString memoryPath = this->memoryPath;
+    if (this->memoryBackend == "file" && memoryPath.isEmpty()) {
+        memoryPath = hugePages ? HostUtils::getHugePagesMountPoint(this->hugePageSize) : "/dev/shm";
     }
 
-    qDebug() << "Command " << qemuCommand;
+    for (int i = 0; i < nodes; ++i) {
+        // The last node gets the rest of the division
+        qlonglong nodeRAM = this->RAM / nodes;
+        if (i == nodes - 1) {
+            nodeRAM += this->RAM % nodes;
+        }
 
-    return qemuCommand;
+        QString memoryObject = QString("%1,id=mem%2,size=%3M").arg(backend).arg(i).arg(nodeRAM);
+
+        if (this->memoryBackend == "memfd" && hugePages) {
+            memoryObject.append(",hugetlb=on,hugetlbsize=" + hugePageSize);
+        } else if (this->memoryBackend == "file") {
+            memoryObject.append(",mem-path=" + QString(memoryPath).replace(",", ",,"));
+            memoryObject.append(",share=on");
+        }
+
+        if (this->memoryPrealloc) {
+            memoryObject.append(QString(",prealloc=on,prealloc-threads=%1").arg(qMax(1, this->preallocThreads)));
+        }
+
+        QString hostNodes = this->NUMAHostNodes.value(i).trimmed();
+        if (!hostNodes.isEmpty()) {
+            foreach (const QString &hostNode, hostNodes.split(',', Qt::SkipEmptyParts)) {
+                memoryObject.append(",host-nodes=" + hostNode.trimmed());
+            }
+            memoryObject.append(",policy=bind");
+        }
+
+        memoryCommand << "-object" << memoryObject;
+        memoryCommand << "-numa" << QString("node,nodeid=%1,memdev=mem%1").arg(i);
+    }
+
+    return memoryCommand;
 }
 
 /**
- * @brief Show a message when cannot connect to the machine
+ * @brief Generate the network options
+ * @return network options of the QEMU command
  *
- * Show a message when cannot connect to the machine
+ * Every network card has a backend (-netdev) and a device.
+ * With the tap backend and virtio-net, vhost-net and
+ * one queue per vCPU are used
  */
-void Machine::failConnectMachine()
+QStringList Machine::generateNetworkCommand()
 {
-    m_failConnectErrorMessageBox = new QMessageBox();
-    m_failConnectErrorMessageBox->setWindowTitle(tr("QEMU - Connection"));
-    m_failConnectErrorMessageBox->setIcon(QMessageBox::Critical);
-    m_failConnectErrorMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-    m_failConnectErrorMessageBox->setText(tr("Fail to send command to the QEMU machine"));
-    m_failConnectErrorMessageBox->show();
-    m_failConnectErrorMessageBox->raise();
-    m_failConnectErrorMessageBox->activateWindow();
+    QStringList networkCommand;
+
+    if (!this->useNetwork || this->networkInterfaces.isEmpty()) {
+        networkCommand << "-net" << "none";
+        return networkCommand;
+    }
+
+    for (int i = 0; i < this->networkInterfaces.size(); ++i) {
+        NetworkInterface *networkInterface = this->networkInterfaces.at(i);
+
+        QString backend = networkInterface->backend();
+        bool virtio = networkInterface->model() == "virtio-net-pci";
+
+        // Multiqueue is only available in tap
+        int queues = 1;
+        if (backend == "tap" && virtio) {
+            queues = networkInterface->queues() > 0 ? networkInterface->queues() : this->CPUCount;
+        }
+
+        QString netdev;
+        if (backend == "tap") {
+            netdev = QString("tap,id=net%1,ifname=%2,script=no,downscript=no")
+                     .arg(i).arg(networkInterface->hostInterface());
+            if (networkInterface->vhost()) {
+                netdev.append(",vhost=on");
+            }
+            if (queues > 1) {
+                netdev.append(QString(",queues=%1").arg(queues));
+            }
+        } else if (backend == "bridge") {
+            netdev = QString("bridge,id=net%1,br=%2").arg(i).arg(networkInterface->hostInterface());
+        } else {
+            netdev = QString("user,id=net%1").arg(i);
+        }
+
+        QString device = QString("%1,netdev=net%2,id=nic%2").arg(networkInterface->model()).arg(i);
+        if (!networkInterface->MACAddress().isEmpty()) {
+            device.append(",mac=" + networkInterface->MACAddress());
+        }
+
+        // One vector per queue for rx and tx, one for config and one for control
+        if (queues > 1) {
+            device.append(QString(",mq=on,vectors=%1").arg(2 * queues + 2));
+        }
+
+        networkCommand << "-netdev" << netdev;
+        networkCommand << "-device" << device;
+    }
 
-    SystemUtils::showMessage(tr("QEMU - Connection"),
-                             tr("Fail to send command to the QEMU machine"),
-                             QMessageBox::Critical);
+    return networkCommand;
 }
 
 /**
- * @brief Save the machine
+ * @brief Generate the media command
+ * @return List with the media arguments
  *
- * Save the machine data in the file of the machine
+ * Generate a -blockdev node graph for every hard disk and cdrom,
+ * a protocol node with the file and a format node on top of it,
+ * and attach the format node to a virtio, scsi or ide device.
+ * Floppies use the legacy -fda/-fdb options
  */
-bool Machine::saveMachine()
+QStringList Machine::generateMediaCommand()
 {
-    QFile machineFile(this->configPath);
-    if (!machineFile.open(QFile::WriteOnly)) {
-        SystemUtils::showMessage(tr("Qtemu - Critical error"),
-                                 tr("<p>Cannot save the machine</p>"
-                                    "<p>The file with the machine configuration are not writable</p>"),
-                                 QMessageBox::Critical);
-        return false;
+    QStringList mediaCommand;
+    QHash<QString, QString> scsiControllers;
+    QStringList IOThreadIds;
+    int nextIOThread = 0;
+
+    for (int i = 0; i < this->IOThreads; ++i) {
+        IOThreadIds.append(QString("iothread%1").arg(i));
+        mediaCommand << "-object" << "iothread,id=" + IOThreadIds.last();
     }
 
+    for (int i = 0; i < this->media.size(); ++i) {
+        Media *disk = this->media.at(i);
+
+        if (disk->type() == "fdd") {
+            mediaCommand << "-" + disk->driveInterface();
+            mediaCommand << QDir::toNativeSeparators(disk->path());
+            continue;
+        }
+
+        bool isCdrom = disk->type() == "cdrom";
+        QString cache = disk->cache();
+        QString aio = disk->IO();
+
+        // Cache modes are split in the two options of the block layer
+        bool cacheDirect = cache == "none" || cache == "directsync";
+        bool cacheNoFlush = cache == "unsafe";
+        bool writeCache = cache != "writethrough" && cache != "directsync";
+
+        // Linux native AIO needs O_DIRECT
+        if (aio == "native" && !cacheDirect) {
+            qDebug() << "Native AIO needs cache none or directsync, using threads for" << disk->name();
+            aio = "threads";
+        }
+
+        QString fileNode = QString("file%1").arg(i);
+        QString formatNode = QString("drive%1").arg(i);
+        QString cacheOptions = QString("cache.direct=%1,cache.no-flush=%2")
+                               .arg(cacheDirect ? "on" : "off")
+                               .arg(cacheNoFlush ? "on" : "off");
+
+        QString fileBlockdev = QString("driver=file,node-name=%1,filename=%2,%3,aio=%4")
+                               .arg(fileNode)
+                               .arg(QDir::toNativeSeparators(disk->path()).replace(",", ",,"))
+                               .arg(cacheOptions)
+                               .arg(aio);
+
+        QString formatBlockdev = QString("driver=%1,node-name=%2,file=%3,%4")
+                                 .arg(disk->imageFormat())
+                                 .arg(formatNode)
+                                 .arg(fileNode)
+                                 .arg(cacheOptions);
+
+        if (isCdrom) {
+            fileBlockdev.append(",read-only=on");
+            formatBlockdev.append(",read-only=on");
+        } else if (disk->discard()) {
+            fileBlockdev.append(",discard=unmap");
+            formatBlockdev.append(",discard=unmap");
+        }
+
+        mediaCommand << "-blockdev" << fileBlockdev;
+        mediaCommand << "-blockdev" << formatBlockdev;
+
+        // Only virtio devices can be serviced by an IOThread
+        bool virtioDevice = (disk->bus() == "virtio" && !isCdrom) || disk->bus() == "scsi";
+        QString IOThread;
+        if (virtioDevice && !IOThreadIds.isEmpty()) {
+            IOThread = disk->IOThread();
+            // Automatic or no longer existing IOThread, round-robin
+            if (!IOThreadIds.contains(IOThread)) {
+                IOThread = IOThreadIds.at(nextIOThread++ % IOThreadIds.size());
+            }
+        }
+
+        QString device;
+        if (disk->bus() == "virtio" && !isCdrom) {
+            device = QString("virtio-blk-pci,drive=%1,id=disk%2").arg(formatNode).arg(i);
+            if (!IOThread.isEmpty()) {
+                device.append(",iothread=" + IOThread);
+            }
+        } else if (disk->bus() == "scsi") {
+            // One controller per IOThread, the IOThread is set in the controller
+            if (!scsiControllers.contains(IOThread)) {
+                QString controller = QString("scsi%1").arg(scsiControllers.size());
+                QString controllerDevice = "virtio-scsi-pci,id=" + controller;
+                if (!IOThread.isEmpty()) {
+                    controllerDevice.append(",iothread=" + IOThread);
+                }
+                mediaCommand << "-device" << controllerDevice;
+                scsiControllers.insert(IOThread, controller);
+            }
+            device = QString("%1,bus=%2.0,drive=%3,id=disk%4")
+                     .arg(isCdrom ? "scsi-cd" : "scsi-hd")
+                     .arg(scsiControllers.value(IOThread))
+                     .arg(formatNode).arg(i);
+        } else {
+            device = QString("%1,drive=%2,id=disk%3")
+                     .arg(isCdrom ? "ide-cd" : "ide-hd")
+                     .arg(formatNode).arg(i);
+        }
+
+        if (!isCdrom) {
+            device.append(QString(",write-cache=%1").arg(writeCache ? "on" : "off"));
+        }
+
+        mediaCommand << "-device" << device;
+    }
+
+    return mediaCommand;
+}
+
+/**
+ * @brief Show a message when cannot connect to the machine
+ *
+ * Show a message when cannot connect to the machine
+ */
+void Machine::failConnectMachine()
+{
+    ErrorReporter::report(tr("QEMU - Connection"),
+                          tr("Fail to send command to the QEMU machine"),
+                          ErrorReporter::Critical);
+}
+
+/**
+ * @brief Get the machine data in JSON
+ * @return JSON with all the data of the machine
+ *
+ * Get the machine data in JSON, as it's stored
+ * in the file of the machine
+ */
+QJsonObject Machine::getMachineJSON() const
+{
     QJsonObject machineJSONObject;
     machineJSONObject["name"]        = this->name;
     machineJSONObject["OSType"]      = this->OSType;
@@ -1075,6 +1996,8 @@ bool Machine::saveMachine()
     cpu["coresSocket"] = this->coresSocket;
     cpu["threadsCore"] = this->threadsCore;
     cpu["maxHotCPU"]   = this->maxHotCPU;
+    cpu["pinning"]     = this->CPUPinning;
+    cpu["cpuset"]      = this->CPUSet;
     machineJSONObject["cpu"] = cpu;
 
     QJsonObject gpu;
@@ -1089,13 +2012,46 @@ bool Machine::saveMachine()
         disk["path"] = QDir::toNativeSeparators(this->media.at(i)->path());
         disk["type"] = this->media.at(i)->type();
         disk["interface"] = this->media.at(i)->driveInterface();
-        disk["uuid"] = QUuid::createUuid().toString();
+        disk["format"] = this->media.at(i)->format();
+        disk["cache"] = this->media.at(i)->cache();
+        disk["io"] = this->media.at(i)->IO();
+        disk["discard"] = this->media.at(i)->discard();
+        disk["bus"] = this->media.at(i)->bus();
+        disk["iothread"] = this->media.at(i)->IOThread();
+        disk["uuid"] = this->media.at(i)->uuid().isNull() ? QUuid::createUuid().toString()
+                                                          : this->media.at(i)->uuid().toString();
 
         media.append(disk);
     }
 
     machineJSONObject["media"] = media;
 
+    QJsonArray networkInterfaces;
+    foreach (NetworkInterface *networkInterface, this->networkInterfaces) {
+        QJsonObject nic;
+        nic["model"]         = networkInterface->model();
+        nic["backend"]       = networkInterface->backend();
+        nic["hostInterface"] = networkInterface->hostInterface();
+        nic["vhost"]         = networkInterface->vhost();
+        nic["queues"]        = networkInterface->queues();
+        nic["mac"]           = networkInterface->MACAddress();
+
+        networkInterfaces.append(nic);
+    }
+
+    machineJSONObject["nics"] = networkInterfaces;
+    machineJSONObject["iothreads"] = this->IOThreads;
+
+    QJsonObject memory;
+    memory["backend"]         = this->memoryBackend;
+    memory["hugePageSize"]    = this->hugePageSize;
+    memory["path"]            = QDir::toNativeSeparators(this->memoryPath);
+    memory["prealloc"]        = this->memoryPrealloc;
+    memory["preallocThreads"] = this->preallocThreads;
+    memory["NUMANodes"]       = this->NUMANodes;
+    memory["hostNodes"]       = QJsonArray::fromStringList(this->NUMAHostNodes);
+    machineJSONObject["memory"] = memory;
+
     QJsonObject kernelBoot;
     kernelBoot["enabled"] = this->boot->kernelBootEnabled();
     kernelBoot["kernelPath"] = QDir::toNativeSeparators(this->boot->kernelPath());
@@ -1112,7 +2068,26 @@ bool Machine::saveMachine()
     machineJSONObject["accelerator"] = QJsonArray::fromStringList(this->accelerator);
     machineJSONObject["audio"] = QJsonArray::fromStringList(this->audio);
 
-    QJsonDocument machineJSONDocument(machineJSONObject);
+    return machineJSONObject;
+}
+
+/**
+ * @brief Save the machine
+ *
+ * Save the machine data in the file of the machine
+ */
+bool Machine::saveMachine()
+{
+    QFile machineFile(this->configPath);
+    if (!machineFile.open(QFile::WriteOnly)) {
+        ErrorReporter::report(tr("Qtemu - Critical error"),
+                              tr("<p>Cannot save the machine</p>"
+                                 "<p>The file with the machine configuration are not writable</p>"),
+                              ErrorReporter::Critical);
+        return false;
+    }
+
+    QJsonDocument machineJSONDocument(this->getMachineJSON());
 
     machineFile.write(machineJSONDocument.toJson());
     machineFile.flush();
@@ -1127,52 +2102,203 @@ bool Machine::saveMachine()
 }
 
 /**
- * @brief Insert the new machine in the machines file
+ * @brief Insert the new machine in the machines registry
  *
- * Insert the new machine in the machines file.
- * At the bottom of the file.
+ * Insert the new machine in the machines registry.
+ * At the bottom of the list.
  */
 void Machine::insertMachineConfigFile()
 {
-    QSettings settings;
-    settings.beginGroup("DataFolder");
-    QString dataDirectoryPath = settings.value("QtEmuData",
-                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
-    settings.endGroup();
-    QString qtemuConfig = dataDirectoryPath.append("qtemu.json");
-
-    QFile machinesFile(qtemuConfig);
-    if (!machinesFile.open(QFile::ReadWrite)) {
-        SystemUtils::showMessage(tr("Qtemu - Critical error"),
-                                 tr("<p>Cannot save the machine</p>"
-                                    "<p>The file with all the machines configuration are not writable</p>"),
-                                 QMessageBox::Critical);
-        return;
-    }
-
-    // Read all data included in the file
-    QByteArray machinesData = machinesFile.readAll();
-    QJsonDocument machinesDocument(QJsonDocument::fromJson(machinesData));
-    QJsonObject machinesObject;
-
-    // Read other machines
-    QJsonArray machines = machinesDocument["machines"].toArray();
-
-    // Create the new machine
     QJsonObject machine;
     machine["uuid"]       = this->uuid.toString();
+    machine["name"]       = this->name;
     machine["path"]       = QDir::toNativeSeparators(this->path);
     machine["configpath"] = QDir::toNativeSeparators(this->configPath);
     machine["icon"]       = this->OSVersion.toLower().replace(" ", "_");
 
-    machines.append(machine);
-    machinesObject["machines"] = machines;
+    QString error;
+    if (!MachineRegistry::instance()->insertMachine(machine, error)) {
+        ErrorReporter::report(tr("Qtemu - Critical error"),
+                              tr("<p>Cannot save the machine</p>"
+                                 "<p>The file with all the machines configuration are not writable: %1</p>")
+                              .arg(error),
+                              ErrorReporter::Critical);
+    }
+}
+
+/**
+ * @brief Get the folder of the event log
+ * @return folder with the events of the machine
+ *
+ * Get the folder of the event log
+ */
+QString Machine::getEventLogPath() const
+{
+    return QDir::toNativeSeparators(this->path + "/logs/events");
+}
+
+/**
+ * @brief Get the event log of the machine
+ * @return event log
+ *
+ * Get the event log of the machine. The log follows
+ * the machine if its folder changes
+ */
+MachineEventLog *Machine::getEventLog()
+{
+    if (this->m_eventLog == nullptr || this->m_eventLog->directoryPath() != this->getEventLogPath()) {
+        delete this->m_eventLog;
+        this->m_eventLog = new MachineEventLog(this->getEventLogPath(), this);
+    }
 
-    QJsonDocument machinesJSONDocument(machinesObject);
+    return m_eventLog;
+}
 
-    machinesFile.seek(0);
-    machinesFile.write(machinesJSONDocument.toJson());
-    if (machinesFile.isOpen()) {
-        machinesFile.close();
+/**
+ * @brief Record an event of the machine
+ * @param type, type of the event
+ * @param data, data of the event
+ *
+ * Record an event in the event log of the machine
+ */
+void Machine::recordEvent(MachineEventLog::EventTypes type, const QJsonObject &data)
+{
+    if (this->path.isEmpty()) {
+        return;
     }
+
+    this->getEventLog()->record(type, data);
+}
+
+/**
+ * @brief Get the console of the machine
+ * @return buffer with the last output of QEMU
+ *
+ * Get the console of the machine
+ */
+ConsoleBuffer *Machine::getConsole() const
+{
+    return m_console;
+}
+
+/**
+ * @brief Notify an error of QEMU
+ * @param message, error written by QEMU
+ *
+ * Notify an error of QEMU. Only one notification is sent
+ * in every interval, the rest are summarized later
+ */
+void Machine::notifyConsoleError(const QString &message)
+{
+    if (this->m_notificationTimer->isActive()) {
+        ++this->m_pendingNotifications;
+        return;
+    }
+
+    emit(machineConsoleNotificationSignal(this->uuid, message.simplified()));
+    this->m_notificationTimer->start();
+}
+
+/**
+ * @brief Send the summary of the errors not notified
+ *
+ * Send the summary of the errors received
+ * since the last notification
+ */
+void Machine::sendPendingNotifications()
+{
+    if (this->m_pendingNotifications == 0) {
+        return;
+    }
+
+    emit(machineConsoleNotificationSignal(this->uuid,
+                                          tr("%n more error message(s), see the console", "",
+                                             this->m_pendingNotifications)));
+    this->m_pendingNotifications = 0;
+    this->m_notificationTimer->start();
+}
+
+/**
+ * @brief Get the process id of QEMU
+ * @return process id, 0 if the machine isn't running
+ *
+ * Get the process id of QEMU
+ */
+qint64 Machine::getProcessId() const
+{
+    return this->m_machineProcess->processId();
+}
+
+/**
+ * @brief Get the vCPU threads
+ * @return thread ids of the vCPUs
+ *
+ * Get the thread ids of the vCPUs, known
+ * when the QMP connection is ready
+ */
+QList<qint64> Machine::getVCPUThreads() const
+{
+    return m_vCPUThreads;
+}
+
+/**
+ * @brief Get the resource usage of the machine
+ * @return last samples of the machine
+ *
+ * Get the last samples of the resource usage
+ */
+MetricsSeries *Machine::getMetrics()
+{
+    return &this->m_metrics;
+}
+
+/**
+ * @brief Get the time the machine is running
+ * @return time since QEMU was started in milliseconds, 0 if the machine is stopped
+ *
+ * Get the time the machine is running
+ */
+qint64 Machine::getUptime() const
+{
+    if (this->state == Machine::Stopped || !this->m_runTimer.isValid()) {
+        return 0;
+    }
+
+    return this->m_runTimer.elapsed();
+}
+
+/**
+ * @brief Get the number of restarts
+ * @return times QEMU was started again since QtEmu was opened
+ *
+ * Get the number of restarts. The first start isn't counted
+ */
+int Machine::getRestartCount() const
+{
+    return qMax(0, this->m_startCount - 1);
+}
+
+/**
+ * @brief Get the name of an exit cause
+ * @param cause, why QEMU finished
+ * @return name of the cause, stored in the event log
+ *
+ * Get the name of an exit cause
+ */
+QString Machine::exitCauseName(Machine::ExitCauses cause)
+{
+    switch (cause) {
+        case Machine::StopRequested:
+            return "stop";
+        case Machine::GuestShutdown:
+            return "shutdown";
+        case Machine::ProcessFailure:
+            return "failure";
+        case Machine::ProcessCrash:
+            return "crash";
+        case Machine::GuestPanic:
+            return "panic";
+    }
+
+    return QString();
 }
@@ -24,19 +24,29 @@
 // Qt
 #include <QObject>
 #include <QProcess>
-#include <QTcpSocket>
 #include <QHash>
+#include <QMap>
 #include <QUuid>
-#include <QMessageBox>
 #include <QSettings>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <QDebug>
 
 // Local
 #include "qemu.h"
 #include "boot.h"
 #include "media.h"
+#include "networkinterface.h"
+#include "qmpclient.h"
 #include "machineutils.h"
+#include "machineregistry.h"
+#include "utils/hosttopology.h"
 #include "utils/logger.h"
+#include "utils/machineeventlog.h"
+#include "utils/consolebuffer.h"
+#include "utils/metricsseries.h"
+#include "utils/errorreporter.h"
+#include "utils/hostutils.h"
 
 class Machine: public QObject {
     Q_OBJECT
@@ -49,6 +59,10 @@ class Machine: public QObject {
             Started, Stopped, Saved, Paused
         };
 
+        enum ExitCauses {
+            StopRequested, GuestShutdown, ProcessFailure, ProcessCrash, GuestPanic
+        };
+
         QString getName() const;
         void setName(const QString &value);
 
@@ -67,6 +81,12 @@ class Machine: public QObject {
         QString getConfigPath() const;
         void setConfigPath(const QString &value);
 
+        QString getQMPSocketPath() const;
+        QString getGuestAgentSocketPath() const;
+        bool getGuestAgent() const;
+        void setGuestAgent(bool value);
+        QMPClient *getQMPClient() const;
+
         QUuid getUuid() const;
         void setUuid(const QUuid &value);
 
@@ -94,6 +114,12 @@ class Machine: public QObject {
         int getMaxHotCPU() const;
         void setMaxHotCPU(const int &value);
 
+        QString getCPUPinning() const;
+        void setCPUPinning(const QString &value);
+
+        QString getCPUSet() const;
+        void setCPUSet(const QString &value);
+
         QString getGPUType() const;
         void setGPUType(const QString &value);
 
@@ -103,6 +129,27 @@ class Machine: public QObject {
         qlonglong getRAM() const;
         void setRAM(const qlonglong &value);
 
+        QString getMemoryBackend() const;
+        void setMemoryBackend(const QString &value);
+
+        int getHugePageSize() const;
+        void setHugePageSize(const int &value);
+
+        QString getMemoryPath() const;
+        void setMemoryPath(const QString &value);
+
+        bool getMemoryPrealloc() const;
+        void setMemoryPrealloc(bool value);
+
+        int getPreallocThreads() const;
+        void setPreallocThreads(const int &value);
+
+        int getNUMANodes() const;
+        void setNUMANodes(const int &value);
+
+        QStringList getNUMAHostNodes() const;
+        void setNUMAHostNodes(const QStringList &value);
+
         QStringList getAudio() const;
         void setAudio(const QStringList &value);
 
@@ -112,9 +159,15 @@ class Machine: public QObject {
         bool getUseNetwork() const;
         void setUseNetwork(bool value);
 
+        QList<NetworkInterface *> getNetworkInterfaces() const;
+        void addNetworkInterface(NetworkInterface *networkInterface);
+
         QList<Media *> getMedia() const;
         void addMedia(Media *media);
 
+        int getIOThreads() const;
+        void setIOThreads(const int &value);
+
         QStringList getAccelerator() const;
         void setAccelerator(const QStringList &value);
 
@@ -131,19 +184,42 @@ class Machine: public QObject {
         void removeAllAccelerators();
 
         void removeAllMedia();
+        void removeAllNetworkInterfaces();
 
         QString getAudioLabel();
         QString getAcceleratorLabel();
+        QString getCPUPlacementLabel();
+        QString getNetworkLabel();
 
         void runMachine(QEMU *QEMUGlobalObject);
-        void stopMachine();
+        void stopMachine(bool force = false);
         void resetMachine();
         void pauseMachine();
+        QJsonObject getMachineJSON() const;
         bool saveMachine();
         void insertMachineConfigFile();
 
+        QString getEventLogPath() const;
+        MachineEventLog *getEventLog();
+        void recordEvent(MachineEventLog::EventTypes type, const QJsonObject &data);
+
+        ConsoleBuffer *getConsole() const;
+
+        qint64 getProcessId() const;
+        QList<qint64> getVCPUThreads() const;
+        MetricsSeries *getMetrics();
+        qint64 getUptime() const;
+        int getRestartCount() const;
+
+        static QString exitCauseName(Machine::ExitCauses cause);
+
     signals:
         void machineStateChangedSignal(States newState);
+        void machineCPUPlacementChangedSignal(const QUuid machineUuid);
+        void machineConsoleNotificationSignal(const QUuid machineUuid, const QString &message);
+        void machineStartFailedSignal(const QUuid machineUuid, const QString &error);
+        void machineExitedSignal(const QUuid machineUuid, Machine::ExitCauses cause,
+                                 int exitCode, qint64 duration);
 
     public slots:
 
@@ -152,6 +228,12 @@ class Machine: public QObject {
         void readMachineErrorOut();
         void machineStarted();
         void machineFinished(int exitCode, QProcess::ExitStatus exitStatus);
+        void machineProcessError(QProcess::ProcessError error);
+        void QMPReady();
+        void QMPStopped();
+        void QMPResumed();
+        void QMPCommandFailed(const QString &command, const QString &error);
+        void sendPendingNotifications();
 
     protected:
 
@@ -174,6 +256,8 @@ class Machine: public QObject {
         int coresSocket;
         int threadsCore;
         int maxHotCPU;
+        QString CPUPinning;
+        QString CPUSet;
 
         // Hardware - GPU
         QString GPUType;
@@ -181,6 +265,13 @@ class Machine: public QObject {
 
         // Hardware - RAM
         qlonglong RAM;
+        QString memoryBackend;
+        int hugePageSize;
+        QString memoryPath;
+        bool memoryPrealloc;
+        int preallocThreads;
+        int NUMANodes;
+        QStringList NUMAHostNodes;
 
         // Hardware - Audio
         QStringList audio;
@@ -188,9 +279,14 @@ class Machine: public QObject {
 
         // Hardware - Network
         bool useNetwork;
+        QList<NetworkInterface *> networkInterfaces;
+
+        // Channel of the guest agent
+        bool guestAgent;
 
         // Hardware - media
         QList<Media *> media;
+        int IOThreads;
 
         // Accelerator
         QStringList accelerator;
@@ -200,19 +296,40 @@ class Machine: public QObject {
 
         // Process
         QProcess *m_machineProcess;
-        QTcpSocket *m_machineTcpSocket;
+        QMPClient *m_QMPClient;
+        QElapsedTimer m_runTimer;
+        int m_startCount;
+
+        // Why QEMU finished
+        bool m_stopRequested;
+        bool m_guestPanicked;
+        QString m_shutdownReason;
+
+        // Structured events of the machine
+        MachineEventLog *m_eventLog;
+
+        // Output of QEMU and notifications of its errors
+        ConsoleBuffer *m_console;
+        QTimer *m_notificationTimer;
+        int m_pendingNotifications;
+
+        // Resource usage of the running machine
+        QList<qint64> m_vCPUThreads;
+        MetricsSeries m_metrics;
 
-        // Messages
-        QMessageBox *m_saveMachineMessageBox;
-        QMessageBox *m_machineConfigMessageBox;
-        QMessageBox *m_machineStandardOutMessageBox;
-        QMessageBox *m_machineErrorOutMessageBox;
-        QMessageBox *m_machineBinaryErrorMessageBox;
-        QMessageBox *m_failConnectErrorMessageBox;
+        // Placement of the threads in the host CPUs
+        QList<int> m_pinnedCPUs;
+        QMap<int, int> m_vCPUPlacement;
 
         // Methods
         QProcessEnvironment buildEnvironment();
         QStringList generateMachineCommand();
+        QStringList generateMemoryCommand();
+        QStringList generateMediaCommand();
+        QStringList generateNetworkCommand();
+        void sendQMPCommand(const QString &command);
+        void pinThreads();
         void failConnectMachine();
+        void notifyConsoleError(const QString &message);
 };
 #endif // MACHINE_H
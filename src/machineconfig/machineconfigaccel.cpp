@@ -55,8 +55,9 @@ MachineConfigAccel::MachineConfigAccel(Machine *machine,
 
     QStringList accelList = machine->getAccelerator();
 
-    QHash<QString, QString> accelHash = SystemUtils::getAccelerators();
-    QHashIterator<QString, QString> i(accelHash);
+    // Offer the accelerators of the installed QEMU and keep the selected ones
+    QHash<QString, QString> accelHash = HostUtils::getAccelerators();
+    QHashIterator<QString, QString> i(HostUtils::getAvailableAccelerators());
     while (i.hasNext()) {
         i.next();
         if ( ! accelList.contains(i.key())) {
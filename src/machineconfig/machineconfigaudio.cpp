@@ -55,8 +55,9 @@ MachineConfigAudio::MachineConfigAudio(Machine *machine,
 
     QStringList audioList = machine->getAudio();
 
-    QHash<QString, QString> audioHash = SystemUtils::getSoundCards();
-    QHashIterator<QString, QString> i(audioHash);
+    // Offer the cards of the installed QEMU and keep the selected ones
+    QHash<QString, QString> audioHash = HostUtils::getSoundCards();
+    QHashIterator<QString, QString> i(HostUtils::getAvailableSoundCards());
     while (i.hasNext()) {
         i.next();
         if ( ! audioList.contains(i.key())) {
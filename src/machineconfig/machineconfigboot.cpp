@@ -58,7 +58,7 @@ MachineConfigBoot::MachineConfigBoot(Machine *machine,
             this, &MachineConfigBoot::moveDownButton);
 
     QStringList bootList = this->m_machine->getBoot()->bootOrder();
-    QMap<QString, QString> mediaDevicesMap = SystemUtils::getMediaDevices();
+    QMap<QString, QString> mediaDevicesMap = HostUtils::getMediaDevices();
     QMapIterator<QString, QString> i(mediaDevicesMap);
     while (i.hasNext()) {
         i.next();
@@ -44,12 +44,16 @@ MachineConfigGeneral::MachineConfigGeneral(Machine *machine,
 
     m_basicTab = new BasicTab(machine, enableFields, this);
     m_descriptionTab = new DescriptionTab(machine, enableFields, this);
+    m_autostartTab = new AutostartTab(machine, this);
+    m_restartTab = new RestartTab(machine, this);
 
     m_generalTabWidget = new QTabWidget(this);
     m_generalTabWidget->setSizePolicy(QSizePolicy::MinimumExpanding,
                                             QSizePolicy::MinimumExpanding);
     m_generalTabWidget->addTab(this->m_basicTab, tr("Basic Details"));
     m_generalTabWidget->addTab(this->m_descriptionTab, tr("Description"));
+    m_generalTabWidget->addTab(this->m_autostartTab, tr("Autostart"));
+    m_generalTabWidget->addTab(this->m_restartTab, tr("Restart"));
 
     m_generalPageLayout = new QVBoxLayout();
     m_generalPageLayout->setAlignment(Qt::AlignCenter);
@@ -78,4 +82,18 @@ void MachineConfigGeneral::saveGeneralData()
     this->m_machine->setOSType(this->m_basicTab->getMachineType());
     this->m_machine->setOSVersion(this->m_basicTab->getMachineVersion());
     this->m_machine->setDescription(this->m_descriptionTab->getMachineDescription());
+
+    // The autostart and restart configs are stored in the registry
+    QString error;
+    AutostartManager::BootConfig bootConfig = this->m_autostartTab->getBootConfig();
+    if (AutostartManager::setBootConfig(this->m_machine->getUuid(), bootConfig, error)) {
+        this->m_machine->setGuestAgent(bootConfig.readiness == AutostartManager::GuestAgent);
+    } else {
+        Logger::logQtemuError(tr("Cannot save the autostart of the machine: %1").arg(error));
+    }
+
+    if (!MachineSupervisor::setRestartConfig(this->m_machine->getUuid(),
+                                             this->m_restartTab->getRestartConfig(), error)) {
+        Logger::logQtemuError(tr("Cannot save the restart policy of the machine: %1").arg(error));
+    }
 }
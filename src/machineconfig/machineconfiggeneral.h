@@ -62,6 +62,8 @@ class MachineConfigGeneral : public QWidget {
         Machine *m_machine;
         BasicTab *m_basicTab;
         DescriptionTab *m_descriptionTab;
+        AutostartTab *m_autostartTab;
+        RestartTab *m_restartTab;
 };
 
 #endif // MACHINECONFIGGENERAL_H
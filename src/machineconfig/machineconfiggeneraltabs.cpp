@@ -239,3 +239,219 @@ QString DescriptionTab::getMachineDescription() const
 {
     return this->m_machineDescTextEdit->toPlainText();
 }
+
+/**
+ * @brief Tab with the autostart of the machine
+ * @param machine, machine to be configured
+ * @param parent, parent widget
+ *
+ * Tab with the autostart of the machine. The boot group,
+ * the groups that must be ready before the machine is
+ * started and how to know that the machine is ready
+ */
+AutostartTab::AutostartTab(Machine *machine,
+                           QWidget *parent) : QWidget(parent)
+{
+    AutostartManager::BootConfig bootConfig = AutostartManager::bootConfig(machine->getUuid());
+
+    m_autostartCheckBox = new QCheckBox(tr("Start the machine with QtEmu"), this);
+    m_autostartCheckBox->setChecked(bootConfig.enabled);
+    connect(m_autostartCheckBox, &QAbstractButton::toggled,
+            this, &AutostartTab::updateFields);
+
+    m_bootGroupLineEdit = new QLineEdit(this);
+    m_bootGroupLineEdit->setText(bootConfig.group);
+    m_bootGroupLineEdit->setPlaceholderText("database");
+    m_bootGroupLineEdit->setToolTip(tr("The machines of a group are ready when all of them are ready"));
+
+    m_afterGroupsLineEdit = new QLineEdit(this);
+    m_afterGroupsLineEdit->setText(bootConfig.after.join(", "));
+    m_afterGroupsLineEdit->setPlaceholderText("network, storage");
+    m_afterGroupsLineEdit->setToolTip(tr("Groups that must be ready before the machine is started, separated by commas"));
+
+    m_readinessComboBox = new QComboBox(this);
+    m_readinessComboBox->addItem(tr("QEMU is running"), AutostartManager::QMPRunning);
+    m_readinessComboBox->addItem(tr("A TCP port is open"), AutostartManager::TCPPort);
+    m_readinessComboBox->addItem(tr("The guest agent answers"), AutostartManager::GuestAgent);
+    m_readinessComboBox->setCurrentIndex(m_readinessComboBox->findData(bootConfig.readiness));
+    m_readinessComboBox->setToolTip(tr("The guest agent needs qemu-guest-agent in the guest"));
+    connect(m_readinessComboBox, &QComboBox::currentIndexChanged,
+            this, &AutostartTab::updateFields);
+
+    m_readyHostLineEdit = new QLineEdit(this);
+    m_readyHostLineEdit->setText(bootConfig.host);
+    m_readyHostLineEdit->setPlaceholderText("127.0.0.1");
+
+    m_readyPortSpinBox = new QSpinBox(this);
+    m_readyPortSpinBox->setMinimum(1);
+    m_readyPortSpinBox->setMaximum(65535);
+    m_readyPortSpinBox->setValue(bootConfig.port > 0 ? bootConfig.port : 22);
+
+    m_readyTimeoutSpinBox = new QSpinBox(this);
+    m_readyTimeoutSpinBox->setMinimum(1);
+    m_readyTimeoutSpinBox->setMaximum(3600);
+    m_readyTimeoutSpinBox->setSuffix(" s");
+    m_readyTimeoutSpinBox->setValue(bootConfig.timeout);
+
+    m_autostartFormLayout = new QFormLayout();
+    m_autostartFormLayout->setAlignment(Qt::AlignTop);
+    m_autostartFormLayout->setLabelAlignment(Qt::AlignLeft);
+    m_autostartFormLayout->setHorizontalSpacing(20);
+    m_autostartFormLayout->setVerticalSpacing(10);
+    m_autostartFormLayout->addRow(m_autostartCheckBox);
+    m_autostartFormLayout->addRow(tr("Boot group") + ":", m_bootGroupLineEdit);
+    m_autostartFormLayout->addRow(tr("Start after") + ":", m_afterGroupsLineEdit);
+    m_autostartFormLayout->addRow(tr("Ready when") + ":", m_readinessComboBox);
+    m_autostartFormLayout->addRow(tr("Host") + ":", m_readyHostLineEdit);
+    m_autostartFormLayout->addRow(tr("Port") + ":", m_readyPortSpinBox);
+    m_autostartFormLayout->addRow(tr("Timeout") + ":", m_readyTimeoutSpinBox);
+
+    m_autostartLayout = new QVBoxLayout();
+    m_autostartLayout->addItem(m_autostartFormLayout);
+
+    this->setLayout(m_autostartLayout);
+
+    this->updateFields();
+
+    qDebug() << "AutostartTab created";
+}
+
+AutostartTab::~AutostartTab()
+{
+    qDebug() << "AutostartTab destroyed";
+}
+
+/**
+ * @brief Enable the fields used by the config
+ *
+ * The host and the port are only used
+ * when the readiness is a TCP port
+ */
+void AutostartTab::updateFields()
+{
+    bool enabled = this->m_autostartCheckBox->isChecked();
+    bool TCPPort = this->m_readinessComboBox->currentData().toInt() == AutostartManager::TCPPort;
+
+    this->m_bootGroupLineEdit->setEnabled(enabled);
+    this->m_afterGroupsLineEdit->setEnabled(enabled);
+    this->m_readinessComboBox->setEnabled(enabled);
+    this->m_readyHostLineEdit->setEnabled(enabled && TCPPort);
+    this->m_readyPortSpinBox->setEnabled(enabled && TCPPort);
+    this->m_readyTimeoutSpinBox->setEnabled(enabled);
+}
+
+/**
+ * @brief Get the autostart config of the machine
+ * @return autostart config
+ *
+ * Get the autostart config of the machine
+ */
+AutostartManager::BootConfig AutostartTab::getBootConfig() const
+{
+    AutostartManager::BootConfig bootConfig;
+    bootConfig.enabled = this->m_autostartCheckBox->isChecked();
+    bootConfig.group = this->m_bootGroupLineEdit->text().trimmed();
+    foreach (const QString &group, this->m_afterGroupsLineEdit->text().split(',', Qt::SkipEmptyParts)) {
+        if (!group.trimmed().isEmpty()) {
+            bootConfig.after.append(group.trimmed());
+        }
+    }
+    bootConfig.readiness = static_cast<AutostartManager::Readiness>(this->m_readinessComboBox->currentData().toInt());
+    bootConfig.host = this->m_readyHostLineEdit->text().trimmed();
+    if (bootConfig.host.isEmpty()) {
+        bootConfig.host = "127.0.0.1";
+    }
+    bootConfig.port = this->m_readyPortSpinBox->value();
+    bootConfig.timeout = this->m_readyTimeoutSpinBox->value();
+
+    return bootConfig;
+}
+
+/**
+ * @brief Tab with the restart policy of the machine
+ * @param machine, machine to be configured
+ * @param parent, parent widget
+ *
+ * Tab with the restart policy of the machine. When QEMU
+ * is restarted and how many times it's restarted in a row
+ */
+RestartTab::RestartTab(Machine *machine,
+                       QWidget *parent) : QWidget(parent)
+{
+    MachineSupervisor::RestartConfig restartConfig = MachineSupervisor::restartConfig(machine->getUuid());
+
+    m_restartPolicyComboBox = new QComboBox(this);
+    m_restartPolicyComboBox->addItem(tr("Never"), MachineSupervisor::Never);
+    m_restartPolicyComboBox->addItem(tr("When QEMU fails or the guest panics"), MachineSupervisor::OnFailure);
+    m_restartPolicyComboBox->addItem(tr("Always, unless it's stopped from QtEmu"), MachineSupervisor::Always);
+    m_restartPolicyComboBox->setCurrentIndex(m_restartPolicyComboBox->findData(restartConfig.policy));
+    connect(m_restartPolicyComboBox, &QComboBox::currentIndexChanged,
+            this, &RestartTab::updateFields);
+
+    m_maxRestartsSpinBox = new QSpinBox(this);
+    m_maxRestartsSpinBox->setMinimum(0);
+    m_maxRestartsSpinBox->setMaximum(100);
+    m_maxRestartsSpinBox->setSpecialValueText(tr("No limit"));
+    m_maxRestartsSpinBox->setValue(restartConfig.maxRestarts);
+    m_maxRestartsSpinBox->setToolTip(tr("Restarts in a row. The count is reset when the machine runs five minutes"));
+
+    m_backoffSpinBox = new QSpinBox(this);
+    m_backoffSpinBox->setMinimum(500);
+    m_backoffSpinBox->setMaximum(300000);
+    m_backoffSpinBox->setSingleStep(500);
+    m_backoffSpinBox->setSuffix(" ms");
+    m_backoffSpinBox->setValue(restartConfig.backoff);
+    m_backoffSpinBox->setToolTip(tr("Time before the first restart, doubled after every restart"));
+
+    m_restartFormLayout = new QFormLayout();
+    m_restartFormLayout->setAlignment(Qt::AlignTop);
+    m_restartFormLayout->setLabelAlignment(Qt::AlignLeft);
+    m_restartFormLayout->setHorizontalSpacing(20);
+    m_restartFormLayout->setVerticalSpacing(10);
+    m_restartFormLayout->addRow(tr("Restart") + ":", m_restartPolicyComboBox);
+    m_restartFormLayout->addRow(tr("Maximum restarts") + ":", m_maxRestartsSpinBox);
+    m_restartFormLayout->addRow(tr("Delay") + ":", m_backoffSpinBox);
+
+    m_restartLayout = new QVBoxLayout();
+    m_restartLayout->addItem(m_restartFormLayout);
+
+    this->setLayout(m_restartLayout);
+
+    this->updateFields();
+
+    qDebug() << "RestartTab created";
+}
+
+RestartTab::~RestartTab()
+{
+    qDebug() << "RestartTab destroyed";
+}
+
+/**
+ * @brief Enable the fields used by the policy
+ *
+ * The limits aren't used if the machine is never restarted
+ */
+void RestartTab::updateFields()
+{
+    bool restart = this->m_restartPolicyComboBox->currentData().toInt() != MachineSupervisor::Never;
+
+    this->m_maxRestartsSpinBox->setEnabled(restart);
+    this->m_backoffSpinBox->setEnabled(restart);
+}
+
+/**
+ * @brief Get the restart config of the machine
+ * @return restart config
+ *
+ * Get the restart config of the machine
+ */
+MachineSupervisor::RestartConfig RestartTab::getRestartConfig() const
+{
+    MachineSupervisor::RestartConfig restartConfig;
+    restartConfig.policy = static_cast<MachineSupervisor::RestartPolicies>(this->m_restartPolicyComboBox->currentData().toInt());
+    restartConfig.maxRestarts = this->m_maxRestartsSpinBox->value();
+    restartConfig.backoff = this->m_backoffSpinBox->value();
+
+    return restartConfig;
+}
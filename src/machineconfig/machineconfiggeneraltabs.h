@@ -29,9 +29,13 @@
 #include <QPlainTextEdit>
 #include <QComboBox>
 #include <QLineEdit>
+#include <QCheckBox>
+#include <QSpinBox>
 
 // Local
 #include "../machine.h"
+#include "../autostartmanager.h"
+#include "../machinesupervisor.h"
 
 
 class BasicTab: public QWidget {
@@ -95,4 +99,62 @@ class DescriptionTab: public QWidget {
 
 };
 
+class AutostartTab: public QWidget {
+    Q_OBJECT
+
+    public:
+        explicit AutostartTab(Machine *machine,
+                              QWidget *parent = nullptr);
+        ~AutostartTab();
+        AutostartManager::BootConfig getBootConfig() const;
+
+    signals:
+
+    public slots:
+
+    private slots:
+        void updateFields();
+
+    protected:
+
+    private:
+        QVBoxLayout *m_autostartLayout;
+        QFormLayout *m_autostartFormLayout;
+
+        QCheckBox *m_autostartCheckBox;
+        QLineEdit *m_bootGroupLineEdit;
+        QLineEdit *m_afterGroupsLineEdit;
+        QComboBox *m_readinessComboBox;
+        QLineEdit *m_readyHostLineEdit;
+        QSpinBox *m_readyPortSpinBox;
+        QSpinBox *m_readyTimeoutSpinBox;
+};
+
+class RestartTab: public QWidget {
+    Q_OBJECT
+
+    public:
+        explicit RestartTab(Machine *machine,
+                            QWidget *parent = nullptr);
+        ~RestartTab();
+        MachineSupervisor::RestartConfig getRestartConfig() const;
+
+    signals:
+
+    public slots:
+
+    private slots:
+        void updateFields();
+
+    protected:
+
+    private:
+        QVBoxLayout *m_restartLayout;
+        QFormLayout *m_restartFormLayout;
+
+        QComboBox *m_restartPolicyComboBox;
+        QSpinBox *m_maxRestartsSpinBox;
+        QSpinBox *m_backoffSpinBox;
+};
+
 #endif // MACHINECONFIGGENERALTABS_H
@@ -79,7 +79,20 @@ void MachineConfigHardware::saveHardwareData()
     this->m_machine->setType(this->m_machineTypeTab->getMachineType());
     this->m_machine->setCPUType(this->m_processorConfigTab->getCPUType());
     this->m_machine->setCPUCount(this->m_processorConfigTab->getCPUCount());
+    this->m_machine->setSocketCount(this->m_processorConfigTab->getSocketCount());
+    this->m_machine->setCoresSocket(this->m_processorConfigTab->getCoresSocket());
+    this->m_machine->setThreadsCore(this->m_processorConfigTab->getThreadsCore());
+    this->m_machine->setMaxHotCPU(this->m_processorConfigTab->getMaxHotCPU());
+    this->m_machine->setCPUPinning(this->m_processorConfigTab->getCPUPinning());
+    this->m_machine->setCPUSet(this->m_processorConfigTab->getCPUSet());
     this->m_machine->setGPUType(this->m_graphicsConfigTab->getGPUType());
     this->m_machine->setKeyboard(this->m_graphicsConfigTab->getKeyboardLayout());
     this->m_machine->setRAM(this->m_ramConfigTab->getAmountRam());
+    this->m_machine->setMemoryBackend(this->m_ramConfigTab->getMemoryBackend());
+    this->m_machine->setHugePageSize(this->m_ramConfigTab->getHugePageSize());
+    this->m_machine->setMemoryPath(QDir::fromNativeSeparators(this->m_ramConfigTab->getMemoryPath()));
+    this->m_machine->setMemoryPrealloc(this->m_ramConfigTab->getMemoryPrealloc());
+    this->m_machine->setPreallocThreads(this->m_ramConfigTab->getPreallocThreads());
+    this->m_machine->setNUMANodes(this->m_ramConfigTab->getNUMANodes());
+    this->m_machine->setNUMAHostNodes(this->m_ramConfigTab->getNUMAHostNodes());
 }
@@ -40,6 +40,11 @@ ProcessorConfigTab::ProcessorConfigTab(Machine *machine,
     m_CPUType->setEnabled(enableFields);
     SystemUtils::setCPUTypesx86(m_CPUType);
     int cpuTypeIndex = m_CPUType->findData(machine->getCPUType());
+    // Keep the model of the machine, even if QEMU doesn't have it
+    if (cpuTypeIndex == -1 && !machine->getCPUType().isEmpty()) {
+        m_CPUType->addItem(machine->getCPUType(), machine->getCPUType());
+        cpuTypeIndex = m_CPUType->count() - 1;
+    }
     if (cpuTypeIndex != -1) {
        m_CPUType->setCurrentIndex(cpuTypeIndex);
     }
@@ -72,12 +77,108 @@ ProcessorConfigTab::ProcessorConfigTab(Machine *machine,
     m_CPUSettings = new QGroupBox(tr("CPU Settings"), this);
     m_CPUSettings->setLayout(m_CPUSettingsLayout);
 
+    // Topology. 0 means that the value is calculated
+    m_socketCountSpinBox = new QSpinBox(this);
+    m_socketCountSpinBox->setMinimum(0);
+    m_socketCountSpinBox->setMaximum(255);
+    m_socketCountSpinBox->setSpecialValueText(tr("Auto"));
+    m_socketCountSpinBox->setValue(machine->getSocketCount());
+    m_socketCountSpinBox->setEnabled(enableFields);
+
+    m_coresSocketSpinBox = new QSpinBox(this);
+    m_coresSocketSpinBox->setMinimum(0);
+    m_coresSocketSpinBox->setMaximum(255);
+    m_coresSocketSpinBox->setSpecialValueText(tr("Auto"));
+    m_coresSocketSpinBox->setValue(machine->getCoresSocket());
+    m_coresSocketSpinBox->setEnabled(enableFields);
+
+    m_threadsCoreSpinBox = new QSpinBox(this);
+    m_threadsCoreSpinBox->setMinimum(0);
+    m_threadsCoreSpinBox->setMaximum(8);
+    m_threadsCoreSpinBox->setSpecialValueText(tr("Auto"));
+    m_threadsCoreSpinBox->setValue(machine->getThreadsCore());
+    m_threadsCoreSpinBox->setEnabled(enableFields);
+
+    m_maxHotCPUSpinBox = new QSpinBox(this);
+    m_maxHotCPUSpinBox->setMinimum(0);
+    m_maxHotCPUSpinBox->setMaximum(255);
+    m_maxHotCPUSpinBox->setSpecialValueText(tr("Auto"));
+    m_maxHotCPUSpinBox->setValue(machine->getMaxHotCPU());
+    m_maxHotCPUSpinBox->setEnabled(enableFields);
+
+    m_topologyStatusLabel = new QLabel(this);
+    m_topologyStatusLabel->setWordWrap(true);
+
+    connect(m_CPUCountSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &ProcessorConfigTab::checkTopology);
+    connect(m_socketCountSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &ProcessorConfigTab::checkTopology);
+    connect(m_coresSocketSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &ProcessorConfigTab::checkTopology);
+    connect(m_threadsCoreSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &ProcessorConfigTab::checkTopology);
+    connect(m_maxHotCPUSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &ProcessorConfigTab::checkTopology);
+
+    m_topologyLayout = new QFormLayout();
+    m_topologyLayout->setLabelAlignment(Qt::AlignLeft);
+    m_topologyLayout->addRow(tr("Sockets") + ":", m_socketCountSpinBox);
+    m_topologyLayout->addRow(tr("Cores per socket") + ":", m_coresSocketSpinBox);
+    m_topologyLayout->addRow(tr("Threads per core") + ":", m_threadsCoreSpinBox);
+    m_topologyLayout->addRow(tr("Maximum hotplug CPUs") + ":", m_maxHotCPUSpinBox);
+    m_topologyLayout->addRow(m_topologyStatusLabel);
+
+    m_topologySettings = new QGroupBox(tr("CPU Topology"), this);
+    m_topologySettings->setLayout(m_topologyLayout);
+
+    // Pinning of the threads of QEMU in the host CPUs
+    this->m_enableFields = enableFields;
+
+    m_pinningComboBox = new QComboBox(this);
+    m_pinningComboBox->addItem(tr("None"), QString("none"));
+    m_pinningComboBox->addItem(tr("Automatic"), QString("auto"));
+    m_pinningComboBox->addItem(tr("Host CPUs"), QString("explicit"));
+    int pinningIndex = m_pinningComboBox->findData(machine->getCPUPinning());
+    m_pinningComboBox->setCurrentIndex(pinningIndex != -1 ? pinningIndex : 0);
+    m_pinningComboBox->setEnabled(enableFields);
+
+    m_CPUSetLineEdit = new QLineEdit(this);
+    m_CPUSetLineEdit->setPlaceholderText(tr("Ex: 2-5,8"));
+    m_CPUSetLineEdit->setText(machine->getCPUSet());
+
+    m_hostTopologyLabel = new QLabel(HostTopology::getTopologyLabel(), this);
+    m_hostTopologyLabel->setWordWrap(true);
+
+    m_pinningStatusLabel = new QLabel(this);
+    m_pinningStatusLabel->setWordWrap(true);
+
+    connect(m_pinningComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &ProcessorConfigTab::checkPinning);
+    connect(m_CPUSetLineEdit, &QLineEdit::textChanged,
+            this, &ProcessorConfigTab::checkPinning);
+    connect(m_CPUCountSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &ProcessorConfigTab::checkPinning);
+
+    m_pinningLayout = new QFormLayout();
+    m_pinningLayout->setLabelAlignment(Qt::AlignLeft);
+    m_pinningLayout->addRow(tr("Policy") + ":", m_pinningComboBox);
+    m_pinningLayout->addRow(tr("Host CPUs") + ":", m_CPUSetLineEdit);
+    m_pinningLayout->addRow(m_hostTopologyLabel);
+    m_pinningLayout->addRow(m_pinningStatusLabel);
+
+    m_pinningSettings = new QGroupBox(tr("CPU Pinning"), this);
+    m_pinningSettings->setLayout(m_pinningLayout);
+
     m_processorLayout = new QVBoxLayout();
     m_processorLayout->setAlignment(Qt::AlignTop);
     m_processorLayout->addItem(m_CPUTypeLayout);
     m_processorLayout->addWidget(m_CPUSettings);
+    m_processorLayout->addWidget(m_topologySettings);
+    m_processorLayout->addWidget(m_pinningSettings);
 
     this->setLayout(m_processorLayout);
+    this->checkTopology();
+    this->checkPinning();
 
     qDebug() << "ProcessorConfigTab created";
 }
@@ -109,6 +210,125 @@ int ProcessorConfigTab::getCPUCount()
     return this->m_CPUCountSpinBox->value();
 }
 
+/**
+ * @brief Get the socket count
+ * @return socket count, 0 if it's calculated by QEMU
+ *
+ * Get the socket count
+ */
+int ProcessorConfigTab::getSocketCount()
+{
+    return this->m_socketCountSpinBox->value();
+}
+
+/**
+ * @brief Get the cores per socket
+ * @return cores per socket, 0 if it's calculated by QEMU
+ *
+ * Get the cores per socket
+ */
+int ProcessorConfigTab::getCoresSocket()
+{
+    return this->m_coresSocketSpinBox->value();
+}
+
+/**
+ * @brief Get the threads per core
+ * @return threads per core, 0 if it's calculated by QEMU
+ *
+ * Get the threads per core
+ */
+int ProcessorConfigTab::getThreadsCore()
+{
+    return this->m_threadsCoreSpinBox->value();
+}
+
+/**
+ * @brief Get the maximum number of hotplug CPUs
+ * @return maximum number of CPUs, 0 for the CPU count
+ *
+ * Get the maximum number of hotplug CPUs
+ */
+int ProcessorConfigTab::getMaxHotCPU()
+{
+    return this->m_maxHotCPUSpinBox->value();
+}
+
+/**
+ * @brief Get the CPU pinning policy
+ * @return CPU pinning policy
+ *
+ * Get the CPU pinning policy
+ */
+QString ProcessorConfigTab::getCPUPinning()
+{
+    return this->m_pinningComboBox->currentData().toString();
+}
+
+/**
+ * @brief Get the host CPUs of the explicit pinning
+ * @return list of host CPUs
+ *
+ * Get the host CPUs of the explicit pinning
+ */
+QString ProcessorConfigTab::getCPUSet()
+{
+    return this->m_CPUSetLineEdit->text().trimmed();
+}
+
+/**
+ * @brief Check the CPU topology
+ *
+ * Check the CPU topology and show the topology
+ * that the guest is going to see
+ */
+void ProcessorConfigTab::checkTopology()
+{
+    int sockets = this->m_socketCountSpinBox->value();
+    int cores = this->m_coresSocketSpinBox->value();
+    int threads = this->m_threadsCoreSpinBox->value();
+    int maxCPUs = this->m_maxHotCPUSpinBox->value();
+    QString topologyError;
+
+    if (!MachineUtils::resolveCPUTopology(this->m_CPUCountSpinBox->value(), sockets, cores,
+                                          threads, maxCPUs, topologyError)) {
+        this->m_topologyStatusLabel->setText("<font color='red'>" + topologyError + "</font>");
+    } else if (sockets == 0) {
+        this->m_topologyStatusLabel->setText(tr("QEMU default topology"));
+    } else {
+        this->m_topologyStatusLabel->setText(tr("%1 socket(s), %2 core(s) per socket, "
+                                                "%3 thread(s) per core, %4 CPU(s) maximum")
+                                             .arg(sockets).arg(cores).arg(threads).arg(maxCPUs));
+    }
+}
+
+/**
+ * @brief Check the CPU pinning
+ *
+ * Enable the host CPUs only with the explicit policy
+ * and show if the host CPUs are enough for the machine
+ */
+void ProcessorConfigTab::checkPinning()
+{
+    QString pinning = this->m_pinningComboBox->currentData().toString();
+    this->m_CPUSetLineEdit->setEnabled(this->m_enableFields && pinning == "explicit");
+
+    if (pinning != "explicit") {
+        this->m_pinningStatusLabel->setText("");
+        return;
+    }
+
+    QList<int> CPUs = HostTopology::parseCPUList(this->m_CPUSetLineEdit->text());
+    if (CPUs.isEmpty()) {
+        this->m_pinningStatusLabel->setText(tr("The list of host CPUs is not valid"));
+    } else if (CPUs.size() < this->m_CPUCountSpinBox->value()) {
+        this->m_pinningStatusLabel->setText(tr("%1 host CPUs for %2 vCPUs, some vCPUs share host CPUs")
+                                            .arg(CPUs.size()).arg(this->m_CPUCountSpinBox->value()));
+    } else {
+        this->m_pinningStatusLabel->setText(tr("One host CPU per vCPU"));
+    }
+}
+
 
 /**
  * @brief Tab with the GPU and keyboard
@@ -128,6 +348,10 @@ GraphicsConfigTab::GraphicsConfigTab(Machine *machine,
     m_GPUType->setEnabled(enableFields);
     SystemUtils::setGPUTypes(m_GPUType);
     int gpuIndex = m_GPUType->findData(machine->getGPUType());
+    if (gpuIndex == -1 && !machine->getGPUType().isEmpty()) {
+        m_GPUType->addItem(machine->getGPUType(), machine->getGPUType());
+        gpuIndex = m_GPUType->count() - 1;
+    }
     if (gpuIndex != -1) {
        m_GPUType->setCurrentIndex(gpuIndex);
     }
@@ -205,7 +429,7 @@ RamConfigTab::RamConfigTab(Machine *machine,
     m_descriptionMemoryLabel->setWordWrap(true);
 
     int totalRAM = 0;
-    SystemUtils::getTotalMemory(totalRAM);
+    HostUtils::getTotalMemory(totalRAM);
     m_spinBoxMemoryLabel = new QLabel("MiB", this);
 
     m_memorySpinBox = new QSpinBox(this);
@@ -231,9 +455,95 @@ RamConfigTab::RamConfigTab(Machine *machine,
     m_minMemoryLabel = new QLabel("1 MiB", this);
     m_maxMemorylabel = new QLabel(QString("%1 MiB").arg(totalRAM), this);
 
+    this->m_enableFields = enableFields;
+
+    // Memory backend
+    m_memoryBackendComboBox = new QComboBox(this);
+    m_memoryBackendComboBox->addItem(tr("Default"), QString("default"));
+    m_memoryBackendComboBox->addItem("memfd", QString("memfd"));
+    m_memoryBackendComboBox->addItem(tr("File"), QString("file"));
+    int backendIndex = m_memoryBackendComboBox->findData(machine->getMemoryBackend());
+    m_memoryBackendComboBox->setCurrentIndex(backendIndex != -1 ? backendIndex : 0);
+    m_memoryBackendComboBox->setEnabled(enableFields);
+
+    m_hugePagesComboBox = new QComboBox(this);
+    m_hugePagesComboBox->addItem(tr("None"), 0);
+    QMap<int, int> hugePages = HostUtils::getHugePages();
+    if (machine->getHugePageSize() > 0 && !hugePages.contains(machine->getHugePageSize())) {
+        hugePages.insert(machine->getHugePageSize(), 0);
+    }
+    QMapIterator<int, int> hugePagesIterator(hugePages);
+    while (hugePagesIterator.hasNext()) {
+        hugePagesIterator.next();
+        QString pageSize = hugePagesIterator.key() >= 1048576 ? QString("%1 GiB").arg(hugePagesIterator.key() / 1048576)
+                                                              : QString("%1 MiB").arg(hugePagesIterator.key() / 1024);
+        m_hugePagesComboBox->addItem(tr("%1 (%2 free)").arg(pageSize).arg(hugePagesIterator.value()),
+                                     hugePagesIterator.key());
+    }
+    int hugePagesIndex = m_hugePagesComboBox->findData(machine->getHugePageSize());
+    m_hugePagesComboBox->setCurrentIndex(hugePagesIndex != -1 ? hugePagesIndex : 0);
+
+    m_memoryPathLineEdit = new QLineEdit(this);
+    m_memoryPathLineEdit->setPlaceholderText(tr("Automatic"));
+    m_memoryPathLineEdit->setText(QDir::toNativeSeparators(machine->getMemoryPath()));
+
+    m_preallocCheckBox = new QCheckBox(tr("Allocate the memory when the machine starts"), this);
+    m_preallocCheckBox->setChecked(machine->getMemoryPrealloc());
+    m_preallocCheckBox->setEnabled(enableFields);
+
+    m_preallocThreadsSpinBox = new QSpinBox(this);
+    m_preallocThreadsSpinBox->setMinimum(1);
+    m_preallocThreadsSpinBox->setMaximum(qMax(1, QThread::idealThreadCount()));
+    m_preallocThreadsSpinBox->setValue(machine->getPreallocThreads());
+
+    connect(m_memoryBackendComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &RamConfigTab::updateBackendFields);
+    connect(m_hugePagesComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &RamConfigTab::updateBackendFields);
+    connect(m_preallocCheckBox, &QCheckBox::toggled,
+            this, &RamConfigTab::updateBackendFields);
+
+    m_backendLayout = new QFormLayout();
+    m_backendLayout->setLabelAlignment(Qt::AlignLeft);
+    m_backendLayout->addRow(tr("Backend") + ":", m_memoryBackendComboBox);
+    m_backendLayout->addRow(tr("Huge pages") + ":", m_hugePagesComboBox);
+    m_backendLayout->addRow(tr("Path") + ":", m_memoryPathLineEdit);
+    m_backendLayout->addRow(tr("Preallocation") + ":", m_preallocCheckBox);
+    m_backendLayout->addRow(tr("Preallocation threads") + ":", m_preallocThreadsSpinBox);
+
+    m_backendGroupBox = new QGroupBox(tr("Memory backend"), this);
+    m_backendGroupBox->setLayout(m_backendLayout);
+
+    // NUMA. The RAM is split between the guest nodes
+    m_NUMANodesSpinBox = new QSpinBox(this);
+    m_NUMANodesSpinBox->setMinimum(0);
+    m_NUMANodesSpinBox->setMaximum(8);
+    m_NUMANodesSpinBox->setSpecialValueText(tr("None"));
+    m_NUMANodesSpinBox->setValue(machine->getNUMANodes());
+    m_NUMANodesSpinBox->setEnabled(enableFields);
+
+    m_hostNodesLineEdit = new QLineEdit(this);
+    m_hostNodesLineEdit->setPlaceholderText(tr("Ex: 0 1"));
+    m_hostNodesLineEdit->setToolTip(tr("Host nodes of every guest node, separated by spaces. Ex: 0 1 or 0-1 2-3"));
+    m_hostNodesLineEdit->setText(machine->getNUMAHostNodes().join(' '));
+    m_hostNodesLineEdit->setEnabled(enableFields);
+
+    m_hostNodesLabel = new QLabel(tr("The host has %1 NUMA nodes").arg(HostUtils::getHostNUMANodes()), this);
+
+    m_NUMALayout = new QFormLayout();
+    m_NUMALayout->setLabelAlignment(Qt::AlignLeft);
+    m_NUMALayout->addRow(tr("Guest nodes") + ":", m_NUMANodesSpinBox);
+    m_NUMALayout->addRow(tr("Host nodes") + ":", m_hostNodesLineEdit);
+    m_NUMALayout->addRow(m_hostNodesLabel);
+
+    m_NUMAGroupBox = new QGroupBox(tr("NUMA"), this);
+    m_NUMAGroupBox->setLayout(m_NUMALayout);
+
+    this->updateBackendFields();
+
     m_machineMemoryLayout = new QGridLayout();
     m_machineMemoryLayout->setRowStretch(1, 1);
-    m_machineMemoryLayout->setRowStretch(2, 10);
+    m_machineMemoryLayout->setRowStretch(5, 10);
     m_machineMemoryLayout->setColumnStretch(1, 10);
     m_machineMemoryLayout->addWidget(m_descriptionMemoryLabel, 0, 0, 1, 5, Qt::AlignTop);
     m_machineMemoryLayout->addWidget(m_memorySlider,           1, 0, 1, 3, Qt::AlignTop);
@@ -241,6 +551,8 @@ RamConfigTab::RamConfigTab(Machine *machine,
     m_machineMemoryLayout->addWidget(m_spinBoxMemoryLabel,     1, 4, 1, 1, Qt::AlignTop);
     m_machineMemoryLayout->addWidget(m_minMemoryLabel,         2, 0, 1, 1, Qt::AlignTop);
     m_machineMemoryLayout->addWidget(m_maxMemorylabel,         2, 2, 1, 1, Qt::AlignTop);
+    m_machineMemoryLayout->addWidget(m_backendGroupBox,        3, 0, 1, 5, Qt::AlignTop);
+    m_machineMemoryLayout->addWidget(m_NUMAGroupBox,           4, 0, 1, 5, Qt::AlignTop);
 
     this->setLayout(m_machineMemoryLayout);
 
@@ -263,6 +575,102 @@ int RamConfigTab::getAmountRam()
     return this->m_memorySpinBox->value();
 }
 
+/**
+ * @brief Enable the fields of the memory backend
+ *
+ * Huge pages are only available with memfd and file backends,
+ * and the path only with the file backend
+ */
+void RamConfigTab::updateBackendFields()
+{
+    QString backend = this->m_memoryBackendComboBox->currentData().toString();
+
+    this->m_hugePagesComboBox->setEnabled(this->m_enableFields && backend != "default");
+    this->m_memoryPathLineEdit->setEnabled(this->m_enableFields && backend == "file");
+    this->m_preallocThreadsSpinBox->setEnabled(this->m_enableFields && this->m_preallocCheckBox->isChecked());
+}
+
+/**
+ * @brief Get the memory backend selected
+ * @return memory backend selected
+ *
+ * Get the memory backend selected
+ */
+QString RamConfigTab::getMemoryBackend()
+{
+    return this->m_memoryBackendComboBox->currentData().toString();
+}
+
+/**
+ * @brief Get the size of the huge pages selected
+ * @return size of the huge pages in KiB, 0 without huge pages
+ *
+ * Get the size of the huge pages selected
+ */
+int RamConfigTab::getHugePageSize()
+{
+    if (this->getMemoryBackend() == "default") {
+        return 0;
+    }
+
+    return this->m_hugePagesComboBox->currentData().toInt();
+}
+
+/**
+ * @brief Get the path of the memory backend
+ * @return path of the memory backend
+ *
+ * Get the path of the memory backend
+ */
+QString RamConfigTab::getMemoryPath()
+{
+    return this->m_memoryPathLineEdit->text().trimmed();
+}
+
+/**
+ * @brief Get if the memory is preallocated
+ * @return true if the memory is preallocated
+ *
+ * Get if the memory is preallocated
+ */
+bool RamConfigTab::getMemoryPrealloc()
+{
+    return this->m_preallocCheckBox->isChecked();
+}
+
+/**
+ * @brief Get the preallocation threads
+ * @return number of preallocation threads
+ *
+ * Get the preallocation threads
+ */
+int RamConfigTab::getPreallocThreads()
+{
+    return this->m_preallocThreadsSpinBox->value();
+}
+
+/**
+ * @brief Get the guest NUMA nodes
+ * @return number of guest NUMA nodes
+ *
+ * Get the guest NUMA nodes
+ */
+int RamConfigTab::getNUMANodes()
+{
+    return this->m_NUMANodesSpinBox->value();
+}
+
+/**
+ * @brief Get the host nodes of every guest node
+ * @return host nodes of every guest node
+ *
+ * Get the host nodes of every guest node
+ */
+QStringList RamConfigTab::getNUMAHostNodes()
+{
+    return this->m_hostNodesLineEdit->text().split(' ', Qt::SkipEmptyParts);
+}
+
 /**
  * @brief Machine type configuration tab
  * @param machine, machine to be configured
@@ -343,6 +751,12 @@ void MachineTypeTab::setMachines()
     model->setHeaderData(0, Qt::Horizontal, QObject::tr("Machine"));
     model->setHeaderData(1, Qt::Horizontal, QObject::tr("Description"));
 
+    // Machines of the installed QEMU, when they're known
+    if (SystemUtils::setMachineTypes(model)) {
+        customFilter->setSourceModel(model);
+        return;
+    }
+
     this->addMachine(model, "pc-q35-2.4", "Standard PC (Q35 + ICH9, 2009)");
     this->addMachine(model, "pc-q35-2.5", "Standard PC (Q35 + ICH9, 2009)");
     this->addMachine(model, "pc-q35-2.6", "Standard PC (Q35 + ICH9, 2009)");
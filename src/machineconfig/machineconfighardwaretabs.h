@@ -29,10 +29,14 @@
 #include <QTreeView>
 #include <QStandardItemModel>
 #include <QLineEdit>
+#include <QFormLayout>
+#include <QCheckBox>
+#include <QThread>
 
 // Local
 #include "../components/customfilter.h"
 #include "../machine.h"
+#include "../utils/systemutils.h"
 
 class ProcessorConfigTab: public QWidget {
     Q_OBJECT
@@ -46,27 +50,52 @@ class ProcessorConfigTab: public QWidget {
         // Methods
         QString getCPUType();
         int getCPUCount();
+        int getSocketCount();
+        int getCoresSocket();
+        int getThreadsCore();
+        int getMaxHotCPU();
+        QString getCPUPinning();
+        QString getCPUSet();
 
     signals:
 
     public slots:
 
+    private slots:
+        void checkTopology();
+        void checkPinning();
+
     protected:
 
     private:
         QHBoxLayout *m_CPUTypeLayout;
         QHBoxLayout *m_CPUCountLayout;
         QVBoxLayout *m_CPUSettingsLayout;
+        QFormLayout *m_topologyLayout;
+        QFormLayout *m_pinningLayout;
         QVBoxLayout *m_processorLayout;
 
         QComboBox *m_CPUType;
 
         QGroupBox *m_CPUSettings;
+        QGroupBox *m_topologySettings;
+        QGroupBox *m_pinningSettings;
+
+        QComboBox *m_pinningComboBox;
+        QLineEdit *m_CPUSetLineEdit;
+        QLabel *m_hostTopologyLabel;
+        QLabel *m_pinningStatusLabel;
+        bool m_enableFields;
 
         QLabel *m_CPUTypeLabel;
         QLabel *m_CPUCountLabel;
+        QLabel *m_topologyStatusLabel;
 
         QSpinBox *m_CPUCountSpinBox;
+        QSpinBox *m_socketCountSpinBox;
+        QSpinBox *m_coresSocketSpinBox;
+        QSpinBox *m_threadsCoreSpinBox;
+        QSpinBox *m_maxHotCPUSpinBox;
 
 };
 
@@ -113,15 +142,42 @@ class RamConfigTab: public QWidget {
 
         // Methods
         int getAmountRam();
+        QString getMemoryBackend();
+        int getHugePageSize();
+        QString getMemoryPath();
+        bool getMemoryPrealloc();
+        int getPreallocThreads();
+        int getNUMANodes();
+        QStringList getNUMAHostNodes();
 
     signals:
 
     public slots:
 
+    private slots:
+        void updateBackendFields();
+
     protected:
 
     private:
+        bool m_enableFields;
+
         QGridLayout *m_machineMemoryLayout;
+        QFormLayout *m_backendLayout;
+        QFormLayout *m_NUMALayout;
+
+        QGroupBox *m_backendGroupBox;
+        QGroupBox *m_NUMAGroupBox;
+
+        QComboBox *m_memoryBackendComboBox;
+        QComboBox *m_hugePagesComboBox;
+        QLineEdit *m_memoryPathLineEdit;
+        QCheckBox *m_preallocCheckBox;
+        QSpinBox *m_preallocThreadsSpinBox;
+
+        QSpinBox *m_NUMANodesSpinBox;
+        QLineEdit *m_hostNodesLineEdit;
+        QLabel *m_hostNodesLabel;
 
         QSpinBox *m_memorySpinBox;
         QSlider *m_memorySlider;
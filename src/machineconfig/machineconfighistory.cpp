@@ -0,0 +1,221 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machineconfighistory.h"
+
+// Events read every time
+static const int PAGE_EVENTS = 200;
+
+/**
+ * @brief History of the machine
+ * @param machine, machine
+ * @param parent, parent widget
+ *
+ * In this window the user can see the events of the machine:
+ * launches, state changes, QMP events, exits and errors.
+ * Only the requested events are read from the event log
+ */
+MachineConfigHistory::MachineConfigHistory(Machine *machine,
+                                           QWidget *parent) : QWidget(parent)
+{
+    this->m_machine = machine;
+    this->m_oldestTimestamp = 0;
+    this->m_oldestEvents = 0;
+
+    m_typeLabel = new QLabel(tr("Events") + ":", this);
+    m_typeComboBox = new QComboBox(this);
+    m_typeComboBox->addItem(tr("All"), MachineEventLog::AllEvents);
+    m_typeComboBox->addItem(tr("Launches"), MachineEventLog::Launch);
+    m_typeComboBox->addItem(tr("State changes"), MachineEventLog::State);
+    m_typeComboBox->addItem(tr("QMP events"), MachineEventLog::QMPEvent);
+    m_typeComboBox->addItem(tr("Exits"), MachineEventLog::Exit);
+    m_typeComboBox->addItem(tr("Errors"), MachineEventLog::Error);
+    m_typeComboBox->addItem(tr("Restarts"), MachineEventLog::Restart);
+    m_typeComboBox->addItem(tr("Resource samples"), MachineEventLog::Sample);
+
+    m_fromLabel = new QLabel(tr("From") + ":", this);
+    m_fromDateTimeEdit = new QDateTimeEdit(QDateTime::currentDateTime().addDays(-30), this);
+    m_fromDateTimeEdit->setCalendarPopup(true);
+
+    m_toLabel = new QLabel(tr("To") + ":", this);
+    m_toDateTimeEdit = new QDateTimeEdit(QDateTime::currentDateTime().addDays(1), this);
+    m_toDateTimeEdit->setCalendarPopup(true);
+
+    m_filterLayout = new QHBoxLayout();
+    m_filterLayout->setAlignment(Qt::AlignLeft);
+    m_filterLayout->addWidget(m_typeLabel);
+    m_filterLayout->addWidget(m_typeComboBox);
+    m_filterLayout->addWidget(m_fromLabel);
+    m_filterLayout->addWidget(m_fromDateTimeEdit);
+    m_filterLayout->addWidget(m_toLabel);
+    m_filterLayout->addWidget(m_toDateTimeEdit);
+
+    QList<QString> header;
+    header << tr("Time") << tr("Event") << tr("Details");
+
+    m_eventsTree = new QTreeWidget(this);
+    m_eventsTree->setColumnCount(3);
+    m_eventsTree->setHeaderLabels(header);
+    m_eventsTree->setRootIsDecorated(false);
+    m_eventsTree->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+
+    m_refreshButton = new QPushButton(tr("Refresh"), this);
+    connect(m_refreshButton, &QAbstractButton::clicked,
+            this, &MachineConfigHistory::refreshEvents);
+
+    m_olderButton = new QPushButton(tr("Load older events"), this);
+    connect(m_olderButton, &QAbstractButton::clicked,
+            this, &MachineConfigHistory::loadOlderEvents);
+
+    connect(m_typeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MachineConfigHistory::refreshEvents);
+
+    m_buttonsLayout = new QHBoxLayout();
+    m_buttonsLayout->setAlignment(Qt::AlignRight);
+    m_buttonsLayout->addWidget(m_refreshButton);
+    m_buttonsLayout->addWidget(m_olderButton);
+
+    m_historyLayout = new QVBoxLayout();
+    m_historyLayout->addItem(m_filterLayout);
+    m_historyLayout->addWidget(m_eventsTree);
+    m_historyLayout->addItem(m_buttonsLayout);
+
+    m_historyPageWidget = new QWidget();
+    m_historyPageWidget->setLayout(m_historyLayout);
+
+    this->refreshEvents();
+
+    qDebug() << "MachineConfigHistory created";
+}
+
+MachineConfigHistory::~MachineConfigHistory()
+{
+    qDebug() << "MachineConfigHistory destroyed";
+}
+
+/**
+ * @brief Show the newest events
+ *
+ * Show the newest events of the selected range and type
+ */
+void MachineConfigHistory::refreshEvents()
+{
+    this->m_eventsTree->clear();
+    this->m_oldestTimestamp = 0;
+    this->m_oldestEvents = 0;
+    this->loadEvents(this->m_toDateTimeEdit->dateTime().toMSecsSinceEpoch(), 0);
+}
+
+/**
+ * @brief Show older events
+ *
+ * Add the events before the oldest event shown.
+ * The events with the time of the oldest one are
+ * read again and the shown ones are skipped
+ */
+void MachineConfigHistory::loadOlderEvents()
+{
+    if (this->m_eventsTree->topLevelItemCount() == 0) {
+        return;
+    }
+
+    this->loadEvents(this->m_oldestTimestamp, this->m_oldestEvents);
+}
+
+/**
+ * @brief Read a page of events
+ * @param to, time of the newest event
+ * @param skip, number of events at that time already shown
+ *
+ * Read a page of events from the event log
+ * and add them to the tree
+ */
+void MachineConfigHistory::loadEvents(qint64 to, int skip)
+{
+    quint32 types = this->m_typeComboBox->currentData().toUInt();
+    qint64 from = this->m_fromDateTimeEdit->dateTime().toMSecsSinceEpoch();
+
+    // Include the events that aren't indexed yet
+    if (this->m_machine->getState() != Machine::Stopped) {
+        this->m_machine->getEventLog()->flush();
+    }
+
+    QList<MachineEvent> events = MachineEventLog::query(this->m_machine->getEventLogPath(),
+                                                        from, to, types, PAGE_EVENTS + skip);
+    events = events.mid(skip);
+
+    foreach (const MachineEvent &event, events) {
+        QTreeWidgetItem *eventItem = new QTreeWidgetItem(this->m_eventsTree, QTreeWidgetItem::Type);
+        eventItem->setText(0, QDateTime::fromMSecsSinceEpoch(event.timestamp).toString("dd.MM.yyyy hh:mm:ss"));
+        eventItem->setText(1, MachineEventLog::typeName(event.type));
+        eventItem->setText(2, this->eventDetails(event));
+        eventItem->setToolTip(2, QString::fromUtf8(QJsonDocument(event.data).toJson(QJsonDocument::Indented)));
+
+        if (event.timestamp == this->m_oldestTimestamp) {
+            ++this->m_oldestEvents;
+        } else {
+            this->m_oldestTimestamp = event.timestamp;
+            this->m_oldestEvents = 1;
+        }
+    }
+
+    this->m_olderButton->setEnabled(events.size() == PAGE_EVENTS);
+    this->m_eventsTree->resizeColumnToContents(0);
+    this->m_eventsTree->resizeColumnToContents(1);
+}
+
+/**
+ * @brief Get the description of an event
+ * @param event, event of the machine
+ * @return short description for the tree
+ *
+ * Get the description of an event
+ */
+QString MachineConfigHistory::eventDetails(const MachineEvent &event)
+{
+    switch (event.type) {
+        case MachineEventLog::Launch:
+            return event.data["program"].toString();
+        case MachineEventLog::State:
+            return event.data["state"].toString();
+        case MachineEventLog::QMPEvent:
+            return event.data["event"].toString();
+        case MachineEventLog::Exit:
+            return tr("Exit code %1 (%2) after %3 s")
+                    .arg(event.data["exitCode"].toInt())
+                    .arg(event.data["exitStatus"].toString())
+                    .arg(event.data["duration"].toDouble() / 1000, 0, 'f', 1);
+        case MachineEventLog::Error:
+            return event.data["message"].toString().simplified();
+        case MachineEventLog::Restart:
+            if (event.data["abandoned"].toBool()) {
+                return tr("Not restarted after %1 restarts (%2)")
+                        .arg(event.data["attempt"].toInt() - 1)
+                        .arg(event.data["cause"].toString());
+            }
+            return tr("Restart %1 in %2 s (%3)")
+                    .arg(event.data["attempt"].toInt())
+                    .arg(event.data["delay"].toDouble() / 1000, 0, 'f', 1)
+                    .arg(event.data["cause"].toString());
+    }
+
+    return QString::fromUtf8(QJsonDocument(event.data).toJson(QJsonDocument::Compact));
+}
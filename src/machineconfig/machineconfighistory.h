@@ -0,0 +1,87 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINECONFIGHISTORY_H
+#define MACHINECONFIGHISTORY_H
+
+// Qt
+#include <QWidget>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QLabel>
+#include <QComboBox>
+#include <QDateTimeEdit>
+#include <QPushButton>
+#include <QTreeWidget>
+
+// Local
+#include "../machine.h"
+#include "../utils/machineeventlog.h"
+
+class MachineConfigHistory : public QWidget {
+    Q_OBJECT
+
+    public:
+        explicit MachineConfigHistory(Machine *machine,
+                                      QWidget *parent = nullptr);
+        ~MachineConfigHistory();
+        QWidget *m_historyPageWidget;
+
+    signals:
+
+    public slots:
+
+    private slots:
+        void refreshEvents();
+        void loadOlderEvents();
+
+    protected:
+
+    private:
+        QHBoxLayout *m_filterLayout;
+        QHBoxLayout *m_buttonsLayout;
+        QVBoxLayout *m_historyLayout;
+
+        QLabel *m_typeLabel;
+        QLabel *m_fromLabel;
+        QLabel *m_toLabel;
+
+        QComboBox *m_typeComboBox;
+
+        QDateTimeEdit *m_fromDateTimeEdit;
+        QDateTimeEdit *m_toDateTimeEdit;
+
+        QPushButton *m_refreshButton;
+        QPushButton *m_olderButton;
+
+        QTreeWidget *m_eventsTree;
+
+        Machine *m_machine;
+
+        // Several events can have the same time, the shown ones are skipped
+        qint64 m_oldestTimestamp;
+        int m_oldestEvents;
+
+        // Methods
+        void loadEvents(qint64 to, int skip);
+        QString eventDetails(const MachineEvent &event);
+};
+
+#endif // MACHINECONFIGHISTORY_H
@@ -22,6 +22,10 @@
 // Local
 #include "machineconfigmedia.h"
 
+// Role of the tree items with the options edited in the page.
+// They are copied to the media when the configuration is saved
+static const int MEDIA_OPTIONS_ROLE = Qt::UserRole + 1;
+
 /**
  * @brief Configuration of the machine. Media page
  * @param machine, machine to be configured
@@ -38,18 +42,69 @@ MachineConfigMedia::MachineConfigMedia(Machine *machine,
 {
     this->m_machineOptions = machine;
     this->m_qemuGlobalObject = QEMUGlobalObject;
+    this->m_loadingOptions = false;
 
     bool enableFields = true;
 
     if (machine->getState() != Machine::Stopped) {
         enableFields = false;
     }
+    this->m_enableFields = enableFields;
 
     m_mediaNameLabel = new QLabel(this);
     m_mediaNameLabel->setWordWrap(true);
     m_mediaPathLabel = new QLabel(this);
     m_mediaPathLabel->setWordWrap(true);
 
+    m_busComboBox = new QComboBox(this);
+    m_busComboBox->setEnabled(enableFields);
+    m_busComboBox->addItem("IDE", QString("ide"));
+    m_busComboBox->addItem("VirtIO", QString("virtio"));
+    m_busComboBox->addItem("SCSI (VirtIO)", QString("scsi"));
+    connect(m_busComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MachineConfigMedia::saveMediaOptions);
+
+    m_cacheComboBox = new QComboBox(this);
+    m_cacheComboBox->setEnabled(enableFields);
+    m_cacheComboBox->addItem("writeback");
+    m_cacheComboBox->addItem("none");
+    m_cacheComboBox->addItem("writethrough");
+    m_cacheComboBox->addItem("directsync");
+    m_cacheComboBox->addItem("unsafe");
+    connect(m_cacheComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MachineConfigMedia::saveMediaOptions);
+
+    m_IOComboBox = new QComboBox(this);
+    m_IOComboBox->setEnabled(enableFields);
+    m_IOComboBox->addItem("threads");
+#ifdef Q_OS_LINUX
+    m_IOComboBox->addItem("native");
+    m_IOComboBox->addItem("io_uring");
+#endif
+    connect(m_IOComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MachineConfigMedia::saveMediaOptions);
+
+    m_discardMediaCheck = new QCheckBox(tr("Pass discard requests to the image"), this);
+    m_discardMediaCheck->setEnabled(enableFields);
+    connect(m_discardMediaCheck, &QCheckBox::toggled,
+            this, &MachineConfigMedia::saveMediaOptions);
+
+    m_IOThreadComboBox = new QComboBox(this);
+    m_IOThreadComboBox->setEnabled(enableFields);
+    connect(m_IOThreadComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MachineConfigMedia::saveMediaOptions);
+
+    m_IOThreadsSpinBox = new QSpinBox(this);
+    m_IOThreadsSpinBox->setEnabled(enableFields);
+    m_IOThreadsSpinBox->setMinimum(0);
+    m_IOThreadsSpinBox->setMaximum(16);
+    m_IOThreadsSpinBox->setSpecialValueText(tr("None"));
+    m_IOThreadsSpinBox->setToolTip(tr("Threads that service the VirtIO disks outside the main loop of QEMU"));
+    connect(m_IOThreadsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &MachineConfigMedia::fillIOThreadComboBox);
+    m_IOThreadsSpinBox->setValue(machine->getIOThreads());
+    this->fillIOThreadComboBox(machine->getIOThreads());
+
     m_mediaTree = new QTreeWidget(this);
     m_mediaTree->setEnabled(enableFields);
     m_mediaTree->setMaximumHeight(250);
@@ -95,39 +150,22 @@ MachineConfigMedia::MachineConfigMedia(Machine *machine,
     m_mediaSettingsGroupBox = new QGroupBox(tr("Details"), this);
     m_mediaSettingsGroupBox->setLayout(m_mediaDetailsLayout);
 
-    /*m_cacheComboBox = new QComboBox(this);
-    m_cacheComboBox->setEnabled(enableFields);
-    m_cacheComboBox->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    m_cacheComboBox->addItem("none");
-    m_cacheComboBox->addItem("writethrough");
-    m_cacheComboBox->addItem("writeback");
-    m_cacheComboBox->addItem("directsync");
-    m_cacheComboBox->addItem("unsafe");
-    m_cacheComboBox->setCurrentIndex(0);
-
-    m_IOComboBox = new QComboBox(this);
-    m_IOComboBox->setEnabled(enableFields);
-    m_IOComboBox->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    m_IOComboBox->addItem("threads");
-    m_IOComboBox->addItem("native");
-    m_IOComboBox->setCurrentIndex(0);
-
-    m_readOnlyMediaCheck = new QCheckBox(this);
-    m_readOnlyMediaCheck->setEnabled(enableFields);
-
     m_mediaOptionsLayout = new QFormLayout();
     m_mediaOptionsLayout->setAlignment(Qt::AlignTop);
     m_mediaOptionsLayout->setLabelAlignment(Qt::AlignLeft);
     m_mediaOptionsLayout->setHorizontalSpacing(20);
     m_mediaOptionsLayout->setVerticalSpacing(10);
+    m_mediaOptionsLayout->addRow(tr("Bus") + ":", m_busComboBox);
     m_mediaOptionsLayout->addRow(tr("Cache mode") + ":", m_cacheComboBox);
     m_mediaOptionsLayout->addRow(tr("IO mode") + ":", m_IOComboBox);
-    m_mediaOptionsLayout->addRow(tr("Read only") + ":", m_readOnlyMediaCheck);
+    m_mediaOptionsLayout->addRow(tr("Discard") + ":", m_discardMediaCheck);
+    m_mediaOptionsLayout->addRow(tr("IOThread") + ":", m_IOThreadComboBox);
+    m_mediaOptionsLayout->addRow(tr("IOThreads of the machine") + ":", m_IOThreadsSpinBox);
 
     m_mediaOptionsGroupBox = new QGroupBox(tr("Options"), this);
     m_mediaOptionsGroupBox->setFlat(true);
     m_mediaOptionsGroupBox->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    m_mediaOptionsGroupBox->setLayout(m_mediaOptionsLayout);*/
+    m_mediaOptionsGroupBox->setLayout(m_mediaOptionsLayout);
 
     m_addFloppyPushButton = new QPushButton(this);
     m_addFloppyPushButton->setEnabled(enableFields);
@@ -172,7 +210,7 @@ MachineConfigMedia::MachineConfigMedia(Machine *machine,
     m_mediaPageLayout->addWidget(m_mediaTree,             0, 0, 1, 1);
     m_mediaPageLayout->addWidget(m_mediaSettingsGroupBox, 0, 1, 1, 1);
     m_mediaPageLayout->addWidget(m_mediaAddGroupBox,      1, 0, 1, 1);
-    //m_mediaPageLayout->addWidget(m_mediaOptionsGroupBox,  1, 1, 1, 1); // TODO: In QtEmu 2.1
+    m_mediaPageLayout->addWidget(m_mediaOptionsGroupBox,  1, 1, 1, 1);
 
     m_mediaPageWidget = new QWidget();
     m_mediaPageWidget->setLayout(m_mediaPageLayout);
@@ -210,9 +248,110 @@ void MachineConfigMedia::fillDetailsSection()
 
     QVariant mediaVariant = this->m_mediaTree->currentItem()->data(0, Qt::UserRole);
     Media *selectedMedia = mediaVariant.value<Media *>();
+    QVariantMap mediaOptions = this->m_mediaTree->currentItem()->data(0, MEDIA_OPTIONS_ROLE).toMap();
 
     this->m_mediaNameLabel->setText(selectedMedia->name());
     this->m_mediaPathLabel->setText(selectedMedia->path());
+
+    // Load the options without saving them again
+    this->m_loadingOptions = true;
+
+    bool isFloppy = selectedMedia->type() == "fdd";
+    bool isCdrom = selectedMedia->type() == "cdrom";
+
+    this->m_busComboBox->setEnabled(this->m_enableFields && !isFloppy);
+    this->m_cacheComboBox->setEnabled(this->m_enableFields && !isFloppy);
+    this->m_IOComboBox->setEnabled(this->m_enableFields && !isFloppy);
+    this->m_discardMediaCheck->setEnabled(this->m_enableFields && !isFloppy && !isCdrom);
+    this->m_IOThreadComboBox->setEnabled(this->m_enableFields && !isFloppy);
+
+    // virtio-blk cannot emulate a cdrom
+    int virtioIndex = this->m_busComboBox->findData(QString("virtio"));
+    QStandardItemModel *busModel = qobject_cast<QStandardItemModel *>(this->m_busComboBox->model());
+    if (busModel != nullptr && virtioIndex != -1) {
+        busModel->item(virtioIndex)->setEnabled(!isCdrom);
+    }
+
+    int busIndex = this->m_busComboBox->findData(mediaOptions["bus"].toString());
+    this->m_busComboBox->setCurrentIndex(busIndex != -1 ? busIndex : 0);
+
+    int cacheIndex = this->m_cacheComboBox->findText(mediaOptions["cache"].toString());
+    this->m_cacheComboBox->setCurrentIndex(cacheIndex != -1 ? cacheIndex : 0);
+
+    int IOIndex = this->m_IOComboBox->findText(mediaOptions["io"].toString());
+    this->m_IOComboBox->setCurrentIndex(IOIndex != -1 ? IOIndex : 0);
+
+    this->m_discardMediaCheck->setChecked(mediaOptions["discard"].toBool());
+
+    int IOThreadIndex = this->m_IOThreadComboBox->findData(mediaOptions["iothread"].toString());
+    this->m_IOThreadComboBox->setCurrentIndex(IOThreadIndex != -1 ? IOThreadIndex : 0);
+
+    this->m_loadingOptions = false;
+}
+
+/**
+ * @brief Fill the IOThread combobox
+ * @param IOThreads, number of IOThreads of the machine
+ *
+ * Fill the IOThread combobox with the IOThreads of the machine.
+ * The automatic option spreads the disks in round-robin
+ */
+void MachineConfigMedia::fillIOThreadComboBox(int IOThreads)
+{
+    bool loadingOptions = this->m_loadingOptions;
+    this->m_loadingOptions = true;
+
+    QString currentIOThread = this->m_IOThreadComboBox->currentData().toString();
+
+    this->m_IOThreadComboBox->clear();
+    this->m_IOThreadComboBox->addItem(tr("Automatic"), QString());
+    for (int i = 0; i < IOThreads; ++i) {
+        this->m_IOThreadComboBox->addItem(QString("iothread%1").arg(i), QString("iothread%1").arg(i));
+    }
+
+    int IOThreadIndex = this->m_IOThreadComboBox->findData(currentIOThread);
+    this->m_IOThreadComboBox->setCurrentIndex(IOThreadIndex != -1 ? IOThreadIndex : 0);
+
+    this->m_loadingOptions = loadingOptions;
+}
+
+/**
+ * @brief Save the options of the selected media
+ *
+ * Keep the bus, cache, IO and discard options
+ * of the selected media until the configuration is saved
+ */
+void MachineConfigMedia::saveMediaOptions()
+{
+    if (this->m_loadingOptions || this->countMedia() <= 0 ||
+        this->m_mediaTree->currentItem() == nullptr) {
+        return;
+    }
+
+    QVariant mediaVariant = this->m_mediaTree->currentItem()->data(0, Qt::UserRole);
+    Media *selectedMedia = mediaVariant.value<Media *>();
+
+    if (selectedMedia->type() == "fdd") {
+        return;
+    }
+
+    // Native AIO needs O_DIRECT, only available with cache none or directsync
+    if (this->m_IOComboBox->currentText() == "native" &&
+        this->m_cacheComboBox->currentText() != "none" &&
+        this->m_cacheComboBox->currentText() != "directsync") {
+        this->m_loadingOptions = true;
+        this->m_cacheComboBox->setCurrentIndex(this->m_cacheComboBox->findText("none"));
+        this->m_loadingOptions = false;
+    }
+
+    QVariantMap mediaOptions;
+    mediaOptions["bus"] = this->m_busComboBox->currentData().toString();
+    mediaOptions["cache"] = this->m_cacheComboBox->currentText();
+    mediaOptions["io"] = this->m_IOComboBox->currentText();
+    mediaOptions["discard"] = selectedMedia->type() != "cdrom" && this->m_discardMediaCheck->isChecked();
+    mediaOptions["iothread"] = this->m_IOThreadComboBox->currentData().toString();
+
+    this->m_mediaTree->currentItem()->setData(0, MEDIA_OPTIONS_ROLE, mediaOptions);
 }
 
 /**
@@ -242,6 +381,7 @@ void MachineConfigMedia::addFloppyMedia()
     media->setName(floppyInfo.fileName());
     media->setPath(QDir::toNativeSeparators(floppyInfo.absoluteFilePath()));
     media->setType("fdd");
+    media->setBus(Media::defaultBus("fdd", this->m_machineOptions->getOSType()));
     media->setDriveInterface(this->m_floppyMap->first());
     media->setUuid(QUuid::createUuid());
 
@@ -304,6 +444,7 @@ void MachineConfigMedia::addHddMedia()
        existingMedia->setName(hddInfo.fileName());
        existingMedia->setPath(QDir::toNativeSeparators(hddInfo.absoluteFilePath()));
        existingMedia->setType("hdd");
+       existingMedia->setBus(Media::defaultBus("hdd", this->m_machineOptions->getOSType()));
        existingMedia->setDriveInterface(this->m_diskMap->first());
        existingMedia->setUuid(QUuid::createUuid());
 
@@ -356,6 +497,7 @@ void MachineConfigMedia::addOpticalMedia()
     media->setName(cdromInfo.fileName());
     media->setPath(QDir::toNativeSeparators(cdromInfo.absoluteFilePath()));
     media->setType("cdrom");
+    media->setBus(Media::defaultBus("cdrom", this->m_machineOptions->getOSType()));
     media->setDriveInterface(this->m_cdromMap->first());
     media->setUuid(QUuid::createUuid());
 
@@ -407,6 +549,14 @@ void MachineConfigMedia::addMediaToTree(Media *media)
     m_mediaItem->setText(0, mediaName);
     m_mediaItem->setData(0, Qt::UserRole, mediaVariant);
 
+    QVariantMap mediaOptions;
+    mediaOptions["bus"] = media->bus();
+    mediaOptions["cache"] = media->cache();
+    mediaOptions["io"] = media->IO();
+    mediaOptions["discard"] = media->discard();
+    mediaOptions["iothread"] = media->IOThread();
+    m_mediaItem->setData(0, MEDIA_OPTIONS_ROLE, mediaOptions);
+
     // To prevent undefined behavior :'(
     this->m_mediaTree->setCurrentItem(m_mediaItem);
     this->removeInterface(media->driveInterface());
@@ -487,11 +637,20 @@ void MachineConfigMedia::saveMediaData()
 {
     // Remove all media from the machine
     this->m_machineOptions->removeAllMedia();
+    this->m_machineOptions->setIOThreads(this->m_IOThreadsSpinBox->value());
 
     QTreeWidgetItemIterator it(this->m_mediaTree);
     while (*it) {
         QVariant mediaVariant = (*it)->data(0, Qt::UserRole);
         Media *media = mediaVariant.value<Media *>();
+
+        QVariantMap mediaOptions = (*it)->data(0, MEDIA_OPTIONS_ROLE).toMap();
+        media->setBus(mediaOptions["bus"].toString());
+        media->setCache(mediaOptions["cache"].toString());
+        media->setIO(mediaOptions["io"].toString());
+        media->setDiscard(mediaOptions["discard"].toBool());
+        media->setIOThread(mediaOptions["iothread"].toString());
+
         this->m_machineOptions->addMedia(media);
         ++it;
     }
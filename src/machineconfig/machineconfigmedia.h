@@ -31,12 +31,14 @@
 #include <QGroupBox>
 #include <QComboBox>
 #include <QCheckBox>
+#include <QSpinBox>
 #include <QPushButton>
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QListWidget>
 #include <QAction>
 #include <QMenu>
+#include <QStandardItemModel>
 
 // Local
 #include "../machine.h"
@@ -64,6 +66,8 @@ class MachineConfigMedia : public QWidget {
     private slots:
         void removeMediaMenu(const QPoint &pos);
         void removeMediaFromTree();
+        void saveMediaOptions();
+        void fillIOThreadComboBox(int IOThreads);
 
     protected:
 
@@ -83,10 +87,17 @@ class MachineConfigMedia : public QWidget {
         QGroupBox *m_mediaOptionsGroupBox;
         QGroupBox *m_mediaAddGroupBox;
 
+        QComboBox *m_busComboBox;
         QComboBox *m_cacheComboBox;
         QComboBox *m_IOComboBox;
+        QComboBox *m_IOThreadComboBox;
 
-        QCheckBox *m_readOnlyMediaCheck;
+        QCheckBox *m_discardMediaCheck;
+
+        QSpinBox *m_IOThreadsSpinBox;
+
+        bool m_enableFields;
+        bool m_loadingOptions;
 
         QPushButton *m_addFloppyPushButton;
         QPushButton *m_addHDDPushButton;
@@ -27,7 +27,7 @@
  * @param machine, machine to be configured
  * @param parent, parent widget
  *
- * In this window the user can enable or disable the network of the machine
+ * In this window the user can configure the network cards of the machine
  */
 MachineConfigNetwork::MachineConfigNetwork(Machine *machine,
                                            QWidget *parent) : QWidget(parent)
@@ -39,26 +39,99 @@ MachineConfigNetwork::MachineConfigNetwork(Machine *machine,
     }
 
     this->m_machine = machine;
+    this->m_enableFields = enableFields;
+    this->m_loadingOptions = false;
 
-    m_withNetworkRadio = new QRadioButton(tr("User Mode Network Connection (Uses the user mode network stack)"), this);
-    m_withNetworkRadio->setEnabled(enableFields);
-    if (machine->getUseNetwork() == true) {
-        m_withNetworkRadio->setChecked(true);
+    // The cards are edited in copies, the machine changes only when the config is saved
+    foreach (NetworkInterface *networkInterface, machine->getNetworkInterfaces()) {
+        this->m_networkInterfaces.append(networkInterface->copy(this));
     }
 
-    m_withoutNetworkRadio = new QRadioButton(tr("No network (No network cards installed on this machine"), this);
-    m_withoutNetworkRadio->setEnabled(enableFields);
-    if (machine->getUseNetwork() == false) {
-        m_withoutNetworkRadio->setChecked(true);
-    }
+    m_networkList = new QListWidget(this);
+    m_networkList->setMaximumHeight(120);
+    m_networkList->setEnabled(enableFields);
+    connect(m_networkList, &QListWidget::currentRowChanged,
+            this, &MachineConfigNetwork::fillNetworkInterfaceSection);
+
+    m_addNetworkButton = new QPushButton(QIcon::fromTheme("list-add"), tr("Add"), this);
+    m_addNetworkButton->setEnabled(enableFields);
+    connect(m_addNetworkButton, &QAbstractButton::clicked,
+            this, &MachineConfigNetwork::addNetworkInterface);
+
+    m_removeNetworkButton = new QPushButton(QIcon::fromTheme("remove",
+                                                             QIcon(QPixmap(":/images/icons/breeze/32x32/remove.svg"))),
+                                            tr("Remove"), this);
+    m_removeNetworkButton->setEnabled(enableFields);
+    connect(m_removeNetworkButton, &QAbstractButton::clicked,
+            this, &MachineConfigNetwork::removeNetworkInterface);
+
+    m_networkButtonsLayout = new QVBoxLayout();
+    m_networkButtonsLayout->setAlignment(Qt::AlignTop);
+    m_networkButtonsLayout->addWidget(m_addNetworkButton);
+    m_networkButtonsLayout->addWidget(m_removeNetworkButton);
+
+    m_networkListLayout = new QHBoxLayout();
+    m_networkListLayout->addWidget(m_networkList);
+    m_networkListLayout->addItem(m_networkButtonsLayout);
+
+    m_modelComboBox = new QComboBox(this);
+    m_modelComboBox->addItem("VirtIO", QString("virtio-net-pci"));
+    m_modelComboBox->addItem("Intel e1000", QString("e1000"));
+    m_modelComboBox->addItem("Realtek RTL8139", QString("rtl8139"));
+    connect(m_modelComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MachineConfigNetwork::saveNetworkInterfaceOptions);
+
+    m_backendComboBox = new QComboBox(this);
+    m_backendComboBox->addItem(tr("User mode"), QString("user"));
+    m_backendComboBox->addItem("TAP", QString("tap"));
+    m_backendComboBox->addItem(tr("Bridge"), QString("bridge"));
+    connect(m_backendComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MachineConfigNetwork::saveNetworkInterfaceOptions);
+
+    m_hostInterfaceLineEdit = new QLineEdit(this);
+    m_hostInterfaceLineEdit->setPlaceholderText(tr("Ex: tap0, br0"));
+    connect(m_hostInterfaceLineEdit, &QLineEdit::textChanged,
+            this, &MachineConfigNetwork::saveNetworkInterfaceOptions);
+
+    m_vhostCheckBox = new QCheckBox(tr("Process the packets in the kernel (vhost-net)"), this);
+    connect(m_vhostCheckBox, &QCheckBox::toggled,
+            this, &MachineConfigNetwork::saveNetworkInterfaceOptions);
+
+    m_queuesSpinBox = new QSpinBox(this);
+    m_queuesSpinBox->setMinimum(0);
+    m_queuesSpinBox->setMaximum(64);
+    m_queuesSpinBox->setSpecialValueText(tr("One per vCPU"));
+    connect(m_queuesSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MachineConfigNetwork::saveNetworkInterfaceOptions);
+
+    m_MACAddressLineEdit = new QLineEdit(this);
+    m_MACAddressLineEdit->setInputMask("HH:HH:HH:HH:HH:HH;_");
+    connect(m_MACAddressLineEdit, &QLineEdit::textChanged,
+            this, &MachineConfigNetwork::saveNetworkInterfaceOptions);
+
+    m_networkInterfaceLayout = new QFormLayout();
+    m_networkInterfaceLayout->setLabelAlignment(Qt::AlignLeft);
+    m_networkInterfaceLayout->addRow(tr("Model") + ":", m_modelComboBox);
+    m_networkInterfaceLayout->addRow(tr("Backend") + ":", m_backendComboBox);
+    m_networkInterfaceLayout->addRow(tr("Host interface") + ":", m_hostInterfaceLineEdit);
+    m_networkInterfaceLayout->addRow(tr("vhost") + ":", m_vhostCheckBox);
+    m_networkInterfaceLayout->addRow(tr("Queues") + ":", m_queuesSpinBox);
+    m_networkInterfaceLayout->addRow(tr("MAC address") + ":", m_MACAddressLineEdit);
+
+    m_networkInterfaceGroup = new QGroupBox(tr("Network card"), this);
+    m_networkInterfaceGroup->setFlat(true);
+    m_networkInterfaceGroup->setLayout(m_networkInterfaceLayout);
 
     m_networkLayout = new QVBoxLayout();
     m_networkLayout->setAlignment(Qt::AlignTop);
     m_networkLayout->setContentsMargins(5, 20, 5, 0);
-    m_networkLayout->addWidget(m_withNetworkRadio);
-    m_networkLayout->addWidget(m_withoutNetworkRadio);
+    m_networkLayout->addItem(m_networkListLayout);
+    m_networkLayout->addWidget(m_networkInterfaceGroup);
 
     m_machineNetworkGroup = new QGroupBox(tr("Machine Network"));
+    m_machineNetworkGroup->setCheckable(true);
+    m_machineNetworkGroup->setChecked(machine->getUseNetwork());
+    m_machineNetworkGroup->setEnabled(enableFields);
     m_machineNetworkGroup->setLayout(m_networkLayout);
 
     m_networkMainLayout = new QVBoxLayout();
@@ -67,6 +140,12 @@ MachineConfigNetwork::MachineConfigNetwork(Machine *machine,
     m_networkPageWidget = new QWidget();
     m_networkPageWidget->setLayout(m_networkMainLayout);
 
+    foreach (NetworkInterface *networkInterface, this->m_networkInterfaces) {
+        this->m_networkList->addItem(networkInterface->label());
+    }
+    this->m_networkList->setCurrentRow(0);
+    this->fillNetworkInterfaceSection();
+
     qDebug() << "MachineConfigNetwork created";
 }
 
@@ -76,16 +155,149 @@ MachineConfigNetwork::~MachineConfigNetwork()
 }
 
 /**
- * @brief Enable or disable the network
+ * @brief Add a network card
+ *
+ * Add a network card with the user mode backend
+ */
+void MachineConfigNetwork::addNetworkInterface()
+{
+    NetworkInterface *networkInterface = new NetworkInterface(this);
+    networkInterface->setModel(NetworkInterface::defaultModel(this->m_machine->getOSType()));
+    networkInterface->setMACAddress(NetworkInterface::generateMACAddress());
+
+    this->m_networkInterfaces.append(networkInterface);
+    this->m_networkList->addItem(networkInterface->label());
+    this->m_networkList->setCurrentRow(this->m_networkList->count() - 1);
+}
+
+/**
+ * @brief Remove the selected network card
+ *
+ * Remove the selected network card
+ */
+void MachineConfigNetwork::removeNetworkInterface()
+{
+    int row = this->m_networkList->currentRow();
+    if (row < 0 || row >= this->m_networkInterfaces.size()) {
+        return;
+    }
+
+    delete this->m_networkInterfaces.takeAt(row);
+    delete this->m_networkList->takeItem(row);
+    this->fillNetworkInterfaceSection();
+}
+
+/**
+ * @brief Fill the options of the selected network card
+ *
+ * Fill the options of the selected network card.
+ * vhost and the queues are only used with tap
+ */
+void MachineConfigNetwork::fillNetworkInterfaceSection()
+{
+    int row = this->m_networkList->currentRow();
+    bool selected = row >= 0 && row < this->m_networkInterfaces.size();
+
+    this->m_networkInterfaceGroup->setEnabled(this->m_enableFields && selected);
+    this->m_removeNetworkButton->setEnabled(this->m_enableFields && selected);
+
+    if (!selected) {
+        return;
+    }
+
+    NetworkInterface *networkInterface = this->m_networkInterfaces.at(row);
+
+    this->m_loadingOptions = true;
+
+    int modelIndex = this->m_modelComboBox->findData(networkInterface->model());
+    this->m_modelComboBox->setCurrentIndex(modelIndex != -1 ? modelIndex : 0);
+    int backendIndex = this->m_backendComboBox->findData(networkInterface->backend());
+    this->m_backendComboBox->setCurrentIndex(backendIndex != -1 ? backendIndex : 0);
+    this->m_hostInterfaceLineEdit->setText(networkInterface->hostInterface());
+    this->m_vhostCheckBox->setChecked(networkInterface->vhost());
+    this->m_queuesSpinBox->setValue(networkInterface->queues());
+    this->m_MACAddressLineEdit->setText(networkInterface->MACAddress());
+
+    this->m_loadingOptions = false;
+
+    this->saveNetworkInterfaceOptions();
+}
+
+/**
+ * @brief Save the options of the selected network card
+ *
+ * Save the options in the copy of the selected network card
+ */
+void MachineConfigNetwork::saveNetworkInterfaceOptions()
+{
+    int row = this->m_networkList->currentRow();
+    if (this->m_loadingOptions || row < 0 || row >= this->m_networkInterfaces.size()) {
+        return;
+    }
+
+    QString backend = this->m_backendComboBox->currentData().toString();
+    bool tap = backend == "tap";
+    bool virtio = this->m_modelComboBox->currentData().toString() == "virtio-net-pci";
+
+    this->m_hostInterfaceLineEdit->setEnabled(backend != "user");
+    this->m_vhostCheckBox->setEnabled(tap);
+    this->m_queuesSpinBox->setEnabled(tap && virtio);
+
+    NetworkInterface *networkInterface = this->m_networkInterfaces.at(row);
+    networkInterface->setModel(this->m_modelComboBox->currentData().toString());
+    networkInterface->setBackend(backend);
+    networkInterface->setHostInterface(this->m_hostInterfaceLineEdit->text().trimmed());
+    networkInterface->setVhost(this->m_vhostCheckBox->isChecked());
+    networkInterface->setQueues(this->m_queuesSpinBox->value());
+
+    // Incomplete MAC addresses are generated by QEMU
+    QString MACAddress = this->m_MACAddressLineEdit->text();
+    networkInterface->setMACAddress(this->m_MACAddressLineEdit->hasAcceptableInput() ? MACAddress.toLower()
+                                                                                      : QString());
+
+    this->m_networkList->item(row)->setText(networkInterface->label());
+}
+
+/**
+ * @brief Check the network cards
+ * @param error, description of the problem
+ * @return true if the network cards can be saved
+ *
+ * TAP and bridge need the interface of the host.
+ * The first card with problems is selected
+ */
+bool MachineConfigNetwork::checkNetworkData(QString &error)
+{
+    if (!this->m_machineNetworkGroup->isChecked()) {
+        return true;
+    }
+
+    for (int i = 0; i < this->m_networkInterfaces.size(); ++i) {
+        NetworkInterface *networkInterface = this->m_networkInterfaces.at(i);
+        if (networkInterface->backend() != "user" && networkInterface->hostInterface().isEmpty()) {
+            this->m_networkList->setCurrentRow(i);
+            error = tr("The network card %1 needs the interface of the host").arg(i + 1);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Save the network
  *
- * Enable or disable the network for the machine
+ * Enable or disable the network and replace
+ * the network cards of the machine with the edited ones
  */
 void MachineConfigNetwork::saveNetworkData()
 {
-    bool useNetwork = false;
+    this->m_machine->setUseNetwork(this->m_machineNetworkGroup->isChecked());
 
-    if (this->m_withNetworkRadio->isChecked()) {
-        useNetwork = true;
+    this->m_machine->removeAllNetworkInterfaces();
+    foreach (NetworkInterface *networkInterface, this->m_networkInterfaces) {
+        networkInterface->setParent(this->m_machine);
+        this->m_machine->addNetworkInterface(networkInterface);
     }
-    this->m_machine->setUseNetwork(useNetwork);
+    this->m_networkInterfaces.clear();
 }
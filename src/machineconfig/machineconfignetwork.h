@@ -24,8 +24,15 @@
 // Qt
 #include <QWidget>
 #include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
 #include <QGroupBox>
-#include <QRadioButton>
+#include <QListWidget>
+#include <QPushButton>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QSpinBox>
 
 // Local
 #include "../machine.h"
@@ -40,6 +47,7 @@ class MachineConfigNetwork : public QWidget {
         QWidget *m_networkPageWidget;
 
         // Methods
+        bool checkNetworkData(QString &error);
         void saveNetworkData();
 
     signals:
@@ -47,17 +55,38 @@ class MachineConfigNetwork : public QWidget {
     public slots:
 
     private slots:
+        void addNetworkInterface();
+        void removeNetworkInterface();
+        void fillNetworkInterfaceSection();
+        void saveNetworkInterfaceOptions();
 
     protected:
 
     private:
         QVBoxLayout *m_networkLayout;
         QVBoxLayout *m_networkMainLayout;
+        QHBoxLayout *m_networkListLayout;
+        QVBoxLayout *m_networkButtonsLayout;
+        QFormLayout *m_networkInterfaceLayout;
 
         QGroupBox *m_machineNetworkGroup;
+        QGroupBox *m_networkInterfaceGroup;
 
-        QRadioButton *m_withNetworkRadio;
-        QRadioButton *m_withoutNetworkRadio;
+        QListWidget *m_networkList;
+
+        QPushButton *m_addNetworkButton;
+        QPushButton *m_removeNetworkButton;
+
+        QComboBox *m_modelComboBox;
+        QComboBox *m_backendComboBox;
+        QLineEdit *m_hostInterfaceLineEdit;
+        QCheckBox *m_vhostCheckBox;
+        QSpinBox *m_queuesSpinBox;
+        QLineEdit *m_MACAddressLineEdit;
+
+        QList<NetworkInterface *> m_networkInterfaces;
+        bool m_enableFields;
+        bool m_loadingOptions;
 
         Machine *m_machine;
 
@@ -58,6 +58,7 @@ MachineConfigWindow::MachineConfigWindow(Machine *machine,
     m_configNetwork  = new MachineConfigNetwork(machine, this);
     m_configAudio    = new MachineConfigAudio(machine, this);
     m_configAccel    = new MachineConfigAccel(machine, this);
+    m_configHistory  = new MachineConfigHistory(machine, this);
 
     m_optionsListWidget = new QListWidget(this);
     m_optionsListWidget->setViewMode(QListView::ListMode);
@@ -97,8 +98,12 @@ MachineConfigWindow::MachineConfigWindow(Machine *machine,
     m_optionsListWidget->item(6)->setIcon(QIcon::fromTheme("mathematica",
                                                            QIcon(QPixmap(":/images/icons/breeze/32x32/mathematica.svg"))));
 
+    m_optionsListWidget->addItem(tr("History"));
+    m_optionsListWidget->item(7)->setIcon(QIcon::fromTheme("view-history",
+                                                           QIcon(QPixmap(":/images/icons/breeze/32x32/chronometer-reset.svg"))));
+
     /*m_optionsListWidget->addItem(tr("Display"));
-    m_optionsListWidget->item(7)->setIcon(QIcon::fromTheme("applications-multimedia",
+    m_optionsListWidget->item(8)->setIcon(QIcon::fromTheme("applications-multimedia",
                                                            QIcon(QPixmap(":/images/icons/breeze/32x32/.svg"))));*/
 
     // Prepare window
@@ -112,6 +117,7 @@ MachineConfigWindow::MachineConfigWindow(Machine *machine,
     m_optionsStackedWidget->addWidget(this->m_configNetwork->m_networkPageWidget);
     m_optionsStackedWidget->addWidget(this->m_configAudio->m_audioPageWidget);
     m_optionsStackedWidget->addWidget(this->m_configAccel->m_acceleratorPageWidget);
+    m_optionsStackedWidget->addWidget(this->m_configHistory->m_historyPageWidget);
 
     connect(m_optionsListWidget, &QListWidget::currentRowChanged,
             m_optionsStackedWidget, &QStackedWidget::setCurrentIndex);
@@ -170,6 +176,13 @@ MachineConfigWindow::~MachineConfigWindow()
  */
 void MachineConfigWindow::saveMachineSettings()
 {
+    QString error;
+    if (!this->m_configNetwork->checkNetworkData(error)) {
+        this->m_optionsListWidget->setCurrentRow(4);
+        SystemUtils::showMessage(tr("Qtemu - network"), error, QMessageBox::Warning);
+        return;
+    }
+
     this->m_configGeneral->saveGeneralData();
     this->m_configHardware->saveHardwareData();
     this->m_configBoot->saveBootData();
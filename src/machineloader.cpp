@@ -0,0 +1,121 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machineloader.h"
+
+// The configs are usually small files, the time is spent waiting
+// for the disk or the network, so at least this many threads are used
+static const int MIN_LOADER_THREADS = 16;
+
+/**
+ * @brief Machine loader
+ * @param parent, parent object
+ *
+ * Parse the config files of the machines in a thread pool.
+ * The results are emitted in the thread of the loader
+ * as soon as every file is parsed
+ */
+MachineLoader::MachineLoader(QObject *parent) : QObject(parent)
+{
+    this->m_pendingMachines = 0;
+
+    this->m_threadPool = new QThreadPool(this);
+    this->m_threadPool->setMaxThreadCount(qMax(MIN_LOADER_THREADS, QThread::idealThreadCount()));
+
+    qDebug() << "MachineLoader created";
+}
+
+MachineLoader::~MachineLoader()
+{
+    // The pending files are discarded
+    this->m_threadPool->clear();
+    this->m_threadPool->waitForDone();
+
+    qDebug() << "MachineLoader destroyed";
+}
+
+/**
+ * @brief Load the machines
+ * @param machines, machines of the registry
+ *
+ * Parse the config file of every machine without blocking
+ */
+void MachineLoader::loadMachines(const QList<QJsonObject> &machines)
+{
+    foreach (const QJsonObject &machine, machines) {
+        QUuid uuid(machine["uuid"].toString());
+        QString machineConfigPath = machine["configpath"].toString();
+
+        ++this->m_pendingMachines;
+
+        this->m_threadPool->start([this, uuid, machineConfigPath]() {
+            QString error;
+            QJsonObject machineJSON = MachineUtils::parseMachineFile(machineConfigPath, error);
+
+            QMetaObject::invokeMethod(this, "parseFinished", Qt::QueuedConnection,
+                                      Q_ARG(QUuid, uuid),
+                                      Q_ARG(QJsonObject, machineJSON),
+                                      Q_ARG(QString, machineConfigPath),
+                                      Q_ARG(QString, error));
+        });
+    }
+
+    if (this->m_pendingMachines == 0) {
+        emit(finished());
+    }
+}
+
+/**
+ * @brief Get the machines that are being parsed
+ * @return number of machines
+ *
+ * Get the machines that are being parsed
+ */
+int MachineLoader::pendingMachines() const
+{
+    return m_pendingMachines;
+}
+
+/**
+ * @brief A config file is parsed
+ * @param uuid, uuid of the machine
+ * @param machineJSON, data of the machine
+ * @param machineConfigPath, path of the config file
+ * @param error, description of the problem
+ *
+ * Emit the result of the config file
+ */
+void MachineLoader::parseFinished(const QUuid &uuid, const QJsonObject &machineJSON,
+                                  const QString &machineConfigPath, const QString &error)
+{
+    --this->m_pendingMachines;
+
+    if (error.isEmpty()) {
+        emit(machineLoaded(uuid, machineJSON, machineConfigPath));
+    } else {
+        qDebug() << "Cannot load the machine" << machineConfigPath << error;
+        emit(machineFailed(uuid, error));
+    }
+
+    if (this->m_pendingMachines == 0) {
+        emit(finished());
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINELOADER_H
+#define MACHINELOADER_H
+
+// Qt
+#include <QObject>
+#include <QThreadPool>
+#include <QThread>
+#include <QUuid>
+#include <QJsonObject>
+#include <QDebug>
+
+// Local
+#include "machineutils.h"
+
+class MachineLoader : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MachineLoader(QObject *parent = nullptr);
+        ~MachineLoader();
+
+        void loadMachines(const QList<QJsonObject> &machines);
+        int pendingMachines() const;
+
+    signals:
+        void machineLoaded(const QUuid &uuid, const QJsonObject &machineJSON,
+                           const QString &machineConfigPath);
+        void machineFailed(const QUuid &uuid, const QString &error);
+        void finished();
+
+    public slots:
+
+    private slots:
+        void parseFinished(const QUuid &uuid, const QJsonObject &machineJSON,
+                           const QString &machineConfigPath, const QString &error);
+
+    protected:
+
+    private:
+        QThreadPool *m_threadPool;
+        int m_pendingMachines;
+};
+
+#endif // MACHINELOADER_H
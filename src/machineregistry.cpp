@@ -0,0 +1,681 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machineregistry.h"
+
+// GNU
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+// Number of journal entries before the registry is rewritten
+static const int COMPACTION_THRESHOLD = 64;
+
+// Time to wait for the other QtEmu processes that change the registry
+static const int LOCK_TIMEOUT = 5000;
+
+/**
+ * @brief Machine registry
+ *
+ * Index of all the machines, by uuid.
+ *
+ * The machines are stored in the qtemu.json file. Every change
+ * is appended to the qtemu.journal file instead of rewriting
+ * the whole registry, and the journal is merged in qtemu.json
+ * when it grows or when the registry is loaded.
+ * qtemu.json is always replaced atomically, so a crash
+ * can lose the last change at most, never the list.
+ * The graphical interface and qtemu-cli share the files.
+ * The changes are written with qtemu.lock held, after
+ * replaying the entries of the other processes
+ */
+MachineRegistry::MachineRegistry()
+{
+    this->m_loaded = false;
+    this->m_journalEntries = 0;
+    this->m_journalOffset = 0;
+
+    qDebug() << "MachineRegistry created";
+}
+
+MachineRegistry::~MachineRegistry()
+{
+    qDebug() << "MachineRegistry destroyed";
+}
+
+/**
+ * @brief Get the registry
+ * @return registry of the machines
+ *
+ * Get the registry of the machines
+ */
+MachineRegistry *MachineRegistry::instance()
+{
+    static MachineRegistry registry;
+
+    return &registry;
+}
+
+/**
+ * @brief Load the registry
+ * @param error, description of the problem
+ * @return true if the registry is loaded
+ *
+ * Read qtemu.json and replay the journal over it.
+ * A truncated entry at the end of the journal, written
+ * during a crash, is discarded.
+ * If qtemu.json is damaged, the machines of the journal
+ * are loaded anyway and false is returned
+ */
+bool MachineRegistry::load(QString &error)
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    QSettings settings;
+    settings.beginGroup("DataFolder");
+    this->m_dataDirectoryPath = settings.value("QtEmuData",
+                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
+    settings.endGroup();
+
+    error.clear();
+    this->m_loaded = true;
+
+    QDir().mkpath(this->m_dataDirectoryPath);
+
+    QLockFile lockFile(this->lockPath());
+    if (!this->lock(lockFile, error)) {
+        this->m_loaded = false;
+        return false;
+    }
+
+    if (!this->readFiles(error)) {
+        this->m_loaded = false;
+        return false;
+    }
+
+    qDebug() << "Machine registry loaded" << this->m_machines.size() << "machines,"
+             << this->m_journalEntries << "journal entries";
+
+    if (!error.isEmpty()) {
+        return false;
+    }
+
+    if (this->m_journalEntries > 0) {
+        return this->writeRegistry(error);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get if the registry is loaded
+ * @return true if the registry is loaded
+ *
+ * Get if the registry is loaded
+ */
+bool MachineRegistry::isLoaded() const
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    return m_loaded;
+}
+
+/**
+ * @brief Get the machines
+ * @return machines of the registry, in the order of the list
+ *
+ * Get the machines. Every machine has the uuid,
+ * path, configpath and icon of the machine
+ */
+QList<QJsonObject> MachineRegistry::machines() const
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    QList<QJsonObject> machines;
+    foreach (const QUuid &uuid, this->m_order) {
+        if (uuid.isNull()) {
+            continue;
+        }
+        machines.append(this->m_machines.value(uuid));
+    }
+
+    return machines;
+}
+
+/**
+ * @brief Get a machine
+ * @param uuid, uuid of the machine
+ * @return machine, empty if the machine isn't in the registry
+ *
+ * Get a machine
+ */
+QJsonObject MachineRegistry::machine(const QUuid &uuid) const
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    return m_machines.value(uuid);
+}
+
+/**
+ * @brief Check if a machine is in the registry
+ * @param uuid, uuid of the machine
+ * @return true if the machine is in the registry
+ *
+ * Check if a machine is in the registry
+ */
+bool MachineRegistry::contains(const QUuid &uuid) const
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    return m_machines.contains(uuid);
+}
+
+/**
+ * @brief Get the number of machines
+ * @return number of machines
+ *
+ * Get the number of machines
+ */
+int MachineRegistry::count() const
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    return m_machines.size();
+}
+
+/**
+ * @brief Insert a machine
+ * @param machine, machine with the uuid, path, configpath and icon
+ * @param error, description of the problem
+ * @return true if the machine is inserted
+ *
+ * Insert a machine at the end of the list.
+ * Only the change is written to the journal
+ */
+bool MachineRegistry::insertMachine(const QJsonObject &machine, QString &error)
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    QJsonObject entry;
+    entry["op"] = "insert";
+    entry["machine"] = machine;
+
+    return this->appendEntry(entry, error);
+}
+
+/**
+ * @brief Update a machine
+ * @param machine, machine with the uuid, path, configpath and icon
+ * @param error, description of the problem
+ * @return true if the machine is updated
+ *
+ * Update a machine without changing its position in the list
+ */
+bool MachineRegistry::updateMachine(const QJsonObject &machine, QString &error)
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    QJsonObject entry;
+    entry["op"] = "update";
+    entry["machine"] = machine;
+
+    return this->appendEntry(entry, error);
+}
+
+/**
+ * @brief Remove a machine
+ * @param uuid, uuid of the machine
+ * @param error, description of the problem
+ * @return true if the machine is removed
+ *
+ * Remove a machine from the registry
+ */
+bool MachineRegistry::removeMachine(const QUuid &uuid, QString &error)
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    QJsonObject entry;
+    entry["op"] = "remove";
+    entry["uuid"] = uuid.toString();
+
+    return this->appendEntry(entry, error);
+}
+
+/**
+ * @brief Compact the registry
+ * @param error, description of the problem
+ * @return true if the registry is written
+ *
+ * Write all the machines in qtemu.json and
+ * remove the journal
+ */
+bool MachineRegistry::compact(QString &error)
+{
+    QMutexLocker locker(&this->m_mutex);
+
+    QLockFile lockFile(this->lockPath());
+    if (!this->lock(lockFile, error) || !this->syncJournal(error)) {
+        return false;
+    }
+
+    return this->writeRegistry(error);
+}
+
+/**
+ * @brief Get the path of the registry
+ * @return path of qtemu.json
+ *
+ * Get the path of the registry
+ */
+QString MachineRegistry::registryPath() const
+{
+    return QDir::toNativeSeparators(m_dataDirectoryPath + "/qtemu.json");
+}
+
+/**
+ * @brief Get the path of the journal
+ * @return path of qtemu.journal
+ *
+ * Get the path of the journal
+ */
+QString MachineRegistry::journalPath() const
+{
+    return QDir::toNativeSeparators(m_dataDirectoryPath + "/qtemu.journal");
+}
+
+/**
+ * @brief Get the path of the lock
+ * @return path of qtemu.lock
+ *
+ * Get the path of the lock of the registry files
+ */
+QString MachineRegistry::lockPath() const
+{
+    return QDir::toNativeSeparators(m_dataDirectoryPath + "/qtemu.lock");
+}
+
+/**
+ * @brief Lock the registry files
+ * @param lockFile, lock of the registry
+ * @param error, description of the problem
+ * @return true if the files are locked
+ *
+ * The graphical interface and qtemu-cli change the same
+ * files, only one process can write them at a time
+ */
+bool MachineRegistry::lock(QLockFile &lockFile, QString &error)
+{
+    if (lockFile.tryLock(LOCK_TIMEOUT)) {
+        return true;
+    }
+
+    if (lockFile.error() == QLockFile::LockFailedError) {
+        error = QObject::tr("The machine registry is locked by another QtEmu process");
+    } else {
+        error = QObject::tr("Cannot lock the machine registry in %1").arg(this->lockPath());
+    }
+
+    return false;
+}
+
+/**
+ * @brief Read the registry files
+ * @param error, description of the problem
+ * @return false if qtemu.json cannot be read
+ *
+ * Read qtemu.json and replay all the journal. If qtemu.json
+ * is damaged, a copy is saved, the error is set and the
+ * journal is replayed anyway
+ */
+bool MachineRegistry::readFiles(QString &error)
+{
+    this->m_machines.clear();
+    this->m_order.clear();
+    this->m_positions.clear();
+    this->m_generation.clear();
+    this->m_journalEntries = 0;
+    this->m_journalOffset = 0;
+
+    QFile registryFile(this->registryPath());
+    if (registryFile.exists()) {
+        if (!registryFile.open(QFile::ReadOnly)) {
+            error = registryFile.errorString();
+            return false;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument registryDocument(QJsonDocument::fromJson(registryFile.readAll(), &parseError));
+        if (parseError.error != QJsonParseError::NoError) {
+            // Keep a copy, the damaged file is replaced with the next compaction
+            QString damagedPath = this->registryPath() + ".damaged";
+            QFile::remove(damagedPath);
+            QFile::copy(this->registryPath(), damagedPath);
+
+            error = QObject::tr("The file is damaged: %1. A copy is saved in %2")
+                    .arg(parseError.errorString(), damagedPath);
+        }
+
+        this->m_generation = registryDocument["generation"].toString();
+
+        QJsonArray machines = registryDocument["machines"].toArray();
+        for (int i = 0; i < machines.size(); ++i) {
+            QJsonObject machine = machines[i].toObject();
+            QUuid uuid(machine["uuid"].toString());
+            if (uuid.isNull() || this->m_machines.contains(uuid)) {
+                continue;
+            }
+
+            this->m_machines.insert(uuid, machine);
+            this->m_positions.insert(uuid, this->m_order.size());
+            this->m_order.append(uuid);
+        }
+    }
+
+    QFile journalFile(this->journalPath());
+    if (journalFile.open(QFile::ReadOnly)) {
+        this->replayJournal(journalFile);
+        journalFile.close();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Apply the changes of the other processes
+ * @param error, description of the problem
+ * @return true if the registry is up to date
+ *
+ * Replay the journal entries written after the last read.
+ * If another process compacted the registry, the journal
+ * starts with another generation and all the files are read
+ */
+bool MachineRegistry::syncJournal(QString &error)
+{
+    QFile journalFile(this->journalPath());
+    if (!journalFile.exists()) {
+        if (this->m_journalOffset == 0) {
+            return true;
+        }
+        return this->readFiles(error) && error.isEmpty();
+    }
+
+    if (!journalFile.open(QFile::ReadOnly)) {
+        error = journalFile.errorString();
+        return false;
+    }
+
+    QJsonObject header = QJsonDocument::fromJson(journalFile.readLine()).object();
+    QString journalGeneration = header["op"].toString() == "generation" ? header["generation"].toString()
+                                                                         : QString();
+
+    if (journalGeneration != this->m_generation || journalFile.size() < this->m_journalOffset) {
+        journalFile.close();
+        return this->readFiles(error) && error.isEmpty();
+    }
+
+    journalFile.seek(this->m_journalOffset);
+    this->replayJournal(journalFile);
+    journalFile.close();
+
+    return true;
+}
+
+/**
+ * @brief Replay the journal
+ * @param journalFile, journal open at the first entry to replay
+ *
+ * Apply the entries of the journal until the end and
+ * remember where the next entries will start
+ */
+void MachineRegistry::replayJournal(QFile &journalFile)
+{
+    while (!journalFile.atEnd()) {
+        QByteArray line = journalFile.readLine();
+        // An entry without end was cut by a crash, the next entry starts after it
+        this->m_journalOffset = journalFile.pos();
+        if (!line.endsWith('\n')) {
+            qDebug() << "Discarded journal entry" << line;
+            break;
+        }
+
+        line = line.trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument entry = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !entry.isObject()) {
+            qDebug() << "Discarded journal entry" << line;
+            continue;
+        }
+
+        if (entry["op"].toString() == "generation") {
+            continue;
+        }
+
+        this->applyEntry(entry.object());
+        ++this->m_journalEntries;
+    }
+}
+
+/**
+ * @brief Apply an entry of the journal
+ * @param entry, change of the registry
+ *
+ * Apply an entry of the journal. Applying the same entry
+ * twice has no effect, so the journal can be replayed over
+ * a registry that already has its changes
+ */
+void MachineRegistry::applyEntry(const QJsonObject &entry)
+{
+    QString operation = entry["op"].toString();
+
+    if (operation == "insert" || operation == "update") {
+        QJsonObject machine = entry["machine"].toObject();
+        QUuid uuid(machine["uuid"].toString());
+        if (uuid.isNull()) {
+            return;
+        }
+
+        if (!this->m_machines.contains(uuid)) {
+            this->m_positions.insert(uuid, this->m_order.size());
+            this->m_order.append(uuid);
+        } else if (operation == "update") {
+            // Keep the values that aren't in the update
+            QJsonObject oldMachine = this->m_machines.value(uuid);
+            for (auto it = machine.constBegin(); it != machine.constEnd(); ++it) {
+                oldMachine[it.key()] = it.value();
+            }
+            machine = oldMachine;
+        }
+        this->m_machines.insert(uuid, machine);
+    } else if (operation == "remove") {
+        QUuid uuid(entry["uuid"].toString());
+        if (this->m_machines.remove(uuid) > 0) {
+            // The machine leaves a hole, the list is rebuilt when half of it are holes
+            this->m_order[this->m_positions.take(uuid)] = QUuid();
+            if (this->m_order.size() > 2 * this->m_machines.size()) {
+                this->compactOrder();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Remove the holes of the order
+ *
+ * Remove the holes left by the removed machines
+ * and update the positions
+ */
+void MachineRegistry::compactOrder()
+{
+    QList<QUuid> order;
+    order.reserve(this->m_machines.size());
+
+    this->m_positions.clear();
+    foreach (const QUuid &uuid, this->m_order) {
+        if (uuid.isNull()) {
+            continue;
+        }
+        this->m_positions.insert(uuid, order.size());
+        order.append(uuid);
+    }
+
+    this->m_order = order;
+}
+
+/**
+ * @brief Append an entry to the journal
+ * @param entry, change of the registry
+ * @param error, description of the problem
+ * @return true if the entry is written
+ *
+ * Apply the changes of the other processes, then write
+ * the entry to the journal and apply it.
+ * The registry is compacted when the journal is too long
+ */
+bool MachineRegistry::appendEntry(const QJsonObject &entry, QString &error)
+{
+    if (!this->m_loaded) {
+        error = QObject::tr("The machine registry isn't loaded");
+        return false;
+    }
+
+    QDir().mkpath(this->m_dataDirectoryPath);
+
+    QLockFile lockFile(this->lockPath());
+    if (!this->lock(lockFile, error) || !this->syncJournal(error)) {
+        return false;
+    }
+
+    QFile journalFile(this->journalPath());
+    if (!journalFile.open(QFile::ReadWrite | QFile::Append)) {
+        error = journalFile.errorString();
+        return false;
+    }
+
+    QByteArray line;
+    if (journalFile.size() == 0) {
+        line = this->generationEntry();
+    } else if (journalFile.seek(journalFile.size() - 1) && journalFile.read(1) != "\n") {
+        // Don't glue the entry to one cut by a crash
+        line.append('\n');
+    }
+    line.append(QJsonDocument(entry).toJson(QJsonDocument::Compact));
+    line.append('\n');
+
+    if (journalFile.write(line) != line.size() || !journalFile.flush()) {
+        error = journalFile.errorString();
+        return false;
+    }
+
+#ifdef Q_OS_UNIX
+    ::fsync(journalFile.handle());
+#endif
+    this->m_journalOffset = journalFile.size();
+    journalFile.close();
+
+    this->applyEntry(entry);
+
+    if (++this->m_journalEntries >= COMPACTION_THRESHOLD) {
+        QString compactionError;
+        if (!this->writeRegistry(compactionError)) {
+            // The change is in the journal, so it isn't lost
+            qDebug() << "Cannot compact the machine registry" << compactionError;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write the registry
+ * @param error, description of the problem
+ * @return true if the registry is written
+ *
+ * Replace qtemu.json with all the machines and start an empty
+ * journal. The registry and the journal get a new generation,
+ * so the other processes know they must read the files again.
+ * If QtEmu crashes before the journal is replaced, the journal
+ * is replayed again on the next load without effect.
+ * The registry must be locked
+ */
+bool MachineRegistry::writeRegistry(QString &error)
+{
+    QDir().mkpath(this->m_dataDirectoryPath);
+
+    QJsonArray machines;
+    foreach (const QUuid &uuid, this->m_order) {
+        if (uuid.isNull()) {
+            continue;
+        }
+        machines.append(this->m_machines.value(uuid));
+    }
+
+    QString generation = QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    QJsonObject registryObject;
+    registryObject["generation"] = generation;
+    registryObject["machines"] = machines;
+
+    QSaveFile registryFile(this->registryPath());
+    if (!registryFile.open(QFile::WriteOnly)) {
+        error = registryFile.errorString();
+        return false;
+    }
+
+    registryFile.write(QJsonDocument(registryObject).toJson());
+    if (!registryFile.commit()) {
+        error = registryFile.errorString();
+        return false;
+    }
+
+    this->m_generation = generation;
+    this->m_journalEntries = 0;
+
+    QSaveFile journalFile(this->journalPath());
+    QByteArray header = this->generationEntry();
+    if (journalFile.open(QFile::WriteOnly) && journalFile.write(header) == header.size() &&
+        journalFile.commit()) {
+        this->m_journalOffset = header.size();
+    } else {
+        // The old journal doesn't match the generation, it will be read again
+        this->m_journalOffset = 0;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get the first entry of the journal
+ * @return entry with the generation of the registry
+ *
+ * Get the first entry of the journal
+ */
+QByteArray MachineRegistry::generationEntry() const
+{
+    QJsonObject entry;
+    entry["op"] = "generation";
+    entry["generation"] = this->m_generation;
+
+    return QJsonDocument(entry).toJson(QJsonDocument::Compact) + '\n';
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINEREGISTRY_H
+#define MACHINEREGISTRY_H
+
+// Qt
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QLockFile>
+#include <QSettings>
+#include <QUuid>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+class MachineRegistry {
+
+    public:
+        static MachineRegistry *instance();
+
+        bool load(QString &error);
+        bool isLoaded() const;
+
+        QList<QJsonObject> machines() const;
+        QJsonObject machine(const QUuid &uuid) const;
+        bool contains(const QUuid &uuid) const;
+        int count() const;
+
+        bool insertMachine(const QJsonObject &machine, QString &error);
+        bool updateMachine(const QJsonObject &machine, QString &error);
+        bool removeMachine(const QUuid &uuid, QString &error);
+
+        bool compact(QString &error);
+
+        QString registryPath() const;
+        QString journalPath() const;
+        QString lockPath() const;
+
+    private:
+        MachineRegistry();
+        ~MachineRegistry();
+
+        Q_DISABLE_COPY(MachineRegistry)
+
+        mutable QMutex m_mutex;
+        bool m_loaded;
+        QString m_dataDirectoryPath;
+
+        // Machines by uuid, and their order in the list.
+        // A removed machine leaves a null uuid until the order is compacted
+        QHash<QUuid, QJsonObject> m_machines;
+        QList<QUuid> m_order;
+        QHash<QUuid, int> m_positions;
+        int m_journalEntries;
+
+        // Generation of qtemu.json and bytes of the journal already applied
+        QString m_generation;
+        qint64 m_journalOffset;
+
+        // Methods
+        bool lock(QLockFile &lockFile, QString &error);
+        bool readFiles(QString &error);
+        bool syncJournal(QString &error);
+        void replayJournal(QFile &journalFile);
+        void applyEntry(const QJsonObject &entry);
+        void compactOrder();
+        bool appendEntry(const QJsonObject &entry, QString &error);
+        bool writeRegistry(QString &error);
+        QByteArray generationEntry() const;
+};
+
+#endif // MACHINEREGISTRY_H
@@ -0,0 +1,370 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machinesupervisor.h"
+
+// Maximum time between two restarts
+static const int MAX_BACKOFF = 300000;
+
+// Minimum time before a restart, a machine that always fails doesn't use all the CPU
+static const int MIN_BACKOFF = 500;
+
+// A machine running this time is stable, the restarts are counted again
+static const qint64 STABLE_UPTIME = 300000;
+
+// Default restart limits
+static const int DEFAULT_MAX_RESTARTS = 5;
+static const int DEFAULT_BACKOFF = 1000;
+
+/**
+ * @brief Machine supervisor
+ * @param QEMUObject, QEMU object used to restart the machines
+ * @param parent, parent object
+ *
+ * Restart the machines when QEMU finishes, following
+ * the restart policy of every machine. The time between
+ * two restarts doubles after every restart, until the
+ * machine runs long enough or the limit is reached.
+ * Every restart is recorded in the event log of the machine
+ */
+MachineSupervisor::MachineSupervisor(QEMU *QEMUObject, QObject *parent) : QObject(parent)
+{
+    this->m_QEMUObject = QEMUObject;
+
+    qDebug() << "MachineSupervisor created";
+}
+
+MachineSupervisor::~MachineSupervisor()
+{
+    qDebug() << "MachineSupervisor destroyed";
+}
+
+/**
+ * @brief Supervise a machine
+ * @param machine, machine
+ *
+ * Supervise a machine until it's destroyed
+ */
+void MachineSupervisor::addMachine(Machine *machine)
+{
+    if (machine == nullptr || this->m_supervisions.contains(machine)) {
+        return;
+    }
+
+    Supervision supervision;
+    supervision.machine = machine;
+    supervision.restarts = 0;
+    supervision.restarting = false;
+    supervision.restartTimer = new QTimer(machine);
+    supervision.restartTimer->setSingleShot(true);
+    this->m_supervisions.insert(machine, supervision);
+
+    connect(supervision.restartTimer, &QTimer::timeout,
+            this, [=]() {
+        this->restartMachine(machine);
+    });
+    connect(machine, &Machine::machineExitedSignal,
+            this, [=](const QUuid &machineUuid, Machine::ExitCauses cause, int exitCode, qint64 duration) {
+        Q_UNUSED(machineUuid)
+        this->machineExited(machine, cause, exitCode, duration);
+    });
+    // QEMU doesn't start or the restart fails before QEMU is started
+    connect(machine, &Machine::machineStartFailedSignal,
+            this, [=]() {
+        if (this->m_supervisions.value(machine).restarting) {
+            this->machineExited(machine, Machine::ProcessFailure, -1, 0);
+        }
+    });
+    connect(machine, &Machine::machineStateChangedSignal,
+            this, [=](Machine::States newState) {
+        if (newState == Machine::Started && this->m_supervisions.contains(machine)) {
+            this->m_supervisions[machine].restarting = false;
+        }
+    });
+    connect(machine->getQMPClient(), &QMPClient::eventReceived,
+            this, [=](const QString &event, const QJsonObject &data) {
+        // With the pause action the guest stays stopped until QEMU is finished
+        if (event == "GUEST_PANICKED" && data["action"].toString() == "pause") {
+            this->guestPanicked(machine);
+        }
+    });
+    connect(machine, &QObject::destroyed,
+            this, [=]() {
+        this->m_supervisions.remove(machine);
+    });
+}
+
+/**
+ * @brief Stop supervising a machine
+ * @param machineUuid, uuid of the machine
+ *
+ * Cancel the restart of a machine that is removed.
+ * The machine isn't restarted anymore
+ */
+void MachineSupervisor::removeMachine(const QUuid &machineUuid)
+{
+    QMutableHashIterator<Machine *, Supervision> supervision(this->m_supervisions);
+    while (supervision.hasNext()) {
+        supervision.next();
+        Machine *machine = supervision.value().machine;
+        if (machine != nullptr && machine->getUuid() != machineUuid) {
+            continue;
+        }
+
+        if (machine != nullptr) {
+            disconnect(machine, nullptr, this, nullptr);
+            disconnect(machine->getQMPClient(), nullptr, this, nullptr);
+        }
+        supervision.value().restartTimer->stop();
+        supervision.value().restartTimer->deleteLater();
+        supervision.remove();
+    }
+}
+
+/**
+ * @brief Cancel the next restart of a machine
+ * @param machineUuid, uuid of the machine
+ * @return true if a restart was waiting
+ *
+ * Cancel the restart of a machine that is waiting
+ * for the end of the backoff
+ */
+bool MachineSupervisor::cancelRestart(const QUuid &machineUuid)
+{
+    for (auto it = this->m_supervisions.begin(); it != this->m_supervisions.end(); ++it) {
+        if (it.value().machine.isNull() || it.value().machine->getUuid() != machineUuid ||
+            !it.value().restartTimer->isActive()) {
+            continue;
+        }
+
+        it.value().restartTimer->stop();
+        it.value().restarts = 0;
+        it.value().machine->getConsole()->append(ConsoleBuffer::Info,
+                                                 tr("Restart cancelled").toUtf8() + '\n');
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the restart config of a machine
+ * @param entry, entry of the machine in the registry
+ * @return restart config
+ *
+ * The config is stored in the supervisor object of the entry.
+ * Ex: {"policy": "on-failure", "maxRestarts": 5, "backoff": 1000}
+ */
+MachineSupervisor::RestartConfig MachineSupervisor::restartConfig(const QJsonObject &entry)
+{
+    QJsonObject supervisor = entry["supervisor"].toObject();
+
+    RestartConfig config;
+    QString policy = supervisor["policy"].toString();
+    if (policy == MachineSupervisor::policyName(MachineSupervisor::OnFailure)) {
+        config.policy = MachineSupervisor::OnFailure;
+    } else if (policy == MachineSupervisor::policyName(MachineSupervisor::Always)) {
+        config.policy = MachineSupervisor::Always;
+    } else {
+        config.policy = MachineSupervisor::Never;
+    }
+    config.maxRestarts = qMax(0, supervisor["maxRestarts"].toInt(DEFAULT_MAX_RESTARTS));
+    config.backoff = qBound(MIN_BACKOFF, supervisor["backoff"].toInt(DEFAULT_BACKOFF), MAX_BACKOFF);
+
+    return config;
+}
+
+/**
+ * @brief Get the restart config of a machine
+ * @param machineUuid, uuid of the machine
+ * @return restart config
+ *
+ * Get the restart config of a machine of the registry
+ */
+MachineSupervisor::RestartConfig MachineSupervisor::restartConfig(const QUuid &machineUuid)
+{
+    return MachineSupervisor::restartConfig(MachineRegistry::instance()->machine(machineUuid));
+}
+
+/**
+ * @brief Save the restart config of a machine
+ * @param machineUuid, uuid of the machine
+ * @param config, restart config
+ * @param error, description of the problem
+ * @return true if the config is saved
+ *
+ * Save the restart config in the entry of the machine in the registry
+ */
+bool MachineSupervisor::setRestartConfig(const QUuid &machineUuid,
+                                         const MachineSupervisor::RestartConfig &config,
+                                         QString &error)
+{
+    QJsonObject supervisor;
+    supervisor["policy"] = MachineSupervisor::policyName(config.policy);
+    supervisor["maxRestarts"] = config.maxRestarts;
+    supervisor["backoff"] = qBound(MIN_BACKOFF, config.backoff, MAX_BACKOFF);
+
+    QJsonObject supervisorUpdate;
+    supervisorUpdate["uuid"] = machineUuid.toString();
+    supervisorUpdate["supervisor"] = supervisor;
+
+    return MachineRegistry::instance()->updateMachine(supervisorUpdate, error);
+}
+
+/**
+ * @brief Get the name of a restart policy
+ * @param policy, restart policy
+ * @return name of the policy, stored in the registry
+ *
+ * Get the name of a restart policy
+ */
+QString MachineSupervisor::policyName(MachineSupervisor::RestartPolicies policy)
+{
+    switch (policy) {
+        case MachineSupervisor::Never:
+            return "never";
+        case MachineSupervisor::OnFailure:
+            return "on-failure";
+        case MachineSupervisor::Always:
+            return "always";
+    }
+
+    return QString();
+}
+
+/**
+ * @brief QEMU finished
+ * @param machine, machine
+ * @param cause, why QEMU finished
+ * @param exitCode, exit code of QEMU
+ * @param duration, time the machine was running in milliseconds
+ *
+ * Schedule the restart of the machine if its policy
+ * restarts it for this cause and the limit isn't reached
+ */
+void MachineSupervisor::machineExited(Machine *machine, Machine::ExitCauses cause, int exitCode,
+                                      qint64 duration)
+{
+    if (!this->m_supervisions.contains(machine)) {
+        return;
+    }
+
+    Supervision &supervision = this->m_supervisions[machine];
+    supervision.restarting = false;
+
+    if (duration >= STABLE_UPTIME) {
+        supervision.restarts = 0;
+    }
+
+    RestartConfig config = MachineSupervisor::restartConfig(machine->getUuid());
+
+    bool failure = cause == Machine::ProcessFailure ||
+                   cause == Machine::ProcessCrash ||
+                   cause == Machine::GuestPanic;
+    bool restart = false;
+    if (config.policy == MachineSupervisor::Always) {
+        restart = cause != Machine::StopRequested;
+    } else if (config.policy == MachineSupervisor::OnFailure) {
+        restart = failure;
+    }
+
+    if (!restart) {
+        supervision.restarts = 0;
+        return;
+    }
+
+    QString causeName = Machine::exitCauseName(cause);
+    int attempt = supervision.restarts + 1;
+
+    QJsonObject restartData;
+    restartData["cause"] = causeName;
+    restartData["exitCode"] = exitCode;
+    restartData["attempt"] = attempt;
+
+    if (config.maxRestarts > 0 && attempt > config.maxRestarts) {
+        supervision.restarts = 0;
+
+        restartData["abandoned"] = true;
+        machine->recordEvent(MachineEventLog::Restart, restartData);
+        machine->getConsole()->append(ConsoleBuffer::Info,
+                                      tr("The machine isn't restarted after %1 restarts")
+                                      .arg(config.maxRestarts).toUtf8() + '\n');
+        Logger::logQtemuError(QString("Machine %1 not restarted after %2 restarts (%3)")
+                              .arg(machine->getName()).arg(config.maxRestarts).arg(causeName));
+
+        emit(restartAbandoned(machine->getUuid(), config.maxRestarts, causeName));
+        return;
+    }
+
+    // The delay doubles with every restart
+    qint64 delay = config.backoff;
+    for (int i = 0; i < supervision.restarts && delay < MAX_BACKOFF; ++i) {
+        delay *= 2;
+    }
+    delay = qMin(delay, static_cast<qint64>(MAX_BACKOFF));
+
+    supervision.restarts = attempt;
+    supervision.restartTimer->start(static_cast<int>(delay));
+
+    restartData["delay"] = static_cast<double>(delay);
+    machine->recordEvent(MachineEventLog::Restart, restartData);
+    machine->getConsole()->append(ConsoleBuffer::Info,
+                                  tr("QEMU will be restarted in %1 s (%2)")
+                                  .arg(delay / 1000.0, 0, 'f', 1).arg(causeName).toUtf8() + '\n');
+    Logger::logQtemuAction(QString("Machine %1 restart %2 in %3 ms (%4)")
+                           .arg(machine->getName()).arg(attempt).arg(delay).arg(causeName));
+
+    emit(restartScheduled(machine->getUuid(), attempt, static_cast<int>(delay), causeName));
+}
+
+/**
+ * @brief The guest panicked
+ * @param machine, machine
+ *
+ * QEMU keeps the panicked guest paused. Quit QEMU
+ * if the machine is restarted after a failure
+ */
+void MachineSupervisor::guestPanicked(Machine *machine)
+{
+    if (MachineSupervisor::restartConfig(machine->getUuid()).policy == MachineSupervisor::Never) {
+        return;
+    }
+
+    Logger::logQtemuError(QString("Machine %1: the guest panicked").arg(machine->getName()));
+    machine->getQMPClient()->execute("quit");
+}
+
+/**
+ * @brief Restart a machine
+ * @param machine, machine
+ *
+ * Start the machine again, unless it was
+ * started by hand during the backoff
+ */
+void MachineSupervisor::restartMachine(Machine *machine)
+{
+    if (!this->m_supervisions.contains(machine) || machine->getState() != Machine::Stopped) {
+        return;
+    }
+
+    this->m_supervisions[machine].restarting = true;
+    machine->runMachine(this->m_QEMUObject);
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINESUPERVISOR_H
+#define MACHINESUPERVISOR_H
+
+// Qt
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QUuid>
+#include <QTimer>
+#include <QJsonObject>
+#include <QDebug>
+
+// Local
+#include "machine.h"
+#include "machineregistry.h"
+#include "qemu.h"
+#include "utils/logger.h"
+
+class MachineSupervisor : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MachineSupervisor(QEMU *QEMUObject, QObject *parent = nullptr);
+        ~MachineSupervisor();
+
+        enum RestartPolicies {
+            Never, OnFailure, Always
+        };
+
+        struct RestartConfig {
+            MachineSupervisor::RestartPolicies policy = MachineSupervisor::Never;
+            int maxRestarts = 0;
+            int backoff = 0;
+        };
+
+        void addMachine(Machine *machine);
+        void removeMachine(const QUuid &machineUuid);
+        bool cancelRestart(const QUuid &machineUuid);
+
+        static MachineSupervisor::RestartConfig restartConfig(const QJsonObject &entry);
+        static MachineSupervisor::RestartConfig restartConfig(const QUuid &machineUuid);
+        static bool setRestartConfig(const QUuid &machineUuid,
+                                     const MachineSupervisor::RestartConfig &config,
+                                     QString &error);
+        static QString policyName(MachineSupervisor::RestartPolicies policy);
+
+    signals:
+        void restartScheduled(const QUuid machineUuid, int attempt, int delay,
+                              const QString &cause);
+        void restartAbandoned(const QUuid machineUuid, int restarts, const QString &cause);
+
+    public slots:
+
+    private slots:
+
+    protected:
+
+    private:
+        struct Supervision {
+            QPointer<Machine> machine;
+            int restarts;
+            bool restarting;
+            QTimer *restartTimer;
+        };
+
+        QEMU *m_QEMUObject;
+        QHash<Machine *, Supervision> m_supervisions;
+
+        // Methods
+        void machineExited(Machine *machine, Machine::ExitCauses cause, int exitCode,
+                           qint64 duration);
+        void guestPanicked(Machine *machine);
+        void restartMachine(Machine *machine);
+};
+
+#endif // MACHINESUPERVISOR_H
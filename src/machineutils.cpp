@@ -42,31 +42,51 @@ MachineUtils::~MachineUtils()
  */
 QJsonObject MachineUtils::readMachineFile(QString machinePath)
 {
-    QJsonObject machineJSON;
+    QString error;
+    QJsonObject machineJSON = MachineUtils::parseMachineFile(machinePath, error);
 
-    // TODO: Move all to generic function to check if file can be opened or readed
+    if (!error.isEmpty()) {
+        ErrorReporter::report(tr("Qtemu - Critical error"),
+                              tr("<p>Cannot load the machine</p>"
+                                 "<p>Cannot open the <strong>%1</strong> file. "
+                                 "Please ensure that the file exists and it's readable</p>"
+                                 "<p>%2</p>").arg(machinePath, error),
+                              ErrorReporter::Critical);
+    }
+
+    return machineJSON;
+}
+
+/**
+ * @brief Parse the machine file
+ * @param machinePath, path of the machine config
+ * @param error, description of the problem
+ * @return machine data, empty if the file cannot be read
+ *
+ * Parse the machine file without showing messages,
+ * so it can be called from any thread
+ */
+QJsonObject MachineUtils::parseMachineFile(const QString &machinePath, QString &error)
+{
     QFile machineFile(machinePath);
     if (!machineFile.open(QFile::ReadOnly)) {
-        QMessageBox *machinePathMessageBox = new QMessageBox();
-        machinePathMessageBox->setWindowTitle(tr("Qtemu - Critical error"));
-        machinePathMessageBox->setIcon(QMessageBox::Critical);
-        machinePathMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-        machinePathMessageBox->setText(tr(qPrintable(QString("<p>Cannot load the machine</p>"
-                                                               "<p>Cannot open the <strong>%1</strong> file. "
-                                                               "Please ensure that the file exists and it's readable</p>").arg(machinePath))));
-        machinePathMessageBox->exec();
-        return machineJSON;
+        error = machineFile.errorString();
+        return QJsonObject();
     }
 
-    QByteArray machineData = machineFile.readAll();
-    QJsonDocument machineDocument(QJsonDocument::fromJson(machineData));
-    machineJSON = machineDocument.object();
+    QJsonParseError parseError;
+    QJsonDocument machineDocument(QJsonDocument::fromJson(machineFile.readAll(), &parseError));
+    if (parseError.error != QJsonParseError::NoError) {
+        error = tr("The file is damaged: %1").arg(parseError.errorString());
+        return QJsonObject();
+    }
 
-    if (machineFile.isOpen()) {
-        machineFile.close();
+    if (!machineDocument.isObject() || machineDocument.object().isEmpty()) {
+        error = tr("The file doesn't have a machine");
+        return QJsonObject();
     }
 
-    return machineJSON;
+    return machineDocument.object();
 }
 
 /**
@@ -83,6 +103,7 @@ void MachineUtils::fillMachineObject(Machine *machine,
 {
     QJsonObject gpuObject = machineJSON["gpu"].toObject();
     QJsonObject cpuObject = machineJSON["cpu"].toObject();
+    QJsonObject memoryObject = machineJSON["memory"].toObject();
     QJsonObject bootObject = machineJSON["boot"].toObject();
     QJsonObject kernelObject = bootObject["kernelBoot"].toObject();
     QJsonArray mediaArray = machineJSON["media"].toArray();
@@ -103,10 +124,38 @@ void MachineUtils::fillMachineObject(Machine *machine,
         media->setPath(mediaObject["path"].toString());
         media->setType(mediaObject["type"].toString());
         media->setDriveInterface(mediaObject["interface"].toString());
+        media->setFormat(mediaObject["format"].toString());
+        media->setCache(mediaObject["cache"].toString("writeback"));
+        media->setIO(mediaObject["io"].toString("threads"));
+        media->setDiscard(mediaObject["discard"].toBool());
+        media->setBus(mediaObject["bus"].toString(media->type() == "fdd" ? "fdc" : "ide"));
+        media->setIOThread(mediaObject["iothread"].toString());
         media->setUuid(mediaObject["uuid"].toVariant().toUuid());
         machine->addMedia(media);
     }
 
+    QJsonArray networkArray = machineJSON["nics"].toArray();
+    for (int i = 0; i < networkArray.size(); ++i) {
+        QJsonObject networkObject = networkArray[i].toObject();
+
+        NetworkInterface *networkInterface = new NetworkInterface(machine);
+        networkInterface->setModel(networkObject["model"].toString("virtio-net-pci"));
+        networkInterface->setBackend(networkObject["backend"].toString("user"));
+        networkInterface->setHostInterface(networkObject["hostInterface"].toString());
+        networkInterface->setVhost(networkObject["vhost"].toBool(true));
+        networkInterface->setQueues(networkObject["queues"].toInt());
+        networkInterface->setMACAddress(networkObject["mac"].toString());
+        machine->addNetworkInterface(networkInterface);
+    }
+
+    // Machines created before the network cards used -net nic -net user
+    if (!machineJSON.contains("nics") && machineJSON["network"].toBool()) {
+        NetworkInterface *networkInterface = new NetworkInterface(machine);
+        networkInterface->setModel("e1000");
+        networkInterface->setBackend("user");
+        machine->addNetworkInterface(networkInterface);
+    }
+
     machine->setState(Machine::Stopped);
     machine->setName(machineJSON["name"].toString());
     machine->setOSType(machineJSON["OSType"].toString());
@@ -115,6 +164,14 @@ void MachineUtils::fillMachineObject(Machine *machine,
     machine->setDescription(machineJSON["description"].toString());
     machine->setRAM(machineJSON["RAM"].toInt());
     machine->setUseNetwork(machineJSON["network"].toBool());
+    machine->setIOThreads(machineJSON["iothreads"].toInt());
+    machine->setMemoryBackend(memoryObject["backend"].toString("default"));
+    machine->setHugePageSize(memoryObject["hugePageSize"].toInt());
+    machine->setMemoryPath(memoryObject["path"].toString());
+    machine->setMemoryPrealloc(memoryObject["prealloc"].toBool());
+    machine->setPreallocThreads(memoryObject["preallocThreads"].toInt(1));
+    machine->setNUMANodes(memoryObject["NUMANodes"].toInt());
+    machine->setNUMAHostNodes(memoryObject["hostNodes"].toVariant().toStringList());
     machine->setConfigPath(machineConfigPath);
     machine->setPath(machineJSON["path"].toString());
     machine->setUuid(QUuid(machineJSON["uuid"].toString()));
@@ -124,6 +181,8 @@ void MachineUtils::fillMachineObject(Machine *machine,
     machine->setCPUCount(cpuObject["CPUCount"].toInt());
     machine->setCoresSocket(cpuObject["coresSocket"].toInt());
     machine->setMaxHotCPU(cpuObject["maxHotCPU"].toInt());
+    machine->setCPUPinning(cpuObject["pinning"].toString("none"));
+    machine->setCPUSet(cpuObject["cpuset"].toString());
     machine->setSocketCount(cpuObject["socketCount"].toInt());
     machine->setThreadsCore(cpuObject["threadsCore"].toInt());
     machine->setHostSoundSystem(machineJSON["hostsoundsystem"].toString());
@@ -141,63 +200,184 @@ void MachineUtils::fillMachineObject(Machine *machine,
  */
 bool MachineUtils::deleteMachine(const QUuid machineUuid)
 {
-    QSettings settings;
-    settings.beginGroup("DataFolder");
-    QString dataDirectoryPath = settings.value("QtEmuData",
-                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
-    settings.endGroup();
-
-    // Open the file with the machines
-    QString qtemuConfig = dataDirectoryPath.append("qtemu.json");
-    QFile machinesFile(qtemuConfig);
-    if (!machinesFile.open(QFile::ReadWrite)) {
-        QMessageBox *m_deleteMachineMessageBox = new QMessageBox();
-        m_deleteMachineMessageBox->setWindowTitle(tr("Qtemu - Critical error"));
-        m_deleteMachineMessageBox->setIcon(QMessageBox::Critical);
-        m_deleteMachineMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-        m_deleteMachineMessageBox->setText(tr("<p>Cannot delete the machine</p>"
-                                              "<p>The file with the machines configuration are not readable</p>"));
-        m_deleteMachineMessageBox->exec();
+    QString machinePath = MachineRegistry::instance()->machine(machineUuid)["path"].toString();
+
+    QString error;
+    if (!MachineRegistry::instance()->removeMachine(machineUuid, error)) {
+        ErrorReporter::report(tr("Qtemu - Critical error"),
+                              tr("<p>Cannot delete the machine</p>"
+                                 "<p>The file with the machines configuration are not writable: %1</p>")
+                              .arg(error),
+                              ErrorReporter::Critical);
+        return false;
+    }
+
+    // Never remove the current folder
+    if (machinePath.isEmpty()) {
+        return true;
+    }
+
+    QDir *machineDirectory = new QDir(QDir::toNativeSeparators(machinePath));
+    bool removedDirectory = machineDirectory->removeRecursively();
+
+    return removedDirectory;
+}
+
+/**
+ * @brief Resolve the CPU topology of the machine
+ * @param CPUCount, number of CPUs at startup
+ * @param sockets, number of sockets. 0 to calculate it
+ * @param cores, number of cores per socket. 0 to calculate it
+ * @param threads, number of threads per core. 0 for one thread
+ * @param maxCPUs, maximum number of hotpluggable CPUs. 0 for CPUCount
+ * @param error, description of the problem if the topology is wrong
+ * @return true if the topology is valid
+ *
+ * Resolve the CPU topology of the machine.
+ * If sockets, cores, threads and maxCPUs are 0, there's no topology
+ * and QEMU uses the default one. Otherwise the missing values are
+ * calculated and sockets * cores * threads must be equal to maxCPUs
+ */
+bool MachineUtils::resolveCPUTopology(const int CPUCount, int &sockets, int &cores,
+                                      int &threads, int &maxCPUs, QString &error)
+{
+    if (sockets <= 0 && cores <= 0 && threads <= 0 && maxCPUs <= 0) {
+        sockets = cores = threads = maxCPUs = 0;
+        return true;
+    }
+
+    if (maxCPUs <= 0) {
+        maxCPUs = CPUCount;
+    }
+
+    if (CPUCount > maxCPUs) {
+        error = tr("The CPU count (%1) is greater than the maximum number of CPUs (%2)")
+                .arg(CPUCount).arg(maxCPUs);
         return false;
     }
 
-    // Read all the machines included in the file
-    QByteArray machinesData = machinesFile.readAll();
-    QJsonDocument machinesDocument(QJsonDocument::fromJson(machinesData));
-    QJsonArray machines = machinesDocument["machines"].toArray();
-
-    int machinePos = 0;
-    bool machineExists = false;
-    QString machinePath;
-    while(machinePos < machines.size() && ! machineExists) {
-        QJsonObject machineJSON = machines[machinePos].toObject();
-        if (machineUuid.toString() == machineJSON["uuid"].toVariant()) {
-            machineExists = true;
-            machinePath = machineJSON["path"].toString();
-        } else {
-            ++machinePos;
+    if (threads <= 0) {
+        threads = 1;
+    }
+
+    if (sockets <= 0 && cores <= 0) {
+        sockets = 1;
+        cores = maxCPUs / threads;
+    } else if (sockets <= 0) {
+        sockets = maxCPUs / (cores * threads);
+    } else if (cores <= 0) {
+        cores = maxCPUs / (sockets * threads);
+    }
+
+    if (sockets <= 0 || cores <= 0 || sockets * cores * threads != maxCPUs) {
+        error = tr("Sockets (%1) * cores (%2) * threads (%3) must be equal to the maximum number of CPUs (%4)")
+                .arg(sockets).arg(cores).arg(threads).arg(maxCPUs);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check the memory backend of the machine
+ * @param machine, machine to check
+ * @param error, description of the problem if the backend is wrong
+ * @return true if the machine can allocate the RAM
+ *
+ * Check that the host has enough free huge pages,
+ * the hugetlbfs is mounted and the host NUMA nodes exist
+ */
+bool MachineUtils::checkMemoryBackend(const Machine *machine, QString &error)
+{
+    int hugePageSize = machine->getHugePageSize();
+    if (hugePageSize > 0 && machine->getMemoryBackend() != "default") {
+        QMap<int, int> hugePages = HostUtils::getHugePages();
+        if (!hugePages.contains(hugePageSize)) {
+            error = tr("The host doesn't support huge pages of %1 KiB").arg(hugePageSize);
+            return false;
+        }
+
+        qlonglong freeRAM = static_cast<qlonglong>(hugePages.value(hugePageSize)) * hugePageSize / 1024;
+        if (freeRAM < machine->getRAM()) {
+            error = tr("There are only %1 MiB free in huge pages of %2 KiB, the machine needs %3 MiB")
+                    .arg(freeRAM).arg(hugePageSize).arg(machine->getRAM());
+            return false;
+        }
+
+        if (machine->getMemoryBackend() == "file" && machine->getMemoryPath().isEmpty() &&
+            HostUtils::getHugePagesMountPoint(hugePageSize).isEmpty()) {
+            error = tr("There isn't any hugetlbfs mounted with pages of %1 KiB").arg(hugePageSize);
+            return false;
         }
     }
 
-    if (machineExists) {
-        machines.removeAt(machinePos);
+    int hostNodes = HostUtils::getHostNUMANodes();
+    QStringList NUMAHostNodes = machine->getNUMAHostNodes();
+    for (int i = 0; i < qMax(1, machine->getNUMANodes()); ++i) {
+        QStringList nodes = NUMAHostNodes.value(i).split(QRegularExpression("[,-]"), Qt::SkipEmptyParts);
+        foreach (const QString &node, nodes) {
+            bool validNode = false;
+            int hostNode = node.trimmed().toInt(&validNode);
+            if (!validNode || hostNode < 0 || hostNode >= hostNodes) {
+                error = tr("The host NUMA node '%1' of the guest node %2 doesn't exist")
+                        .arg(node.trimmed()).arg(i);
+                return false;
+            }
+        }
     }
 
-    QJsonObject machinesObject;
-    machinesObject["machines"] = machines;
-    QJsonDocument machinesDocumentJSON(machinesObject);
+    return true;
+}
 
-    machinesFile.seek(0);
-    machinesFile.resize(0);
-    machinesFile.write(machinesDocumentJSON.toJson());
-    if (machinesFile.isOpen()) {
-        machinesFile.close();
+/**
+ * @brief Check the CPU pinning of the machine
+ * @param machine, machine to check
+ * @param error, description of the problem if the pinning is wrong
+ * @return true if the threads of the machine can be pinned
+ *
+ * The explicit cpuset must be valid and exist in the host.
+ * The automatic placement needs enough CPUs in the host
+ */
+bool MachineUtils::checkCPUPinning(const Machine *machine, QString &error)
+{
+    QString pinning = machine->getCPUPinning();
+    if (pinning != "explicit" && pinning != "auto") {
+        return true;
     }
 
-    QDir *machineDirectory = new QDir(QDir::toNativeSeparators(machinePath));
-    bool removedDirectory = machineDirectory->removeRecursively();
+#ifndef Q_OS_LINUX
+    qDebug() << "CPU pinning is only available in Linux";
+    return true;
+#endif
 
-    return removedDirectory;
+    QList<int> hostCPUs;
+    foreach (const HostCPU &hostCPU, HostTopology::getHostCPUs()) {
+        hostCPUs.append(hostCPU.id);
+    }
+
+    if (pinning == "auto") {
+        if (hostCPUs.size() < machine->getCPUCount()) {
+            error = tr("The host has %1 CPUs, the machine needs %2")
+                    .arg(hostCPUs.size()).arg(machine->getCPUCount());
+            return false;
+        }
+        return true;
+    }
+
+    QList<int> CPUs = HostTopology::parseCPUList(machine->getCPUSet());
+    if (CPUs.isEmpty()) {
+        error = tr("The host CPU list '%1' is not valid. Ex: 2-5,8").arg(machine->getCPUSet());
+        return false;
+    }
+
+    foreach (int CPU, CPUs) {
+        if (!hostCPUs.contains(CPU)) {
+            error = tr("The host CPU %1 doesn't exist or is offline").arg(CPU);
+            return false;
+        }
+    }
+
+    return true;
 }
 
 /**
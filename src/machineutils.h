@@ -32,11 +32,14 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QMutableHashIterator>
-#include <QMessageBox>
+#include <QRegularExpression>
 #include <QDebug>
 
 // Local
-#include "utils/systemutils.h"
+#include "utils/errorreporter.h"
+#include "utils/hostutils.h"
+#include "utils/hosttopology.h"
+#include "machineregistry.h"
 
 class Machine; // Forward declaration :'(
 
@@ -48,10 +51,16 @@ class MachineUtils : public QObject {
         ~MachineUtils();
 
         static QJsonObject readMachineFile(QString machinePath);
+        static QJsonObject parseMachineFile(const QString &machinePath, QString &error);
         static void fillMachineObject(Machine *machine,
                                       QJsonObject machineJSON, QString machineConfigPath);
         static bool deleteMachine(const QUuid machineUuid);
 
+        static bool resolveCPUTopology(const int CPUCount, int &sockets, int &cores,
+                                       int &threads, int &maxCPUs, QString &error);
+        static bool checkMemoryBackend(const Machine *machine, QString &error);
+        static bool checkCPUPinning(const Machine *machine, QString &error);
+
         static QStringList getSoundCards(QJsonArray soundCardsArray);
         static QStringList getAccelerators(QJsonArray acceleratorsArray);
         static QStringList getMediaDevices(QJsonArray mediaDevicesArray);
@@ -25,6 +25,7 @@
 #include <QLibraryInfo>
 #include <QDir>
 #include <QCoreApplication>
+#include <QThread>
 
 // C++ standard library
 #include <iostream>
@@ -33,6 +34,8 @@
 #include "mainwindow.h"
 #include "qemu.h"
 #include "utils/logger.h"
+#include "utils/errorreporter.h"
+#include "utils/systemutils.h"
 #include "utils/firstrunwizard.h"
 
 int main(int argc, char *argv[])
@@ -80,6 +83,25 @@ int main(int argc, char *argv[])
     settings.setValue("QtEmuLogs", dataDirectoryLogs);
     settings.endGroup();
 
+    // Errors of the machines are shown in dialogs, always in the main thread
+    ErrorReporter::setHandler([&qtemuApp](const QString &title, const QString &text,
+                                          ErrorReporter::Severity severity) {
+        QMessageBox::Icon severityLevel = QMessageBox::Information;
+        if (severity == ErrorReporter::Warning) {
+            severityLevel = QMessageBox::Warning;
+        } else if (severity == ErrorReporter::Critical) {
+            severityLevel = QMessageBox::Critical;
+        }
+
+        if (QThread::currentThread() == qtemuApp.thread()) {
+            SystemUtils::showMessage(title, text, severityLevel);
+        } else {
+            QMetaObject::invokeMethod(&qtemuApp, [=]() {
+                SystemUtils::showMessage(title, text, severityLevel);
+            }, Qt::QueuedConnection);
+        }
+    });
+
     // Translations
     QTranslator translatorQt;
     QTranslator translatorQtEmu;
@@ -159,5 +181,10 @@ int main(int argc, char *argv[])
     MainWindow qtemuWindow;
     qtemuWindow.show();
 
-    return qtemuApp.exec();
+    int exitCode = qtemuApp.exec();
+
+    // Write the pending messages
+    Logger::shutdown();
+
+    return exitCode;
 }
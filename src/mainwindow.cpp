@@ -22,6 +22,10 @@
 // Local
 #include "mainwindow.h"
 
+// Role of the list items with the load state of the machine.
+// The items without it are loaded
+static const int MACHINE_STATE_ROLE = Qt::UserRole + 1;
+
 /**
  * @brief The main window of the application
  * @param parent, parent widget
@@ -54,6 +58,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     m_osListWidget->setMovement(QListView::Static);
     m_osListWidget->setMaximumWidth(170);
     m_osListWidget->setSpacing(7);
+    m_osListWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
 
     m_machineNameLabel     = new QLabel(this);
     m_machineOsLabel       = new QLabel(this);
@@ -64,8 +69,11 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     m_machineAudioLabel->setWordWrap(true);
     m_machineAccelLabel    = new QLabel(this);
     m_machineNetworkLabel  = new QLabel(this);
+    m_machineNetworkLabel->setWordWrap(true);
     m_machineMediaLabel    = new QLabel(this);
     m_machineMediaLabel->setWordWrap(true);
+    m_machinePlacementLabel = new QLabel(this);
+    m_machinePlacementLabel->setWordWrap(true);
 
     m_machineDetailsLayout = new QFormLayout();
     m_machineDetailsLayout->setSpacing(7);
@@ -81,6 +89,23 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     m_machineDetailsLayout->addRow(tr("Accelerator") + ":", m_machineAccelLabel);
     m_machineDetailsLayout->addRow(tr("Network") + ":", m_machineNetworkLabel);
     m_machineDetailsLayout->addRow(tr("Media") + ":", m_machineMediaLabel);
+    m_machineDetailsLayout->addRow(tr("CPU placement") + ":", m_machinePlacementLabel);
+
+    m_vCPUSparkline = new Sparkline(this);
+    m_vCPUSparkline->setMinimumRange(100);
+    m_stealSparkline = new Sparkline(this);
+    m_stealSparkline->setMinimumRange(10);
+    m_memorySparkline = new Sparkline(this);
+    m_IOPSSparkline = new Sparkline(this);
+    m_IOPSSparkline->setMinimumRange(10);
+    m_throughputSparkline = new Sparkline(this);
+    m_throughputSparkline->setMinimumRange(1024 * 1024);
+
+    m_machineDetailsLayout->addRow(tr("vCPU usage") + ":", m_vCPUSparkline);
+    m_machineDetailsLayout->addRow(tr("vCPU steal") + ":", m_stealSparkline);
+    m_machineDetailsLayout->addRow(tr("Memory usage") + ":", m_memorySparkline);
+    m_machineDetailsLayout->addRow(tr("Disk IOPS") + ":", m_IOPSSparkline);
+    m_machineDetailsLayout->addRow(tr("Disk throughput") + ":", m_throughputSparkline);
 
     m_machineDetailsGroup = new QGroupBox(tr("Machine details"), this);
     m_machineDetailsGroup->setAlignment(Qt::AlignHCenter);
@@ -111,7 +136,57 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     this->createMenus();
     this->createToolBars();
 
+    // Resource usage of the running machines
+    m_metricsSampler = new MetricsSampler(this);
+    connect(m_metricsSampler, &MetricsSampler::machineSampled,
+            this, &MainWindow::machineSampled);
+    connect(m_configWindow, &ConfigWindow::settingsSavedSignal,
+            m_metricsSampler, &MetricsSampler::loadSettings);
+
+    // Metrics for the monitoring systems
+    m_metricsExporter = new MetricsExporter(this);
+    connect(m_metricsSampler, &MetricsSampler::machineSampled,
+            m_metricsExporter, &MetricsExporter::machineSampled);
+    connect(m_configWindow, &ConfigWindow::settingsSavedSignal,
+            m_metricsExporter, &MetricsExporter::loadSettings);
+
+    // Start of several machines without overloading the host
+    m_launchScheduler = new LaunchScheduler(qemuGlobalObject, this);
+    connect(m_launchScheduler, &LaunchScheduler::launchStateChanged,
+            this, &MainWindow::machineLaunchStateChanged);
+    connect(m_launchScheduler, &LaunchScheduler::progressChanged,
+            this, &MainWindow::launchProgressChanged);
+    connect(m_configWindow, &ConfigWindow::settingsSavedSignal,
+            m_launchScheduler, &LaunchScheduler::loadSettings);
+
+    // Control of the machines from scripts
+    m_controlServer = new ControlServer(qemuGlobalObject, this);
+    m_controlServer->setLaunchScheduler(m_launchScheduler);
+    connect(m_configWindow, &ConfigWindow::settingsSavedSignal,
+            m_controlServer, &ControlServer::loadSettings);
+    m_controlServer->loadSettings();
+
+    // Restart of the machines that fail
+    m_machineSupervisor = new MachineSupervisor(qemuGlobalObject, this);
+    connect(m_machineSupervisor, &MachineSupervisor::restartScheduled,
+            this, &MainWindow::machineRestartScheduled);
+    connect(m_machineSupervisor, &MachineSupervisor::restartAbandoned,
+            this, &MainWindow::machineRestartAbandoned);
+
+    // Machines started with QtEmu
+    m_autostartManager = new AutostartManager(m_launchScheduler, this);
+    connect(m_autostartManager, &AutostartManager::bootStateChanged,
+            this, &MainWindow::machineBootStateChanged);
+
     // Load all the machines
+    m_machineLoader = new MachineLoader(this);
+    connect(m_machineLoader, &MachineLoader::machineLoaded,
+            this, &MainWindow::machineLoaded);
+    connect(m_machineLoader, &MachineLoader::machineFailed,
+            this, &MainWindow::machineLoadFailed);
+    connect(m_machineLoader, &MachineLoader::finished,
+            this, &MainWindow::machinesLoaded);
+
     this->m_osListWidget->setCurrentRow(0);
     this->loadMachines();
     this->loadUI(m_osListWidget->count());
@@ -153,7 +228,10 @@ void MainWindow::createMenus()
     m_machineMenu->addAction(m_newMachineAction);
     m_machineMenu->addAction(m_settingsMachineAction);
     m_machineMenu->addAction(m_exportMachineAction);
+    m_machineMenu->addAction(m_cloneMachineAction);
     m_machineMenu->addAction(m_removeMachineAction);
+    m_machineMenu->addSeparator();
+    m_machineMenu->addAction(m_consoleMachineAction);
 
     // Help
     m_helpMenu = new QMenu(tr("&Help"), this);
@@ -229,6 +307,12 @@ void MainWindow::createMenusActions()
     connect(m_exportMachineAction, &QAction::triggered,
             this, &MainWindow::exportMachine);
 
+    m_cloneMachineAction = new QAction(QIcon::fromTheme("edit-copy"),
+                                       tr("Clone machine"),
+                                       this);
+    connect(m_cloneMachineAction, &QAction::triggered,
+            this, &MainWindow::cloneMachine);
+
     m_removeMachineAction = new QAction(QIcon::fromTheme("project-development-close",
                                                          QIcon(QPixmap(":/images/icons/breeze/32x32/project-development-close.svg"))),
                                         tr("Remove Machine"),
@@ -273,6 +357,13 @@ void MainWindow::createMenusActions()
     connect(m_helpAboutAction, &QAction::triggered,
             m_aboutwidget, &QWidget::show);
 
+    m_consoleMachineAction = new QAction(QIcon::fromTheme("utilities-terminal",
+                                                          QIcon(QPixmap(":/images/icons/breeze/32x32/document-properties.svg"))),
+                                         tr("Console"),
+                                         this);
+    connect(m_consoleMachineAction, &QAction::triggered,
+            this, &MainWindow::openMachineConsole);
+
     // Actions for Machine toolbar
     m_startMachineAction = new QAction(this);
     m_startMachineAction->setIcon(QIcon::fromTheme("media-playback-start",
@@ -285,6 +376,8 @@ void MainWindow::createMenusActions()
     m_stopMachineAction->setIcon(QIcon::fromTheme("media-playback-stop",
                                                   QIcon(QPixmap(":/images/icons/breeze/32x32/stop.svg"))));
     m_stopMachineAction->setToolTip(tr("Stop machine"));
+    connect(m_stopMachineAction, &QAction::triggered,
+            this, &MainWindow::stopMachine);
 
     m_resetMachineAction = new QAction(this);
     m_resetMachineAction->setIcon(QIcon::fromTheme("chronometer-reset",
@@ -416,83 +509,271 @@ void MainWindow::quitApp()
 /**
  * @brief Load created machines
  *
- * Load all the machines stored in the qtemu.json file on config data folder
+ * Load all the machines stored in the machines registry on config data folder.
+ * The list is filled with the data of the registry and the config
+ * files of the machines are parsed in the background
  */
 void MainWindow::loadMachines()
 {
-    QSettings settings;
-    settings.beginGroup("DataFolder");
-    QString dataDirectoryPath = settings.value("QtEmuData",
-                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
-    settings.endGroup();
-
-    // Open the file with the machines
-    QString qtemuConfig = dataDirectoryPath.append("qtemu.json");
-    QFile machinesFile(qtemuConfig);
-    // If file don't exists I asume that there's no machines
-    if (!machinesFile.exists()) {
-        return;
-    }
-
-    if (!machinesFile.open(QIODevice::ReadOnly)) {        
+    QString error;
+    if (!MachineRegistry::instance()->load(error)) {
         SystemUtils::showMessage(tr("QtEmu - Critical error"),
                                  tr("<p><strong>Cannot load the saved machines</strong></p>"
-                                    "<p>Cannot open the <strong>qtemu.json</strong> file. "
-                                    "The saved machines cannot be loaded. "
-                                    "Please ensure that the file exists and it's readable</p>"),
+                                    "<p>Cannot read the <strong>qtemu.json</strong> file. "
+                                    "Please ensure that the file exists and it's readable</p>"
+                                    "<p>%1</p>").arg(error),
                                  QMessageBox::Critical);
-        return;
     }
 
-    // Read all data included in the file
-    QByteArray machinesData = machinesFile.readAll();
-    QJsonDocument machinesDocument(QJsonDocument::fromJson(machinesData));
-    QJsonArray machines = machinesDocument["machines"].toArray();
+    QList<QJsonObject> machines = MachineRegistry::instance()->machines();
     for (int i = 0; i < machines.size(); ++i) {
-        this->generateMachineObject(machines[i].toObject(), i);
-    }
+        QString machineName = machines[i]["name"].toString();
+        if (machineName.isEmpty()) {
+            machineName = QFileInfo(machines[i]["configpath"].toString()).completeBaseName();
+        }
 
-    if (machinesFile.isOpen()) {
-        machinesFile.close();
+        QListWidgetItem *machineListItem = new QListWidgetItem(machineName, this->m_osListWidget);
+        machineListItem->setData(QMetaType::QUuid, machines[i]["uuid"].toString());
+        machineListItem->setData(MACHINE_STATE_ROLE, MainWindow::ItemLoading);
+        machineListItem->setIcon(QIcon(":/images/os/64x64/" +
+                                       SystemUtils::getOsIcon(machines[i]["icon"].toString())));
+        machineListItem->setToolTip(tr("Loading..."));
+
+        // To prevent undefined behavior :'(
+        if (i == 0) {
+            this->m_osListWidget->setCurrentItem(machineListItem);
+        }
     }
+
+    this->m_machineLoader->loadMachines(machines);
 }
 
 /**
- * @brief Generate the machine object for the list
- * @param machineConfigJsonObject, JSON with the machine configpath, icon, path and uuid
- * @param pos, pos of the machine in the list
- * @return machine object
+ * @brief The config of a machine is loaded
+ * @param machineUuid, uuid of the machine
+ * @param machineJSON, data of the machine
+ * @param machineConfigPath, path of the config file
  *
- * Generate the machine object for the list
+ * Generate the machine object and update its item of the list
  */
-void MainWindow::generateMachineObject(const QJsonObject machineConfigJsonObject, int pos)
+void MainWindow::machineLoaded(const QUuid &machineUuid, const QJsonObject &machineJSON,
+                               const QString &machineConfigPath)
 {
-    QString machineConfigPath = machineConfigJsonObject["configpath"].toString();
-    QJsonObject machineJSON = MachineUtils::readMachineFile(machineConfigPath);
-
-    if (machineJSON.isEmpty()) {
+    QListWidgetItem *machineListItem = this->findMachineItem(machineUuid);
+    if (machineListItem == nullptr) {
         return;
     }
 
-    QListWidgetItem *machineListItem = new QListWidgetItem(machineJSON["name"].toString(), this->m_osListWidget);
-    machineListItem->setData(QMetaType::QUuid, machineJSON["uuid"].toString());
-    machineListItem->setIcon(QIcon(":/images/os/64x64/" +
-                                   SystemUtils::getOsIcon(machineConfigJsonObject["icon"].toString())));
-
-    // To prevent undefined behavior :'(
-    if (pos == 0) {
-        this->m_osListWidget->setCurrentItem(machineListItem);
-    }
-
     Machine *machine = new Machine(this);
-    connect(machine, &Machine::machineStateChangedSignal,
-            this, &MainWindow::machineStateChanged);
+    this->registerMachine(machine);
 
     MachineUtils::fillMachineObject(machine,
                                     machineJSON,
                                     machineConfigPath);
 
     this->m_machinesList.append(machine);
+
+    machineListItem->setText(machine->getName());
+    machineListItem->setData(MACHINE_STATE_ROLE, MainWindow::ItemLoaded);
+    machineListItem->setToolTip(QString());
+
+    // Machines registered by older versions don't have the name
+    QJsonObject registryMachine = MachineRegistry::instance()->machine(machineUuid);
+    if (registryMachine["name"].toString() != machine->getName()) {
+        QJsonObject nameUpdate;
+        nameUpdate["uuid"] = machineUuid.toString();
+        nameUpdate["name"] = machine->getName();
+
+        QString error;
+        MachineRegistry::instance()->updateMachine(nameUpdate, error);
+    }
+
+    if (machineListItem == this->m_osListWidget->currentItem()) {
+        this->loadUI(this->m_osListWidget->count());
+    }
+}
+
+/**
+ * @brief Register a machine
+ * @param machine, machine
+ *
+ * Follow the state of the machine and add it to the
+ * metrics, the control server, the supervisor and the
+ * autostart. The machines of the wizards are registered
+ * when the wizard finishes
+ */
+void MainWindow::registerMachine(Machine *machine)
+{
+    connect(machine, &Machine::machineStateChangedSignal,
+            this, &MainWindow::machineStateChanged);
+    connect(machine, &Machine::machineCPUPlacementChangedSignal,
+            this, &MainWindow::machineCPUPlacementChanged);
+    connect(machine, &Machine::machineConsoleNotificationSignal,
+            this, &MainWindow::machineConsoleNotification);
+    this->m_metricsSampler->addMachine(machine);
+    this->m_metricsExporter->addMachine(machine);
+    this->m_controlServer->addMachine(machine);
+    this->m_machineSupervisor->addMachine(machine);
+    this->m_autostartManager->addMachine(machine);
+}
+
+/**
+ * @brief The config of a machine cannot be loaded
+ * @param machineUuid, uuid of the machine
+ * @param error, description of the problem
+ *
+ * Show the error in the item of the machine.
+ * The machine can only be removed
+ */
+void MainWindow::machineLoadFailed(const QUuid &machineUuid, const QString &error)
+{
+    QListWidgetItem *machineListItem = this->findMachineItem(machineUuid);
+    if (machineListItem == nullptr) {
+        return;
+    }
+
+    machineListItem->setData(MACHINE_STATE_ROLE, MainWindow::ItemFailed);
+    machineListItem->setIcon(QIcon::fromTheme("dialog-error",
+                                              QIcon(":/images/os/64x64/" + SystemUtils::getOsIcon(""))));
+    machineListItem->setForeground(this->palette().brush(QPalette::Disabled, QPalette::Text));
+    machineListItem->setToolTip(tr("Cannot load the machine: %1").arg(error));
+
+    if (machineListItem == this->m_osListWidget->currentItem()) {
+        this->loadUI(this->m_osListWidget->count());
+    }
+}
+
+/**
+ * @brief All the machines are loaded
+ *
+ * Start the autostart machines, unless another
+ * QtEmu process owns the machines
+ */
+void MainWindow::machinesLoaded()
+{
+    disconnect(m_machineLoader, &MachineLoader::finished,
+               this, &MainWindow::machinesLoaded);
+
+    if (!this->m_controlServer->isListening() && ControlServer::serverRunning()) {
+        return;
+    }
+
+    this->m_autostartManager->start();
+}
+
+/**
+ * @brief State of an autostart machine changed
+ * @param machineUuid, uuid of the machine
+ * @param state, state of the machine
+ * @param message, description of the state
+ *
+ * Show the machines that are waiting for the guest
+ * and the ones that cannot be started
+ */
+void MainWindow::machineBootStateChanged(const QUuid machineUuid,
+                                         AutostartManager::BootStates state,
+                                         const QString &message)
+{
+    QListWidgetItem *machineListItem = this->findMachineItem(machineUuid);
+    if (machineListItem == nullptr ||
+        machineListItem->data(MACHINE_STATE_ROLE).toInt() != MainWindow::ItemLoaded) {
+        return;
+    }
+
+    if (state == AutostartManager::Probing) {
+        machineListItem->setToolTip(message);
+    } else if (state == AutostartManager::Failed || state == AutostartManager::Skipped) {
+        machineListItem->setToolTip(tr("Autostart failed: %1").arg(message));
+        this->statusBar()->showMessage(machineListItem->text() + " - " + machineListItem->toolTip(), 10000);
+    } else if (state == AutostartManager::Ready) {
+        machineListItem->setToolTip(QString());
+    }
+}
+
+/**
+ * @brief The restart of a machine is scheduled
+ * @param machineUuid, uuid of the machine
+ * @param attempt, restarts in a row
+ * @param delay, time until the restart in milliseconds
+ * @param cause, why QEMU finished
+ *
+ * Show when a machine that failed will be restarted
+ */
+void MainWindow::machineRestartScheduled(const QUuid machineUuid, int attempt, int delay,
+                                         const QString &cause)
+{
+    QListWidgetItem *machineListItem = this->findMachineItem(machineUuid);
+    if (machineListItem == nullptr) {
+        return;
+    }
+
+    this->statusBar()->showMessage(machineListItem->text() + " - " +
+                                   tr("Restart %1 in %2 s (%3)")
+                                   .arg(attempt).arg(delay / 1000.0, 0, 'f', 1).arg(cause), 10000);
+}
+
+/**
+ * @brief A machine isn't restarted anymore
+ * @param machineUuid, uuid of the machine
+ * @param restarts, restarts in a row
+ * @param cause, why QEMU finished
+ *
+ * Show that the restart limit of a machine is reached
+ */
+void MainWindow::machineRestartAbandoned(const QUuid machineUuid, int restarts, const QString &cause)
+{
+    QListWidgetItem *machineListItem = this->findMachineItem(machineUuid);
+    if (machineListItem == nullptr) {
+        return;
+    }
+
+    machineListItem->setToolTip(tr("Not restarted after %1 restarts (%2)").arg(restarts).arg(cause));
+    this->statusBar()->showMessage(machineListItem->text() + " - " + machineListItem->toolTip());
+}
+
+/**
+ * @brief Find the item of a machine
+ * @param machineUuid, uuid of the machine
+ * @return item of the list, nullptr if the machine isn't in the list
+ *
+ * Find the item of a machine in the list
+ */
+QListWidgetItem *MainWindow::findMachineItem(const QUuid &machineUuid)
+{
+    for (int i = 0; i < this->m_osListWidget->count(); ++i) {
+        QListWidgetItem *machineListItem = this->m_osListWidget->item(i);
+        if (machineListItem->data(QMetaType::QUuid).toUuid() == machineUuid) {
+            return machineListItem;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Show the state of a machine that isn't loaded
+ * @param machineItem, machine item of the list
+ *
+ * Disable the machine actions and show if the machine
+ * is being loaded or cannot be loaded
+ */
+void MainWindow::showMachineItemState(QListWidgetItem *machineItem)
+{
+    bool machineFailed = machineItem->data(MACHINE_STATE_ROLE).toInt() == MainWindow::ItemFailed;
+
+    this->m_startMachineAction->setEnabled(false);
+    this->m_stopMachineAction->setEnabled(false);
+    this->m_resetMachineAction->setEnabled(false);
+    this->m_pauseMachineAction->setEnabled(false);
+    this->m_settingsMachineAction->setEnabled(false);
+    this->m_exportMachineAction->setEnabled(false);
+    this->m_cloneMachineAction->setEnabled(false);
+    this->m_consoleMachineAction->setEnabled(false);
+    this->m_removeMachineAction->setEnabled(machineFailed);
+
+    this->emptyMachineDetailsSection();
+    this->m_machineNameLabel->setText(machineItem->text());
+    this->m_machineOsLabel->setText(machineItem->toolTip());
 }
 
 /**
@@ -511,18 +792,21 @@ void MainWindow::createNewMachine()
     m_machine->setMaxHotCPU(0);
     m_machine->setState(Machine::Stopped);
 
-    connect(m_machine, &Machine::machineStateChangedSignal,
-            this, &MainWindow::machineStateChanged);
-
     MachineWizard newMachineWizard(m_machine, this->m_osListWidget, this->qemuGlobalObject, this);
 
     newMachineWizard.show();
     newMachineWizard.exec();
 
-    if (!m_machine->getUuid().isNull()) {
-        m_machinesList.append(m_machine);
-        this->loadUI(this->m_osListWidget->count());
+    // The wizard is cancelled
+    if (m_machine->getUuid().isNull()) {
+        delete m_machine;
+        m_machine = nullptr;
+        return;
     }
+
+    this->registerMachine(m_machine);
+    m_machinesList.append(m_machine);
+    this->loadUI(this->m_osListWidget->count());
 }
 
 /**
@@ -535,12 +819,27 @@ void MainWindow::deleteMachine()
     QUuid machineUuid = this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid();
     bool isMachineDeleted = MachineUtils::deleteMachine(machineUuid);
     if (isMachineDeleted) {
-        this->m_osListWidget->takeItem(this->m_osListWidget->currentRow());
+        this->m_metricsSampler->removeMachine(machineUuid);
+        this->m_metricsExporter->removeMachine(machineUuid);
+        this->m_controlServer->removeMachine(machineUuid);
+        // A machine waiting to be restarted or started must not be started again
+        this->m_machineSupervisor->removeMachine(machineUuid);
+        this->m_launchScheduler->cancel(machineUuid);
+        this->m_autostartManager->removeMachine(machineUuid);
+        delete this->m_osListWidget->takeItem(this->m_osListWidget->currentRow());
+
+        QPointer<ConsoleWindow> consoleWindow = this->m_consoleWindows.take(machineUuid);
+        if (!consoleWindow.isNull()) {
+            consoleWindow->deleteLater();
+        }
+
         bool machineRemovedList = false;
         QMutableListIterator<Machine*> machines(this->m_machinesList);
         while (machines.hasNext() && !machineRemovedList) {
-            if (machines.next()->getUuid() == machineUuid) {
+            Machine *machine = machines.next();
+            if (machine->getUuid() == machineUuid) {
                 machines.remove();
+                machine->deleteLater();
                 machineRemovedList = true;
             }
         }
@@ -575,6 +874,57 @@ void MainWindow::machineOptions()
             this, &MainWindow::updateMachineDetailsConfig);
 }
 
+/**
+ * @brief Open the console of the selected machine
+ *
+ * Open the window with the output of QEMU for the selected
+ * machine. If it's already open, it's brought to the front
+ */
+void MainWindow::openMachineConsole()
+{
+    QUuid machineUuid = this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid();
+
+    QPointer<ConsoleWindow> consoleWindow = this->m_consoleWindows.value(machineUuid);
+    if (consoleWindow.isNull()) {
+        foreach (Machine *machine, this->m_machinesList) {
+            if (machine->getUuid() == machineUuid){
+                consoleWindow = new ConsoleWindow(machine, this);
+                this->m_consoleWindows.insert(machineUuid, consoleWindow);
+                break;
+            }
+        }
+    }
+
+    if (consoleWindow.isNull()) {
+        return;
+    }
+
+    consoleWindow->show();
+    consoleWindow->raise();
+    consoleWindow->activateWindow();
+}
+
+/**
+ * @brief Show an error of QEMU
+ * @param machineUuid, uuid of the machine
+ * @param message, error of QEMU
+ *
+ * Show an error of QEMU in the status bar,
+ * without interrupting the user
+ */
+void MainWindow::machineConsoleNotification(const QUuid machineUuid, const QString &message)
+{
+    QString machineName;
+    foreach (Machine *machine, this->m_machinesList) {
+        if (machine->getUuid() == machineUuid){
+            machineName = machine->getName();
+            break;
+        }
+    }
+
+    this->statusBar()->showMessage(machineName + " - " + message, 10000);
+}
+
 /**
  * @brief Export the selected machine
  *
@@ -605,6 +955,44 @@ void MainWindow::exportMachine()
     }
 }
 
+/**
+ * @brief Clone the selected machine
+ *
+ * Open the wizard to create a full or a linked
+ * clone of the selected machine
+ */
+void MainWindow::cloneMachine()
+{
+    QUuid machineUuid = this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid();
+    Machine *sourceMachine = nullptr;
+    foreach (Machine *machine, this->m_machinesList) {
+        if (machine->getUuid() == machineUuid){
+            sourceMachine = machine;
+            break;
+        }
+    }
+
+    if (sourceMachine == nullptr) {
+        return;
+    }
+
+    Machine *machine = new Machine(this);
+
+    CloneWizard cloneWizard(sourceMachine, machine, this->qemuGlobalObject, this->m_osListWidget, this);
+
+    cloneWizard.show();
+    cloneWizard.exec();
+
+    if (machine->getUuid().isNull()) {
+        delete machine;
+        return;
+    } else {
+        this->registerMachine(machine);
+        this->m_machinesList.append(machine);
+        this->loadUI(this->m_osListWidget->count());
+    }
+}
+
 /**
  * @brief Import machine wizard
  *
@@ -613,8 +1001,6 @@ void MainWindow::exportMachine()
 void MainWindow::importMachine()
 {
     Machine *machine = new Machine(this);
-    connect(machine, &Machine::machineStateChangedSignal,
-            this, &MainWindow::machineStateChanged);
 
     ImportWizard importWizard(machine, this->m_osListWidget, this);
 
@@ -625,45 +1011,60 @@ void MainWindow::importMachine()
         delete machine;
         return;
     } else {
+        this->registerMachine(machine);
         this->m_machinesList.append(machine);
         this->loadUI(this->m_osListWidget->count());
     }
 }
 
 /**
- * @brief Start the selected machine
+ * @brief Start the selected machines
  *
- * Start the selected machine
+ * Start the selected machines through the launch
+ * scheduler, in the order of the list
  */
 void MainWindow::runMachine()
 {
-    QUuid machineUuid = this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid();
-    foreach (Machine *machine, this->m_machinesList) {
-        if (machine->getUuid() == machineUuid){
-            machine->runMachine(this->qemuGlobalObject);
-            break;
+    foreach (Machine *machine, this->selectedMachines()) {
+        if (machine->getState() == Machine::Stopped) {
+            this->m_launchScheduler->enqueue(machine);
         }
     }
 }
 
 /**
- * @brief Reset the selected machine
+ * @brief Stop the selected machines
  *
- * Reset the selected machine
+ * Stop the selected machines
+ */
+void MainWindow::stopMachine()
+{
+    foreach (Machine *machine, this->selectedMachines()) {
+        // A machine that is already starting is stopped like a running machine
+        if (!this->m_launchScheduler->cancel(machine->getUuid()) &&
+            !this->m_machineSupervisor->cancelRestart(machine->getUuid()) &&
+            machine->getState() != Machine::Stopped) {
+            machine->stopMachine();
+        }
+    }
+}
+
+/**
+ * @brief Reset the selected machines
+ *
+ * Reset the selected machines
  */
 void MainWindow::resetMachine()
 {
-    QUuid machineUuid = this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid();
-    foreach (Machine *machine, this->m_machinesList) {
-        if (machine->getUuid() == machineUuid){
+    foreach (Machine *machine, this->selectedMachines()) {
+        if (machine->getState() != Machine::Stopped) {
             machine->resetMachine();
-            break;
         }
     }
 }
 
 /**
- * @brief Pause or continue the selected machine
+ * @brief Pause or continue the selected machines
  *
  * If the State of the machine is Started, then
  * pause the machine.
@@ -672,13 +1073,87 @@ void MainWindow::resetMachine()
  */
 void MainWindow::pauseMachine()
 {
-    QUuid machineUuid = this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid();
-    foreach (Machine *machine, this->m_machinesList) {
-        if (machine->getUuid() == machineUuid){
-            machine->pauseMachine();
-            break;
+    foreach (Machine *machine, this->selectedMachines()) {
+        machine->pauseMachine();
+    }
+}
+
+/**
+ * @brief Get the selected machines
+ * @return loaded machines selected in the list, in the order of the list
+ *
+ * Get the selected machines
+ */
+QList<Machine *> MainWindow::selectedMachines()
+{
+    QList<Machine *> machines;
+
+    for (int i = 0; i < this->m_osListWidget->count(); ++i) {
+        QListWidgetItem *machineListItem = this->m_osListWidget->item(i);
+        if (!machineListItem->isSelected()) {
+            continue;
+        }
+
+        QUuid machineUuid = machineListItem->data(QMetaType::QUuid).toUuid();
+        foreach (Machine *machine, this->m_machinesList) {
+            if (machine->getUuid() == machineUuid) {
+                machines.append(machine);
+                break;
+            }
         }
     }
+
+    return machines;
+}
+
+/**
+ * @brief State of the launch of a machine changed
+ * @param machineUuid, uuid of the machine
+ * @param state, state of the launch
+ * @param message, description of the state
+ *
+ * Show why a machine is waiting or cannot be started
+ * in the tooltip of the machine
+ */
+void MainWindow::machineLaunchStateChanged(const QUuid machineUuid,
+                                           LaunchScheduler::LaunchStates state,
+                                           const QString &message)
+{
+    QListWidgetItem *machineListItem = this->findMachineItem(machineUuid);
+    if (machineListItem == nullptr ||
+        machineListItem->data(MACHINE_STATE_ROLE).toInt() != MainWindow::ItemLoaded) {
+        return;
+    }
+
+    if (state == LaunchScheduler::Waiting) {
+        machineListItem->setToolTip(message);
+    } else if (state == LaunchScheduler::Failed) {
+        machineListItem->setToolTip(tr("Cannot be started: %1").arg(message));
+        this->statusBar()->showMessage(machineListItem->text() + " - " + machineListItem->toolTip(), 10000);
+    } else {
+        machineListItem->setToolTip(QString());
+    }
+}
+
+/**
+ * @brief Progress of the launch scheduler
+ * @param finishedLaunches, machines started, failed or cancelled
+ * @param totalLaunches, machines added to the queue
+ *
+ * Show the progress when several machines are started
+ */
+void MainWindow::launchProgressChanged(int finishedLaunches, int totalLaunches)
+{
+    if (totalLaunches < 2) {
+        return;
+    }
+
+    if (finishedLaunches < totalLaunches) {
+        this->statusBar()->showMessage(tr("Starting machines: %1 of %2")
+                                       .arg(finishedLaunches).arg(totalLaunches));
+    } else {
+        this->statusBar()->showMessage(tr("%1 machines processed").arg(totalLaunches), 10000);
+    }
 }
 
 /**
@@ -701,15 +1176,24 @@ void MainWindow::loadUI(const int machineCount)
         this->m_pauseMachineAction->setEnabled(false);
         this->m_settingsMachineAction->setEnabled(false);
         this->m_exportMachineAction->setEnabled(false);
+        this->m_cloneMachineAction->setEnabled(false);
+        this->m_consoleMachineAction->setEnabled(false);
         this->m_removeMachineAction->setEnabled(false);
 
         this->emptyMachineDetailsSection();
     } else {
+        if (this->m_osListWidget->currentItem()->data(MACHINE_STATE_ROLE).toInt() != MainWindow::ItemLoaded) {
+            this->showMachineItemState(this->m_osListWidget->currentItem());
+            return;
+        }
+
         QUuid machineUuid = this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid();
         foreach (Machine *machine, this->m_machinesList) {
             if (machine->getUuid() == machineUuid){
                 this->m_settingsMachineAction->setEnabled(true);
                 this->m_exportMachineAction->setEnabled(true);
+                this->m_cloneMachineAction->setEnabled(true);
+                this->m_consoleMachineAction->setEnabled(true);
                 this->m_removeMachineAction->setEnabled(true);
                 this->controlMachineActions(machine->getState());
                 this->fillMachineDetailsSection(machine);
@@ -728,6 +1212,11 @@ void MainWindow::loadUI(const int machineCount)
  */
 void MainWindow::changeMachine(QListWidgetItem *machineItem)
 {
+    if (machineItem->data(MACHINE_STATE_ROLE).toInt() != MainWindow::ItemLoaded) {
+        this->showMachineItemState(machineItem);
+        return;
+    }
+
     QUuid machineUuid = machineItem->data(QMetaType::QUuid).toUuid();
     foreach (Machine *machine, this->m_machinesList) {
         if (machine->getUuid() == machineUuid) {
@@ -753,7 +1242,7 @@ void MainWindow::fillMachineDetailsSection(Machine *machine)
     this->m_machineGraphicsLabel->setText(machine->getGPUType());
     this->m_machineAudioLabel->setText(machine->getAudioLabel());
     this->m_machineAccelLabel->setText(machine->getAcceleratorLabel());
-    this->m_machineNetworkLabel->setText(machine->getUseNetwork() == true ? tr("Yes") : tr("no"));
+    this->m_machineNetworkLabel->setText(machine->getNetworkLabel());
     QString mediaLabel;
     for (int i = 0; i < machine->getMedia().size(); ++i) {
          mediaLabel.append("(")
@@ -763,6 +1252,77 @@ void MainWindow::fillMachineDetailsSection(Machine *machine)
                    .append("\n");
     }
     this->m_machineMediaLabel->setText(mediaLabel);
+    this->m_machinePlacementLabel->setText(machine->getCPUPlacementLabel());
+    this->fillMachineMetricsSection(machine);
+}
+
+/**
+ * @brief Fill the resource usage of the machine
+ * @param machine, machine with the samples
+ *
+ * Fill the charts with the last samples of the machine
+ */
+void MainWindow::fillMachineMetricsSection(Machine *machine)
+{
+    MetricsSeries *metrics = machine->getMetrics();
+    if (metrics->isEmpty() || machine->getState() == Machine::Stopped) {
+        this->m_vCPUSparkline->clear();
+        this->m_stealSparkline->clear();
+        this->m_memorySparkline->clear();
+        this->m_IOPSSparkline->clear();
+        this->m_throughputSparkline->clear();
+        return;
+    }
+
+    QVector<double> vCPUValues;
+    QVector<double> stealValues;
+    QVector<double> memoryValues;
+    QVector<double> IOPSValues;
+    QVector<double> throughputValues;
+    for (int i = 0; i < metrics->size(); ++i) {
+        const MetricsSample &sample = metrics->at(i);
+        vCPUValues.append(sample.vCPUUsage);
+        stealValues.append(sample.vCPUSteal);
+        memoryValues.append(sample.residentMemory);
+        IOPSValues.append(sample.readOperations + sample.writeOperations);
+        throughputValues.append(sample.readBytes + sample.writeBytes);
+    }
+
+    const MetricsSample &lastSample = metrics->last();
+    QLocale locale;
+
+    this->m_vCPUSparkline->setValues(vCPUValues, metrics->capacity());
+    this->m_vCPUSparkline->setText(QString::number(lastSample.vCPUUsage, 'f', 1) + " %");
+    this->m_stealSparkline->setValues(stealValues, metrics->capacity());
+    this->m_stealSparkline->setText(QString::number(lastSample.vCPUSteal, 'f', 1) + " %");
+    this->m_memorySparkline->setValues(memoryValues, metrics->capacity());
+    this->m_memorySparkline->setText(locale.formattedDataSize(lastSample.residentMemory));
+    this->m_IOPSSparkline->setValues(IOPSValues, metrics->capacity());
+    this->m_IOPSSparkline->setText(QString::number(lastSample.readOperations + lastSample.writeOperations, 'f', 0));
+    this->m_throughputSparkline->setValues(throughputValues, metrics->capacity());
+    this->m_throughputSparkline->setText(
+                locale.formattedDataSize(static_cast<qint64>(lastSample.readBytes + lastSample.writeBytes)) + "/s");
+}
+
+/**
+ * @brief A machine is sampled
+ * @param machineUuid, uuid of the machine
+ *
+ * Update the charts if the machine is selected
+ */
+void MainWindow::machineSampled(const QUuid machineUuid)
+{
+    QListWidgetItem *currentItem = this->m_osListWidget->currentItem();
+    if (currentItem == nullptr || currentItem->data(QMetaType::QUuid).toUuid() != machineUuid) {
+        return;
+    }
+
+    foreach (Machine *machine, this->m_machinesList) {
+        if (machine->getUuid() == machineUuid){
+            this->fillMachineMetricsSection(machine);
+            break;
+        }
+    }
 }
 
 /**
@@ -782,6 +1342,12 @@ void MainWindow::emptyMachineDetailsSection()
     this->m_machineAccelLabel->setText("");
     this->m_machineNetworkLabel->setText("");
     this->m_machineMediaLabel->setText("");
+    this->m_machinePlacementLabel->setText("");
+    this->m_vCPUSparkline->clear();
+    this->m_stealSparkline->clear();
+    this->m_memorySparkline->clear();
+    this->m_IOPSSparkline->clear();
+    this->m_throughputSparkline->clear();
 }
 
 /**
@@ -850,3 +1416,20 @@ void MainWindow::updateMachineDetailsConfig(const QUuid machineUuid)
         }
     }
 }
+
+/**
+ * @brief Update the CPU placement of a machine
+ * @param machineUuid, uuid of the machine
+ *
+ * Update the machine details when the threads
+ * of the selected machine are pinned or released
+ */
+void MainWindow::machineCPUPlacementChanged(const QUuid machineUuid)
+{
+    if (this->m_osListWidget->currentItem() == nullptr ||
+        this->m_osListWidget->currentItem()->data(QMetaType::QUuid).toUuid() != machineUuid) {
+        return;
+    }
+
+    this->updateMachineDetailsConfig(machineUuid);
+}
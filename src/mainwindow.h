@@ -41,13 +41,25 @@
 #include <QStackedWidget>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QProcess>
 #include <QMessageBox>
+#include <QStatusBar>
+#include <QPointer>
 
 // Local
 #include "machine.h"
 #include "machineutils.h"
+#include "machineloader.h"
+#include "metricssampler.h"
+#include "metricsexporter.h"
+#include "controlserver.h"
+#include "launchscheduler.h"
+#include "autostartmanager.h"
+#include "machinesupervisor.h"
+#include "components/sparkline.h"
 #include "machineconfig/machineconfigwindow.h"
+#include "consolewindow.h"
 #include "helpwidget.h"
 #include "aboutwidget.h"
 #include "configwindow.h"
@@ -55,6 +67,7 @@
 #include "qemu.h"
 #include "export-import/export.h"
 #include "export-import/import.h"
+#include "utils/clonewizard.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -78,8 +91,10 @@ class MainWindow : public QMainWindow {
         void createNewMachine();
         void machineOptions();
         void exportMachine();
+        void cloneMachine();
         void importMachine();
         void runMachine();
+        void stopMachine();
         void resetMachine();
         void pauseMachine();
         void deleteMachine();
@@ -88,10 +103,32 @@ class MainWindow : public QMainWindow {
         void machineStateChanged(Machine::States newState);
         void machinesMenu(const QPoint &pos);
         void updateMachineDetailsConfig(const QUuid machineUuid);
+        void machineCPUPlacementChanged(const QUuid machineUuid);
+        void machineLoaded(const QUuid &machineUuid, const QJsonObject &machineJSON,
+                           const QString &machineConfigPath);
+        void machineLoadFailed(const QUuid &machineUuid, const QString &error);
+        void machinesLoaded();
+        void machineBootStateChanged(const QUuid machineUuid,
+                                     AutostartManager::BootStates state,
+                                     const QString &message);
+        void machineRestartScheduled(const QUuid machineUuid, int attempt, int delay,
+                                     const QString &cause);
+        void machineRestartAbandoned(const QUuid machineUuid, int restarts, const QString &cause);
+        void openMachineConsole();
+        void machineConsoleNotification(const QUuid machineUuid, const QString &message);
+        void machineSampled(const QUuid machineUuid);
+        void machineLaunchStateChanged(const QUuid machineUuid,
+                                       LaunchScheduler::LaunchStates state,
+                                       const QString &message);
+        void launchProgressChanged(int finishedLaunches, int totalLaunches);
 
     protected:
 
     private:
+        enum MachineItemStates {
+            ItemLoaded, ItemLoading, ItemFailed
+        };
+
         // Start menus
         QMenu *m_fileMenu;
         QMenu *m_machineMenu;
@@ -105,8 +142,10 @@ class MainWindow : public QMainWindow {
         QAction *m_addMachineAction;
         QAction *m_settingsMachineAction;
         QAction *m_exportMachineAction;
+        QAction *m_cloneMachineAction;
         QAction *m_importMachineAction;
         QAction *m_removeMachineAction;
+        QAction *m_consoleMachineAction;
         QAction *m_groupMachineAction;
 
         QAction *m_helpQuickHelpAction;
@@ -130,6 +169,7 @@ class MainWindow : public QMainWindow {
         ConfigWindow *m_configWindow;
         HelpWidget *m_helpwidget;
         AboutWidget *m_aboutwidget;
+        QHash<QUuid, QPointer<ConsoleWindow>> m_consoleWindows;
 
         // Layouts
         QVBoxLayout *m_mainLayout;
@@ -146,6 +186,13 @@ class MainWindow : public QMainWindow {
         QListWidget *m_osListWidget;
         QStackedWidget *m_osDetailsStackedWidget;
         QList<Machine *> m_machinesList;
+        MachineLoader *m_machineLoader;
+        MetricsSampler *m_metricsSampler;
+        MetricsExporter *m_metricsExporter;
+        ControlServer *m_controlServer;
+        LaunchScheduler *m_launchScheduler;
+        AutostartManager *m_autostartManager;
+        MachineSupervisor *m_machineSupervisor;
 
         // Machine
         Machine *m_machine;
@@ -160,16 +207,28 @@ class MainWindow : public QMainWindow {
         QLabel *m_machineAccelLabel;
         QLabel *m_machineNetworkLabel;
         QLabel *m_machineMediaLabel;
+        QLabel *m_machinePlacementLabel;
+
+        // Resource usage
+        Sparkline *m_vCPUSparkline;
+        Sparkline *m_stealSparkline;
+        Sparkline *m_memorySparkline;
+        Sparkline *m_IOPSSparkline;
+        Sparkline *m_throughputSparkline;
 
         // QEMU
         QEMU *qemuGlobalObject;
 
         // Methods
-        void generateMachineObject(const QJsonObject machinesConfigJsonObject, int pos);
         void loadMachines();
+        QListWidgetItem *findMachineItem(const QUuid &machineUuid);
+        void registerMachine(Machine *machine);
+        QList<Machine *> selectedMachines();
+        void showMachineItemState(QListWidgetItem *machineItem);
         void controlMachineActions(Machine::States state);
         void fillMachineDetailsSection(Machine *machine);
         void emptyMachineDetailsSection();
+        void fillMachineMetricsSection(Machine *machine);
 
 };
 #endif // MAINWINDOW_H
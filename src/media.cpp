@@ -28,6 +28,12 @@
  */
 Media::Media(QObject *parent) : QObject(parent)
 {
+    this->m_size = 0;
+    this->m_cache = "writeback";
+    this->m_IO = "threads";
+    this->m_discard = false;
+    this->m_bus = "ide";
+
     qDebug() << "Media object created";
 }
 
@@ -217,6 +223,112 @@ void Media::setIO(const QString &IO)
     m_IO = IO;
 }
 
+/**
+ * @brief Get if the discard requests are passed to the host
+ * @return true if discard is enabled
+ *
+ * Get if the discard (TRIM) requests of the guest
+ * are passed to the image
+ */
+bool Media::discard() const
+{
+    return m_discard;
+}
+
+/**
+ * @brief Set if the discard requests are passed to the host
+ * @param discard, true to enable discard
+ *
+ * Set if the discard requests are passed to the host
+ */
+void Media::setDiscard(bool discard)
+{
+    m_discard = discard;
+}
+
+/**
+ * @brief Get the bus of the media
+ * @return bus of the media
+ *
+ * Get the bus where the media is connected
+ * Ex: ide, virtio, scsi...
+ */
+QString Media::bus() const
+{
+    return m_bus;
+}
+
+/**
+ * @brief Set the bus of the media
+ * @param bus, new bus
+ *
+ * Set the bus of the media
+ */
+void Media::setBus(const QString &bus)
+{
+    m_bus = bus;
+}
+
+/**
+ * @brief Get the IOThread of the media
+ * @return id of the IOThread, empty if automatic
+ *
+ * Get the IOThread that services the media.
+ * If empty, the IOThreads of the machine are
+ * assigned in round-robin
+ */
+QString Media::IOThread() const
+{
+    return m_IOThread;
+}
+
+/**
+ * @brief Set the IOThread of the media
+ * @param IOThread, id of the IOThread. Ex: iothread0
+ *
+ * Set the IOThread of the media
+ */
+void Media::setIOThread(const QString &IOThread)
+{
+    m_IOThread = IOThread;
+}
+
+/**
+ * @brief Get the format of the image
+ * @return format of the image
+ *
+ * Get the format of the image. If the format is unknown,
+ * read the header of the image to find it
+ * Ex: qcow2, raw...
+ */
+QString Media::imageFormat() const
+{
+    if (!m_format.isEmpty()) {
+        return m_format;
+    }
+
+    QFile imageFile(m_path);
+    if (imageFile.open(QIODevice::ReadOnly)) {
+        QByteArray header = imageFile.read(8);
+        imageFile.close();
+
+        if (header.startsWith("QFI\xfb") && header.size() == 8) {
+            return header.at(7) == 1 ? "qcow" : "qcow2";
+        } else if (header.startsWith(QByteArray("QED\0", 4))) {
+            return "qed";
+        } else if (header.startsWith("KDMV")) {
+            return "vmdk";
+        }
+    }
+
+    QString suffix = QFileInfo(m_path).suffix().toLower();
+    if (suffix == "vdi" || suffix == "vhdx" || suffix == "cloop") {
+        return suffix;
+    }
+
+    return "raw";
+}
+
 /**
  * @brief Get the uuid of the media
  * @return the uuid
@@ -238,3 +350,26 @@ void Media::setUuid(const QUuid &uuid)
 {
     m_uuid = uuid;
 }
+
+/**
+ * @brief Get the default bus for new media
+ * @param type, type of the media. Ex: hdd, cdrom, fdd
+ * @param OSType, operating system of the machine
+ * @return default bus
+ *
+ * Get the default bus for new media.
+ * Hard disks use virtio, except on Windows guests that
+ * don't have the drivers installed by default
+ */
+QString Media::defaultBus(const QString &type, const QString &OSType)
+{
+    if (type == "fdd") {
+        return "fdc";
+    }
+
+    if (type == "hdd" && !OSType.contains("Windows", Qt::CaseInsensitive)) {
+        return "virtio";
+    }
+
+    return "ide";
+}
@@ -24,6 +24,8 @@
 // Qt
 #include <QObject>
 #include <QUuid>
+#include <QFile>
+#include <QFileInfo>
 #include <QDebug>
 
 class Media: public QObject {
@@ -57,9 +59,22 @@ class Media: public QObject {
         QString IO() const;
         void setIO(const QString &IO);
 
+        bool discard() const;
+        void setDiscard(bool discard);
+
+        QString bus() const;
+        void setBus(const QString &bus);
+
+        QString IOThread() const;
+        void setIOThread(const QString &IOThread);
+
+        QString imageFormat() const;
+
         QUuid uuid() const;
         void setUuid(const QUuid &uuid);
 
+        static QString defaultBus(const QString &type, const QString &OSType);
+
     protected:
 
     private:
@@ -71,6 +86,9 @@ class Media: public QObject {
         QString m_driveInterface;
         QString m_cache;
         QString m_IO;
+        bool m_discard;
+        QString m_bus;
+        QString m_IOThread;
         QUuid m_uuid;
 };
 
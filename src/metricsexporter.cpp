@@ -0,0 +1,530 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "metricsexporter.h"
+
+// Port of the HTTP endpoint, next to the usual exporters
+static const int DEFAULT_PORT = 9477;
+
+// Time the rendered metrics are reused, in milliseconds
+static const qint64 RENDER_INTERVAL = 1000;
+
+// Time between two writes of the textfile, in milliseconds
+static const int TEXTFILE_INTERVAL = 10000;
+
+// Limits of a request. The scrapers send small GET requests
+static const int MAX_REQUEST_SIZE = 8192;
+static const int REQUEST_TIMEOUT = 5000;
+
+namespace {
+
+enum MetricValues {
+    MachineState, Uptime, Restarts, CPUTime, vCPUTime, ResidentMemory,
+    ReadOperations, WriteOperations, ReadBytes, WriteBytes,
+    ReceivedBytes, TransmittedBytes
+};
+
+struct MetricFamily {
+    const char *name;
+    // Counters are written with the _total suffix
+    bool counter;
+    // Only the running machines have resource usage
+    bool running;
+    MetricValues value;
+    const char *help;
+};
+
+const MetricFamily METRIC_FAMILIES[] = {
+    { "qtemu_machine_state", false, false, MachineState, "State of the machine" },
+    { "qtemu_machine_uptime_seconds", false, true, Uptime, "Time since QEMU was started" },
+    { "qtemu_machine_restarts", true, false, Restarts, "Times QEMU was started again since QtEmu was opened" },
+    { "qtemu_machine_cpu_seconds", true, true, CPUTime, "CPU time of the QEMU process" },
+    { "qtemu_machine_vcpu_seconds", true, true, vCPUTime, "CPU time of the vCPU threads" },
+    { "qtemu_machine_resident_memory_bytes", false, true, ResidentMemory, "Resident memory of the QEMU process" },
+    { "qtemu_machine_disk_read_operations", true, true, ReadOperations, "Read operations of all the disks" },
+    { "qtemu_machine_disk_write_operations", true, true, WriteOperations, "Write operations of all the disks" },
+    { "qtemu_machine_disk_read_bytes", true, true, ReadBytes, "Bytes read from all the disks" },
+    { "qtemu_machine_disk_written_bytes", true, true, WriteBytes, "Bytes written to all the disks" },
+    { "qtemu_machine_network_receive_bytes", true, true, ReceivedBytes, "Bytes received by the tap devices in the host" },
+    { "qtemu_machine_network_transmit_bytes", true, true, TransmittedBytes, "Bytes sent by the tap devices in the host" }
+};
+
+const struct {
+    Machine::States state;
+    const char *label;
+} MACHINE_STATES[] = {
+    { Machine::Started, ",state=\"started\"}" },
+    { Machine::Stopped, ",state=\"stopped\"}" },
+    { Machine::Saved, ",state=\"saved\"}" },
+    { Machine::Paused, ",state=\"paused\"}" }
+};
+
+}
+
+/**
+ * @brief Metrics exporter
+ * @param parent, parent object
+ *
+ * Expose the metrics of the machines in the Prometheus
+ * and OpenMetrics text formats, with a local HTTP endpoint
+ * and a file for the textfile collector of node_exporter.
+ * The rendered text is reused between scrapes until a
+ * machine changes or the cache is one second old
+ */
+MetricsExporter::MetricsExporter(QObject *parent) : QObject(parent)
+{
+    this->m_clock.start();
+    this->m_port = 0;
+
+    this->m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection,
+            this, &MetricsExporter::newConnection);
+
+    this->m_textfileTimer = new QTimer(this);
+    this->m_textfileTimer->setInterval(TEXTFILE_INTERVAL);
+    this->m_textfileTimer->setTimerType(Qt::CoarseTimer);
+    connect(m_textfileTimer, &QTimer::timeout,
+            this, &MetricsExporter::writeTextfile);
+
+    this->loadSettings();
+
+    qDebug() << "MetricsExporter created";
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    qDebug() << "MetricsExporter destroyed";
+}
+
+/**
+ * @brief Load the settings of the exporter
+ *
+ * Start or stop the HTTP endpoint and the textfile
+ * following the QtEmu settings
+ */
+void MetricsExporter::loadSettings()
+{
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    bool HTTPEnabled = settings.value("metricsHTTP", false).toBool();
+    QHostAddress address(settings.value("metricsAddress", "127.0.0.1").toString());
+    quint16 port = static_cast<quint16>(settings.value("metricsPort", DEFAULT_PORT).toInt());
+    this->m_textfilePath = settings.value("metricsTextfile", "").toString();
+    settings.endGroup();
+
+    if (address.isNull()) {
+        address = QHostAddress::LocalHost;
+    }
+
+    if (!HTTPEnabled) {
+        this->m_server->close();
+    } else if (!this->m_server->isListening() || address != this->m_address || port != this->m_port) {
+        this->m_server->close();
+        if (!this->m_server->listen(address, port)) {
+            Logger::logQtemuError(tr("Cannot start the metrics endpoint on %1:%2: %3")
+                                  .arg(address.toString())
+                                  .arg(port)
+                                  .arg(this->m_server->errorString()));
+        }
+    }
+    this->m_address = address;
+    this->m_port = port;
+
+    if (this->m_textfilePath.isEmpty()) {
+        this->m_textfileTimer->stop();
+    } else if (!this->m_textfileTimer->isActive()) {
+        this->m_textfileTimer->start();
+    }
+}
+
+/**
+ * @brief Add a machine
+ * @param machine, machine to be exported
+ *
+ * Add a machine to the metrics
+ */
+void MetricsExporter::addMachine(Machine *machine)
+{
+    if (machine == nullptr) {
+        return;
+    }
+
+    foreach (const ExportedMachine &exportedMachine, this->m_machines) {
+        if (exportedMachine.machine == machine) {
+            return;
+        }
+    }
+
+    ExportedMachine exportedMachine;
+    exportedMachine.machine = machine;
+    exportedMachine.uuid = machine->getUuid();
+    exportedMachine.name = machine->getName();
+    exportedMachine.labels = MetricsExporter::machineLabels(machine);
+    this->m_machines.append(exportedMachine);
+
+    connect(machine, &Machine::machineStateChangedSignal,
+            this, &MetricsExporter::invalidate);
+
+    this->invalidate();
+}
+
+/**
+ * @brief Remove a machine
+ * @param machineUuid, uuid of the machine
+ *
+ * Remove a machine from the metrics
+ */
+void MetricsExporter::removeMachine(const QUuid &machineUuid)
+{
+    QMutableListIterator<ExportedMachine> exportedMachine(this->m_machines);
+    while (exportedMachine.hasNext()) {
+        Machine *machine = exportedMachine.next().machine;
+        if (machine == nullptr || machine->getUuid() == machineUuid) {
+            if (machine != nullptr) {
+                disconnect(machine, nullptr, this, nullptr);
+            }
+            exportedMachine.remove();
+        }
+    }
+
+    this->invalidate();
+}
+
+/**
+ * @brief Machine sampled
+ * @param machineUuid, uuid of the machine
+ *
+ * The counters of the machine changed, the
+ * metrics are rendered again in the next scrape
+ */
+void MetricsExporter::machineSampled(const QUuid machineUuid)
+{
+    Q_UNUSED(machineUuid)
+
+    this->invalidate();
+}
+
+/**
+ * @brief Discard the rendered metrics
+ *
+ * Discard the rendered metrics
+ */
+void MetricsExporter::invalidate()
+{
+    this->m_caches[MetricsExporter::Prometheus].renderedAt = -1;
+    this->m_caches[MetricsExporter::OpenMetrics].renderedAt = -1;
+}
+
+/**
+ * @brief Get the metrics
+ * @param format, text format of the metrics
+ * @return metrics of all the machines
+ *
+ * Get the metrics of all the machines. The text is
+ * rendered again only if it's outdated
+ */
+QByteArray MetricsExporter::metrics(MetricsExporter::Formats format)
+{
+    RenderCache &cache = this->m_caches[format];
+    qint64 now = this->m_clock.elapsed();
+
+    if (cache.renderedAt < 0 || now - cache.renderedAt >= RENDER_INTERVAL) {
+        this->render(cache.data, format);
+        cache.renderedAt = now;
+    }
+
+    return cache.data;
+}
+
+/**
+ * @brief Render the metrics
+ * @param buffer, buffer where the metrics are written
+ * @param format, text format of the metrics
+ *
+ * Write all the metric families in the buffer.
+ * The memory of the buffer is reused and the labels
+ * of every machine are built only when its name or uuid change
+ */
+void MetricsExporter::render(QByteArray &buffer, MetricsExporter::Formats format)
+{
+    // Keep the capacity of the last render
+    buffer.resize(0);
+
+    QMutableListIterator<ExportedMachine> exportedMachine(this->m_machines);
+    while (exportedMachine.hasNext()) {
+        ExportedMachine &nextMachine = exportedMachine.next();
+        if (nextMachine.machine.isNull()) {
+            exportedMachine.remove();
+        } else if (nextMachine.uuid != nextMachine.machine->getUuid() ||
+                   nextMachine.name != nextMachine.machine->getName()) {
+            // The machines of the wizards get the uuid after they're added
+            nextMachine.uuid = nextMachine.machine->getUuid();
+            nextMachine.name = nextMachine.machine->getName();
+            nextMachine.labels = MetricsExporter::machineLabels(nextMachine.machine);
+        }
+    }
+
+    for (const MetricFamily &family : METRIC_FAMILIES) {
+        const char *familySuffix = family.counter && format == MetricsExporter::Prometheus ? "_total" : "";
+        const char *sampleSuffix = family.counter ? "_total" : "";
+
+        buffer.append("# HELP ").append(family.name).append(familySuffix)
+              .append(' ').append(family.help).append('\n');
+        buffer.append("# TYPE ").append(family.name).append(familySuffix)
+              .append(family.counter ? " counter\n" : " gauge\n");
+
+        foreach (const ExportedMachine &nextMachine, this->m_machines) {
+            Machine *machine = nextMachine.machine;
+            Machine::States state = machine->getState();
+            bool running = state == Machine::Started || state == Machine::Paused;
+
+            if (family.running && !running) {
+                continue;
+            }
+
+            if (family.value == MachineState) {
+                for (const auto &machineState : MACHINE_STATES) {
+                    buffer.append(family.name).append(nextMachine.labels).append(machineState.label);
+                    buffer.append(state == machineState.state ? " 1\n" : " 0\n");
+                }
+                continue;
+            }
+
+            const MetricsSeries *series = machine->getMetrics();
+            const MetricsCounters &counters = series->counters();
+            double value = 0;
+            switch (family.value) {
+                case Uptime:
+                    value = machine->getUptime() / 1000.0;
+                    break;
+                case Restarts:
+                    value = machine->getRestartCount();
+                    break;
+                case CPUTime:
+                    value = counters.CPUTime;
+                    break;
+                case vCPUTime:
+                    value = counters.vCPUTime;
+                    break;
+                case ResidentMemory:
+                    value = series->isEmpty() ? 0 : series->last().residentMemory;
+                    break;
+                case ReadOperations:
+                    value = counters.readOperations;
+                    break;
+                case WriteOperations:
+                    value = counters.writeOperations;
+                    break;
+                case ReadBytes:
+                    value = counters.readBytes;
+                    break;
+                case WriteBytes:
+                    value = counters.writeBytes;
+                    break;
+                case ReceivedBytes:
+                    value = counters.receivedBytes;
+                    break;
+                case TransmittedBytes:
+                    value = counters.transmittedBytes;
+                    break;
+                default:
+                    break;
+            }
+
+            buffer.append(family.name).append(sampleSuffix)
+                  .append(nextMachine.labels).append("} ");
+            MetricsExporter::appendValue(buffer, value);
+            buffer.append('\n');
+        }
+    }
+
+    if (format == MetricsExporter::OpenMetrics) {
+        buffer.append("# EOF\n");
+    }
+}
+
+/**
+ * @brief New connection in the HTTP endpoint
+ *
+ * Wait for the requests of the new clients
+ */
+void MetricsExporter::newConnection()
+{
+    while (this->m_server->hasPendingConnections()) {
+        QTcpSocket *socket = this->m_server->nextPendingConnection();
+        this->m_requests.insert(socket, QByteArray());
+
+        connect(socket, &QTcpSocket::readyRead,
+                this, [=]() {
+            this->readRequest(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected,
+                this, [=]() {
+            this->m_requests.remove(socket);
+            socket->deleteLater();
+        });
+
+        // The slow clients don't keep the connection open
+        QTimer::singleShot(REQUEST_TIMEOUT, socket, &QTcpSocket::abort);
+    }
+}
+
+/**
+ * @brief Read a request
+ * @param socket, socket of the client
+ *
+ * Answer the request when the headers are complete.
+ * Only GET and HEAD of /metrics are supported
+ */
+void MetricsExporter::readRequest(QTcpSocket *socket)
+{
+    QByteArray &request = this->m_requests[socket];
+    request.append(socket->readAll());
+
+    if (request.size() > MAX_REQUEST_SIZE) {
+        this->writeResponse(socket, "431 Request Header Fields Too Large",
+                            "text/plain; charset=utf-8", "Request too large\n", false);
+        return;
+    }
+
+    int headersEnd = request.indexOf("\r\n\r\n");
+    if (headersEnd == -1) {
+        return;
+    }
+
+    QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+    QByteArray method = requestLine.value(0);
+    QByteArray target = requestLine.value(1);
+    bool headOnly = method == "HEAD";
+
+    // The target can have a query, the scrapers add their parameters
+    int queryStart = target.indexOf('?');
+    if (queryStart != -1) {
+        target.truncate(queryStart);
+    }
+
+    if (method != "GET" && !headOnly) {
+        this->writeResponse(socket, "405 Method Not Allowed",
+                            "text/plain; charset=utf-8", "Method not allowed\n", false);
+    } else if (target != "/metrics") {
+        this->writeResponse(socket, "404 Not Found",
+                            "text/plain; charset=utf-8", "The metrics are in /metrics\n", headOnly);
+    } else if (request.left(headersEnd).toLower().contains("application/openmetrics-text")) {
+        this->writeResponse(socket, "200 OK",
+                            "application/openmetrics-text; version=1.0.0; charset=utf-8",
+                            this->metrics(MetricsExporter::OpenMetrics), headOnly);
+    } else {
+        this->writeResponse(socket, "200 OK",
+                            "text/plain; version=0.0.4; charset=utf-8",
+                            this->metrics(MetricsExporter::Prometheus), headOnly);
+    }
+}
+
+/**
+ * @brief Write a response
+ * @param socket, socket of the client
+ * @param status, HTTP status code and reason
+ * @param contentType, type of the body
+ * @param body, body of the response
+ * @param headOnly, true to send only the headers
+ *
+ * Write the response and close the connection
+ */
+void MetricsExporter::writeResponse(QTcpSocket *socket, const QByteArray &status,
+                                    const QByteArray &contentType, const QByteArray &body,
+                                    bool headOnly)
+{
+    this->m_requests.remove(socket);
+    disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+    QByteArray headers;
+    headers.reserve(160);
+    headers.append("HTTP/1.1 ").append(status).append("\r\n");
+    headers.append("Content-Type: ").append(contentType).append("\r\n");
+    headers.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+    headers.append("Connection: close\r\n\r\n");
+
+    socket->write(headers);
+    if (!headOnly) {
+        socket->write(body);
+    }
+    socket->disconnectFromHost();
+}
+
+/**
+ * @brief Write the textfile
+ *
+ * Write the metrics in the file read by the textfile
+ * collector of node_exporter. The file is replaced
+ * at once, the collector never reads half a file
+ */
+void MetricsExporter::writeTextfile()
+{
+    if (this->m_textfilePath.isEmpty()) {
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(this->m_textfilePath).absolutePath());
+
+    QSaveFile textfile(this->m_textfilePath);
+    if (!textfile.open(QFile::WriteOnly)) {
+        qDebug() << "Cannot write the metrics textfile" << textfile.errorString();
+        return;
+    }
+
+    textfile.write(this->metrics(MetricsExporter::Prometheus));
+    if (!textfile.commit()) {
+        qDebug() << "Cannot write the metrics textfile" << textfile.errorString();
+    }
+}
+
+/**
+ * @brief Build the labels of a machine
+ * @param machine, machine
+ * @return labels without the closing brace
+ *
+ * Build the labels of a machine, escaping the name
+ */
+QByteArray MetricsExporter::machineLabels(Machine *machine)
+{
+    QByteArray name = machine->getName().toUtf8();
+    name.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+
+    QByteArray labels;
+    labels.append("{uuid=\"").append(machine->getUuid().toByteArray(QUuid::WithoutBraces));
+    labels.append("\",name=\"").append(name).append('"');
+
+    return labels;
+}
+
+/**
+ * @brief Append a value
+ * @param buffer, buffer of the metrics
+ * @param value, value of the sample
+ *
+ * Append a value without temporary strings
+ */
+void MetricsExporter::appendValue(QByteArray &buffer, double value)
+{
+    char number[32];
+    int length = qsnprintf(number, sizeof(number), "%.15g", value);
+    buffer.append(number, qMin(length, static_cast<int>(sizeof(number)) - 1));
+}
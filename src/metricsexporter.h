@@ -0,0 +1,109 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+// Qt
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QHash>
+#include <QSettings>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+// Local
+#include "machine.h"
+#include "utils/metricsseries.h"
+
+class MetricsExporter : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MetricsExporter(QObject *parent = nullptr);
+        ~MetricsExporter();
+
+        enum Formats {
+            Prometheus, OpenMetrics
+        };
+
+        void addMachine(Machine *machine);
+        void removeMachine(const QUuid &machineUuid);
+
+        QByteArray metrics(MetricsExporter::Formats format);
+
+    signals:
+
+    public slots:
+        void loadSettings();
+        void machineSampled(const QUuid machineUuid);
+
+    private slots:
+        void newConnection();
+        void writeTextfile();
+
+    protected:
+
+    private:
+        struct ExportedMachine {
+            QPointer<Machine> machine;
+            QUuid uuid;
+            QString name;
+            // Labels without the closing brace, other labels can be added
+            QByteArray labels;
+        };
+
+        struct RenderCache {
+            QByteArray data;
+            qint64 renderedAt = -1;
+        };
+
+        QTcpServer *m_server;
+        QHostAddress m_address;
+        quint16 m_port;
+        QHash<QTcpSocket *, QByteArray> m_requests;
+
+        QTimer *m_textfileTimer;
+        QString m_textfilePath;
+
+        QList<ExportedMachine> m_machines;
+        RenderCache m_caches[2];
+        QElapsedTimer m_clock;
+
+        // Methods
+        void invalidate();
+        void render(QByteArray &buffer, MetricsExporter::Formats format);
+        void readRequest(QTcpSocket *socket);
+        void writeResponse(QTcpSocket *socket, const QByteArray &status,
+                           const QByteArray &contentType, const QByteArray &body,
+                           bool headOnly);
+
+        static QByteArray machineLabels(Machine *machine);
+        static void appendValue(QByteArray &buffer, double value);
+};
+
+#endif // METRICSEXPORTER_H
@@ -0,0 +1,474 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "metricssampler.h"
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Time between two samples, in milliseconds
+static const int DEFAULT_INTERVAL = 2000;
+static const int MIN_INTERVAL = 500;
+
+// Time between two samples stored in the event log of the machine
+static const qint64 EVENT_INTERVAL = 60000;
+
+/**
+ * @brief Resource usage sampler
+ * @param parent, parent object
+ *
+ * Sample the resource usage of all the running machines in one pass.
+ * In Linux the counters are read from /proc and /sys, keeping the
+ * files open between samples, and the disk counters are taken from QMP
+ * without waiting for the answer. The disk counters of QMP are used
+ * instead of /proc/<pid>/io, that also counts the page cache and the
+ * files that aren't disks. The network counters are read from the
+ * tap devices. The samples are stored in the series of every machine
+ */
+MetricsSampler::MetricsSampler(QObject *parent) : QObject(parent)
+{
+    this->m_clock.start();
+
+    this->m_sampleTimer = new QTimer(this);
+    this->m_sampleTimer->setTimerType(Qt::CoarseTimer);
+    connect(m_sampleTimer, &QTimer::timeout,
+            this, &MetricsSampler::sampleMachines);
+
+    this->loadSettings();
+    this->m_sampleTimer->start();
+
+    qDebug() << "MetricsSampler created";
+}
+
+MetricsSampler::~MetricsSampler()
+{
+    QMutableHashIterator<QUuid, ProcessState> state(this->m_states);
+    while (state.hasNext()) {
+        state.next();
+        this->closeState(state.value());
+    }
+
+    qDebug() << "MetricsSampler destroyed";
+}
+
+/**
+ * @brief Add a machine
+ * @param machine, machine to be sampled
+ *
+ * The machine is sampled while it's running
+ */
+void MetricsSampler::addMachine(Machine *machine)
+{
+    if (machine != nullptr && !this->m_machines.contains(machine)) {
+        this->m_machines.append(machine);
+    }
+}
+
+/**
+ * @brief Remove a machine
+ * @param machineUuid, uuid of the machine
+ *
+ * Stop sampling a machine
+ */
+void MetricsSampler::removeMachine(const QUuid &machineUuid)
+{
+    QMutableListIterator<QPointer<Machine>> machine(this->m_machines);
+    while (machine.hasNext()) {
+        QPointer<Machine> nextMachine = machine.next();
+        if (nextMachine.isNull() || nextMachine->getUuid() == machineUuid) {
+            machine.remove();
+        }
+    }
+
+    if (this->m_states.contains(machineUuid)) {
+        this->closeState(this->m_states[machineUuid]);
+        this->m_states.remove(machineUuid);
+    }
+}
+
+/**
+ * @brief Load the settings
+ *
+ * Load the interval between two samples
+ */
+void MetricsSampler::loadSettings()
+{
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    int interval = qMax(MIN_INTERVAL, settings.value("metricsInterval", DEFAULT_INTERVAL).toInt());
+    settings.endGroup();
+
+    if (interval != this->m_sampleTimer->interval()) {
+        this->m_sampleTimer->setInterval(interval);
+    }
+}
+
+/**
+ * @brief Sample all the running machines
+ *
+ * Sample all the running machines
+ */
+void MetricsSampler::sampleMachines()
+{
+    QMutableListIterator<QPointer<Machine>> machines(this->m_machines);
+    while (machines.hasNext()) {
+        Machine *machine = machines.next();
+        if (machine == nullptr) {
+            machines.remove();
+            continue;
+        }
+
+        QUuid machineUuid = machine->getUuid();
+        if (machine->getState() == Machine::Stopped || machine->getProcessId() <= 0) {
+            if (this->m_states.contains(machineUuid)) {
+                this->closeState(this->m_states[machineUuid]);
+                this->m_states.remove(machineUuid);
+            }
+            continue;
+        }
+
+        this->sampleMachine(machine, this->m_states[machineUuid]);
+    }
+}
+
+/**
+ * @brief Sample a machine
+ * @param machine, running machine
+ * @param state, counters of the last sample
+ *
+ * Read the counters of the machine and store
+ * the difference with the last sample
+ */
+void MetricsSampler::sampleMachine(Machine *machine, ProcessState &state)
+{
+    qint64 processId = machine->getProcessId();
+    if (state.processId != processId) {
+        this->closeState(state);
+        state = ProcessState();
+        state.processId = processId;
+    }
+
+    qint64 now = this->m_clock.elapsed();
+    double elapsed = (now - state.lastSample) / 1000.0;
+
+    MetricsSample sample;
+    sample.timestamp = QDateTime::currentMSecsSinceEpoch();
+
+#ifdef Q_OS_LINUX
+    static const double ticksPerSecond = sysconf(_SC_CLK_TCK);
+    static const qint64 pageSize = sysconf(_SC_PAGESIZE);
+
+    QByteArray processPath = "/proc/" + QByteArray::number(processId);
+    if (state.statFile == -1) {
+        state.statFile = MetricsSampler::openProcFile(processPath + "/stat");
+        state.statmFile = MetricsSampler::openProcFile(processPath + "/statm");
+    }
+
+    qint64 CPUTicks = 0;
+    MetricsSampler::readTicks(state.statFile, CPUTicks);
+
+    // size resident shared text lib data dt, in pages
+    QList<QByteArray> statm = MetricsSampler::readProcFile(state.statmFile).split(' ');
+    if (statm.size() > 1) {
+        sample.residentMemory = statm.at(1).toLongLong() * pageSize;
+    }
+
+    // The files of the threads that are gone are closed
+    QList<qint64> vCPUThreads = machine->getVCPUThreads();
+    QMutableHashIterator<qint64, ThreadState> thread(state.threads);
+    while (thread.hasNext()) {
+        thread.next();
+        if (!vCPUThreads.contains(thread.key())) {
+            ::close(thread.value().statFile);
+            ::close(thread.value().schedstatFile);
+            thread.remove();
+        }
+    }
+
+    bool vCPUsChanged = vCPUThreads.size() != state.threads.size();
+    qint64 vCPUTicks = 0;
+    qint64 vCPUWait = 0;
+    foreach (qint64 threadId, vCPUThreads) {
+        ThreadState &threadState = state.threads[threadId];
+        if (threadState.statFile == -1) {
+            QByteArray threadPath = processPath + "/task/" + QByteArray::number(threadId);
+            threadState.statFile = MetricsSampler::openProcFile(threadPath + "/stat");
+            threadState.schedstatFile = MetricsSampler::openProcFile(threadPath + "/schedstat");
+        }
+
+        qint64 threadTicks = 0;
+        if (MetricsSampler::readTicks(threadState.statFile, threadTicks)) {
+            vCPUTicks += threadTicks;
+        }
+
+        // Time on the CPU, time waiting for a CPU and timeslices, in nanoseconds
+        QList<QByteArray> schedstat = MetricsSampler::readProcFile(threadState.schedstatFile).split(' ');
+        if (schedstat.size() > 1) {
+            vCPUWait += schedstat.at(1).toLongLong();
+        }
+    }
+
+    if (state.lastSample > 0 && elapsed > 0) {
+        sample.CPUUsage = qMax(0.0, (CPUTicks - state.CPUTicks) / ticksPerSecond / elapsed * 100);
+
+        if (!vCPUsChanged && !vCPUThreads.isEmpty()) {
+            sample.vCPUUsage = qMax(0.0, (vCPUTicks - state.vCPUTicks) / ticksPerSecond / elapsed * 100 /
+                                         vCPUThreads.size());
+            sample.vCPUSteal = qMax(0.0, (vCPUWait - state.vCPUWait) / 1e9 / elapsed * 100 /
+                                         vCPUThreads.size());
+        }
+    }
+
+    state.CPUTicks = CPUTicks;
+    state.vCPUTicks = vCPUTicks;
+    state.vCPUWait = vCPUWait;
+
+    MetricsCounters &counters = machine->getMetrics()->counters();
+    counters.CPUTime = CPUTicks / ticksPerSecond;
+    counters.vCPUTime = vCPUTicks / ticksPerSecond;
+
+    // Only the tap devices have a name in the host
+    qint64 receivedBytes = 0;
+    qint64 transmittedBytes = 0;
+    foreach (NetworkInterface *networkInterface, machine->getNetworkInterfaces()) {
+        if (networkInterface->backend() != "tap" || networkInterface->hostInterface().isEmpty()) {
+            continue;
+        }
+
+        NetworkState &networkState = state.networks[networkInterface->hostInterface()];
+        if (networkState.receivedFile == -1) {
+            QByteArray statisticsPath = "/sys/class/net/" + networkInterface->hostInterface().toUtf8() + "/statistics";
+            networkState.receivedFile = MetricsSampler::openProcFile(statisticsPath + "/rx_bytes");
+            networkState.transmittedFile = MetricsSampler::openProcFile(statisticsPath + "/tx_bytes");
+        }
+
+        receivedBytes += MetricsSampler::readProcFile(networkState.receivedFile).toLongLong();
+        transmittedBytes += MetricsSampler::readProcFile(networkState.transmittedFile).toLongLong();
+    }
+    counters.receivedBytes = receivedBytes;
+    counters.transmittedBytes = transmittedBytes;
+#endif
+
+    sample.readOperations = state.readOperationsRate;
+    sample.writeOperations = state.writeOperationsRate;
+    sample.readBytes = state.readBytesRate;
+    sample.writeBytes = state.writeBytesRate;
+
+    bool firstSample = state.lastSample == 0;
+    state.lastSample = now;
+
+    this->queryBlockStats(machine);
+
+    // The first sample doesn't have a previous one to compare with
+    if (firstSample) {
+        return;
+    }
+
+    machine->getMetrics()->append(sample);
+
+    if (now - state.lastEvent >= EVENT_INTERVAL) {
+        state.lastEvent = now;
+        machine->recordEvent(MachineEventLog::Sample, sample.toJSON());
+    }
+
+    emit(machineSampled(machine->getUuid()));
+}
+
+/**
+ * @brief Ask the disk counters
+ * @param machine, running machine
+ *
+ * Ask the disk counters to QEMU. The answer updates the
+ * rates used by the next sample
+ */
+void MetricsSampler::queryBlockStats(Machine *machine)
+{
+    if (!machine->getQMPClient()->isReady()) {
+        return;
+    }
+
+    QPointer<MetricsSampler> sampler(this);
+    QPointer<Machine> machinePointer(machine);
+    QUuid machineUuid = machine->getUuid();
+    qint64 processId = machine->getProcessId();
+
+    machine->getQMPClient()->execute("query-blockstats", QJsonObject(),
+                                     [=](const QJsonObject &response) {
+        if (sampler.isNull() || machinePointer.isNull() || !response.contains("return")) {
+            return;
+        }
+
+        auto state = sampler->m_states.find(machineUuid);
+        if (state == sampler->m_states.end() || state->processId != processId) {
+            return;
+        }
+
+        qint64 readOperations = 0;
+        qint64 writeOperations = 0;
+        qint64 readBytes = 0;
+        qint64 writeBytes = 0;
+        foreach (const QJsonValue &device, response["return"].toArray()) {
+            QJsonObject stats = device.toObject()["stats"].toObject();
+            readOperations += static_cast<qint64>(stats["rd_operations"].toDouble());
+            writeOperations += static_cast<qint64>(stats["wr_operations"].toDouble());
+            readBytes += static_cast<qint64>(stats["rd_bytes"].toDouble());
+            writeBytes += static_cast<qint64>(stats["wr_bytes"].toDouble());
+        }
+
+        qint64 now = sampler->m_clock.elapsed();
+        double elapsed = (now - state->blockSample) / 1000.0;
+        if (state->readOperations >= 0 && elapsed > 0) {
+            state->readOperationsRate = qMax(0.0, (readOperations - state->readOperations) / elapsed);
+            state->writeOperationsRate = qMax(0.0, (writeOperations - state->writeOperations) / elapsed);
+            state->readBytesRate = qMax(0.0, (readBytes - state->readBytes) / elapsed);
+            state->writeBytesRate = qMax(0.0, (writeBytes - state->writeBytes) / elapsed);
+        }
+
+        MetricsCounters &counters = machinePointer->getMetrics()->counters();
+        counters.readOperations = readOperations;
+        counters.writeOperations = writeOperations;
+        counters.readBytes = readBytes;
+        counters.writeBytes = writeBytes;
+
+        state->blockSample = now;
+        state->readOperations = readOperations;
+        state->writeOperations = writeOperations;
+        state->readBytes = readBytes;
+        state->writeBytes = writeBytes;
+    });
+}
+
+/**
+ * @brief Close the files of a machine
+ * @param state, state of the machine
+ *
+ * Close the files kept open between samples
+ */
+void MetricsSampler::closeState(ProcessState &state)
+{
+#ifdef Q_OS_LINUX
+    if (state.statFile != -1) {
+        ::close(state.statFile);
+    }
+    if (state.statmFile != -1) {
+        ::close(state.statmFile);
+    }
+
+    foreach (const ThreadState &threadState, state.threads) {
+        if (threadState.statFile != -1) {
+            ::close(threadState.statFile);
+        }
+        if (threadState.schedstatFile != -1) {
+            ::close(threadState.schedstatFile);
+        }
+    }
+
+    foreach (const NetworkState &networkState, state.networks) {
+        if (networkState.receivedFile != -1) {
+            ::close(networkState.receivedFile);
+        }
+        if (networkState.transmittedFile != -1) {
+            ::close(networkState.transmittedFile);
+        }
+    }
+#endif
+
+    state.statFile = -1;
+    state.statmFile = -1;
+    state.threads.clear();
+    state.networks.clear();
+}
+
+/**
+ * @brief Open a file of /proc
+ * @param path, path of the file
+ * @return file descriptor, -1 if the file cannot be opened
+ *
+ * Open a file of /proc. The file is read again
+ * from the beginning in every sample
+ */
+int MetricsSampler::openProcFile(const QByteArray &path)
+{
+#ifdef Q_OS_LINUX
+    return ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+#else
+    Q_UNUSED(path)
+    return -1;
+#endif
+}
+
+/**
+ * @brief Read a file of /proc
+ * @param file, file descriptor
+ * @return content of the file, without the final new line
+ *
+ * Read the current content of a file of /proc
+ */
+QByteArray MetricsSampler::readProcFile(int file)
+{
+#ifdef Q_OS_LINUX
+    if (file == -1) {
+        return QByteArray();
+    }
+
+    char buffer[1024];
+    ssize_t bytesRead = ::pread(file, buffer, sizeof(buffer), 0);
+    if (bytesRead <= 0) {
+        return QByteArray();
+    }
+
+    return QByteArray(buffer, static_cast<int>(bytesRead)).trimmed();
+#else
+    Q_UNUSED(file)
+    return QByteArray();
+#endif
+}
+
+/**
+ * @brief Read the CPU time of a process or thread
+ * @param file, file descriptor of the stat file
+ * @param ticks, user and system time, in clock ticks
+ * @return true if the time is read
+ *
+ * Read the CPU time from a stat file. The name of the
+ * process can have spaces, so the fields are counted
+ * from the end of the name
+ */
+bool MetricsSampler::readTicks(int file, qint64 &ticks)
+{
+    QByteArray stat = MetricsSampler::readProcFile(file);
+    int nameEnd = stat.lastIndexOf(')');
+    if (nameEnd == -1) {
+        return false;
+    }
+
+    // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+    QList<QByteArray> fields = stat.mid(nameEnd + 2).split(' ');
+    if (fields.size() < 13) {
+        return false;
+    }
+
+    ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+
+    return true;
+}
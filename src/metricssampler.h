@@ -0,0 +1,113 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef METRICSSAMPLER_H
+#define METRICSSAMPLER_H
+
+// Qt
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QHash>
+#include <QSettings>
+#include <QDebug>
+
+// Local
+#include "machine.h"
+#include "utils/metricsseries.h"
+
+class MetricsSampler : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MetricsSampler(QObject *parent = nullptr);
+        ~MetricsSampler();
+
+        void addMachine(Machine *machine);
+        void removeMachine(const QUuid &machineUuid);
+
+    signals:
+        void machineSampled(const QUuid machineUuid);
+
+    public slots:
+        void loadSettings();
+
+    private slots:
+        void sampleMachines();
+
+    protected:
+
+    private:
+        struct ThreadState {
+            int statFile = -1;
+            int schedstatFile = -1;
+        };
+
+        struct NetworkState {
+            int receivedFile = -1;
+            int transmittedFile = -1;
+        };
+
+        struct ProcessState {
+            qint64 processId = 0;
+            qint64 lastSample = 0;
+            qint64 lastEvent = 0;
+
+            // Files kept open between samples
+            int statFile = -1;
+            int statmFile = -1;
+            QHash<qint64, ThreadState> threads;
+            QHash<QString, NetworkState> networks;
+
+            // Counters of the last sample
+            qint64 CPUTicks = 0;
+            qint64 vCPUTicks = 0;
+            qint64 vCPUWait = 0;
+
+            // Block counters of the last query-blockstats
+            qint64 blockSample = 0;
+            qint64 readOperations = -1;
+            qint64 writeOperations = 0;
+            qint64 readBytes = 0;
+            qint64 writeBytes = 0;
+            double readOperationsRate = 0;
+            double writeOperationsRate = 0;
+            double readBytesRate = 0;
+            double writeBytesRate = 0;
+        };
+
+        QTimer *m_sampleTimer;
+        QElapsedTimer m_clock;
+
+        QList<QPointer<Machine>> m_machines;
+        QHash<QUuid, ProcessState> m_states;
+
+        // Methods
+        void sampleMachine(Machine *machine, ProcessState &state);
+        void queryBlockStats(Machine *machine);
+        void closeState(ProcessState &state);
+
+        static int openProcFile(const QByteArray &path);
+        static QByteArray readProcFile(int file);
+        static bool readTicks(int file, qint64 &ticks);
+};
+
+#endif // METRICSSAMPLER_H
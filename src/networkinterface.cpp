@@ -0,0 +1,251 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "networkinterface.h"
+
+/**
+ * @brief Network interface object
+ *
+ * Network card of the machine and the
+ * backend that connects it with the host
+ */
+NetworkInterface::NetworkInterface(QObject *parent) : QObject(parent)
+{
+    this->m_model = "virtio-net-pci";
+    this->m_backend = "user";
+    this->m_vhost = true;
+    this->m_queues = 0;
+
+    qDebug() << "NetworkInterface object created";
+}
+
+NetworkInterface::~NetworkInterface()
+{
+    qDebug() << "NetworkInterface object destroyed";
+}
+
+/**
+ * @brief Get the model of the network card
+ * @return model of the network card
+ *
+ * Get the device emulated in the machine
+ * Ex: virtio-net-pci, e1000, rtl8139
+ */
+QString NetworkInterface::model() const
+{
+    return m_model;
+}
+
+/**
+ * @brief Set the model of the network card
+ * @param model, model of the network card
+ *
+ * Set the model of the network card
+ */
+void NetworkInterface::setModel(const QString &model)
+{
+    m_model = model;
+}
+
+/**
+ * @brief Get the backend of the network card
+ * @return backend of the network card
+ *
+ * Get how the network card is connected with the host
+ * Ex: user, tap, bridge
+ */
+QString NetworkInterface::backend() const
+{
+    return m_backend;
+}
+
+/**
+ * @brief Set the backend of the network card
+ * @param backend, backend of the network card
+ *
+ * Set the backend of the network card
+ */
+void NetworkInterface::setBackend(const QString &backend)
+{
+    m_backend = backend;
+}
+
+/**
+ * @brief Get the host interface
+ * @return name of the tap device or the bridge
+ *
+ * Get the tap device or the bridge of the host
+ * used by the tap and bridge backends
+ */
+QString NetworkInterface::hostInterface() const
+{
+    return m_hostInterface;
+}
+
+/**
+ * @brief Set the host interface
+ * @param hostInterface, name of the tap device or the bridge
+ *
+ * Set the host interface
+ */
+void NetworkInterface::setHostInterface(const QString &hostInterface)
+{
+    m_hostInterface = hostInterface;
+}
+
+/**
+ * @brief Get if vhost is used
+ * @return true if the packets are processed by vhost-net
+ *
+ * Get if the packets are processed in the kernel
+ * by vhost-net. Only with the tap backend
+ */
+bool NetworkInterface::vhost() const
+{
+    return m_vhost;
+}
+
+/**
+ * @brief Set if vhost is used
+ * @param vhost, true to use vhost-net
+ *
+ * Set if vhost is used
+ */
+void NetworkInterface::setVhost(bool vhost)
+{
+    m_vhost = vhost;
+}
+
+/**
+ * @brief Get the queues of the network card
+ * @return number of queues, 0 for one queue per vCPU
+ *
+ * Get the queues of the network card.
+ * Only with virtio-net and the tap backend
+ */
+int NetworkInterface::queues() const
+{
+    return m_queues;
+}
+
+/**
+ * @brief Set the queues of the network card
+ * @param queues, number of queues
+ *
+ * Set the queues of the network card
+ */
+void NetworkInterface::setQueues(const int &queues)
+{
+    m_queues = queues;
+}
+
+/**
+ * @brief Get the MAC address
+ * @return MAC address of the network card
+ *
+ * Get the MAC address of the network card
+ */
+QString NetworkInterface::MACAddress() const
+{
+    return m_MACAddress;
+}
+
+/**
+ * @brief Set the MAC address
+ * @param MACAddress, MAC address of the network card
+ *
+ * Set the MAC address of the network card
+ */
+void NetworkInterface::setMACAddress(const QString &MACAddress)
+{
+    m_MACAddress = MACAddress;
+}
+
+/**
+ * @brief Get a description of the network card
+ * @return description of the network card
+ *
+ * Get a description of the network card
+ * Ex: virtio-net-pci (tap0)
+ */
+QString NetworkInterface::label() const
+{
+    if (this->m_backend == "user") {
+        return QString("%1 (%2)").arg(this->m_model).arg(tr("user mode"));
+    }
+
+    return QString("%1 (%2)").arg(this->m_model).arg(this->m_hostInterface);
+}
+
+/**
+ * @brief Copy the network card
+ * @param parent, parent of the copy
+ * @return new network card with the same options
+ *
+ * Copy the network card, used to edit it
+ * without changing the machine
+ */
+NetworkInterface *NetworkInterface::copy(QObject *parent) const
+{
+    NetworkInterface *networkInterface = new NetworkInterface(parent);
+    networkInterface->m_model = this->m_model;
+    networkInterface->m_backend = this->m_backend;
+    networkInterface->m_hostInterface = this->m_hostInterface;
+    networkInterface->m_vhost = this->m_vhost;
+    networkInterface->m_queues = this->m_queues;
+    networkInterface->m_MACAddress = this->m_MACAddress;
+
+    return networkInterface;
+}
+
+/**
+ * @brief Get the default model of the network card
+ * @param OSType, type of the operating system
+ * @return default model
+ *
+ * VirtIO for all the systems except Windows,
+ * that doesn't include the VirtIO drivers
+ */
+QString NetworkInterface::defaultModel(const QString &OSType)
+{
+    if (OSType.contains("Windows", Qt::CaseInsensitive)) {
+        return "e1000";
+    }
+
+    return "virtio-net-pci";
+}
+
+/**
+ * @brief Generate a MAC address
+ * @return MAC address
+ *
+ * Generate a random MAC address with the
+ * prefix of QEMU, 52:54:00
+ */
+QString NetworkInterface::generateMACAddress()
+{
+    quint32 random = QRandomGenerator::global()->generate();
+
+    return QString("52:54:00:%1:%2:%3")
+           .arg((random >> 16) & 0xff, 2, 16, QChar('0'))
+           .arg((random >> 8) & 0xff, 2, 16, QChar('0'))
+           .arg(random & 0xff, 2, 16, QChar('0'));
+}
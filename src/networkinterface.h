@@ -0,0 +1,71 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef NETWORKINTERFACE_H
+#define NETWORKINTERFACE_H
+
+// Qt
+#include <QObject>
+#include <QRandomGenerator>
+#include <QDebug>
+
+class NetworkInterface: public QObject {
+    Q_OBJECT
+
+    public:
+        explicit NetworkInterface(QObject *parent = nullptr);
+        ~NetworkInterface();
+
+        QString model() const;
+        void setModel(const QString &model);
+
+        QString backend() const;
+        void setBackend(const QString &backend);
+
+        QString hostInterface() const;
+        void setHostInterface(const QString &hostInterface);
+
+        bool vhost() const;
+        void setVhost(bool vhost);
+
+        int queues() const;
+        void setQueues(const int &queues);
+
+        QString MACAddress() const;
+        void setMACAddress(const QString &MACAddress);
+
+        QString label() const;
+        NetworkInterface *copy(QObject *parent) const;
+
+        static QString defaultModel(const QString &OSType);
+        static QString generateMACAddress();
+
+    protected:
+
+    private:
+        QString m_model;
+        QString m_backend;
+        QString m_hostInterface;
+        bool m_vhost;
+        int m_queues;
+        QString m_MACAddress;
+};
+
+#endif // NETWORKINTERFACE_H
@@ -66,6 +66,13 @@ MachineConclusionPage::MachineConclusionPage(Machine *machine,
     m_acceleratorLabel->setWordWrap(true);
     m_diskLabel        = new QLabel(this);
 
+    this->m_diskJob = nullptr;
+    this->m_diskCreated = false;
+
+    m_diskProgressBar = new QProgressBar(this);
+    m_diskProgressBar->setRange(0, 0);
+    m_diskProgressBar->setVisible(false);
+
     m_conclusionLayout = new QGridLayout();
     m_conclusionLayout->addWidget(m_conclusionLabel,      0, 0, 1, 4);
     m_conclusionLayout->addWidget(m_machineDescLabel,     1, 0, 1, 1);
@@ -84,6 +91,7 @@ MachineConclusionPage::MachineConclusionPage(Machine *machine,
     m_conclusionLayout->addWidget(m_RAMLabel,             7, 1, 1, 1);
     m_conclusionLayout->addWidget(m_acceleratorDescLabel, 8, 0, 1, 1);
     m_conclusionLayout->addWidget(m_acceleratorLabel,     8, 1, 1, 1);
+    m_conclusionLayout->addWidget(m_diskProgressBar,      10, 0, 1, 4);
 
     this->setLayout(m_conclusionLayout);
 
@@ -92,6 +100,11 @@ MachineConclusionPage::MachineConclusionPage(Machine *machine,
 
 MachineConclusionPage::~MachineConclusionPage()
 {
+    // The wizard is closed while the disk is being created
+    if (this->m_diskJob != nullptr) {
+        this->m_diskJob->cancel();
+    }
+
     qDebug() << "MachineConclusionPage destroyed";
 }
 
@@ -102,6 +115,8 @@ void MachineConclusionPage::initializePage()
     QString existingDiskPath = field("machine.diskPath").toString();
     QString diskName = field("machine.diskname").toString();
     QString diskFormat = field("machine.diskFormat").toString();
+    bool useTemplate = field("useTemplate").toBool();
+    QString templatePath = field("machine.templatePath").toString();
 
     this->m_machineNameLabel->setText(this->m_newMachine->getName());
     this->m_OSTypeLabel->setText(this->m_newMachine->getOSType());
@@ -120,6 +135,10 @@ void MachineConclusionPage::initializePage()
         this->m_diskLabel->setText(existingDiskPath);
         this->m_conclusionLayout->addWidget(this->m_diskDescLabel,    9, 0, 1, 1);
         this->m_conclusionLayout->addWidget(this->m_diskLabel,        9, 1, 1, 1);
+    } else if (useTemplate && !templatePath.isEmpty()) {
+        this->m_diskLabel->setText(tr("Linked to %1").arg(QFileInfo(templatePath).fileName()));
+        this->m_conclusionLayout->addWidget(this->m_diskDescLabel,    9, 0, 1, 1);
+        this->m_conclusionLayout->addWidget(this->m_diskLabel,        9, 1, 1, 1);
     } else {
         this->m_diskLabel->setText("");
         this->m_conclusionLayout->removeWidget(this->m_diskDescLabel);
@@ -129,6 +148,11 @@ void MachineConclusionPage::initializePage()
 
 bool MachineConclusionPage::validatePage()
 {
+    // The disk is still being created
+    if (this->m_diskJob != nullptr) {
+        return false;
+    }
+
     // Data to crontol the disk
     bool createNewDisk = field("createDisk").toBool();
     bool useDisk = field("useDisk").toBool();
@@ -136,6 +160,8 @@ bool MachineConclusionPage::validatePage()
     QString diskName = field("machine.diskname").toString();
     QString diskFormat = field("machine.diskFormat").toString();
     double diskSize = field("machine.diskSize").toDouble();
+    bool useTemplate = field("useTemplate").toBool();
+    QString templatePath = field("machine.templatePath").toString();
 
     QSettings settings;
     settings.beginGroup("Configuration");
@@ -150,24 +176,45 @@ bool MachineConclusionPage::validatePage()
                                       .append(this->m_newMachine->getName().toLower().replace(" ", "_"))
                                       .append(".json"));
 
-    if (createNewDisk) {
+    if (createNewDisk && !this->m_diskCreated) {
         QString diskPathName = machinesPath;
         diskPathName.append(diskName.toLower().replace(" ", "_"))
                     .append(QDir::toNativeSeparators("."))
                     .append(diskFormat);
 
-        bool isDiskCreated = SystemUtils::createDisk(this->m_QEMUGlobalObject,
-                                                     diskPathName,
-                                                     diskFormat,
-                                                     diskSize,
-                                                     false);
-        if (isDiskCreated) {
-            this->addMedia(diskName.toLower().replace(" ", "_"), diskFormat, diskPathName);
-        } else {
-            // If the creation of the disk fails
-            return false;
-        }
-    } else if (useDisk) {
+        // The page is validated again when the disk is created
+        this->m_diskJob = this->m_QEMUGlobalObject->QEMUImgJobs()->create(diskPathName,
+                                                                         diskFormat,
+                                                                         QString::number(diskSize) + "G");
+        connect(this->m_diskJob, &QEMUImgJob::finished,
+                this, [=](bool success) {
+            this->diskJobFinished(success, diskName.toLower().replace(" ", "_"), diskFormat, diskPathName);
+        });
+
+        this->m_diskProgressBar->setVisible(true);
+
+        return false;
+    } else if (useTemplate && !templatePath.isEmpty() && !this->m_diskCreated) {
+        QString diskPathName = machinesPath;
+        diskPathName.append(this->m_newMachine->getName().toLower().replace(" ", "_"))
+                    .append(".qcow2");
+
+        TemplateImage image = TemplateLibrary::getTemplate(templatePath);
+
+        // The disk only stores the changes made over the template
+        this->m_diskJob = this->m_QEMUGlobalObject->QEMUImgJobs()->createOverlay(diskPathName,
+                                                                                templatePath,
+                                                                                image.format);
+        connect(this->m_diskJob, &QEMUImgJob::finished,
+                this, [=](bool success) {
+            this->diskJobFinished(success, this->m_newMachine->getName().toLower().replace(" ", "_"),
+                                  "qcow2", diskPathName);
+        });
+
+        this->m_diskProgressBar->setVisible(true);
+
+        return false;
+    } else if (useDisk && !createNewDisk) {
         if (!existingDiskPath.isEmpty()) {
             // Add the existing media to the machine media
             QFileInfo existingDisk(existingDiskPath);
@@ -175,6 +222,13 @@ bool MachineConclusionPage::validatePage()
         }
     }
 
+    if (this->m_newMachine->getUseNetwork()) {
+        NetworkInterface *networkInterface = new NetworkInterface(this->m_newMachine);
+        networkInterface->setModel(NetworkInterface::defaultModel(this->m_newMachine->getOSType()));
+        networkInterface->setMACAddress(NetworkInterface::generateMACAddress());
+        this->m_newMachine->addNetworkInterface(networkInterface);
+    }
+
     // Set the uuid in this point to control the LoadUI in the mainwindow
     // don't move from here
     this->m_newMachine->setUuid(QUuid::createUuid());
@@ -182,6 +236,39 @@ bool MachineConclusionPage::validatePage()
     return true;
 }
 
+/**
+ * @brief The job that creates the disk is finished
+ * @param success, true if the disk is created
+ * @param name, name of the disk
+ * @param format, format of the disk
+ * @param path, path of the disk
+ *
+ * Add the disk to the machine and finish the wizard,
+ * or show the error of qemu-img
+ */
+void MachineConclusionPage::diskJobFinished(bool success,
+                                            const QString &name,
+                                            const QString &format,
+                                            const QString &path)
+{
+    QString errorString = this->m_diskJob->errorString();
+    this->m_diskJob = nullptr;
+    this->m_diskProgressBar->setVisible(false);
+
+    if (!success) {
+        SystemUtils::showMessage(tr("Qtemu - Critical error"),
+                                 tr("<p>Cannot finish qemu-img</p>"
+                                    "<p><strong>Image isn't created</strong></p>"
+                                    "<p>Error: %1</p>").arg(errorString),
+                                 QMessageBox::Critical);
+        return;
+    }
+
+    this->addMedia(name, format, path);
+    this->m_diskCreated = true;
+    this->wizard()->accept();
+}
+
 /**
  * @brief Generate the machine files
  *
@@ -230,7 +317,9 @@ void MachineConclusionPage::addMedia(const QString name,
     disk->setName(name+"."+format);
     disk->setPath(path);
     disk->setType("hdd");
+    disk->setFormat(format);
     disk->setDriveInterface("hda");
+    disk->setBus(Media::defaultBus("hdd", this->m_newMachine->getOSType()));
     disk->setUuid(QUuid::createUuid());
 
     this->m_newMachine->addMedia(disk);
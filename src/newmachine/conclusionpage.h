@@ -34,10 +34,13 @@
 #include <QJsonArray>
 #include <QUuid>
 #include <QFileInfo>
+#include <QProgressBar>
 
 // Local
 #include "../machine.h"
+#include "../utils/systemutils.h"
 #include "../utils/logger.h"
+#include "../utils/templatelibrary.h"
 
 class MachineConclusionPage: public QWizardPage {
     Q_OBJECT
@@ -79,8 +82,13 @@ class MachineConclusionPage: public QWizardPage {
         QLabel *m_acceleratorLabel;
         QLabel *m_diskLabel;
 
+        QProgressBar *m_diskProgressBar;
+
         QListWidget *m_osList;
 
+        QEMUImgJob *m_diskJob;
+        bool m_diskCreated;
+
         Machine *m_newMachine;
 
         QEMU *m_QEMUGlobalObject;
@@ -94,6 +102,10 @@ class MachineConclusionPage: public QWizardPage {
                       const QString format,
                       const QString paths);
         void generateBoot();
+        void diskJobFinished(bool success,
+                             const QString &name,
+                             const QString &format,
+                             const QString &path);
 };
 
 #endif // CONCLUSIONPAGE_H
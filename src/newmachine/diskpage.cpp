@@ -71,10 +71,30 @@ MachineDiskPage::MachineDiskPage(Machine *machine,
 
     this->useExistingDiskToggle(false);
 
+    m_useTemplateRadio = new QRadioButton(tr("Create a linked disk from a template"), this);
+    connect(m_useTemplateRadio, &QAbstractButton::toggled,
+            this, &MachineDiskPage::useTemplateToggle);
+
+    m_templateComboBox = new QComboBox(this);
+    foreach (const TemplateImage &image, TemplateLibrary::getTemplates()) {
+        m_templateComboBox->addItem(QString("%1 (%2)").arg(image.name, image.origin), image.path);
+    }
+    connect(m_templateComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MachineDiskPage::selectTemplate);
+
+    m_templatePathLineEdit = new QLineEdit(this);
+    m_templatePathLineEdit->setHidden(true);
+
+    // Without templates there's nothing to link
+    m_useTemplateRadio->setEnabled(m_templateComboBox->count() > 0);
+    this->useTemplateToggle(false);
+
     this->registerField("noDisk", this->m_noDiskRadio);
     this->registerField("createDisk", this->m_createDiskRadio);
     this->registerField("useDisk", this->m_useExistingDiskRadio);
     this->registerField("machine.diskPath", this->m_hardDiskPathLineEdit);
+    this->registerField("useTemplate", this->m_useTemplateRadio);
+    this->registerField("machine.templatePath", this->m_templatePathLineEdit);
 
     m_useOldDiskLayout = new QHBoxLayout();
     m_useOldDiskLayout->setAlignment(Qt::AlignVCenter);
@@ -90,6 +110,8 @@ MachineDiskPage::MachineDiskPage(Machine *machine,
     m_machineDiskLayout->addWidget(m_createDiskRadio);
     m_machineDiskLayout->addWidget(m_useExistingDiskRadio);
     m_machineDiskLayout->addItem(m_useOldDiskLayout);
+    m_machineDiskLayout->addWidget(m_useTemplateRadio);
+    m_machineDiskLayout->addWidget(m_templateComboBox);
 
     this->setLayout(m_machineDiskLayout);
 
@@ -133,6 +155,38 @@ void MachineDiskPage::useExistingDiskPath()
     }
 }
 
+/**
+ * @brief Use a template
+ * @param toggled, true enable the template combo
+ *
+ * Use a template of the library as base image of the
+ * new disk, enable or disable the combo to select it
+ */
+void MachineDiskPage::useTemplateToggle(bool toggled)
+{
+    this->m_templateComboBox->setEnabled(toggled);
+    if (toggled) {
+        this->selectTemplate(this->m_templateComboBox->currentIndex());
+    } else {
+        this->m_templatePathLineEdit->clear();
+    }
+}
+
+/**
+ * @brief Select a template
+ * @param index, index of the template in the combo
+ *
+ * Select the template used as base image of the new disk
+ */
+void MachineDiskPage::selectTemplate(int index)
+{
+    if (!this->m_useTemplateRadio->isChecked() || index < 0) {
+        return;
+    }
+
+    this->m_templatePathLineEdit->setText(this->m_templateComboBox->itemData(index).toString());
+}
+
 /**
  * @brief Decide the next wizard page
  * @return the page id
@@ -141,7 +195,8 @@ void MachineDiskPage::useExistingDiskPath()
  */
 int MachineDiskPage::nextId() const
 {
-    if(this->m_noDiskRadio->isChecked() || this->m_useExistingDiskRadio->isChecked()) {
+    if(this->m_noDiskRadio->isChecked() || this->m_useExistingDiskRadio->isChecked() ||
+       this->m_useTemplateRadio->isChecked()) {
         return MachineWizard::Page_Conclusion;
     } else {
         return MachineWizard::Page_New_Disk;
@@ -38,11 +38,13 @@
 #include <QSettings>
 #include <QDir>
 #include <QFileDialog>
+#include <QComboBox>
 
 // Local
 #include "../machine.h"
 #include "../machinewizard.h"
 #include "../utils/systemutils.h"
+#include "../utils/templatelibrary.h"
 
 class MachineDiskPage: public QWizardPage {
     Q_OBJECT
@@ -57,6 +59,8 @@ class MachineDiskPage: public QWizardPage {
     public slots:
         void useExistingDiskToggle(bool toggled);
         void useExistingDiskPath();
+        void useTemplateToggle(bool toggled);
+        void selectTemplate(int index);
 
     protected:
 
@@ -70,10 +74,14 @@ class MachineDiskPage: public QWizardPage {
         QRadioButton *m_noDiskRadio;
         QRadioButton *m_createDiskRadio;
         QRadioButton *m_useExistingDiskRadio;
+        QRadioButton *m_useTemplateRadio;
 
         QPushButton *m_pathNewDiskPushButton;
 
+        QComboBox *m_templateComboBox;
+
         QLineEdit *m_hardDiskPathLineEdit;
+        QLineEdit *m_templatePathLineEdit; // Its hidden - used to share data between QWizardPages
 
         QLabel *m_machineDiskLabel;
         QLabel *m_machineDiskInfoLabel;
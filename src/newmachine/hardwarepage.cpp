@@ -160,8 +160,9 @@ GraphicsTab::GraphicsTab(Machine *machine,
     m_GPUTypeLabel->setWordWrap(true);
     m_GPUType = new QComboBox(this);
     SystemUtils::setGPUTypes(m_GPUType);
-    m_GPUType->setCurrentIndex(1);
-    this->selectGraphics(1);
+    int GPUIndex = qMax(0, m_GPUType->findData("std"));
+    m_GPUType->setCurrentIndex(GPUIndex);
+    this->selectGraphics(GPUIndex);
 
     connect(m_GPUType, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &GraphicsTab::selectGraphics);
@@ -100,9 +100,13 @@ void MachinePage::setMachines()
     model->setHeaderData(0, Qt::Horizontal, QObject::tr("Machine"));
     model->setHeaderData(1, Qt::Horizontal, QObject::tr("Description"));
 
+    // Machines of the installed QEMU, when they're known
+    if (SystemUtils::setMachineTypes(model)) {
+        customFilter->setSourceModel(model);
+        return;
+    }
 
-    //Better reduce number of version machine
-    //Later it should parse result from qemu-system-x86_64.exe
+    // QEMU isn't probed yet, offer the common machines
 
     this->addMachine(model, "none", "empty machine");
     this->addMachine(model, "isapc", "ISA-only PC");
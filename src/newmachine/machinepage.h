@@ -27,10 +27,12 @@
 #include <QStandardItemModel>
 #include <QLineEdit>
 #include <QGridLayout>
+#include <QLabel>
 
 // Local
 #include "../components/customfilter.h"
 #include "../machine.h"
+#include "../utils/systemutils.h"
 
 class MachinePage: public QWizardPage {
     Q_OBJECT
@@ -41,7 +41,7 @@ MachineMemoryPage::MachineMemoryPage(Machine *machine,
     m_descriptionMemoryLabel->setWordWrap(true);
 
     int totalRAM = 0;
-    SystemUtils::getTotalMemory(totalRAM);
+    HostUtils::getTotalMemory(totalRAM);
     m_spinBoxMemoryLabel = new QLabel("MiB", this);
 
     m_memorySpinBox = new QSpinBox(this);
@@ -30,6 +30,12 @@
  */
 QEMU::QEMU(QObject *parent) : QObject(parent)
 {
+    this->m_lastSearch = 0;
+    this->m_searching = false;
+
+    this->m_searchPool = new QThreadPool(this);
+    this->m_searchPool->setMaxThreadCount(1);
+
     QSettings settings;
     settings.beginGroup("Configuration");
 
@@ -57,14 +63,31 @@ QEMU::QEMU(QObject *parent) : QObject(parent)
     this->setQEMUImgPath(qemuImgPath);
     this->setQEMUBinaries(qemuBinariesPath);
 
+    this->m_QEMUImgJobs = new QEMUImgJobRunner(this, this);
+
     qDebug() << "QEMU object created";
 }
 
 QEMU::~QEMU()
 {
+    this->m_searchPool->clear();
+    this->m_searchPool->waitForDone();
+
     qDebug() << "QEMU object destroyed";
 }
 
+/**
+ * @brief Get the qemu-img job runner
+ * @return qemu-img job runner
+ *
+ * Get the runner that executes the qemu-img
+ * jobs without blocking the UI
+ */
+QEMUImgJobRunner *QEMU::QEMUImgJobs() const
+{
+    return m_QEMUImgJobs;
+}
+
 /**
  * @brief Get the path of the qemu-img binary
  * @return path of qemu-img
@@ -127,21 +150,252 @@ QString QEMU::getQEMUBinary(const QString binary) const
  * @brief Set the QEMU binaries
  * @param path, path where the QEMU binaries are located
  *
- * Set the QEMU binaries
+ * Set the QEMU binaries. The binaries are searched in the path
+ * and in the directories of $PATH, without entering subdirectories.
+ * The last result is cached with the modification time of the
+ * directories, so it's used while no directory changes.
+ * The search runs out of the GUI thread and QEMUBinariesChanged
+ * is emitted if the binaries are different.
+ * QEMUBinariesSearchFinished is emitted when every search ends,
+ * even if no binary is found
  */
 void QEMU::setQEMUBinaries(const QString path)
 {
-    this->m_QEMUBinaries.clear();
+    QStringList directories = QEMU::binariesDirectories(path);
+    int search = ++this->m_lastSearch;
+
+    if (this->loadBinariesCache(directories)) {
+        this->m_searching = false;
+        emit(QEMUBinariesSearchFinished());
+        return;
+    }
+
+    this->m_searching = true;
+    this->m_searchPool->start([this, search, directories]() {
+        // Taken before the search, so a change during the search invalidates the cache
+        QJsonArray directoriesState = QEMU::binariesDirectoriesState(directories);
+        QMap<QString, QString> binaries = QEMU::findQEMUBinaries(directories);
+
+        QMetaObject::invokeMethod(this, [this, search, directoriesState, binaries]() {
+            this->binariesFound(search, directoriesState, binaries);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Get if the binaries are being searched
+ * @return true if the search isn't finished
+ *
+ * Get if the binaries are being searched
+ */
+bool QEMU::isSearchingBinaries() const
+{
+    return m_searching;
+}
+
+/**
+ * @brief Get the directories where the binaries are searched
+ * @param path, path configured by the user
+ * @return configured path followed by the directories of $PATH
+ *
+ * Get the directories where the binaries are searched,
+ * without duplicates and in order of preference
+ */
+QStringList QEMU::binariesDirectories(const QString &path)
+{
+    QStringList directories;
+    if (!path.isEmpty()) {
+        directories.append(QDir::cleanPath(path));
+    }
+
+    foreach (const QString &directory, qEnvironmentVariable("PATH").split(QDir::listSeparator(), Qt::SkipEmptyParts)) {
+        QString cleanDirectory = QDir::cleanPath(directory);
+        if (!directories.contains(cleanDirectory)) {
+            directories.append(cleanDirectory);
+        }
+    }
+
+    return directories;
+}
 
-    QDirIterator it(path, QStringList() << "qemu-system-*", QDir::NoFilter, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        it.next();
+/**
+ * @brief Find the QEMU binaries
+ * @param directories, directories where the binaries are searched
+ * @return name and path of the binaries
+ *
+ * Find the QEMU binaries in the directories, without entering
+ * subdirectories. Only executable files are taken. If a binary
+ * is in several directories, the first one is taken
+ */
+QMap<QString, QString> QEMU::findQEMUBinaries(const QStringList &directories)
+{
 #ifdef Q_OS_WIN
-        if (it.fileName().contains("w")) {
+    // The binaries without console window. Ex: qemu-system-x86_64w.exe
+    static const QRegularExpression binaryName("^qemu-system-[A-Za-z0-9_]+w\\.exe$",
+                                               QRegularExpression::CaseInsensitiveOption);
 #else
-        if (!it.fileName().contains("w")) {
+    static const QRegularExpression binaryName("^qemu-system-[A-Za-z0-9_]+$");
 #endif
-            this->m_QEMUBinaries.insert(it.fileName(), it.filePath());
+
+    QMap<QString, QString> binaries;
+    foreach (const QString &directory, directories) {
+        QFileInfoList candidates = QDir(directory).entryInfoList(QStringList() << "qemu-system-*",
+                                                                 QDir::Files | QDir::Executable,
+                                                                 QDir::Name);
+        foreach (const QFileInfo &candidate, candidates) {
+            if (binaries.contains(candidate.fileName()) ||
+                !binaryName.match(candidate.fileName()).hasMatch()) {
+                continue;
+            }
+
+            // Broken links and links to directories are discarded
+            if (!candidate.isFile() || !candidate.isExecutable()) {
+                continue;
+            }
+
+            binaries.insert(candidate.fileName(), QDir::toNativeSeparators(candidate.filePath()));
         }
     }
+
+    return binaries;
+}
+
+/**
+ * @brief Get the state of the directories
+ * @param directories, directories where the binaries are searched
+ * @return path and modification time of every directory
+ *
+ * Get the state of the directories. Adding, removing or renaming
+ * a binary changes the modification time of its directory
+ */
+QJsonArray QEMU::binariesDirectoriesState(const QStringList &directories)
+{
+    QJsonArray directoriesState;
+    foreach (const QString &directory, directories) {
+        QFileInfo directoryInfo(directory);
+
+        QJsonObject directoryState;
+        directoryState["path"] = directory;
+        directoryState["mtime"] = static_cast<double>(directoryInfo.exists() ?
+                                                      directoryInfo.lastModified().toMSecsSinceEpoch() : -1);
+        directoriesState.append(directoryState);
+    }
+
+    return directoriesState;
+}
+
+/**
+ * @brief Binaries found
+ * @param search, number of the search
+ * @param directoriesState, state of the directories before the search
+ * @param binaries, binaries found
+ *
+ * Keep the binaries found if no other search
+ * was started in the meantime
+ */
+void QEMU::binariesFound(int search, const QJsonArray &directoriesState,
+                         const QMap<QString, QString> &binaries)
+{
+    if (search != this->m_lastSearch) {
+        return;
+    }
+
+    this->m_searching = false;
+
+    if (binaries != this->m_QEMUBinaries) {
+        this->m_QEMUBinaries = binaries;
+        emit(QEMUBinariesChanged());
+    }
+
+    this->saveBinariesCache(directoriesState);
+
+    QEMUCapabilities::instance()->probe(this->m_QEMUBinaries);
+
+    emit(QEMUBinariesSearchFinished());
+}
+
+/**
+ * @brief Get the path of the binaries cache
+ * @return path of the cache file
+ *
+ * Get the path of the binaries cache
+ */
+QString QEMU::binariesCachePath() const
+{
+    QSettings settings;
+    settings.beginGroup("DataFolder");
+    QString dataDirectoryPath = settings.value("QtEmuData",
+                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
+    settings.endGroup();
+
+    return QDir::toNativeSeparators(dataDirectoryPath + "/binaries.json");
+}
+
+/**
+ * @brief Load the binaries from the cache
+ * @param directories, directories where the binaries are searched
+ * @return true if the cache is valid for the directories
+ *
+ * The cache is valid if it was made with the same directories
+ * and none of them was modified later
+ */
+bool QEMU::loadBinariesCache(const QStringList &directories)
+{
+    QFile cacheFile(this->binariesCachePath());
+    if (!cacheFile.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QJsonObject cache = QJsonDocument::fromJson(cacheFile.readAll()).object();
+    if (cache["directories"].toArray() != QEMU::binariesDirectoriesState(directories)) {
+        return false;
+    }
+
+    QMap<QString, QString> binaries;
+    QJsonObject cachedBinaries = cache["binaries"].toObject();
+    foreach (const QString &binary, cachedBinaries.keys()) {
+        binaries.insert(binary, cachedBinaries[binary].toString());
+    }
+
+    if (binaries != this->m_QEMUBinaries) {
+        this->m_QEMUBinaries = binaries;
+        emit(QEMUBinariesChanged());
+    }
+
+    QEMUCapabilities::instance()->probe(this->m_QEMUBinaries);
+
+    return true;
+}
+
+/**
+ * @brief Save the binaries in the cache
+ * @param directoriesState, state of the directories when they were searched
+ *
+ * Save the binaries and the state of the directories
+ */
+void QEMU::saveBinariesCache(const QJsonArray &directoriesState)
+{
+    QJsonObject cachedBinaries;
+    QMapIterator<QString, QString> binary(this->m_QEMUBinaries);
+    while (binary.hasNext()) {
+        binary.next();
+        cachedBinaries[binary.key()] = binary.value();
+    }
+
+    QJsonObject cache;
+    cache["directories"] = directoriesState;
+    cache["binaries"] = cachedBinaries;
+
+    QDir().mkpath(QFileInfo(this->binariesCachePath()).absolutePath());
+
+    QSaveFile cacheFile(this->binariesCachePath());
+    if (!cacheFile.open(QFile::WriteOnly)) {
+        qDebug() << "Cannot write the binaries cache" << cacheFile.errorString();
+        return;
+    }
+
+    cacheFile.write(QJsonDocument(cache).toJson(QJsonDocument::Compact));
+    if (!cacheFile.commit()) {
+        qDebug() << "Cannot write the binaries cache" << cacheFile.errorString();
+    }
 }
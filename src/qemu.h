@@ -24,14 +24,24 @@
 
 // Qt
 #include <QObject>
-#include <QDirIterator>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QMap>
 #include <QSettings>
+#include <QThreadPool>
+#include <QRegularExpression>
 #include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 
 #include <QDebug>
 
+// Local
+#include "utils/qemuimgjobrunner.h"
+#include "qemucapabilities.h"
+
 class QEMU : public QObject {
     Q_OBJECT
 
@@ -45,12 +55,36 @@ class QEMU : public QObject {
         QMap<QString, QString> QEMUBinaries() const;
         QString getQEMUBinary(const QString binary) const;
         void setQEMUBinaries(const QString path);
+        bool isSearchingBinaries() const;
+
+        QEMUImgJobRunner *QEMUImgJobs() const;
+
+        static QStringList binariesDirectories(const QString &path);
+        static QJsonArray binariesDirectoriesState(const QStringList &directories);
+        static QMap<QString, QString> findQEMUBinaries(const QStringList &directories);
+
+    signals:
+        void QEMUBinariesChanged();
+        void QEMUBinariesSearchFinished();
 
     protected:
 
     private:
         QString m_QEMUImgPath;
         QMap<QString, QString> m_QEMUBinaries;
+        QEMUImgJobRunner *m_QEMUImgJobs;
+
+        // Search of the binaries, out of the GUI thread
+        QThreadPool *m_searchPool;
+        int m_lastSearch;
+        bool m_searching;
+
+        // Methods
+        QString binariesCachePath() const;
+        bool loadBinariesCache(const QStringList &directories);
+        void saveBinariesCache(const QJsonArray &directoriesState);
+        void binariesFound(int search, const QJsonArray &directoriesState,
+                           const QMap<QString, QString> &binaries);
 
 };
 
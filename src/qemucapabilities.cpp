@@ -0,0 +1,539 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "qemucapabilities.h"
+
+// Time for a binary to answer all the queries
+static const int PROBE_TIMEOUT = 15000;
+
+// Version of the cache file. Increase it when the stored data changes
+static const int CACHE_VERSION = 1;
+
+/**
+ * @brief Capabilities of the QEMU binaries
+ * @param parent, parent object
+ *
+ * Machine types, CPU models, devices and accelerators supported
+ * by every QEMU binary. Every binary is started once with an empty
+ * machine and queried through QMP. The answers are cached on disk
+ * by path, modification time and size, so a binary is only probed
+ * again when it changes
+ */
+QEMUCapabilities::QEMUCapabilities(QObject *parent) : QObject(parent)
+{
+    this->m_cacheLoaded = false;
+
+    qDebug() << "QEMUCapabilities created";
+}
+
+QEMUCapabilities::~QEMUCapabilities()
+{
+    foreach (QProcess *process, this->m_probes.keys()) {
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished(1000);
+    }
+
+    qDebug() << "QEMUCapabilities destroyed";
+}
+
+/**
+ * @brief Get the capabilities
+ * @return capabilities of the QEMU binaries
+ *
+ * Get the capabilities of the QEMU binaries
+ */
+QEMUCapabilities *QEMUCapabilities::instance()
+{
+    static QEMUCapabilities *capabilities = new QEMUCapabilities(QCoreApplication::instance());
+
+    return capabilities;
+}
+
+/**
+ * @brief Get the binary used by the machines
+ * @return name of the binary
+ *
+ * Get the name of the binary used to run the machines
+ */
+QString QEMUCapabilities::defaultBinary()
+{
+#ifdef Q_OS_WIN
+    return "qemu-system-x86_64w.exe";
+#else
+    return "qemu-system-x86_64";
+#endif
+}
+
+/**
+ * @brief Probe the binaries
+ * @param binaries, name and path of the binaries
+ *
+ * Take the capabilities of the binaries from the cache and
+ * probe the ones that aren't in the cache or have changed.
+ * The binaries are probed in parallel, without blocking
+ */
+void QEMUCapabilities::probe(const QMap<QString, QString> &binaries)
+{
+    if (!this->m_cacheLoaded) {
+        this->loadCache();
+    }
+
+    QMapIterator<QString, QString> binary(binaries);
+    while (binary.hasNext()) {
+        binary.next();
+
+        if (this->isCacheValid(this->m_capabilities.value(binary.key()), binary.value())) {
+            continue;
+        }
+
+        bool probing = false;
+        foreach (const Probe &probe, this->m_probes) {
+            probing = probing || probe.path == binary.value();
+        }
+        if (probing || this->m_pendingBinaries.contains(qMakePair(binary.key(), binary.value()))) {
+            continue;
+        }
+
+        this->m_pendingBinaries.append(qMakePair(binary.key(), binary.value()));
+    }
+
+    int maxProbes = qMax(1, QThread::idealThreadCount());
+    while (!this->m_pendingBinaries.isEmpty() && this->m_probes.size() < maxProbes) {
+        this->startNextProbe();
+    }
+}
+
+/**
+ * @brief Get if there are binaries being probed
+ * @return true if some binary is being probed
+ *
+ * Get if there are binaries being probed
+ */
+bool QEMUCapabilities::isProbing() const
+{
+    return !this->m_probes.isEmpty() || !this->m_pendingBinaries.isEmpty();
+}
+
+/**
+ * @brief Get if the capabilities of a binary are known
+ * @param binary, name of the binary
+ * @return true if the binary is probed
+ *
+ * Get if the capabilities of a binary are known
+ */
+bool QEMUCapabilities::hasCapabilities(const QString &binary) const
+{
+    return this->m_capabilities.contains(binary);
+}
+
+/**
+ * @brief Get the capabilities of a binary
+ * @param binary, name of the binary
+ * @return capabilities of the binary, empty if unknown
+ *
+ * Get all the capabilities of a binary
+ */
+QJsonObject QEMUCapabilities::capabilities(const QString &binary) const
+{
+    return this->m_capabilities.value(binary);
+}
+
+/**
+ * @brief Get the machine types of a binary
+ * @param binary, name of the binary
+ * @return machine types, with name, description, alias and default
+ *
+ * Get the machine types supported by a binary
+ */
+QList<QJsonObject> QEMUCapabilities::machineTypes(const QString &binary) const
+{
+    QList<QJsonObject> machineTypes;
+    foreach (const QJsonValue &machineType, this->m_capabilities.value(binary)["machines"].toArray()) {
+        machineTypes.append(machineType.toObject());
+    }
+
+    return machineTypes;
+}
+
+/**
+ * @brief Get the CPU models of a binary
+ * @param binary, name of the binary
+ * @return CPU models
+ *
+ * Get the CPU models supported by a binary
+ */
+QStringList QEMUCapabilities::CPUModels(const QString &binary) const
+{
+    QStringList CPUModels;
+    foreach (const QJsonValue &CPUModel, this->m_capabilities.value(binary)["cpus"].toArray()) {
+        CPUModels.append(CPUModel.toString());
+    }
+
+    return CPUModels;
+}
+
+/**
+ * @brief Get if a binary has a device
+ * @param binary, name of the binary
+ * @param device, QOM type of the device. Ex: AC97, qxl-vga...
+ * @return true if the device is available. If the binary isn't
+ * probed yet, every device is considered available
+ *
+ * Get if a binary has a device
+ */
+bool QEMUCapabilities::hasDevice(const QString &binary, const QString &device) const
+{
+    if (!this->m_devices.contains(binary)) {
+        return true;
+    }
+
+    return this->m_devices.value(binary).contains(device);
+}
+
+/**
+ * @brief Get the accelerators of a binary
+ * @param binary, name of the binary
+ * @return accelerators built in the binary. Ex: kvm, tcg
+ *
+ * Get the accelerators built in a binary
+ */
+QStringList QEMUCapabilities::accelerators(const QString &binary) const
+{
+    QStringList accelerators;
+    foreach (const QJsonValue &accelerator, this->m_capabilities.value(binary)["accelerators"].toArray()) {
+        accelerators.append(accelerator.toString());
+    }
+
+    return accelerators;
+}
+
+/**
+ * @brief Get the path of the cache
+ * @return path of the cache file
+ *
+ * Get the path of the cache file
+ */
+QString QEMUCapabilities::cachePath() const
+{
+    QSettings settings;
+    settings.beginGroup("DataFolder");
+    QString dataDirectoryPath = settings.value("QtEmuData",
+                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
+    settings.endGroup();
+
+    return QDir::toNativeSeparators(dataDirectoryPath + "/capabilities.json");
+}
+
+/**
+ * @brief Probe process started
+ *
+ * Enter in command mode and send all the queries.
+ * QEMU answers them in order and quits
+ */
+void QEMUCapabilities::probeStarted()
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    if (process == nullptr) {
+        return;
+    }
+
+    QJsonObject devicesArguments;
+    devicesArguments["implements"] = "device";
+    devicesArguments["abstract"] = false;
+
+    QJsonObject acceleratorsArguments;
+    acceleratorsArguments["implements"] = "accel";
+    acceleratorsArguments["abstract"] = false;
+
+    QList<QJsonObject> commands;
+    commands << QJsonObject{{"execute", "qmp_capabilities"}}
+             << QJsonObject{{"execute", "query-machines"}, {"id", "machines"}}
+             << QJsonObject{{"execute", "query-cpu-definitions"}, {"id", "cpus"}}
+             << QJsonObject{{"execute", "qom-list-types"}, {"arguments", devicesArguments}, {"id", "devices"}}
+             << QJsonObject{{"execute", "qom-list-types"}, {"arguments", acceleratorsArguments}, {"id", "accelerators"}}
+             << QJsonObject{{"execute", "query-kvm"}, {"id", "kvm"}}
+             << QJsonObject{{"execute", "quit"}};
+
+    foreach (const QJsonObject &command, commands) {
+        process->write(QJsonDocument(command).toJson(QJsonDocument::Compact));
+        process->write("\n");
+    }
+}
+
+/**
+ * @brief Read the answers of QEMU
+ *
+ * Keep the answers of the queries by id
+ */
+void QEMUCapabilities::probeReadyRead()
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    if (process == nullptr || !this->m_probes.contains(process)) {
+        return;
+    }
+
+    Probe &probe = this->m_probes[process];
+    probe.buffer.append(process->readAllStandardOutput());
+
+    int newLinePos = probe.buffer.indexOf('\n');
+    while (newLinePos != -1) {
+        QJsonObject message = QJsonDocument::fromJson(probe.buffer.left(newLinePos)).object();
+        probe.buffer.remove(0, newLinePos + 1);
+
+        QString id = message["id"].toString();
+        if (!id.isEmpty() && message.contains("return")) {
+            probe.results[id] = message["return"];
+        }
+
+        newLinePos = probe.buffer.indexOf('\n');
+    }
+}
+
+/**
+ * @brief Probe process finished
+ *
+ * Probe process finished
+ */
+void QEMUCapabilities::probeFinishedProcess()
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    if (process != nullptr) {
+        this->finishProbe(process);
+    }
+}
+
+/**
+ * @brief Finish the probe of a binary
+ * @param process, process of the probe
+ *
+ * Store the capabilities of the binary
+ * and probe the next one
+ */
+void QEMUCapabilities::finishProbe(QProcess *process)
+{
+    if (!this->m_probes.contains(process)) {
+        return;
+    }
+
+    Probe probe = this->m_probes.take(process);
+    process->deleteLater();
+
+    if (!probe.results.contains("machines")) {
+        qDebug() << "Cannot probe" << probe.path << process->errorString();
+    } else {
+        QFileInfo binaryInfo(probe.path);
+
+        QJsonObject capabilities;
+        capabilities["path"] = probe.path;
+        capabilities["mtime"] = static_cast<double>(binaryInfo.lastModified().toMSecsSinceEpoch());
+        capabilities["size"] = static_cast<double>(binaryInfo.size());
+
+        QJsonArray machines;
+        foreach (const QJsonValue &machineValue, probe.results["machines"].toArray()) {
+            QJsonObject machineObject = machineValue.toObject();
+            QJsonObject machine;
+            machine["name"] = machineObject["name"];
+            machine["description"] = machineObject["desc"];
+            machine["alias"] = machineObject["alias"];
+            machine["default"] = machineObject["is-default"].toBool();
+            machine["deprecated"] = machineObject["deprecated"].toBool();
+            machines.append(machine);
+        }
+        capabilities["machines"] = machines;
+
+        QJsonArray cpus;
+        foreach (const QJsonValue &cpu, probe.results["cpus"].toArray()) {
+            cpus.append(cpu.toObject()["name"]);
+        }
+        capabilities["cpus"] = cpus;
+
+        QJsonArray devices;
+        foreach (const QJsonValue &device, probe.results["devices"].toArray()) {
+            devices.append(device.toObject()["name"]);
+        }
+        capabilities["devices"] = devices;
+
+        QJsonArray accelerators;
+        foreach (const QJsonValue &accelerator, probe.results["accelerators"].toArray()) {
+            QString acceleratorName = accelerator.toObject()["name"].toString();
+            accelerators.append(acceleratorName.remove(QRegularExpression("-accel$")));
+        }
+        capabilities["accelerators"] = accelerators;
+        capabilities["kvm"] = probe.results["kvm"];
+
+        this->setCapabilities(probe.binary, capabilities);
+        this->saveCache();
+
+        emit(capabilitiesChanged(probe.binary));
+    }
+
+    if (!this->m_pendingBinaries.isEmpty()) {
+        this->startNextProbe();
+    } else if (this->m_probes.isEmpty()) {
+        emit(probeFinished());
+    }
+}
+
+/**
+ * @brief Load the cache
+ *
+ * Load the capabilities stored in the cache
+ */
+void QEMUCapabilities::loadCache()
+{
+    this->m_cacheLoaded = true;
+
+    QFile cacheFile(this->cachePath());
+    if (!cacheFile.open(QFile::ReadOnly)) {
+        return;
+    }
+
+    QJsonObject cache = QJsonDocument::fromJson(cacheFile.readAll()).object();
+    if (cache["version"].toInt() != CACHE_VERSION) {
+        return;
+    }
+
+    QJsonObject binaries = cache["binaries"].toObject();
+    foreach (const QString &binary, binaries.keys()) {
+        this->setCapabilities(binary, binaries[binary].toObject());
+    }
+}
+
+/**
+ * @brief Save the cache
+ *
+ * Replace the cache file with the known capabilities
+ */
+void QEMUCapabilities::saveCache()
+{
+    QJsonObject binaries;
+    QHashIterator<QString, QJsonObject> capabilities(this->m_capabilities);
+    while (capabilities.hasNext()) {
+        capabilities.next();
+        binaries[capabilities.key()] = capabilities.value();
+    }
+
+    QJsonObject cache;
+    cache["version"] = CACHE_VERSION;
+    cache["binaries"] = binaries;
+
+    QDir().mkpath(QFileInfo(this->cachePath()).absolutePath());
+
+    QSaveFile cacheFile(this->cachePath());
+    if (!cacheFile.open(QFile::WriteOnly)) {
+        qDebug() << "Cannot write the capabilities cache" << cacheFile.errorString();
+        return;
+    }
+
+    cacheFile.write(QJsonDocument(cache).toJson(QJsonDocument::Compact));
+    if (!cacheFile.commit()) {
+        qDebug() << "Cannot write the capabilities cache" << cacheFile.errorString();
+    }
+}
+
+/**
+ * @brief Start the probe of the next binary
+ *
+ * Start the binary with an empty machine and
+ * the QMP server in the standard input and output
+ */
+void QEMUCapabilities::startNextProbe()
+{
+    QPair<QString, QString> binary = this->m_pendingBinaries.takeFirst();
+
+    QProcess *process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::SeparateChannels);
+
+    Probe probe;
+    probe.binary = binary.first;
+    probe.path = binary.second;
+    this->m_probes.insert(process, probe);
+
+    connect(process, &QProcess::started,
+            this, &QEMUCapabilities::probeStarted);
+    connect(process, &QProcess::readyReadStandardOutput,
+            this, &QEMUCapabilities::probeReadyRead);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &QEMUCapabilities::probeFinishedProcess);
+    connect(process, &QProcess::errorOccurred,
+            this, [=](QProcess::ProcessError error) {
+        // finished isn't emitted if the binary cannot be started
+        if (error == QProcess::FailedToStart) {
+            this->finishProbe(process);
+        }
+    });
+
+    // A binary that doesn't answer is killed
+    QTimer::singleShot(PROBE_TIMEOUT, process, [=]() {
+        process->kill();
+    });
+
+    QStringList args;
+    args << "-S"
+         << "-no-user-config"
+         << "-nodefaults"
+         << "-display" << "none"
+         << "-machine" << "none"
+         << "-qmp" << "stdio";
+
+    process->start(binary.second, args);
+}
+
+/**
+ * @brief Check if the cached capabilities are valid
+ * @param capabilities, cached capabilities
+ * @param path, path of the binary
+ * @return true if the binary didn't change
+ *
+ * The capabilities are valid while the path, the
+ * modification time and the size of the binary match
+ */
+bool QEMUCapabilities::isCacheValid(const QJsonObject &capabilities, const QString &path) const
+{
+    if (capabilities.isEmpty()) {
+        return false;
+    }
+
+    QFileInfo binaryInfo(path);
+
+    return capabilities["path"].toString() == path &&
+           static_cast<qint64>(capabilities["mtime"].toDouble()) == binaryInfo.lastModified().toMSecsSinceEpoch() &&
+           static_cast<qint64>(capabilities["size"].toDouble()) == binaryInfo.size();
+}
+
+/**
+ * @brief Set the capabilities of a binary
+ * @param binary, name of the binary
+ * @param capabilities, capabilities of the binary
+ *
+ * Set the capabilities of a binary and index its devices
+ */
+void QEMUCapabilities::setCapabilities(const QString &binary, const QJsonObject &capabilities)
+{
+    QSet<QString> devices;
+    foreach (const QJsonValue &device, capabilities["devices"].toArray()) {
+        devices.insert(device.toString());
+    }
+
+    this->m_capabilities.insert(binary, capabilities);
+    this->m_devices.insert(binary, devices);
+}
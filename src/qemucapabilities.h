@@ -0,0 +1,107 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QEMUCAPABILITIES_H
+#define QEMUCAPABILITIES_H
+
+// Qt
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QRegularExpression>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+class QEMUCapabilities : public QObject {
+    Q_OBJECT
+
+    public:
+        static QEMUCapabilities *instance();
+
+        void probe(const QMap<QString, QString> &binaries);
+        bool isProbing() const;
+
+        bool hasCapabilities(const QString &binary) const;
+        QJsonObject capabilities(const QString &binary) const;
+
+        QList<QJsonObject> machineTypes(const QString &binary) const;
+        QStringList CPUModels(const QString &binary) const;
+        bool hasDevice(const QString &binary, const QString &device) const;
+        QStringList accelerators(const QString &binary) const;
+
+        QString cachePath() const;
+
+        static QString defaultBinary();
+
+    signals:
+        void capabilitiesChanged(const QString &binary);
+        void probeFinished();
+
+    public slots:
+
+    private slots:
+        void probeStarted();
+        void probeReadyRead();
+        void probeFinishedProcess();
+
+    protected:
+
+    private:
+        explicit QEMUCapabilities(QObject *parent = nullptr);
+        ~QEMUCapabilities();
+
+        struct Probe {
+            QString binary;
+            QString path;
+            QByteArray buffer;
+            QJsonObject results;
+        };
+
+        // Capabilities by binary name, and the devices of every binary
+        QHash<QString, QJsonObject> m_capabilities;
+        QHash<QString, QSet<QString>> m_devices;
+        bool m_cacheLoaded;
+
+        // Binaries waiting to be probed and probes running
+        QList<QPair<QString, QString>> m_pendingBinaries;
+        QHash<QProcess *, Probe> m_probes;
+
+        // Methods
+        void loadCache();
+        void saveCache();
+        void startNextProbe();
+        void finishProbe(QProcess *process);
+        bool isCacheValid(const QJsonObject &capabilities, const QString &path) const;
+        void setCapabilities(const QString &binary, const QJsonObject &capabilities);
+};
+
+#endif // QEMUCAPABILITIES_H
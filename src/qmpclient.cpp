@@ -0,0 +1,382 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "qmpclient.h"
+
+// Time between two connection attempts and number of attempts.
+// QEMU creates the socket a little after the process is started
+static const int RETRY_INTERVAL = 100;
+static const int MAX_RETRIES = 50;
+
+/**
+ * @brief QMP client
+ * @param parent, parent object
+ *
+ * Client of the QEMU Machine Protocol.
+ * Commands are sent without blocking and the responses
+ * are matched with the commands by id. The asynchronous
+ * events of QEMU are emitted as signals
+ */
+QMPClient::QMPClient(QObject *parent) : QObject(parent)
+{
+    this->m_state = QMPClient::Disconnected;
+    this->m_port = 0;
+    this->m_retries = 0;
+    this->m_maxRetries = MAX_RETRIES;
+    this->m_nextId = 0;
+
+    this->m_retryTimer = new QTimer(this);
+    this->m_retryTimer->setSingleShot(true);
+    this->m_retryTimer->setInterval(RETRY_INTERVAL);
+    connect(m_retryTimer, &QTimer::timeout,
+            this, &QMPClient::retryConnection);
+
+    this->m_socket = new QMPSocket(this);
+    connect(m_socket, &QMPSocket::readyRead,
+            this, &QMPClient::socketReadyRead);
+    connect(m_socket, &QMPSocket::connected,
+            this, &QMPClient::socketConnected);
+    connect(m_socket, &QMPSocket::disconnected,
+            this, &QMPClient::socketDisconnected);
+    // The server is not listening yet, try again later
+    connect(m_socket, &QMPSocket::errorOccurred,
+            this, [=]() {
+        if (this->m_state == QMPClient::Connecting) {
+            this->m_retryTimer->start();
+        }
+    });
+
+    qDebug() << "QMPClient object created";
+}
+
+QMPClient::~QMPClient()
+{
+    qDebug() << "QMPClient object destroyed";
+}
+
+/**
+ * @brief Get the state of the connection
+ * @return state of the connection
+ *
+ * Get the state of the connection
+ */
+QMPClient::States QMPClient::state() const
+{
+    return m_state;
+}
+
+/**
+ * @brief Get if the client can send commands
+ * @return true if the capabilities negotiation is finished
+ *
+ * Get if the client can send commands
+ */
+bool QMPClient::isReady() const
+{
+    return m_state == QMPClient::Ready;
+}
+
+/**
+ * @brief Set the number of connection attempts
+ * @param retries, attempts after the first one
+ *
+ * Set the number of connection attempts. A client that
+ * only asks the state of a machine doesn't wait for QEMU
+ */
+void QMPClient::setMaxRetries(int retries)
+{
+    this->m_maxRetries = qMax(0, retries);
+}
+
+/**
+ * @brief Connect to the QMP server of the machine
+ * @param serverName, path of the socket or host name in Windows
+ * @param port, port of the server. Only used in Windows
+ *
+ * Connect to the QMP server of the machine.
+ * If the server is not available yet, the connection
+ * is retried without blocking
+ */
+void QMPClient::connectToMachine(const QString &serverName, quint16 port)
+{
+    this->disconnectFromMachine();
+
+    this->m_serverName = serverName;
+    this->m_port = port;
+    this->m_retries = 0;
+    this->m_state = QMPClient::Connecting;
+
+    this->openSocket();
+}
+
+/**
+ * @brief Disconnect from the QMP server
+ *
+ * Disconnect from the QMP server and discard
+ * all the pending commands
+ */
+void QMPClient::disconnectFromMachine()
+{
+    this->m_retryTimer->stop();
+    this->m_state = QMPClient::Disconnected;
+    this->m_buffer.clear();
+    this->m_pendingCommands.clear();
+    this->m_queuedCommands.clear();
+
+    if (this->m_socket->state() != QMPSocket::UnconnectedState) {
+        this->m_socket->abort();
+    }
+}
+
+/**
+ * @brief Execute a QMP command
+ * @param command, name of the command. Ex: stop, cont, system_reset...
+ * @param arguments, arguments of the command
+ * @param callback, function called with the response of QEMU
+ * @return id of the command
+ *
+ * Execute a QMP command without waiting for the response.
+ * If the negotiation isn't finished yet, the command is
+ * queued and sent when the client is ready
+ */
+int QMPClient::execute(const QString &command,
+                       const QJsonObject &arguments,
+                       ResponseCallback callback)
+{
+    int id = ++this->m_nextId;
+
+    QJsonObject commandObject;
+    commandObject["execute"] = command;
+    commandObject["id"] = id;
+    if (!arguments.isEmpty()) {
+        commandObject["arguments"] = arguments;
+    }
+
+    PendingCommand pendingCommand;
+    pendingCommand.command = command;
+    pendingCommand.callback = callback;
+    this->m_pendingCommands.insert(id, pendingCommand);
+
+    QByteArray rawCommand = QJsonDocument(commandObject).toJson(QJsonDocument::Compact);
+    if (this->m_state == QMPClient::Ready) {
+        this->writeCommand(rawCommand);
+    } else {
+        this->m_queuedCommands.append(rawCommand);
+    }
+
+    return id;
+}
+
+/**
+ * @brief Socket connected
+ *
+ * Wait for the greeting of the server
+ */
+void QMPClient::socketConnected()
+{
+    this->m_state = QMPClient::Negotiating;
+}
+
+/**
+ * @brief Read the data sent by QEMU
+ *
+ * Every QMP message ends with a new line.
+ * Complete messages are processed and the rest
+ * is kept for the next read
+ */
+void QMPClient::socketReadyRead()
+{
+    this->m_buffer.append(this->m_socket->readAll());
+
+    int newLinePos = this->m_buffer.indexOf('\n');
+    while (newLinePos != -1) {
+        QByteArray line = this->m_buffer.left(newLinePos).trimmed();
+        this->m_buffer.remove(0, newLinePos + 1);
+
+        if (!line.isEmpty()) {
+            QJsonParseError parseError;
+            QJsonDocument message = QJsonDocument::fromJson(line, &parseError);
+            if (parseError.error == QJsonParseError::NoError && message.isObject()) {
+                this->processMessage(message.object());
+            } else {
+                qDebug() << "QMP invalid message" << line;
+            }
+        }
+
+        newLinePos = this->m_buffer.indexOf('\n');
+    }
+}
+
+/**
+ * @brief Socket disconnected
+ *
+ * Socket disconnected, usually because QEMU is finished
+ */
+void QMPClient::socketDisconnected()
+{
+    if (this->m_state == QMPClient::Disconnected) {
+        return;
+    }
+
+    this->m_state = QMPClient::Disconnected;
+    this->m_pendingCommands.clear();
+    this->m_queuedCommands.clear();
+
+    emit(disconnected());
+}
+
+/**
+ * @brief Retry the connection with the server
+ *
+ * Retry the connection with the server until the
+ * maximum number of retries is reached
+ */
+void QMPClient::retryConnection()
+{
+    if (this->m_state != QMPClient::Connecting) {
+        return;
+    }
+
+    if (++this->m_retries > this->m_maxRetries) {
+        qDebug() << "QMP server not available" << this->m_serverName;
+        this->m_state = QMPClient::Disconnected;
+        this->m_queuedCommands.clear();
+        emit(disconnected());
+        return;
+    }
+
+    this->openSocket();
+}
+
+/**
+ * @brief Open the socket
+ *
+ * Open the socket with the server
+ */
+void QMPClient::openSocket()
+{
+#ifdef Q_OS_WIN
+    this->m_socket->connectToHost(this->m_serverName, this->m_port, QIODevice::ReadWrite);
+#else
+    this->m_socket->connectToServer(this->m_serverName, QIODevice::ReadWrite);
+#endif
+}
+
+/**
+ * @brief Write the command in the socket
+ * @param command, command in JSON format
+ *
+ * Write the command in the socket
+ */
+void QMPClient::writeCommand(const QByteArray &command)
+{
+    this->m_socket->write(command);
+    this->m_socket->write("\n");
+}
+
+/**
+ * @brief Process a message sent by QEMU
+ * @param message, message of QEMU
+ *
+ * A message can be the greeting, a response or an event
+ */
+void QMPClient::processMessage(const QJsonObject &message)
+{
+    if (message.contains("QMP")) {
+        // Greeting. Enter in command mode
+        QJsonObject capabilities;
+        capabilities["execute"] = "qmp_capabilities";
+        capabilities["id"] = 0;
+        this->writeCommand(QJsonDocument(capabilities).toJson(QJsonDocument::Compact));
+    } else if (message.contains("event")) {
+        this->processEvent(message);
+    } else if (message.contains("return") || message.contains("error")) {
+        this->processResponse(message);
+    }
+}
+
+/**
+ * @brief Process the response of a command
+ * @param response, response of QEMU
+ *
+ * Match the response with the command and call the callback
+ */
+void QMPClient::processResponse(const QJsonObject &response)
+{
+    int id = response["id"].toInt(-1);
+
+    if (id == 0 && this->m_state == QMPClient::Negotiating) {
+        if (response.contains("error")) {
+            qDebug() << "QMP capabilities negotiation failed" << response;
+            this->disconnectFromMachine();
+            emit(disconnected());
+            return;
+        }
+
+        this->m_state = QMPClient::Ready;
+        foreach (const QByteArray &command, this->m_queuedCommands) {
+            this->writeCommand(command);
+        }
+        this->m_queuedCommands.clear();
+
+        emit(ready());
+        return;
+    }
+
+    if (!this->m_pendingCommands.contains(id)) {
+        return;
+    }
+
+    PendingCommand pendingCommand = this->m_pendingCommands.take(id);
+
+    if (response.contains("error")) {
+        QJsonObject error = response["error"].toObject();
+        emit(commandFailed(pendingCommand.command, error["desc"].toString()));
+    }
+
+    if (pendingCommand.callback) {
+        pendingCommand.callback(response);
+    }
+}
+
+/**
+ * @brief Process an asynchronous event
+ * @param event, event sent by QEMU
+ *
+ * Emit the signal associated with the event
+ */
+void QMPClient::processEvent(const QJsonObject &event)
+{
+    QString eventName = event["event"].toString();
+    QJsonObject data = event["data"].toObject();
+
+    emit(eventReceived(eventName, data));
+
+    if (eventName == "STOP") {
+        emit(stopped());
+    } else if (eventName == "RESUME") {
+        emit(resumed());
+    } else if (eventName == "SHUTDOWN") {
+        emit(shutdown(data["guest"].toBool()));
+    } else if (eventName == "RESET") {
+        emit(reset(data["guest"].toBool()));
+    }
+}
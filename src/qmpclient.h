@@ -0,0 +1,117 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QMPCLIENT_H
+#define QMPCLIENT_H
+
+// Qt
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <QTcpSocket>
+typedef QTcpSocket QMPSocket;
+#else
+#include <QLocalSocket>
+typedef QLocalSocket QMPSocket;
+#endif
+
+// C++ standard library
+#include <functional>
+
+class QMPClient : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit QMPClient(QObject *parent = nullptr);
+        ~QMPClient();
+
+        typedef std::function<void(const QJsonObject &response)> ResponseCallback;
+
+        enum States {
+            Disconnected, Connecting, Negotiating, Ready
+        };
+
+        QMPClient::States state() const;
+        bool isReady() const;
+
+        void setMaxRetries(int retries);
+        void connectToMachine(const QString &serverName, quint16 port = 0);
+        void disconnectFromMachine();
+
+        int execute(const QString &command,
+                    const QJsonObject &arguments = QJsonObject(),
+                    ResponseCallback callback = nullptr);
+
+    signals:
+        void ready();
+        void disconnected();
+        void commandFailed(const QString &command, const QString &error);
+        void eventReceived(const QString &event, const QJsonObject &data);
+        void stopped();
+        void resumed();
+        void shutdown(bool guest);
+        void reset(bool guest);
+
+    public slots:
+
+    private slots:
+        void socketConnected();
+        void socketReadyRead();
+        void socketDisconnected();
+        void retryConnection();
+
+    protected:
+
+    private:
+        struct PendingCommand {
+            QString command;
+            ResponseCallback callback;
+        };
+
+        States m_state;
+
+        QMPSocket *m_socket;
+        QString m_serverName;
+        quint16 m_port;
+
+        QTimer *m_retryTimer;
+        int m_retries;
+        int m_maxRetries;
+
+        QByteArray m_buffer;
+        int m_nextId;
+        QHash<int, PendingCommand> m_pendingCommands;
+        QList<QByteArray> m_queuedCommands;
+
+        // Methods
+        void openSocket();
+        void writeCommand(const QByteArray &command);
+        void processMessage(const QJsonObject &message);
+        void processResponse(const QJsonObject &response);
+        void processEvent(const QJsonObject &event);
+};
+
+#endif // QMPCLIENT_H
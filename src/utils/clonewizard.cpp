@@ -0,0 +1,251 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "clonewizard.h"
+
+/**
+ * @brief Wizard to clone a machine
+ * @param machine, machine to be cloned
+ * @param cloneMachine, new machine
+ * @param QEMUGlobalObject, QEMU global object with data about QEMU
+ * @param osList, list with all the machines
+ * @param parent, parent widget
+ *
+ * Wizard to clone a machine
+ */
+CloneWizard::CloneWizard(Machine *machine,
+                         Machine *cloneMachine,
+                         QEMU *QEMUGlobalObject,
+                         QListWidget *osList,
+                         QWidget *parent) : QWizard(parent)
+{
+    this->setWindowTitle(tr("Clone machine"));
+    this->setPage(Page_Clone, new ClonePage(machine, cloneMachine, QEMUGlobalObject, osList, this));
+    this->setStartId(Page_Clone);
+
+#ifndef Q_OS_MAC
+    this->setWizardStyle(ClassicStyle);
+#endif
+#ifdef Q_OS_MAC
+    this->setWizardStyle(MacStyle);
+#endif
+
+    this->setPixmap(QWizard::WatermarkPixmap, QPixmap(":/images/banner.png"));
+    this->setPixmap(QWizard::BackgroundPixmap, QPixmap(":/images/banner.png"));
+    this->setMinimumSize(700, 400);
+
+    qDebug() << "CloneWizard created";
+}
+
+CloneWizard::~CloneWizard()
+{
+    qDebug() << "CloneWizard destroyed";
+}
+
+/**
+ * @brief Clone page
+ * @param machine, machine to be cloned
+ * @param cloneMachine, new machine
+ * @param QEMUGlobalObject, QEMU global object with data about QEMU
+ * @param osList, list with all the machines
+ * @param parent, parent widget
+ *
+ * Clone page. A linked clone uses qcow2 overlays over the
+ * images of the template library, a full clone copies the disks
+ */
+ClonePage::ClonePage(Machine *machine,
+                     Machine *cloneMachine,
+                     QEMU *QEMUGlobalObject,
+                     QListWidget *osList,
+                     QWidget *parent) : QWizardPage(parent)
+{
+    this->setTitle(tr("Clone machine"));
+
+    this->m_machine = machine;
+    this->m_cloneMachine = cloneMachine;
+    this->m_osList = osList;
+    this->m_cloneFinished = false;
+
+    this->m_cloner = new MachineCloner(machine, cloneMachine, QEMUGlobalObject->QEMUImgJobs(), this);
+    connect(m_cloner, &MachineCloner::progressChanged,
+            this, &ClonePage::updateProgress);
+    connect(m_cloner, &MachineCloner::finished,
+            this, &ClonePage::cloneFinished);
+
+    m_cloneNameGroupBox = new QGroupBox(tr("Name of the new machine"), this);
+
+    m_cloneNameLineEdit = new QLineEdit(this);
+    m_cloneNameLineEdit->setText(tr("%1 clone").arg(this->m_machine->getName()));
+
+    QHBoxLayout *cloneNameLayout = new QHBoxLayout();
+    cloneNameLayout->addWidget(m_cloneNameLineEdit);
+    m_cloneNameGroupBox->setLayout(cloneNameLayout);
+
+    m_cloneTypeGroupBox = new QGroupBox(tr("Clone type"), this);
+
+    m_linkedCloneRadio = new QRadioButton(tr("Linked clone"), this);
+    m_linkedCloneRadio->setChecked(true);
+    m_fullCloneRadio = new QRadioButton(tr("Full clone"), this);
+
+    m_linkedCloneLabel = new QLabel(tr("A linked clone stores only its own changes in a qcow2 image. "
+                                       "The disks of the machine are moved to the template library "
+                                       "and become read-only, both machines use them as base image."), this);
+    m_linkedCloneLabel->setWordWrap(true);
+
+    m_cloneTypeLayout = new QVBoxLayout();
+    m_cloneTypeLayout->addWidget(m_linkedCloneRadio);
+    m_cloneTypeLayout->addWidget(m_linkedCloneLabel);
+    m_cloneTypeLayout->addWidget(m_fullCloneRadio);
+    m_cloneTypeGroupBox->setLayout(m_cloneTypeLayout);
+
+    m_cloneProgressBar = new QProgressBar(this);
+    m_cloneProgressBar->setVisible(false);
+
+    m_cloneLayout = new QVBoxLayout();
+    m_cloneLayout->addWidget(m_cloneNameGroupBox);
+    m_cloneLayout->addWidget(m_cloneTypeGroupBox);
+    m_cloneLayout->addStretch(1);
+    m_cloneLayout->addWidget(m_cloneProgressBar);
+
+    this->setLayout(m_cloneLayout);
+
+    qDebug() << "ClonePage created";
+}
+
+ClonePage::~ClonePage()
+{
+    // The wizard is closed while the disks are being created
+    this->m_cloner->cancel();
+
+    qDebug() << "ClonePage destroyed";
+}
+
+/**
+ * @brief Validate the page
+ * @return true when the clone is finished
+ *
+ * Start the clone. The page is validated again
+ * when all the disks are created
+ */
+bool ClonePage::validatePage()
+{
+    if (this->m_cloner->isRunning()) {
+        return false;
+    }
+
+    if (this->m_cloneFinished) {
+        return true;
+    }
+
+    return this->startClone();
+}
+
+/**
+ * @brief Start the clone
+ * @return true if the machine is cloned without creating disks
+ *
+ * Start the clone of the machine. The disks
+ * are created without blocking the wizard
+ */
+bool ClonePage::startClone()
+{
+    QString cloneName = this->m_cloneNameLineEdit->text().trimmed();
+    if (cloneName.isEmpty()) {
+        SystemUtils::showMessage(tr("Qtemu - Clone machine"),
+                                 tr("<p>Enter the name of the new machine</p>"),
+                                 QMessageBox::Warning);
+        return false;
+    }
+
+    if (!this->m_cloner->start(cloneName, this->m_linkedCloneRadio->isChecked())) {
+        SystemUtils::showMessage(tr("Qtemu - Clone machine"),
+                                 tr("<p>Cannot clone the machine</p>"
+                                    "<p>%1</p>").arg(this->m_cloner->errorString()),
+                                 QMessageBox::Warning);
+        return false;
+    }
+
+    if (this->m_cloner->isFinished()) {
+        this->addMachineItem();
+        return true;
+    }
+
+    this->m_cloneProgressBar->setRange(0, 100);
+    this->m_cloneProgressBar->setValue(0);
+    this->m_cloneProgressBar->setVisible(true);
+    this->m_cloneNameGroupBox->setEnabled(false);
+    this->m_cloneTypeGroupBox->setEnabled(false);
+
+    return false;
+}
+
+/**
+ * @brief The clone is finished
+ * @param success, true if the disks are created
+ *
+ * Close the wizard or show the error
+ * of the clone, that is already undone
+ */
+void ClonePage::cloneFinished(bool success)
+{
+    this->m_cloneProgressBar->setVisible(false);
+
+    if (!success) {
+        this->m_cloneNameGroupBox->setEnabled(true);
+        this->m_cloneTypeGroupBox->setEnabled(true);
+
+        SystemUtils::showMessage(tr("Qtemu - Critical error"),
+                                 tr("<p>Cannot clone the machine</p>"
+                                    "<p>Error: %1</p>").arg(this->m_cloner->errorString()),
+                                 QMessageBox::Critical);
+        return;
+    }
+
+    this->addMachineItem();
+    this->wizard()->accept();
+}
+
+/**
+ * @brief Update the progress of the clone
+ * @param progress, progress of the clone, from 0 to 100
+ *
+ * Update the progress bar
+ */
+void ClonePage::updateProgress(double progress)
+{
+    this->m_cloneProgressBar->setValue(static_cast<int>(progress));
+}
+
+/**
+ * @brief Add the new machine to the list
+ *
+ * Add the new machine to the list and select it
+ */
+void ClonePage::addMachineItem()
+{
+    QListWidgetItem *machineItem = new QListWidgetItem(this->m_cloneMachine->getName(), this->m_osList);
+    machineItem->setData(QMetaType::QUuid, this->m_cloneMachine->getUuid());
+    machineItem->setIcon(QIcon(":/images/os/64x64/" +
+                               SystemUtils::getOsIcon(this->m_cloneMachine->getOSVersion())));
+    this->m_osList->setCurrentItem(machineItem);
+
+    this->m_cloneFinished = true;
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CLONEWIZARD_H
+#define CLONEWIZARD_H
+
+// Qt
+#include <QWizard>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QGroupBox>
+#include <QRadioButton>
+#include <QLineEdit>
+#include <QLabel>
+#include <QListWidget>
+#include <QProgressBar>
+#include <QSettings>
+#include <QDir>
+#include <QFileInfo>
+
+// Local
+#include "../machine.h"
+#include "../qemu.h"
+#include "systemutils.h"
+#include "machinecloner.h"
+
+class CloneWizard : public QWizard {
+    Q_OBJECT
+
+    public:
+        explicit CloneWizard(Machine *machine,
+                             Machine *cloneMachine,
+                             QEMU *QEMUGlobalObject,
+                             QListWidget *osList,
+                             QWidget *parent = nullptr);
+        ~CloneWizard();
+
+        enum { Page_Clone };
+
+    signals:
+
+    public slots:
+
+    protected:
+
+    private:
+
+};
+
+class ClonePage: public QWizardPage {
+    Q_OBJECT
+
+    public:
+        explicit ClonePage(Machine *machine,
+                           Machine *cloneMachine,
+                           QEMU *QEMUGlobalObject,
+                           QListWidget *osList,
+                           QWidget *parent = nullptr);
+        ~ClonePage();
+
+    signals:
+
+    private slots:
+        void cloneFinished(bool success);
+        void updateProgress(double progress);
+
+    protected:
+
+    private:
+        QVBoxLayout *m_cloneLayout;
+        QVBoxLayout *m_cloneTypeLayout;
+
+        QGroupBox *m_cloneNameGroupBox;
+        QGroupBox *m_cloneTypeGroupBox;
+
+        QLineEdit *m_cloneNameLineEdit;
+
+        QRadioButton *m_linkedCloneRadio;
+        QRadioButton *m_fullCloneRadio;
+
+        QLabel *m_linkedCloneLabel;
+
+        QProgressBar *m_cloneProgressBar;
+
+        MachineCloner *m_cloner;
+        bool m_cloneFinished;
+
+        Machine *m_machine;
+        Machine *m_cloneMachine;
+        QListWidget *m_osList;
+
+        // Methods
+        bool validatePage();
+        bool startClone();
+        void addMachineItem();
+};
+
+#endif // CLONEWIZARD_H
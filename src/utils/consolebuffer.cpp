@@ -0,0 +1,195 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "consolebuffer.h"
+
+// Number of chunks kept. QEMU writes small chunks, so the
+// limit of bytes is usually reached first
+static const int MAX_CHUNKS = 4096;
+
+/**
+ * @brief Console output of a machine
+ * @param capacity, maximum number of bytes kept
+ * @param parent, parent object
+ *
+ * Ring buffer with the last output of QEMU.
+ * The chunks read from the process are kept as they are,
+ * without copying them, and the oldest chunks are
+ * dropped when the buffer is full
+ */
+ConsoleBuffer::ConsoleBuffer(int capacity, QObject *parent) : QObject(parent)
+{
+    this->m_chunks.resize(MAX_CHUNKS);
+    this->m_first = 0;
+    this->m_count = 0;
+    this->m_size = 0;
+    this->m_capacity = capacity;
+    this->m_lastSequence = 0;
+
+    qDebug() << "ConsoleBuffer created";
+}
+
+ConsoleBuffer::~ConsoleBuffer()
+{
+    qDebug() << "ConsoleBuffer destroyed";
+}
+
+/**
+ * @brief Add output to the buffer
+ * @param channel, channel of the output
+ * @param data, output of QEMU
+ *
+ * Add output to the buffer. If the buffer is full
+ * the oldest chunks are dropped
+ */
+void ConsoleBuffer::append(ConsoleBuffer::Channels channel, const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    // Only the end of a huge chunk fits in the buffer
+    QByteArray chunkData = data.size() > this->m_capacity ? data.right(this->m_capacity) : data;
+
+    while (this->m_count > 0 &&
+           (this->m_count == MAX_CHUNKS || this->m_size + chunkData.size() > this->m_capacity)) {
+        this->dropFirst();
+    }
+
+    ConsoleChunk &chunk = this->m_chunks[(this->m_first + this->m_count) % MAX_CHUNKS];
+    chunk.sequence = ++this->m_lastSequence;
+    chunk.timestamp = QDateTime::currentMSecsSinceEpoch();
+    chunk.channel = channel;
+    chunk.data = chunkData;
+
+    ++this->m_count;
+    this->m_size += chunkData.size();
+
+    emit(chunkAppended(chunk.sequence));
+}
+
+/**
+ * @brief Empty the buffer
+ *
+ * Empty the buffer. The sequence numbers are kept,
+ * so the readers know that the output is gone
+ */
+void ConsoleBuffer::clear()
+{
+    while (this->m_count > 0) {
+        this->dropFirst();
+    }
+}
+
+/**
+ * @brief Get the chunks added after a sequence number
+ * @param sequence, last sequence number read
+ * @param truncated, set to true if some chunks were dropped before being read
+ * @return chunks added after the sequence number, oldest first
+ *
+ * Get the chunks added after a sequence number.
+ * The data of the chunks is shared with the buffer
+ */
+QList<ConsoleChunk> ConsoleBuffer::chunksSince(qint64 sequence, bool *truncated) const
+{
+    QList<ConsoleChunk> chunks;
+
+    qint64 firstSequence = this->m_lastSequence - this->m_count + 1;
+    if (truncated != nullptr) {
+        *truncated = sequence + 1 < firstSequence;
+    }
+
+    if (sequence >= this->m_lastSequence) {
+        return chunks;
+    }
+
+    int skip = static_cast<int>(qMax<qint64>(0, sequence + 1 - firstSequence));
+    chunks.reserve(this->m_count - skip);
+    for (int i = skip; i < this->m_count; ++i) {
+        chunks.append(this->m_chunks.at((this->m_first + i) % MAX_CHUNKS));
+    }
+
+    return chunks;
+}
+
+/**
+ * @brief Get the sequence number of the last chunk
+ * @return sequence number of the last chunk
+ *
+ * Get the sequence number of the last chunk
+ */
+qint64 ConsoleBuffer::lastSequence() const
+{
+    return m_lastSequence;
+}
+
+/**
+ * @brief Get the bytes in the buffer
+ * @return bytes in the buffer
+ *
+ * Get the bytes in the buffer
+ */
+int ConsoleBuffer::size() const
+{
+    return m_size;
+}
+
+/**
+ * @brief Get the maximum bytes of the buffer
+ * @return maximum bytes of the buffer
+ *
+ * Get the maximum bytes of the buffer
+ */
+int ConsoleBuffer::capacity() const
+{
+    return m_capacity;
+}
+
+/**
+ * @brief Clean the output of QEMU
+ * @param text, output of QEMU
+ * @return text without terminal control sequences
+ *
+ * Remove the terminal control sequences and the carriage
+ * returns that QEMU writes when the monitor is in the stdio
+ */
+QString ConsoleBuffer::cleanText(const QString &text)
+{
+    static const QRegularExpression controlSequences("\x1b\\[[0-9;?]*[A-Za-z]|\x1b[()][A-Za-z0-9]|\r");
+
+    QString cleanText = text;
+    return cleanText.remove(controlSequences);
+}
+
+/**
+ * @brief Drop the oldest chunk
+ *
+ * Drop the oldest chunk and release its data
+ */
+void ConsoleBuffer::dropFirst()
+{
+    ConsoleChunk &chunk = this->m_chunks[this->m_first];
+    this->m_size -= chunk.data.size();
+    chunk.data = QByteArray();
+
+    this->m_first = (this->m_first + 1) % MAX_CHUNKS;
+    --this->m_count;
+}
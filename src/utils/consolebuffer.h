@@ -0,0 +1,81 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CONSOLEBUFFER_H
+#define CONSOLEBUFFER_H
+
+// Qt
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QDebug>
+
+struct ConsoleChunk {
+    qint64 sequence;
+    qint64 timestamp;
+    int channel;
+    QByteArray data;
+};
+
+class ConsoleBuffer : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit ConsoleBuffer(int capacity = 1024 * 1024,
+                               QObject *parent = nullptr);
+        ~ConsoleBuffer();
+
+        enum Channels {
+            StandardOut, StandardError, Info
+        };
+
+        void append(ConsoleBuffer::Channels channel, const QByteArray &data);
+        void clear();
+
+        QList<ConsoleChunk> chunksSince(qint64 sequence, bool *truncated = nullptr) const;
+        qint64 lastSequence() const;
+        int size() const;
+        int capacity() const;
+
+        static QString cleanText(const QString &text);
+
+    signals:
+        void chunkAppended(qint64 sequence);
+
+    public slots:
+
+    protected:
+
+    private:
+        QVector<ConsoleChunk> m_chunks;
+        int m_first;
+        int m_count;
+        int m_size;
+        int m_capacity;
+        qint64 m_lastSequence;
+
+        // Methods
+        void dropFirst();
+};
+
+#endif // CONSOLEBUFFER_H
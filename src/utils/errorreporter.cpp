@@ -0,0 +1,88 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "errorreporter.h"
+
+ErrorReporter::Handler ErrorReporter::s_handler = nullptr;
+QMutex ErrorReporter::s_handlerMutex;
+
+/**
+ * @brief Report a message to the user
+ * @param title, title of the message
+ * @param text, text of the message, it can have HTML tags
+ * @param severity, severity of the message
+ *
+ * Report a message to the user. The core of QtEmu doesn't know
+ * how the message is shown: the graphical interface shows a
+ * dialog and the command line prints it. Without a handler
+ * the message is only written in the log
+ */
+void ErrorReporter::report(const QString &title, const QString &text,
+                           ErrorReporter::Severity severity)
+{
+    Handler handler;
+    {
+        QMutexLocker locker(&s_handlerMutex);
+        handler = s_handler;
+    }
+
+    Logger::log(severity == ErrorReporter::Critical ? Logger::Error :
+                severity == ErrorReporter::Warning ? Logger::Warning : Logger::Info,
+                title + ": " + ErrorReporter::plainText(text));
+
+    if (handler) {
+        handler(title, text, severity);
+    } else {
+        qWarning().noquote() << title + ":" << ErrorReporter::plainText(text);
+    }
+}
+
+/**
+ * @brief Set the handler of the messages
+ * @param handler, function that shows the messages
+ *
+ * Set the function that shows the messages to the user
+ */
+void ErrorReporter::setHandler(Handler handler)
+{
+    QMutexLocker locker(&s_handlerMutex);
+    s_handler = handler;
+}
+
+/**
+ * @brief Get the text of a message without HTML
+ * @param text, text of the message
+ * @return text without the HTML tags
+ *
+ * Remove the HTML tags of a message, every
+ * paragraph is written in a new line
+ */
+QString ErrorReporter::plainText(const QString &text)
+{
+    static const QRegularExpression paragraphs("</p>\\s*<p>|<br\\s*/?>");
+    static const QRegularExpression tags("<[^>]*>");
+
+    QString plainText = text;
+    plainText.replace(paragraphs, "\n");
+    plainText.remove(tags);
+
+    return plainText.trimmed();
+}
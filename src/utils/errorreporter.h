@@ -0,0 +1,59 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef ERRORREPORTER_H
+#define ERRORREPORTER_H
+
+// Qt
+#include <QString>
+#include <QRegularExpression>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDebug>
+
+// C++ standard library
+#include <functional>
+
+// Local
+#include "logger.h"
+
+class ErrorReporter {
+
+    public:
+        enum Severity {
+            Information, Warning, Critical
+        };
+
+        typedef std::function<void(const QString &title,
+                                   const QString &text,
+                                   ErrorReporter::Severity severity)> Handler;
+
+        static void report(const QString &title, const QString &text,
+                           ErrorReporter::Severity severity);
+        static void setHandler(Handler handler);
+
+        static QString plainText(const QString &text);
+
+    private:
+        static Handler s_handler;
+        static QMutex s_handlerMutex;
+};
+
+#endif // ERRORREPORTER_H
@@ -0,0 +1,351 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "hosttopology.h"
+
+// Host CPUs used by the running machines
+QHash<QUuid, QList<int>> HostTopology::m_reservedCPUs;
+
+HostTopology::HostTopology()
+{
+    qDebug() << "HostTopology created";
+}
+
+HostTopology::~HostTopology()
+{
+    qDebug() << "HostTopology destroyed";
+}
+
+/**
+ * @brief Get the CPUs of the host
+ * @return online CPUs of the host
+ *
+ * Read the package, core and NUMA node of every
+ * online CPU from /sys/devices/system/cpu.
+ * SMT siblings share the package and the core
+ */
+QList<HostCPU> HostTopology::getHostCPUs()
+{
+    QList<HostCPU> hostCPUs;
+
+#ifdef Q_OS_LINUX
+    QFile onlineFile("/sys/devices/system/cpu/online");
+    if (!onlineFile.open(QFile::ReadOnly)) {
+        return hostCPUs;
+    }
+
+    QList<int> onlineCPUs = HostTopology::parseCPUList(QString::fromLatin1(onlineFile.readAll()));
+
+    foreach (int CPUId, onlineCPUs) {
+        QString CPUPath = QString("/sys/devices/system/cpu/cpu%1").arg(CPUId);
+
+        HostCPU hostCPU;
+        hostCPU.id = CPUId;
+        hostCPU.package = HostTopology::readTopologyValue(CPUPath + "/topology/physical_package_id");
+        hostCPU.core = HostTopology::readTopologyValue(CPUPath + "/topology/core_id");
+        hostCPU.node = 0;
+
+        // The NUMA node is a link named nodeN in the directory of the CPU
+        QStringList nodes = QDir(CPUPath).entryList(QStringList("node*"), QDir::Dirs);
+        if (!nodes.isEmpty()) {
+            hostCPU.node = nodes.first().mid(4).toInt();
+        }
+
+        hostCPUs.append(hostCPU);
+    }
+#endif
+
+    return hostCPUs;
+}
+
+/**
+ * @brief Get a description of the host topology
+ * @return description of the host topology
+ *
+ * Get the number of packages, cores, threads
+ * and NUMA nodes of the host
+ */
+QString HostTopology::getTopologyLabel()
+{
+    QList<HostCPU> hostCPUs = HostTopology::getHostCPUs();
+    if (hostCPUs.isEmpty()) {
+        return QString();
+    }
+
+    QList<int> packages;
+    QList<int> nodes;
+    QList<QPair<int, int>> cores;
+    foreach (const HostCPU &hostCPU, hostCPUs) {
+        if (!packages.contains(hostCPU.package)) {
+            packages.append(hostCPU.package);
+        }
+        if (!nodes.contains(hostCPU.node)) {
+            nodes.append(hostCPU.node);
+        }
+        if (!cores.contains(qMakePair(hostCPU.package, hostCPU.core))) {
+            cores.append(qMakePair(hostCPU.package, hostCPU.core));
+        }
+    }
+
+    return QObject::tr("Host: %1 packages, %2 cores, %3 threads, %4 NUMA nodes")
+           .arg(packages.size()).arg(cores.size()).arg(hostCPUs.size()).arg(nodes.size());
+}
+
+/**
+ * @brief Parse a list of CPUs
+ * @param CPUList, list of CPUs. Ex: 0-3,8,10-11
+ * @return CPUs of the list, empty if the list is wrong
+ *
+ * Parse a list of CPUs in the format used by the kernel
+ */
+QList<int> HostTopology::parseCPUList(const QString &CPUList)
+{
+    QList<int> CPUs;
+
+    QStringList ranges = CPUList.trimmed().split(',', Qt::SkipEmptyParts);
+    foreach (const QString &range, ranges) {
+        QStringList limits = range.trimmed().split('-');
+
+        bool validFirst = false;
+        bool validLast = false;
+        int first = limits.first().toInt(&validFirst);
+        int last = limits.last().toInt(&validLast);
+
+        if (limits.size() > 2 || !validFirst || !validLast || first < 0 || last < first) {
+            return QList<int>();
+        }
+
+        for (int CPU = first; CPU <= last; ++CPU) {
+            if (!CPUs.contains(CPU)) {
+                CPUs.append(CPU);
+            }
+        }
+    }
+
+    return CPUs;
+}
+
+/**
+ * @brief Format a list of CPUs
+ * @param CPUs, CPUs to format
+ * @return list of CPUs. Ex: 0-3,8
+ *
+ * Format a list of CPUs in the format used by the kernel
+ */
+QString HostTopology::formatCPUList(QList<int> CPUs)
+{
+    std::sort(CPUs.begin(), CPUs.end());
+
+    QStringList ranges;
+    int i = 0;
+    while (i < CPUs.size()) {
+        int last = i;
+        while (last + 1 < CPUs.size() && CPUs.at(last + 1) == CPUs.at(last) + 1) {
+            ++last;
+        }
+
+        if (last == i) {
+            ranges.append(QString::number(CPUs.at(i)));
+        } else {
+            ranges.append(QString("%1-%2").arg(CPUs.at(i)).arg(CPUs.at(last)));
+        }
+        i = last + 1;
+    }
+
+    return ranges.join(',');
+}
+
+/**
+ * @brief Reserve host CPUs for a machine
+ * @param machineUuid, uuid of the machine
+ * @param count, number of CPUs
+ * @return CPUs reserved, empty if there aren't enough free CPUs
+ *
+ * Automatic placement. The CPUs aren't shared with the
+ * other running machines, the SMT siblings are kept together
+ * and a single NUMA node is used when the machine fits in it.
+ * The core of the CPU 0 is used the last one, because
+ * it usually handles the interrupts of the host
+ */
+QList<int> HostTopology::reserveCPUs(const QUuid &machineUuid, const int count)
+{
+    HostTopology::releaseCPUs(machineUuid);
+
+    QList<int> usedCPUs;
+    foreach (const QList<int> &CPUs, m_reservedCPUs) {
+        usedCPUs.append(CPUs);
+    }
+
+    int housekeepingPackage = -1;
+    int housekeepingCore = -1;
+
+    QMap<int, QList<HostCPU>> freeCPUs;
+    foreach (const HostCPU &hostCPU, HostTopology::getHostCPUs()) {
+        if (hostCPU.id == 0) {
+            housekeepingPackage = hostCPU.package;
+            housekeepingCore = hostCPU.core;
+        }
+        if (!usedCPUs.contains(hostCPU.id)) {
+            freeCPUs[hostCPU.node].append(hostCPU);
+        }
+    }
+
+    auto CPUOrder = [=](const HostCPU &first, const HostCPU &second) {
+        bool firstHousekeeping = first.package == housekeepingPackage && first.core == housekeepingCore;
+        bool secondHousekeeping = second.package == housekeepingPackage && second.core == housekeepingCore;
+        if (firstHousekeeping != secondHousekeeping) {
+            return secondHousekeeping;
+        }
+        if (first.package != second.package) {
+            return first.package < second.package;
+        }
+        if (first.core != second.core) {
+            return first.core < second.core;
+        }
+        return first.id < second.id;
+    };
+
+    QList<HostCPU> candidates;
+    QMapIterator<int, QList<HostCPU>> nodesIterator(freeCPUs);
+    while (nodesIterator.hasNext()) {
+        nodesIterator.next();
+        if (nodesIterator.value().size() >= count) {
+            candidates = nodesIterator.value();
+            break;
+        }
+        candidates.append(nodesIterator.value());
+    }
+
+    if (count <= 0 || candidates.size() < count) {
+        return QList<int>();
+    }
+
+    std::sort(candidates.begin(), candidates.end(), CPUOrder);
+
+    QList<int> CPUs;
+    for (int i = 0; i < count; ++i) {
+        CPUs.append(candidates.at(i).id);
+    }
+
+    m_reservedCPUs.insert(machineUuid, CPUs);
+
+    return CPUs;
+}
+
+/**
+ * @brief Reserve the host CPUs selected for a machine
+ * @param machineUuid, uuid of the machine
+ * @param CPUs, CPUs selected
+ *
+ * Reserve the CPUs of an explicit cpuset, so the
+ * automatic placement of other machines avoid them
+ */
+void HostTopology::reserveCPUs(const QUuid &machineUuid, const QList<int> &CPUs)
+{
+    m_reservedCPUs.insert(machineUuid, CPUs);
+}
+
+/**
+ * @brief Release the host CPUs of a machine
+ * @param machineUuid, uuid of the machine
+ *
+ * Release the host CPUs of a machine
+ */
+void HostTopology::releaseCPUs(const QUuid &machineUuid)
+{
+    m_reservedCPUs.remove(machineUuid);
+}
+
+/**
+ * @brief Get the threads of a process
+ * @param processId, id of the process
+ * @return ids of the threads
+ *
+ * Get the threads of a process from /proc/<pid>/task
+ */
+QList<qint64> HostTopology::getProcessThreads(const qint64 processId)
+{
+    QList<qint64> threads;
+
+#ifdef Q_OS_LINUX
+    QDir tasksDir(QString("/proc/%1/task").arg(processId));
+    foreach (const QString &task, tasksDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        bool validTask = false;
+        qint64 threadId = task.toLongLong(&validTask);
+        if (validTask) {
+            threads.append(threadId);
+        }
+    }
+#else
+    Q_UNUSED(processId)
+#endif
+
+    return threads;
+}
+
+/**
+ * @brief Set the affinity of a thread
+ * @param threadId, id of the thread
+ * @param CPUs, host CPUs where the thread can run
+ * @return true if the affinity is changed
+ *
+ * Set the affinity of a thread with sched_setaffinity
+ */
+bool HostTopology::setThreadAffinity(const qint64 threadId, const QList<int> &CPUs)
+{
+#ifdef Q_OS_LINUX
+    cpu_set_t CPUSet;
+    CPU_ZERO(&CPUSet);
+    foreach (int CPU, CPUs) {
+        if (CPU < CPU_SETSIZE) {
+            CPU_SET(CPU, &CPUSet);
+        }
+    }
+
+    if (sched_setaffinity(static_cast<pid_t>(threadId), sizeof(CPUSet), &CPUSet) != 0) {
+        qDebug() << "Cannot set the affinity of the thread" << threadId;
+        return false;
+    }
+
+    return true;
+#else
+    Q_UNUSED(threadId)
+    Q_UNUSED(CPUs)
+    return false;
+#endif
+}
+
+/**
+ * @brief Read a value of the topology
+ * @param path, path of the file
+ * @return value of the file, 0 if cannot be read
+ *
+ * Read a value of the topology
+ */
+int HostTopology::readTopologyValue(const QString &path)
+{
+    QFile topologyFile(path);
+    if (!topologyFile.open(QFile::ReadOnly)) {
+        return 0;
+    }
+
+    return topologyFile.readAll().trimmed().toInt();
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef HOSTTOPOLOGY_H
+#define HOSTTOPOLOGY_H
+
+// Qt
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QUuid>
+#include <QDebug>
+
+// C++ standard library
+#include <algorithm>
+
+// GNU
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+struct HostCPU {
+    int id;
+    int package;
+    int core;
+    int node;
+};
+
+class HostTopology {
+
+    public:
+        HostTopology();
+        ~HostTopology();
+
+        static QList<HostCPU> getHostCPUs();
+        static QString getTopologyLabel();
+
+        static QList<int> parseCPUList(const QString &CPUList);
+        static QString formatCPUList(QList<int> CPUs);
+
+        static QList<int> reserveCPUs(const QUuid &machineUuid, const int count);
+        static void reserveCPUs(const QUuid &machineUuid, const QList<int> &CPUs);
+        static void releaseCPUs(const QUuid &machineUuid);
+
+        static QList<qint64> getProcessThreads(const qint64 processId);
+        static bool setThreadAffinity(const qint64 threadId, const QList<int> &CPUs);
+
+    private:
+        static QHash<QUuid, QList<int>> m_reservedCPUs;
+
+        static int readTopologyValue(const QString &path);
+};
+
+#endif // HOSTTOPOLOGY_H
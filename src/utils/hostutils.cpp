@@ -0,0 +1,387 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "hostutils.h"
+
+/**
+ * @brief Get the total RAM installed on the system
+ * @param totalRAM, variable to store the total ram
+ *
+ * Get the total RAM installed on the system
+ */
+void HostUtils::getTotalMemory(int &totalRAM)
+{
+#ifdef Q_OS_LINUX
+    struct sysinfo sys_info;
+    if (sysinfo(&sys_info) != -1) {
+        totalRAM = static_cast<int>(((sys_info.totalram * sys_info.mem_unit) * 0.976562) / 1024 / 1024);
+    }
+#endif
+#ifdef Q_OS_WIN
+    MEMORYSTATUSEX statex;
+    statex.dwLength = sizeof (statex);
+    GlobalMemoryStatusEx (&statex);
+    totalRAM = static_cast<int>(statex.ullTotalPhys / (1024 * 1024));
+#endif
+#ifdef Q_OS_MACOS
+    size_t len;
+    unsigned long memory;
+    len = sizeof(memory);
+    sysctlbyname("hw.memsize", &memory, &len, NULL, 0);
+    totalRAM = static_cast<int>(((memory) * 0.976562) / 1024 / 1024);
+#endif
+#ifdef Q_OS_FREEBSD
+    size_t len;
+    unsigned long memory;
+    len = sizeof(memory);
+    sysctlbyname("hw.physmem", &memory, &len, NULL, 0);
+    totalRAM = static_cast<int>(((memory) * 0.976562) / 1024 / 1024);
+#endif
+}
+
+/**
+ * @brief Get the RAM available for new processes
+ * @param availableRAM, variable to store the available ram
+ *
+ * Get the RAM that can be used without swapping, in MiB.
+ * In Linux the page cache that can be reclaimed is included
+ */
+void HostUtils::getAvailableMemory(int &availableRAM)
+{
+#ifdef Q_OS_LINUX
+    QFile memInfoFile("/proc/meminfo");
+    if (memInfoFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        // Ex: MemAvailable:   12345678 kB
+        foreach (const QByteArray &line, memInfoFile.readAll().split('\n')) {
+            if (line.startsWith("MemAvailable:")) {
+                QList<QByteArray> fields = line.simplified().split(' ');
+                availableRAM = static_cast<int>(fields.value(1).toLongLong() / 1024);
+                return;
+            }
+        }
+    }
+
+    // Kernels older than 3.14
+    struct sysinfo sys_info;
+    if (sysinfo(&sys_info) != -1) {
+        availableRAM = static_cast<int>(((sys_info.freeram + sys_info.bufferram) * sys_info.mem_unit) / 1024 / 1024);
+    }
+#endif
+#ifdef Q_OS_WIN
+    MEMORYSTATUSEX statex;
+    statex.dwLength = sizeof (statex);
+    GlobalMemoryStatusEx (&statex);
+    availableRAM = static_cast<int>(statex.ullAvailPhys / (1024 * 1024));
+#endif
+#ifdef Q_OS_MACOS
+    size_t len;
+    qint64 freePages = 0;
+    int pageSize = 0;
+    // The inactive pages can be reused, as in FreeBSD
+    vm_statistics64_data_t vmStats;
+    mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+    if (host_statistics64(mach_host_self(), HOST_VM_INFO64,
+                          reinterpret_cast<host_info64_t>(&vmStats), &count) == KERN_SUCCESS) {
+        freePages = static_cast<qint64>(vmStats.free_count) + vmStats.inactive_count;
+    } else {
+        unsigned int pageFreeCount = 0;
+        len = sizeof(pageFreeCount);
+        sysctlbyname("vm.page_free_count", &pageFreeCount, &len, NULL, 0);
+        freePages = pageFreeCount;
+    }
+    len = sizeof(pageSize);
+    sysctlbyname("hw.pagesize", &pageSize, &len, NULL, 0);
+    availableRAM = static_cast<int>((freePages * pageSize) / 1024 / 1024);
+#endif
+#ifdef Q_OS_FREEBSD
+    size_t len;
+    unsigned int freePages = 0;
+    unsigned int inactivePages = 0;
+    int pageSize = 0;
+    len = sizeof(freePages);
+    sysctlbyname("vm.stats.vm.v_free_count", &freePages, &len, NULL, 0);
+    len = sizeof(inactivePages);
+    sysctlbyname("vm.stats.vm.v_inactive_count", &inactivePages, &len, NULL, 0);
+    len = sizeof(pageSize);
+    sysctlbyname("hw.pagesize", &pageSize, &len, NULL, 0);
+    availableRAM = static_cast<int>((static_cast<qint64>(freePages + inactivePages) * pageSize) / 1024 / 1024);
+#endif
+}
+
+/**
+ * @brief Get the load of the host CPUs
+ * @return load average of the last minute per CPU, -1 if it's unknown
+ *
+ * Get the load average of the last minute divided
+ * by the number of CPUs. 1 means all the CPUs are busy
+ */
+double HostUtils::getLoadAverage()
+{
+#ifdef Q_OS_WIN
+    return -1;
+#else
+    double loadAverage[1];
+    if (getloadavg(loadAverage, 1) != 1) {
+        return -1;
+    }
+
+    return loadAverage[0] / qMax(1, QThread::idealThreadCount());
+#endif
+}
+
+/**
+ * @brief Get the free huge pages of the system
+ * @return map with the size of the page in KiB and the free pages
+ *
+ * Get the free huge pages of every size supported
+ * by the system. Ex: 2048 -> 512, 1048576 -> 0
+ */
+QMap<int, int> HostUtils::getHugePages()
+{
+    QMap<int, int> hugePages;
+
+#ifdef Q_OS_LINUX
+    QDir hugePagesDir("/sys/kernel/mm/hugepages");
+    QStringList pageSizes = hugePagesDir.entryList(QStringList("hugepages-*kB"), QDir::Dirs);
+
+    foreach (const QString &pageSizeDir, pageSizes) {
+        int pageSize = pageSizeDir.mid(10, pageSizeDir.length() - 12).toInt();
+
+        QFile freePagesFile(hugePagesDir.filePath(pageSizeDir + "/free_hugepages"));
+        if (pageSize <= 0 || !freePagesFile.open(QFile::ReadOnly)) {
+            continue;
+        }
+
+        hugePages.insert(pageSize, freePagesFile.readAll().trimmed().toInt());
+    }
+#endif
+
+    return hugePages;
+}
+
+/**
+ * @brief Get the mount point of a hugetlbfs
+ * @param pageSize, size of the page in KiB
+ * @return mount point, empty if there isn't any
+ *
+ * Get the mount point of a hugetlbfs filesystem
+ * with the page size selected
+ */
+QString HostUtils::getHugePagesMountPoint(const int pageSize)
+{
+    QString mountPoint;
+
+#ifdef Q_OS_LINUX
+    QFile mountsFile("/proc/mounts");
+    if (!mountsFile.open(QFile::ReadOnly)) {
+        return mountPoint;
+    }
+
+    // Without the pagesize option the mount uses the default page size
+    bool defaultPageSize = false;
+    QFile memInfoFile("/proc/meminfo");
+    if (memInfoFile.open(QFile::ReadOnly)) {
+        QList<QByteArray> memInfo = memInfoFile.readAll().split('\n');
+        foreach (const QByteArray &line, memInfo) {
+            if (line.startsWith("Hugepagesize:")) {
+                defaultPageSize = line.mid(13).trimmed().split(' ').first().toInt() == pageSize;
+                break;
+            }
+        }
+    }
+
+    QString pageSizeOption = pageSize >= 1048576 ? QString("pagesize=%1G").arg(pageSize / 1048576)
+                                                 : QString("pagesize=%1M").arg(pageSize / 1024);
+
+    QList<QByteArray> mounts = mountsFile.readAll().split('\n');
+    foreach (const QByteArray &mount, mounts) {
+        QList<QByteArray> fields = mount.split(' ');
+        if (fields.size() < 4 || fields.at(2) != "hugetlbfs") {
+            continue;
+        }
+
+        QString options = QString::fromLocal8Bit(fields.at(3));
+        if (options.split(',').contains(pageSizeOption) ||
+           (defaultPageSize && !options.contains("pagesize="))) {
+            mountPoint = QString::fromLocal8Bit(fields.at(1));
+            break;
+        }
+    }
+#else
+    Q_UNUSED(pageSize)
+#endif
+
+    return mountPoint;
+}
+
+/**
+ * @brief Get the NUMA nodes of the host
+ * @return number of NUMA nodes
+ *
+ * Get the NUMA nodes of the host. Without
+ * NUMA information there's only one node
+ */
+int HostUtils::getHostNUMANodes()
+{
+    int nodes = 0;
+
+#ifdef Q_OS_LINUX
+    QDir nodesDir("/sys/devices/system/node");
+    QStringList nodeDirs = nodesDir.entryList(QStringList("node*"), QDir::Dirs);
+    foreach (const QString &nodeDir, nodeDirs) {
+        bool isNode = false;
+        nodeDir.mid(4).toInt(&isNode);
+        if (isNode) {
+            ++nodes;
+        }
+    }
+#endif
+
+    return nodes > 0 ? nodes : 1;
+}
+
+/**
+ * @brief Get all the audio cards
+ * @return hash with all the audio cards
+ *
+ * Get all the audio cards
+ */
+QHash<QString, QString> HostUtils::getSoundCards()
+{
+    QHash<QString, QString> soundCardsHash;
+    soundCardsHash.insert("sb16", "Creative Sound Blaster 16");
+    soundCardsHash.insert("ac97", "Intel AC97(82801AA)");
+    soundCardsHash.insert("gus", "Gravis Ultrasound GF1");
+    soundCardsHash.insert("intel-hda", "Intel HD Audio");
+    soundCardsHash.insert("hda-duplex", "HDA Codec");
+    soundCardsHash.insert("es1370", "ENSONIQ AudioPCI ES1370");
+    soundCardsHash.insert("adlib", "Yamaha YM3812");
+    soundCardsHash.insert("cs4231a", "CS4231A");
+    soundCardsHash.insert("pcspk", "PC Speaker");
+
+    return soundCardsHash;
+}
+
+/**
+ * @brief Get the audio cards of the installed QEMU
+ * @return hash with the available audio cards
+ *
+ * Get the audio cards that the installed QEMU has.
+ * If QEMU isn't probed yet, all the cards are returned
+ */
+QHash<QString, QString> HostUtils::getAvailableSoundCards()
+{
+    QHash<QString, QString> soundCardsDevices;
+    soundCardsDevices.insert("sb16", "sb16");
+    soundCardsDevices.insert("ac97", "AC97");
+    soundCardsDevices.insert("gus", "gus");
+    soundCardsDevices.insert("intel-hda", "intel-hda");
+    soundCardsDevices.insert("hda-duplex", "hda-duplex");
+    soundCardsDevices.insert("es1370", "ES1370");
+    soundCardsDevices.insert("adlib", "adlib");
+    soundCardsDevices.insert("cs4231a", "cs4231a");
+    soundCardsDevices.insert("pcspk", "isa-pcspk");
+
+    QHash<QString, QString> soundCardsHash = HostUtils::getSoundCards();
+    QMutableHashIterator<QString, QString> soundCard(soundCardsHash);
+    while (soundCard.hasNext()) {
+        soundCard.next();
+        if (!QEMUCapabilities::instance()->hasDevice(QEMUCapabilities::defaultBinary(),
+                                                     soundCardsDevices.value(soundCard.key()))) {
+            soundCard.remove();
+        }
+    }
+
+    return soundCardsHash;
+}
+
+/**
+ * @brief Get all the accelerators
+ * @return hash with the accelerators
+ *
+ * Get all the accelerators
+ */
+QHash<QString, QString> HostUtils::getAccelerators()
+{
+    QHash<QString, QString> acceleratorsHash;
+#ifdef Q_OS_LINUX
+    acceleratorsHash.insert("kvm", "Kernel-based Virtual Machine (KVM)");
+    acceleratorsHash.insert("xen", "Xen Hypervisor");
+#endif
+#ifdef Q_OS_MACOS
+    acceleratorsHash.insert("hvf", "Hypervisor Framework (HVF)");
+#endif
+    acceleratorsHash.insert("tcg", "Tiny Code Generator (TCG)");
+#ifdef Q_OS_WIN
+    acceleratorsHash.insert("hax", "Hardware Accelerated Execution Manager (HAXM)");
+    acceleratorsHash.insert("whpx,kernel-irqchip=off", "Windows Hypervisor Platform (WHPX)");
+#endif
+
+    return acceleratorsHash;
+}
+
+/**
+ * @brief Get the accelerators of the installed QEMU
+ * @return hash with the available accelerators
+ *
+ * Get the accelerators built in the installed QEMU.
+ * If QEMU isn't probed yet, all the accelerators are returned
+ */
+QHash<QString, QString> HostUtils::getAvailableAccelerators()
+{
+    QHash<QString, QString> acceleratorsHash = HostUtils::getAccelerators();
+
+    QStringList accelerators = QEMUCapabilities::instance()->accelerators(QEMUCapabilities::defaultBinary());
+    if (accelerators.isEmpty()) {
+        return acceleratorsHash;
+    }
+
+    QMutableHashIterator<QString, QString> accelerator(acceleratorsHash);
+    while (accelerator.hasNext()) {
+        accelerator.next();
+        // Ex: whpx,kernel-irqchip=off
+        if (!accelerators.contains(accelerator.key().section(',', 0, 0))) {
+            accelerator.remove();
+        }
+    }
+
+    return acceleratorsHash;
+}
+
+/**
+ * @brief Get the media devices
+ *
+ * @return map with the media devices
+ *
+ * Get the media devices
+ */
+QMap<QString, QString> HostUtils::getMediaDevices()
+{
+    QMap<QString, QString> mediaMap;
+    mediaMap.insert("a", "Floppy A");
+    mediaMap.insert("b", "Floppy B");
+    mediaMap.insert("c", "HDD");
+    mediaMap.insert("d", "CDROM");
+    mediaMap.insert("n-1", "Network 1");
+    mediaMap.insert("n-2", "Network 2");
+
+    return mediaMap;
+}
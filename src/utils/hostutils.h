@@ -0,0 +1,79 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef HOSTUTILS_H
+#define HOSTUTILS_H
+
+// Qt
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <QHash>
+#include <QMap>
+#include <QDebug>
+
+// Local
+#include "../qemucapabilities.h"
+
+// C++ standard library
+#include <cstdlib>
+
+// GNU
+#ifdef Q_OS_LINUX
+#include <sys/sysinfo.h>
+#endif
+
+// Windows
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+// FreeBSD
+#ifdef Q_OS_FREEBSD
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <sys/utsname.h>
+#endif
+
+// MacOS
+#ifdef Q_OS_MAC
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <mach/mach.h>
+#endif
+
+class HostUtils {
+
+    public:
+        static void getTotalMemory(int &totalRAM);
+        static void getAvailableMemory(int &availableRAM);
+        static double getLoadAverage();
+        static QMap<int, int> getHugePages();
+        static QString getHugePagesMountPoint(const int pageSize);
+        static int getHostNUMANodes();
+
+        static QHash<QString, QString> getSoundCards();
+        static QHash<QString, QString> getAvailableSoundCards();
+        static QHash<QString, QString> getAccelerators();
+        static QHash<QString, QString> getAvailableAccelerators();
+        static QMap<QString, QString> getMediaDevices();
+};
+
+#endif // HOSTUTILS_H
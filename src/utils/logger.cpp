@@ -21,6 +21,23 @@
 // Local
 #include "logger.h"
 
+#ifdef QTEMU_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+// The sink writes the queued entries at least every FLUSH_INTERVAL ms,
+// or before if there are WAKE_THRESHOLD entries or an error
+static const int FLUSH_INTERVAL = 250;
+static const int WAKE_THRESHOLD = 512;
+
+// A log is rotated when it's bigger than MAX_LOG_SIZE or older than
+// ROTATION_INTERVAL seconds. Only the MAX_SEGMENTS newest segments are kept
+static const qint64 MAX_LOG_SIZE = 8 * 1024 * 1024;
+static const qint64 ROTATION_INTERVAL = 7 * 24 * 60 * 60;
+static const int MAX_SEGMENTS = 5;
+
+std::atomic_int Logger::s_minimumSeverity(Logger::Info);
+
 Logger::Logger(QObject *parent) : QObject(parent)
 {
     qDebug() << "Logger created";
@@ -31,6 +48,29 @@ Logger::~Logger()
     qDebug() << "Logger destroyed";
 }
 
+/**
+ * @brief Log a message
+ * @param severity, severity of the message
+ * @param message, message to be logged
+ *
+ * Queue the message for the QtEmu log. The errors
+ * are also written to the errors log.
+ * The caller never waits for the disk
+ */
+void Logger::log(Severity severity, const QString &message)
+{
+    if (severity < s_minimumSeverity.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    LogEntry *entry = new LogEntry();
+    entry->timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry->severity = severity;
+    entry->message = message;
+
+    Logger::sink()->enqueue(entry);
+}
+
 /**
  * @brief Log the machine creation actions
  * @param fileLocation, log file location
@@ -43,29 +83,13 @@ void Logger::logMachineCreation(const QString &fileLocation,
                                 const QString &machineName,
                                 const QString &message)
 {
-    QString path = fileLocation + "/logs/" + machineName.toLower().replace(" ", "_") + ".log";
-
-    QFile machineLogsFile(path);
-    if (!machineLogsFile.open(QIODevice::Append)) {
-        QMessageBox *m_logMachineMessageBox = new QMessageBox();
-        m_logMachineMessageBox->setWindowTitle(tr("Qtemu - Critical error"));
-        m_logMachineMessageBox->setIcon(QMessageBox::Critical);
-        m_logMachineMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-        m_logMachineMessageBox->setText(tr("<p>Problem writing in the log</p>"));
-        m_logMachineMessageBox->exec();
-        return;
-    }
-
-    QTextStream fileStream(&machineLogsFile);
-    fileStream.setEncoding(QStringConverter::Utf8);
+    LogEntry *entry = new LogEntry();
+    entry->timestamp = QDateTime::currentMSecsSinceEpoch();
+    entry->severity = Logger::Info;
+    entry->path = fileLocation + "/logs/" + machineName.toLower().replace(" ", "_") + ".log";
+    entry->message = message;
 
-    if (machineLogsFile.isWritable()) {
-        fileStream << message;
-    }
-
-    if (machineLogsFile.isOpen()) {
-        machineLogsFile.close();
-    }
+    Logger::sink()->enqueue(entry);
 }
 
 /**
@@ -76,71 +100,462 @@ void Logger::logMachineCreation(const QString &fileLocation,
  */
 void Logger::logQtemuAction(const QString &message)
 {
+    Logger::log(Logger::Info, message);
+}
+
+/**
+ * @brief Log the qtemu errors
+ * @param message, message to be logged
+ *
+ * Log the qtemu errors
+ */
+void Logger::logQtemuError(const QString &message)
+{
+    Logger::log(Logger::Error, message);
+}
+
+/**
+ * @brief Set the minimum severity
+ * @param severity, messages below it are discarded
+ *
+ * Set the minimum severity of the QtEmu log
+ */
+void Logger::setMinimumSeverity(Severity severity)
+{
+    s_minimumSeverity.store(severity);
+}
+
+/**
+ * @brief Get the minimum severity
+ * @return minimum severity of the QtEmu log
+ *
+ * Get the minimum severity
+ */
+Logger::Severity Logger::minimumSeverity()
+{
+    return static_cast<Logger::Severity>(s_minimumSeverity.load());
+}
+
+/**
+ * @brief Get the name of a severity
+ * @param severity, severity
+ * @return name written in the log
+ *
+ * Get the name of a severity
+ */
+QString Logger::severityName(Severity severity)
+{
+    switch (severity) {
+        case Logger::Debug:
+            return "DEBUG";
+        case Logger::Info:
+            return "INFO";
+        case Logger::Warning:
+            return "WARNING";
+        case Logger::Error:
+            return "ERROR";
+    }
+
+    return QString();
+}
+
+/**
+ * @brief Stop the logger
+ *
+ * Write all the queued messages and stop the sink.
+ * Called before QtEmu exits
+ */
+void Logger::shutdown()
+{
+    Logger::sink()->stop();
+}
+
+/**
+ * @brief Get the sink of the logger
+ * @return sink, started the first time
+ *
+ * Get the sink of the logger
+ */
+LogSink *Logger::sink()
+{
+    static LogSink *sink = []() {
+        LogSink *logSink = new LogSink();
+        logSink->start(QThread::LowPriority);
+        return logSink;
+    }();
+
+    return sink;
+}
+
+/**
+ * @brief Log sink
+ * @param parent, parent object
+ *
+ * Thread that writes the log entries. The files are kept
+ * open and the entries are written in batches
+ */
+LogSink::LogSink(QObject *parent) : QThread(parent)
+{
+    this->m_stub.next.store(nullptr);
+    this->m_head.store(&this->m_stub);
+    this->m_tail = &this->m_stub;
+    this->m_pendingEntries = 0;
+    this->m_stopping = false;
+
     QSettings settings;
     settings.beginGroup("DataFolder");
-    QString logDirectoryPath = settings.value("QtEmuLogs").toString();
+    this->m_logDirectoryPath = settings.value("QtEmuLogs").toString();
     settings.endGroup();
 
-    QString logMessage = QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss ").append(message).append("\n");
+    settings.beginGroup("Configuration");
+    Logger::setMinimumSeverity(static_cast<Logger::Severity>(settings.value("logSeverity", Logger::Info).toInt()));
+    settings.endGroup();
+
+    qDebug() << "LogSink created";
+}
 
-    QFile logsFile(logDirectoryPath.append("/qtemu.log"));
-    if (!logsFile.open(QIODevice::Append)) {
-        QMessageBox *m_logQtEmuMessageBox = new QMessageBox();
-        m_logQtEmuMessageBox->setWindowTitle(tr("Qtemu - Critical error"));
-        m_logQtEmuMessageBox->setIcon(QMessageBox::Critical);
-        m_logQtEmuMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-        m_logQtEmuMessageBox->setText(tr("<p>Problem writing in the log</p>"));
-        m_logQtEmuMessageBox->exec();
+LogSink::~LogSink()
+{
+    this->stop();
+
+    qDebug() << "LogSink destroyed";
+}
+
+/**
+ * @brief Queue an entry
+ * @param entry, entry to be written
+ *
+ * Queue an entry without locks. The sink is only
+ * woken up for errors or when the queue is long
+ */
+void LogSink::enqueue(LogEntry *entry)
+{
+    if (this->m_stopping.load(std::memory_order_relaxed)) {
+        qDebug().noquote() << entry->message;
+        delete entry;
         return;
     }
 
-    QTextStream fileStream(&logsFile);
-    fileStream.setEncoding(QStringConverter::Utf8);
+    Logger::Severity severity = entry->severity;
+
+    this->push(entry);
 
-    if (logsFile.isWritable()) {
-        fileStream << logMessage;
+    if (this->m_pendingEntries.fetch_add(1, std::memory_order_relaxed) + 1 == WAKE_THRESHOLD ||
+        severity == Logger::Error) {
+        this->m_wakeup.release();
     }
+}
 
-    if (logsFile.isOpen()) {
-        logsFile.close();
+/**
+ * @brief Stop the sink
+ *
+ * Write the queued entries and wait until the thread is finished
+ */
+void LogSink::stop()
+{
+    if (!this->isRunning()) {
+        return;
     }
+
+    this->m_stopping = true;
+    this->m_wakeup.release();
+    this->wait();
 }
 
 /**
- * @brief Log the qtemu errors
- * @param message, message to be logged
+ * @brief Thread of the sink
  *
- * Log the qtemu errors
+ * Write the queued entries, flush the files and
+ * rotate them if needed until the sink is stopped
  */
-void Logger::logQtemuError(const QString &message)
+void LogSink::run()
 {
-    QSettings settings;
-    settings.beginGroup("DataFolder");
+    QDir().mkpath(this->m_logDirectoryPath);
 
-    QString logDirectoryPath = settings.value("QtEmuLogs").toString();
-    settings.endGroup();
+    forever {
+        bool stopping = this->m_stopping.load();
+
+        int entries = this->drain();
+        if (entries > 0) {
+            this->m_pendingEntries.fetch_sub(entries, std::memory_order_relaxed);
+            this->flushFiles();
+        }
 
-    QString logMessage = QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss ").append(message).append("\n");;
+        if (stopping) {
+            break;
+        }
 
-    QFile logsFile(logDirectoryPath.append("/qtemu.err"));
-    if (!logsFile.open(QIODevice::Append)) {
-        QMessageBox *m_logQtEmuErrorMessageBox = new QMessageBox();
-        m_logQtEmuErrorMessageBox->setWindowTitle(tr("Qtemu - Critical error"));
-        m_logQtEmuErrorMessageBox->setIcon(QMessageBox::Critical);
-        m_logQtEmuErrorMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-        m_logQtEmuErrorMessageBox->setText(tr("<p>Problem writing in the log</p>"));
-        m_logQtEmuErrorMessageBox->exec();
+        this->m_wakeup.tryAcquire(1, FLUSH_INTERVAL);
+        // Several wake ups are merged in a single batch
+        while (this->m_wakeup.tryAcquire()) {
+        }
+    }
+
+    foreach (const LogFile &logFile, this->m_files) {
+        logFile.file->close();
+        delete logFile.file;
+    }
+    this->m_files.clear();
+}
+
+/**
+ * @brief Push an entry in the queue
+ * @param entry, entry to be written
+ *
+ * Push an entry in the queue. Called from any thread
+ */
+void LogSink::push(LogEntry *entry)
+{
+    entry->next.store(nullptr, std::memory_order_relaxed);
+    LogEntry *previous = this->m_head.exchange(entry, std::memory_order_acq_rel);
+    previous->next.store(entry, std::memory_order_release);
+}
+
+/**
+ * @brief Pop an entry from the queue
+ * @return entry, nullptr if the queue is empty or
+ * an entry is being pushed
+ *
+ * Pop an entry from the queue. Only called from the sink thread
+ */
+LogEntry *LogSink::pop()
+{
+    LogEntry *tail = this->m_tail;
+    LogEntry *next = tail->next.load(std::memory_order_acquire);
+
+    if (tail == &this->m_stub) {
+        if (next == nullptr) {
+            return nullptr;
+        }
+        this->m_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+        this->m_tail = next;
+        return tail;
+    }
+
+    if (tail != this->m_head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    this->push(&this->m_stub);
+
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        this->m_tail = next;
+        return tail;
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Write all the queued entries
+ * @return number of entries
+ *
+ * Write all the queued entries in the buffers of the files
+ */
+int LogSink::drain()
+{
+    int entries = 0;
+
+    LogEntry *entry = this->pop();
+    while (entry != nullptr) {
+        this->writeEntry(entry);
+        delete entry;
+        ++entries;
+
+        entry = this->pop();
+    }
+
+    return entries;
+}
+
+/**
+ * @brief Write an entry
+ * @param entry, entry to be written
+ *
+ * Format the entry and add it to the buffer of its file
+ */
+void LogSink::writeEntry(LogEntry *entry)
+{
+    // The machine logs have their own format
+    if (!entry->path.isEmpty()) {
+        LogFile *logFile = this->openFile(entry->path);
+        if (logFile != nullptr) {
+            logFile->buffer.append(entry->message.toUtf8());
+        }
         return;
     }
 
-    QTextStream fileStream(&logsFile);
-    fileStream.setEncoding(QStringConverter::Utf8);
+    QByteArray line = QDateTime::fromMSecsSinceEpoch(entry->timestamp).toString("dd.MM.yyyy hh:mm:ss ").toUtf8();
+    line.append('[').append(Logger::severityName(entry->severity).toUtf8()).append("] ");
+    line.append(entry->message.toUtf8());
+    line.append('\n');
+
+    LogFile *logFile = this->openFile(this->m_logDirectoryPath + "/qtemu.log");
+    if (logFile != nullptr) {
+        logFile->buffer.append(line);
+    }
+
+    if (entry->severity == Logger::Error) {
+        logFile = this->openFile(this->m_logDirectoryPath + "/qtemu.err");
+        if (logFile != nullptr) {
+            logFile->buffer.append(line);
+        }
+    }
+}
 
-    if (logsFile.isWritable()) {
-        fileStream << logMessage;
+/**
+ * @brief Open a log file
+ * @param path, path of the log
+ * @return log file, nullptr if it cannot be opened
+ *
+ * Open a log file in append mode. The file
+ * is kept open until the sink is stopped
+ */
+LogSink::LogFile *LogSink::openFile(const QString &path)
+{
+    if (this->m_files.contains(path)) {
+        return &this->m_files[path];
     }
 
-    if (logsFile.isOpen()) {
-        logsFile.close();
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        // Only the first problem is reported, the file is tried again with the next entries
+        if (!this->m_failedFiles.contains(path)) {
+            qWarning() << "Problem writing in the log" << path << file->errorString();
+            this->m_failedFiles.insert(path);
+        }
+        delete file;
+        return nullptr;
+    }
+    this->m_failedFiles.remove(path);
+
+    LogFile logFile;
+    logFile.file = file;
+    logFile.segmentStart = QDateTime::currentSecsSinceEpoch();
+
+    QFileInfo fileInfo(path);
+    if (file->size() > 0 && fileInfo.birthTime().isValid()) {
+        logFile.segmentStart = fileInfo.birthTime().toSecsSinceEpoch();
+    }
+
+    return &this->m_files.insert(path, logFile).value();
+}
+
+/**
+ * @brief Flush the files
+ *
+ * Write the buffers of the files and rotate the files
+ * that are too big or too old
+ */
+void LogSink::flushFiles()
+{
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+
+    for (auto it = this->m_files.begin(); it != this->m_files.end(); ++it) {
+        LogFile &logFile = it.value();
+        if (logFile.buffer.isEmpty()) {
+            continue;
+        }
+
+        if (logFile.file->write(logFile.buffer) != logFile.buffer.size() || !logFile.file->flush()) {
+            qWarning() << "Problem writing in the log" << it.key() << logFile.file->errorString();
+        }
+        logFile.buffer.clear();
+
+        if (logFile.file->size() > MAX_LOG_SIZE || now - logFile.segmentStart > ROTATION_INTERVAL) {
+            this->rotateFile(it.key(), &logFile);
+        }
+    }
+}
+
+/**
+ * @brief Rotate a log
+ * @param path, path of the log
+ * @param logFile, open log
+ *
+ * Rename the log with the rotation time, compress it
+ * and start a new log in the same path
+ */
+void LogSink::rotateFile(const QString &path, LogFile *logFile)
+{
+    logFile->file->close();
+
+    QString segmentPath = path + "." + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+    if (!QFile::rename(path, segmentPath)) {
+        qWarning() << "Cannot rotate the log" << path;
+        segmentPath.clear();
+    }
+
+    if (!logFile->file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Problem writing in the log" << path << logFile->file->errorString();
+    }
+    logFile->segmentStart = QDateTime::currentSecsSinceEpoch();
+
+    if (!segmentPath.isEmpty()) {
+        this->compressSegment(segmentPath);
+        this->pruneSegments(path);
+    }
+}
+
+/**
+ * @brief Compress a rotated log
+ * @param segmentPath, path of the rotated log
+ *
+ * Compress a rotated log with zstd. Without zstd
+ * the segment is kept as is
+ */
+void LogSink::compressSegment(const QString &segmentPath)
+{
+#ifdef QTEMU_HAS_ZSTD
+    QFile segmentFile(segmentPath);
+    if (!segmentFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QByteArray segmentData = segmentFile.readAll();
+    segmentFile.close();
+
+    QByteArray compressedData(static_cast<int>(ZSTD_compressBound(segmentData.size())), '\0');
+    size_t compressedSize = ZSTD_compress(compressedData.data(), compressedData.size(),
+                                          segmentData.constData(), segmentData.size(), 9);
+    if (ZSTD_isError(compressedSize)) {
+        return;
+    }
+    compressedData.resize(static_cast<int>(compressedSize));
+
+    QSaveFile compressedFile(segmentPath + ".zst");
+    if (!compressedFile.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    compressedFile.write(compressedData);
+    if (compressedFile.commit()) {
+        QFile::remove(segmentPath);
+    }
+#else
+    Q_UNUSED(segmentPath)
+#endif
+}
+
+/**
+ * @brief Remove the oldest rotated logs
+ * @param path, path of the log
+ *
+ * Keep only the newest rotated logs of a log
+ */
+void LogSink::pruneSegments(const QString &path)
+{
+    QFileInfo fileInfo(path);
+    QDir logDirectory(fileInfo.absolutePath());
+
+    // The names have the rotation time, so they are sorted by age
+    QStringList segments = logDirectory.entryList(QStringList() << fileInfo.fileName() + ".*",
+                                                  QDir::Files, QDir::Name);
+    while (segments.size() > MAX_SEGMENTS) {
+        logDirectory.remove(segments.takeFirst());
     }
 }
@@ -23,14 +23,23 @@
 
 // Qt
 #include <QObject>
+#include <QThread>
+#include <QSemaphore>
 #include <QDateTime>
 #include <QSettings>
+#include <QDir>
 #include <QFile>
-#include <QTextStream>
-#include <QMessageBox>
-#include <QIcon>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QHash>
+#include <QSet>
 #include <QDebug>
 
+// C++ standard library
+#include <atomic>
+
+class LogSink;
+
 class Logger : public QObject {
     Q_OBJECT
 
@@ -38,18 +47,85 @@ class Logger : public QObject {
         explicit Logger(QObject *parent = nullptr);
         ~Logger();
 
+        enum Severity {
+            Debug, Info, Warning, Error
+        };
+
+        static void log(Severity severity, const QString &message);
         static void logMachineCreation(const QString &fileLocation,
                                        const QString &machineName,
                                        const QString &message);
         static void logQtemuAction(const QString &message);
         static void logQtemuError(const QString &message);
 
+        static void setMinimumSeverity(Severity severity);
+        static Severity minimumSeverity();
+        static QString severityName(Severity severity);
+
+        static void shutdown();
+
     public slots:
 
     protected:
 
     private:
+        static LogSink *sink();
+        static std::atomic_int s_minimumSeverity;
+};
+
+struct LogEntry {
+    std::atomic<LogEntry *> next;
+    qint64 timestamp;
+    Logger::Severity severity;
+    // Empty for the QtEmu logs
+    QString path;
+    QString message;
+};
+
+class LogSink : public QThread {
+    Q_OBJECT
+
+    public:
+        explicit LogSink(QObject *parent = nullptr);
+        ~LogSink();
+
+        void enqueue(LogEntry *entry);
+        void stop();
+
+    protected:
+        void run() override;
+
+    private:
+        struct LogFile {
+            QFile *file;
+            qint64 segmentStart;
+            QByteArray buffer;
+        };
+
+        // Intrusive MPSC queue. The producers only exchange the head,
+        // the sink thread is the only one that reads the tail
+        std::atomic<LogEntry *> m_head;
+        LogEntry *m_tail;
+        LogEntry m_stub;
+
+        std::atomic_int m_pendingEntries;
+        std::atomic_bool m_stopping;
+        QSemaphore m_wakeup;
+
+        QString m_logDirectoryPath;
+        QHash<QString, LogFile> m_files;
+        QSet<QString> m_failedFiles;
 
+        // Methods
+        void push(LogEntry *entry);
+        LogEntry *pop();
+        int drain();
+        void writeEntry(LogEntry *entry);
+        LogFile *openFile(const QString &path);
+        void flushFiles();
+        void rotateFile(const QString &path, LogFile *logFile);
+        void compressSegment(const QString &segmentPath);
+        void pruneSegments(const QString &path);
 };
 
 #endif // LOGGER_H
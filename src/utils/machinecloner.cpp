@@ -0,0 +1,439 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machinecloner.h"
+
+/**
+ * @brief Machine cloner
+ * @param machine, machine to be cloned
+ * @param cloneMachine, new machine
+ * @param jobRunner, runner of the qemu-img jobs
+ * @param parent, parent object
+ *
+ * Clone a machine without any user interface.
+ * A linked clone uses qcow2 overlays over the images
+ * of the template library, a full clone copies the disks
+ */
+MachineCloner::MachineCloner(Machine *machine,
+                             Machine *cloneMachine,
+                             QEMUImgJobRunner *jobRunner,
+                             QObject *parent) : QObject(parent)
+{
+    this->m_machine = machine;
+    this->m_cloneMachine = cloneMachine;
+    this->m_jobRunner = jobRunner;
+    this->m_totalJobs = 0;
+    this->m_finishedJobs = 0;
+    this->m_cloneFailed = false;
+    this->m_cloneFinished = false;
+
+    qDebug() << "MachineCloner created";
+}
+
+MachineCloner::~MachineCloner()
+{
+    // The clone is destroyed while the disks are being created
+    if (!this->m_cloneJobs.isEmpty()) {
+        this->rollbackClone();
+    }
+
+    qDebug() << "MachineCloner destroyed";
+}
+
+/**
+ * @brief Start the clone
+ * @param cloneName, name of the new machine
+ * @param linkedClone, true to create overlays instead of copying the disks
+ * @return false if the clone cannot be started
+ *
+ * Prepare the new machine and submit the qemu-img jobs
+ * that create its disks. Without disks to create, the
+ * clone is finished when this method returns and the
+ * finished signal isn't emitted
+ */
+bool MachineCloner::start(const QString &cloneName, bool linkedClone)
+{
+    if (this->isRunning()) {
+        this->m_errorString = tr("The clone is already running");
+        return false;
+    }
+
+    if (this->m_machine->getState() != Machine::Stopped) {
+        this->m_errorString = tr("Stop the machine before cloning it");
+        return false;
+    }
+
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    QString clonePath = settings.value("machinePath", QDir::homePath()).toString();
+    settings.endGroup();
+    clonePath.append(QDir::toNativeSeparators("/"))
+             .append(cloneName)
+             .append(QDir::toNativeSeparators("/"));
+
+    if (QDir(clonePath).exists()) {
+        this->m_errorString = tr("The folder %1 already exists").arg(clonePath);
+        return false;
+    }
+
+    if (!QDir().mkpath(clonePath)) {
+        this->m_errorString = tr("Cannot create the folder %1").arg(clonePath);
+        return false;
+    }
+    this->m_clonePath = clonePath;
+
+    QJsonObject machineJSON = MachineUtils::readMachineFile(this->m_machine->getConfigPath());
+    this->m_cloneMachine->removeAllMedia();
+    this->m_cloneMachine->removeAllNetworkInterfaces();
+    MachineUtils::fillMachineObject(this->m_cloneMachine, machineJSON, this->m_machine->getConfigPath());
+
+    this->m_cloneMachine->setName(cloneName);
+    this->m_cloneMachine->setPath(clonePath);
+    this->m_cloneMachine->setConfigPath(QDir::toNativeSeparators(clonePath +
+                                                                 QString(cloneName).toLower().replace(" ", "_") +
+                                                                 ".json"));
+    this->m_cloneMachine->setUuid(QUuid());
+
+    // Two machines in the same network cannot share the MAC address
+    foreach (NetworkInterface *networkInterface, this->m_cloneMachine->getNetworkInterfaces()) {
+        networkInterface->setMACAddress(NetworkInterface::generateMACAddress());
+    }
+
+    this->m_cloneFailed = false;
+    this->m_cloneFinished = false;
+    this->m_errorString.clear();
+    this->m_promotedDisks.clear();
+    this->m_totalJobs = 0;
+    this->m_finishedJobs = 0;
+
+    foreach (Media *media, this->m_cloneMachine->getMedia()) {
+        media->setUuid(QUuid::createUuid());
+
+        // CD-ROM and floppy images are shared by both machines
+        if (media->type() != "hdd") {
+            continue;
+        }
+
+        QFileInfo diskInfo(media->path());
+        // Disks added before the format was saved don't have it
+        QString diskFormat = media->imageFormat();
+
+        if (!linkedClone) {
+            QString diskPath = QDir::toNativeSeparators(clonePath + diskInfo.fileName());
+            this->addCloneJob(this->m_jobRunner->convert(media->path(), diskPath, diskFormat));
+            media->setPath(diskPath);
+            continue;
+        }
+
+        QString backingPath = media->path();
+        if (!TemplateLibrary::isTemplate(backingPath)) {
+            // The disk becomes a template and the machine
+            // uses an overlay in the place of the disk
+            PromotedDisk promotedDisk;
+            promotedDisk.media = nullptr;
+            promotedDisk.originalPath = backingPath;
+            foreach (Media *machineMedia, this->m_machine->getMedia()) {
+                if (machineMedia->path() == backingPath) {
+                    promotedDisk.media = machineMedia;
+                    break;
+                }
+            }
+
+            QString error;
+            if (!TemplateLibrary::addTemplate(backingPath, diskFormat, diskInfo.completeBaseName(),
+                                              this->m_machine->getName(), promotedDisk.templatePath, error)) {
+                this->rollbackClone();
+                this->m_errorString = error;
+                return false;
+            }
+
+            promotedDisk.overlayPath = QDir::toNativeSeparators(diskInfo.absolutePath() + "/" +
+                                                                diskInfo.completeBaseName() + ".qcow2");
+            if (promotedDisk.overlayPath != backingPath && QFile::exists(promotedDisk.overlayPath)) {
+                promotedDisk.overlayPath = QDir::toNativeSeparators(diskInfo.absolutePath() + "/" +
+                                                                    diskInfo.completeBaseName() + "-" +
+                                                                    QUuid::createUuid().toString(QUuid::WithoutBraces).left(8) +
+                                                                    ".qcow2");
+            }
+
+            this->m_promotedDisks.append(promotedDisk);
+            this->addCloneJob(this->m_jobRunner->createOverlay(promotedDisk.overlayPath,
+                                                               promotedDisk.templatePath,
+                                                               diskFormat));
+            backingPath = promotedDisk.templatePath;
+        }
+
+        QString overlayPath = QDir::toNativeSeparators(clonePath + diskInfo.completeBaseName() + ".qcow2");
+        this->addCloneJob(this->m_jobRunner->createOverlay(overlayPath, backingPath, diskFormat));
+
+        media->setPath(overlayPath);
+        media->setFormat("qcow2");
+        media->setName(QFileInfo(overlayPath).fileName());
+    }
+
+    if (this->m_cloneJobs.isEmpty()) {
+        this->finishClone();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Cancel the clone
+ *
+ * Cancel the pending jobs and undo the clone
+ */
+void MachineCloner::cancel()
+{
+    if (!this->m_cloneJobs.isEmpty()) {
+        this->rollbackClone();
+    }
+}
+
+/**
+ * @brief Get if the disks are being created
+ * @return true if there are pending jobs
+ *
+ * Get if the disks are being created
+ */
+bool MachineCloner::isRunning() const
+{
+    return !m_cloneJobs.isEmpty();
+}
+
+/**
+ * @brief Get if the clone is finished
+ * @return true if the new machine is saved
+ *
+ * Get if the clone is finished
+ */
+bool MachineCloner::isFinished() const
+{
+    return m_cloneFinished;
+}
+
+/**
+ * @brief Get the progress of the clone
+ * @return progress, from 0 to 100
+ *
+ * Get the progress of the finished jobs
+ * and the running ones
+ */
+double MachineCloner::progress() const
+{
+    if (this->m_totalJobs == 0) {
+        return this->m_cloneFinished ? 100 : 0;
+    }
+
+    double progress = this->m_finishedJobs * 100;
+    foreach (QEMUImgJob *job, this->m_cloneJobs) {
+        if (job->progress() > 0) {
+            progress += job->progress();
+        }
+    }
+
+    return progress / this->m_totalJobs;
+}
+
+/**
+ * @brief Get the error of the clone
+ * @return description of the error
+ *
+ * Get the error of the last clone
+ */
+QString MachineCloner::errorString() const
+{
+    return m_errorString;
+}
+
+/**
+ * @brief Add a job of the clone
+ * @param job, qemu-img job
+ *
+ * Add a job of the clone and follow its progress
+ */
+void MachineCloner::addCloneJob(QEMUImgJob *job)
+{
+    this->m_cloneJobs.append(job);
+    ++this->m_totalJobs;
+
+    connect(job, &QEMUImgJob::progressChanged,
+            this, &MachineCloner::updateProgress);
+    connect(job, &QEMUImgJob::finished,
+            this, [=](bool success) {
+        this->cloneJobFinished(job, success);
+    });
+}
+
+/**
+ * @brief A job of the clone is finished
+ * @param job, qemu-img job
+ * @param success, true if the job is successful
+ *
+ * When all the jobs are finished, save the new machine
+ * or undo the clone if a job failed
+ */
+void MachineCloner::cloneJobFinished(QEMUImgJob *job, bool success)
+{
+    this->m_cloneJobs.removeOne(job);
+    ++this->m_finishedJobs;
+
+    this->updateProgress();
+
+    if (!success && !this->m_cloneFailed) {
+        this->m_cloneFailed = true;
+        this->m_errorString = job->errorString();
+
+        // The rest of the jobs are useless, the clone
+        // is undone when the last one is finished
+        if (!this->m_cloneJobs.isEmpty()) {
+            foreach (QEMUImgJob *cloneJob, this->m_cloneJobs) {
+                cloneJob->cancel();
+            }
+            return;
+        }
+    }
+
+    if (!this->m_cloneJobs.isEmpty()) {
+        return;
+    }
+
+    if (this->m_cloneFailed) {
+        this->rollbackClone();
+        emit(finished(false));
+        return;
+    }
+
+    this->finishClone();
+    emit(finished(true));
+}
+
+/**
+ * @brief Update the progress of the clone
+ *
+ * Emit the progress of the clone
+ */
+void MachineCloner::updateProgress()
+{
+    emit(progressChanged(this->progress()));
+}
+
+/**
+ * @brief Finish the clone
+ *
+ * Point the cloned machine to its overlays
+ * and save the new machine
+ */
+void MachineCloner::finishClone()
+{
+    foreach (const PromotedDisk &promotedDisk, this->m_promotedDisks) {
+        if (promotedDisk.media != nullptr) {
+            promotedDisk.media->setPath(promotedDisk.overlayPath);
+            promotedDisk.media->setFormat("qcow2");
+            promotedDisk.media->setName(QFileInfo(promotedDisk.overlayPath).fileName());
+        }
+    }
+
+    if (!this->m_promotedDisks.isEmpty()) {
+        this->m_machine->saveMachine();
+    }
+    this->m_promotedDisks.clear();
+
+    this->m_cloneMachine->setUuid(QUuid::createUuid());
+    this->m_cloneMachine->saveMachine();
+    this->m_cloneMachine->insertMachineConfigFile();
+
+    Logger::logMachineCreation(this->m_cloneMachine->getPath(),
+                               this->m_cloneMachine->getName(),
+                               "Machine cloned from " + this->m_machine->getName());
+
+    this->m_clonePath.clear();
+    this->m_cloneFinished = true;
+}
+
+/**
+ * @brief Undo the clone
+ *
+ * Cancel the pending jobs, move the disks out of the
+ * template library and remove the folder of the new machine.
+ * A cancelled qemu-img removes its image when it ends, and the
+ * overlay can have the path of the disk, so the disks are
+ * restored when all the cancelled jobs are finished
+ */
+void MachineCloner::rollbackClone()
+{
+    QList<QEMUImgJob *> cancelledJobs = this->m_cloneJobs;
+    this->m_cloneJobs.clear();
+
+    QList<PromotedDisk> promotedDisks = this->m_promotedDisks;
+    QString clonePath = this->m_clonePath;
+    this->m_promotedDisks.clear();
+    this->m_clonePath.clear();
+
+    this->m_cloneMachine->setUuid(QUuid());
+
+    if (cancelledJobs.isEmpty()) {
+        MachineCloner::restoreDisks(promotedDisks, clonePath);
+        return;
+    }
+
+    // The jobs belong to the runner, the disks are restored
+    // even if the cloner is destroyed in the meantime
+    QSharedPointer<int> pendingJobs(new int(cancelledJobs.size()));
+    foreach (QEMUImgJob *job, cancelledJobs) {
+        disconnect(job, nullptr, this, nullptr);
+        connect(job, &QEMUImgJob::finished,
+                this->m_jobRunner, [=]() {
+            if (--(*pendingJobs) == 0) {
+                MachineCloner::restoreDisks(promotedDisks, clonePath);
+            }
+        });
+    }
+
+    foreach (QEMUImgJob *job, cancelledJobs) {
+        job->cancel();
+    }
+}
+
+/**
+ * @brief Restore the disks of the machine
+ * @param promotedDisks, disks moved to the template library
+ * @param clonePath, folder of the new machine
+ *
+ * Move the disks out of the template library
+ * and remove the folder of the new machine.
+ * No job of the clone must be running
+ */
+void MachineCloner::restoreDisks(const QList<PromotedDisk> &promotedDisks, const QString &clonePath)
+{
+    foreach (const PromotedDisk &promotedDisk, promotedDisks) {
+        QFile::remove(promotedDisk.overlayPath);
+
+        QString error;
+        if (!TemplateLibrary::removeTemplate(promotedDisk.templatePath, promotedDisk.originalPath, error)) {
+            qDebug() << "Cannot restore the disk" << promotedDisk.originalPath << error;
+        }
+    }
+
+    if (!clonePath.isEmpty()) {
+        QDir(clonePath).removeRecursively();
+    }
+}
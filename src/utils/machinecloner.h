@@ -0,0 +1,99 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINECLONER_H
+#define MACHINECLONER_H
+
+// Qt
+#include <QObject>
+#include <QSettings>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+#include <QSharedPointer>
+#include <QDebug>
+
+// Local
+#include "../machine.h"
+#include "../qemu.h"
+#include "logger.h"
+#include "qemuimgjobrunner.h"
+#include "templatelibrary.h"
+
+class MachineCloner : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MachineCloner(Machine *machine,
+                               Machine *cloneMachine,
+                               QEMUImgJobRunner *jobRunner,
+                               QObject *parent = nullptr);
+        ~MachineCloner();
+
+        bool start(const QString &cloneName, bool linkedClone);
+        void cancel();
+
+        bool isRunning() const;
+        bool isFinished() const;
+        double progress() const;
+        QString errorString() const;
+
+    signals:
+        void progressChanged(double progress);
+        void finished(bool success);
+
+    public slots:
+
+    private slots:
+        void cloneJobFinished(QEMUImgJob *job, bool success);
+        void updateProgress();
+
+    protected:
+
+    private:
+        struct PromotedDisk {
+            Media *media;
+            QString originalPath;
+            QString templatePath;
+            QString overlayPath;
+        };
+
+        Machine *m_machine;
+        Machine *m_cloneMachine;
+        QEMUImgJobRunner *m_jobRunner;
+
+        QList<QEMUImgJob *> m_cloneJobs;
+        QList<PromotedDisk> m_promotedDisks;
+        QString m_clonePath;
+        QString m_errorString;
+        int m_totalJobs;
+        int m_finishedJobs;
+        bool m_cloneFailed;
+        bool m_cloneFinished;
+
+        // Methods
+        void addCloneJob(QEMUImgJob *job);
+        void finishClone();
+        void rollbackClone();
+        static void restoreDisks(const QList<PromotedDisk> &promotedDisks, const QString &clonePath);
+};
+
+#endif // MACHINECLONER_H
@@ -0,0 +1,614 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "machineeventlog.h"
+
+// C++ standard library
+#include <cstring>
+
+/*
+ * The events of a machine are stored in segments of JSON lines:
+ *
+ *   {"t":1700000000000,"type":"exit","data":{...}}
+ *
+ * The segments are named after the time of their first event, so
+ * they are sorted by time. Every segment has a binary index with
+ * one entry per block of events: time of the first and last event,
+ * offsets of the block and a mask with the types of its events.
+ * The entries have a fixed size, so the blocks of a time range
+ * are found with a binary search, without reading the segment.
+ * The events written after the last entry are read as a block
+ * with all the types
+ */
+static const char SEGMENT_PREFIX[] = "events-";
+static const char SEGMENT_SUFFIX[] = ".jsonl";
+static const char INDEX_SUFFIX[] = ".idx";
+static const qint64 MAX_SEGMENT_SIZE = 4 * 1024 * 1024;
+static const int MAX_SEGMENTS = 64;
+static const int BLOCK_EVENTS = 64;
+static const int INDEX_ENTRY_SIZE = 4 * 8 + 4;
+
+/**
+ * @brief Event log of a machine
+ * @param directoryPath, folder of the segments
+ * @param parent, parent object
+ *
+ * Append-only log with the events of a machine:
+ * launches, state changes, QMP events, exits, errors
+ * and resource samples
+ */
+MachineEventLog::MachineEventLog(const QString &directoryPath,
+                                 QObject *parent) : QObject(parent)
+{
+    this->m_directoryPath = directoryPath;
+    this->m_blockEvents = 0;
+    this->m_lastTimestamp = 0;
+    this->m_block = IndexEntry();
+
+    qDebug() << "MachineEventLog created";
+}
+
+MachineEventLog::~MachineEventLog()
+{
+    this->closeSegment();
+
+    qDebug() << "MachineEventLog destroyed";
+}
+
+/**
+ * @brief Get the folder of the log
+ * @return folder of the segments
+ *
+ * Get the folder of the log
+ */
+QString MachineEventLog::directoryPath() const
+{
+    return m_directoryPath;
+}
+
+/**
+ * @brief Record an event
+ * @param type, type of the event
+ * @param data, data of the event
+ *
+ * Append an event to the current segment. The event
+ * is in the file when the method returns, the index
+ * is written every block of events
+ */
+void MachineEventLog::record(EventTypes type, const QJsonObject &data)
+{
+    // The events are sorted by time even if the clock goes back
+    qint64 timestamp = qMax(QDateTime::currentMSecsSinceEpoch(), this->m_lastTimestamp);
+
+    if (this->m_segmentFile.isOpen() && this->m_segmentFile.size() >= MAX_SEGMENT_SIZE) {
+        this->closeSegment();
+    }
+
+    if (!this->m_segmentFile.isOpen() && !this->openSegment(timestamp)) {
+        return;
+    }
+    timestamp = qMax(timestamp, this->m_lastTimestamp);
+
+    QJsonObject eventObject;
+    eventObject["t"]    = static_cast<double>(timestamp);
+    eventObject["type"] = MachineEventLog::typeName(type);
+    eventObject["data"] = data;
+
+    QByteArray line = QJsonDocument(eventObject).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    qint64 offset = this->m_segmentFile.size();
+    if (this->m_segmentFile.write(line) != line.size() || !this->m_segmentFile.flush()) {
+        qDebug() << "Cannot write the event" << this->m_segmentFile.fileName()
+                 << this->m_segmentFile.errorString();
+        return;
+    }
+
+    if (this->m_blockEvents == 0) {
+        this->m_block.firstTimestamp = timestamp;
+        this->m_block.startOffset = offset;
+        this->m_block.types = 0;
+    }
+    this->m_block.lastTimestamp = timestamp;
+    this->m_block.endOffset = offset + line.size();
+    this->m_block.types |= type;
+    this->m_lastTimestamp = timestamp;
+
+    if (++this->m_blockEvents >= BLOCK_EVENTS) {
+        this->writeBlock();
+    }
+
+    MachineEvent event;
+    event.timestamp = timestamp;
+    event.type = type;
+    event.data = data;
+
+    emit(eventRecorded(event));
+}
+
+/**
+ * @brief Index the pending events
+ *
+ * Write the index entry of the current block
+ */
+void MachineEventLog::flush()
+{
+    if (this->m_blockEvents > 0) {
+        this->writeBlock();
+    }
+}
+
+/**
+ * @brief Query the events
+ * @param directoryPath, folder of the segments
+ * @param from, time of the oldest event, in ms since epoch
+ * @param to, time of the newest event, in ms since epoch
+ * @param types, mask with the types of the events
+ * @param limit, maximum number of events
+ * @return events, the newest first
+ *
+ * Find the newest events of a time range. The segments and
+ * the blocks are found with binary searches and only the
+ * blocks with events of the requested types are read
+ */
+QList<MachineEvent> MachineEventLog::query(const QString &directoryPath,
+                                           qint64 from, qint64 to,
+                                           quint32 types, int limit)
+{
+    QList<MachineEvent> events;
+
+    QStringList segments = MachineEventLog::segments(directoryPath);
+
+    // Last segment started before the end of the range
+    int lo = 0;
+    int hi = segments.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (MachineEventLog::segmentStart(segments[mid]) <= to) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    bool rangeFinished = false;
+    for (int segment = lo - 1; segment >= 0 && !rangeFinished && events.size() < limit; --segment) {
+        QString segmentPath = QDir(directoryPath).filePath(segments[segment]);
+
+        QFile segmentFile(segmentPath);
+        if (!segmentFile.open(QFile::ReadOnly)) {
+            continue;
+        }
+
+        QFile indexFile(MachineEventLog::indexPath(segmentPath));
+        int count = 0;
+        if (indexFile.open(QFile::ReadOnly)) {
+            count = MachineEventLog::indexCount(indexFile);
+        }
+
+        QList<MachineEvent> blockEvents;
+
+        // Events that aren't indexed yet
+        qint64 indexedEnd = count > 0 ? MachineEventLog::readIndexEntry(indexFile, count - 1).endOffset : 0;
+        if (segmentFile.size() > indexedEnd) {
+            IndexEntry tail = IndexEntry();
+            tail.startOffset = indexedEnd;
+            tail.endOffset = segmentFile.size();
+            MachineEventLog::readBlock(segmentFile, tail, from, to, types, blockEvents);
+            for (int i = blockEvents.size() - 1; i >= 0 && events.size() < limit; --i) {
+                events.append(blockEvents[i]);
+            }
+        }
+
+        // Last block started before the end of the range
+        lo = 0;
+        hi = count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (MachineEventLog::readIndexEntry(indexFile, mid).firstTimestamp <= to) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        for (int block = lo - 1; block >= 0 && events.size() < limit; --block) {
+            IndexEntry entry = MachineEventLog::readIndexEntry(indexFile, block);
+            if (entry.lastTimestamp < from) {
+                rangeFinished = true;
+                break;
+            }
+
+            if ((entry.types & types) == 0) {
+                continue;
+            }
+
+            blockEvents.clear();
+            MachineEventLog::readBlock(segmentFile, entry, from, to, types, blockEvents);
+            for (int i = blockEvents.size() - 1; i >= 0 && events.size() < limit; --i) {
+                events.append(blockEvents[i]);
+            }
+        }
+
+        if (MachineEventLog::segmentStart(segments[segment]) < from) {
+            rangeFinished = true;
+        }
+    }
+
+    return events;
+}
+
+/**
+ * @brief Get the name of a type
+ * @param type, type of the event
+ * @return name of the type in the segments
+ *
+ * Get the name of a type
+ */
+QString MachineEventLog::typeName(quint32 type)
+{
+    switch (type) {
+        case MachineEventLog::Launch:
+            return "launch";
+        case MachineEventLog::State:
+            return "state";
+        case MachineEventLog::QMPEvent:
+            return "qmp";
+        case MachineEventLog::Exit:
+            return "exit";
+        case MachineEventLog::Error:
+            return "error";
+        case MachineEventLog::Sample:
+            return "sample";
+        case MachineEventLog::Restart:
+            return "restart";
+    }
+
+    return QString();
+}
+
+/**
+ * @brief Get a type from its name
+ * @param name, name of the type in the segments
+ * @return type, 0 if the name is unknown
+ *
+ * Get a type from its name
+ */
+quint32 MachineEventLog::typeFromName(const QString &name)
+{
+    if (name == "launch") {
+        return MachineEventLog::Launch;
+    } else if (name == "state") {
+        return MachineEventLog::State;
+    } else if (name == "qmp") {
+        return MachineEventLog::QMPEvent;
+    } else if (name == "exit") {
+        return MachineEventLog::Exit;
+    } else if (name == "error") {
+        return MachineEventLog::Error;
+    } else if (name == "sample") {
+        return MachineEventLog::Sample;
+    } else if (name == "restart") {
+        return MachineEventLog::Restart;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Open the segment for the new events
+ * @param timestamp, time of the next event
+ * @return true if the segment is open
+ *
+ * Continue the last segment if it isn't full, or start
+ * a new one. The events of the last segment that aren't
+ * indexed, because QtEmu was closed unexpectedly,
+ * are indexed before writing
+ */
+bool MachineEventLog::openSegment(qint64 timestamp)
+{
+    QDir().mkpath(this->m_directoryPath);
+
+    QString segmentPath;
+    QStringList segments = MachineEventLog::segments(this->m_directoryPath);
+    if (!segments.isEmpty() &&
+        QFileInfo(QDir(this->m_directoryPath).filePath(segments.last())).size() < MAX_SEGMENT_SIZE) {
+        segmentPath = QDir(this->m_directoryPath).filePath(segments.last());
+    } else {
+        segmentPath = QDir(this->m_directoryPath).filePath(QString(SEGMENT_PREFIX) +
+                                                            QString::number(timestamp).rightJustified(13, '0') +
+                                                            SEGMENT_SUFFIX);
+    }
+
+    this->m_segmentFile.setFileName(segmentPath);
+    if (!this->m_segmentFile.open(QFile::ReadWrite | QFile::Append)) {
+        qDebug() << "Cannot open the event log" << segmentPath << this->m_segmentFile.errorString();
+        return false;
+    }
+
+    this->m_indexFile.setFileName(MachineEventLog::indexPath(segmentPath));
+    if (!this->m_indexFile.open(QFile::ReadWrite | QFile::Append)) {
+        qDebug() << "Cannot open the event index" << this->m_indexFile.fileName();
+        this->m_segmentFile.close();
+        return false;
+    }
+
+    this->m_blockEvents = 0;
+
+    // A line cut by a crash is left alone, the next event starts in a new line
+    qint64 segmentSize = this->m_segmentFile.size();
+    if (segmentSize > 0) {
+        this->m_segmentFile.seek(segmentSize - 1);
+        if (this->m_segmentFile.read(1) != "\n") {
+            this->m_segmentFile.write("\n");
+            this->m_segmentFile.flush();
+        }
+    }
+
+    // An entry cut by a crash is removed, the next entries must be aligned
+    int count = MachineEventLog::indexCount(this->m_indexFile);
+    if (this->m_indexFile.size() != static_cast<qint64>(count) * INDEX_ENTRY_SIZE) {
+        this->m_indexFile.resize(static_cast<qint64>(count) * INDEX_ENTRY_SIZE);
+    }
+
+    qint64 indexedEnd = 0;
+    if (count > 0) {
+        IndexEntry lastEntry = MachineEventLog::readIndexEntry(this->m_indexFile, count - 1);
+        indexedEnd = lastEntry.endOffset;
+        this->m_lastTimestamp = qMax(this->m_lastTimestamp, lastEntry.lastTimestamp);
+    }
+
+    if (this->m_segmentFile.size() > indexedEnd) {
+        this->indexTail(indexedEnd);
+    }
+
+    if (segments.isEmpty() || segments.last() != QFileInfo(segmentPath).fileName()) {
+        this->pruneSegments();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Close the current segment
+ *
+ * Index the pending events and close the segment
+ */
+void MachineEventLog::closeSegment()
+{
+    if (!this->m_segmentFile.isOpen()) {
+        return;
+    }
+
+    this->flush();
+
+    this->m_segmentFile.close();
+    this->m_indexFile.close();
+}
+
+/**
+ * @brief Write the index entry of the current block
+ *
+ * Write the index entry of the current block
+ * and start a new block. If the entry cannot be
+ * written, the block continues
+ */
+void MachineEventLog::writeBlock()
+{
+    qint64 indexSize = static_cast<qint64>(MachineEventLog::indexCount(this->m_indexFile)) * INDEX_ENTRY_SIZE;
+    if (!MachineEventLog::writeIndexEntry(this->m_indexFile, this->m_block) || !this->m_indexFile.flush()) {
+        qDebug() << "Cannot write the event index" << this->m_indexFile.fileName() << this->m_indexFile.errorString();
+        // A part of an entry would move all the next ones,
+        // the block grows and is written again with the next event
+        this->m_indexFile.resize(indexSize);
+        return;
+    }
+
+    this->m_blockEvents = 0;
+}
+
+/**
+ * @brief Index the end of the segment
+ * @param startOffset, offset of the first event without index
+ *
+ * Index the events written after the last index entry
+ */
+void MachineEventLog::indexTail(qint64 startOffset)
+{
+    this->m_segmentFile.seek(startOffset);
+
+    qint64 offset = startOffset;
+    while (!this->m_segmentFile.atEnd()) {
+        QByteArray line = this->m_segmentFile.readLine();
+        qint64 lineOffset = offset;
+        offset += line.size();
+
+        QJsonObject eventObject = QJsonDocument::fromJson(line).object();
+        if (eventObject.isEmpty()) {
+            continue;
+        }
+
+        qint64 timestamp = qMax(eventObject["t"].toVariant().toLongLong(), this->m_lastTimestamp);
+        if (this->m_blockEvents == 0) {
+            this->m_block.firstTimestamp = timestamp;
+            this->m_block.startOffset = lineOffset;
+            this->m_block.types = 0;
+        }
+        this->m_block.lastTimestamp = timestamp;
+        this->m_block.endOffset = offset;
+        this->m_block.types |= MachineEventLog::typeFromName(eventObject["type"].toString());
+        this->m_lastTimestamp = timestamp;
+
+        if (++this->m_blockEvents >= BLOCK_EVENTS) {
+            this->writeBlock();
+        }
+    }
+}
+
+/**
+ * @brief Remove the oldest segments
+ *
+ * Keep only the newest segments of the log
+ */
+void MachineEventLog::pruneSegments()
+{
+    QDir directory(this->m_directoryPath);
+    QStringList segments = MachineEventLog::segments(this->m_directoryPath);
+
+    while (segments.size() > MAX_SEGMENTS) {
+        QString segmentPath = directory.filePath(segments.takeFirst());
+        QFile::remove(MachineEventLog::indexPath(segmentPath));
+        QFile::remove(segmentPath);
+    }
+}
+
+/**
+ * @brief Get the segments of a log
+ * @param directoryPath, folder of the segments
+ * @return names of the segments, the oldest first
+ *
+ * Get the segments of a log
+ */
+QStringList MachineEventLog::segments(const QString &directoryPath)
+{
+    return QDir(directoryPath).entryList(QStringList() << QString(SEGMENT_PREFIX) + "*" + SEGMENT_SUFFIX,
+                                         QDir::Files, QDir::Name);
+}
+
+/**
+ * @brief Get the index of a segment
+ * @param segmentPath, path of the segment
+ * @return path of the index
+ *
+ * Get the index of a segment
+ */
+QString MachineEventLog::indexPath(const QString &segmentPath)
+{
+    QString indexPath = segmentPath;
+    indexPath.chop(static_cast<int>(strlen(SEGMENT_SUFFIX)));
+
+    return indexPath + INDEX_SUFFIX;
+}
+
+/**
+ * @brief Get the start of a segment
+ * @param segmentName, name of the segment
+ * @return time of the first event of the segment
+ *
+ * Get the start of a segment from its name
+ */
+qint64 MachineEventLog::segmentStart(const QString &segmentName)
+{
+    return segmentName.mid(static_cast<int>(strlen(SEGMENT_PREFIX)), 13).toLongLong();
+}
+
+/**
+ * @brief Get the number of entries of an index
+ * @param indexFile, open index
+ * @return number of complete entries
+ *
+ * Get the number of entries of an index
+ */
+int MachineEventLog::indexCount(QFile &indexFile)
+{
+    return static_cast<int>(indexFile.size() / INDEX_ENTRY_SIZE);
+}
+
+/**
+ * @brief Read an entry of an index
+ * @param indexFile, open index
+ * @param position, position of the entry
+ * @return entry
+ *
+ * Read an entry of an index
+ */
+MachineEventLog::IndexEntry MachineEventLog::readIndexEntry(QFile &indexFile, int position)
+{
+    IndexEntry entry = IndexEntry();
+
+    indexFile.seek(static_cast<qint64>(position) * INDEX_ENTRY_SIZE);
+
+    QDataStream stream(&indexFile);
+    stream >> entry.firstTimestamp >> entry.lastTimestamp
+           >> entry.startOffset >> entry.endOffset >> entry.types;
+
+    return entry;
+}
+
+/**
+ * @brief Write an entry of an index
+ * @param indexFile, open index
+ * @param entry, entry
+ * @return true if the entry is written
+ *
+ * Append an entry to an index
+ */
+bool MachineEventLog::writeIndexEntry(QFile &indexFile, const IndexEntry &entry)
+{
+    QDataStream stream(&indexFile);
+    stream << entry.firstTimestamp << entry.lastTimestamp
+           << entry.startOffset << entry.endOffset << entry.types;
+
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+ * @brief Read the events of a block
+ * @param segmentFile, open segment
+ * @param entry, block of events
+ * @param from, time of the oldest event
+ * @param to, time of the newest event
+ * @param types, mask with the types of the events
+ * @param events, events of the block, in order
+ *
+ * Read the events of a block that are in the
+ * range and have one of the types
+ */
+void MachineEventLog::readBlock(QFile &segmentFile, const IndexEntry &entry,
+                                qint64 from, qint64 to, quint32 types,
+                                QList<MachineEvent> &events)
+{
+    if (!segmentFile.seek(entry.startOffset)) {
+        return;
+    }
+
+    QByteArray blockData = segmentFile.read(entry.endOffset - entry.startOffset);
+
+    foreach (const QByteArray &line, blockData.split('\n')) {
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonObject eventObject = QJsonDocument::fromJson(line).object();
+        if (eventObject.isEmpty()) {
+            continue;
+        }
+
+        MachineEvent event;
+        event.timestamp = eventObject["t"].toVariant().toLongLong();
+        event.type = MachineEventLog::typeFromName(eventObject["type"].toString());
+        event.data = eventObject["data"].toObject();
+
+        if (event.timestamp >= from && event.timestamp <= to && (event.type & types) != 0) {
+            events.append(event);
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MACHINEEVENTLOG_H
+#define MACHINEEVENTLOG_H
+
+// Qt
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+struct MachineEvent {
+    qint64 timestamp;
+    quint32 type;
+    QJsonObject data;
+};
+
+class MachineEventLog : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MachineEventLog(const QString &directoryPath,
+                                 QObject *parent = nullptr);
+        ~MachineEventLog();
+
+        enum EventTypes {
+            Launch    = 0x01,
+            State     = 0x02,
+            QMPEvent  = 0x04,
+            Exit      = 0x08,
+            Error     = 0x10,
+            Sample    = 0x20,
+            Restart   = 0x40,
+            AllEvents = 0xFFFFFFFF
+        };
+
+        QString directoryPath() const;
+
+        void record(EventTypes type, const QJsonObject &data);
+        void flush();
+
+        static QList<MachineEvent> query(const QString &directoryPath,
+                                         qint64 from, qint64 to,
+                                         quint32 types = MachineEventLog::AllEvents,
+                                         int limit = 200);
+
+        static QString typeName(quint32 type);
+        static quint32 typeFromName(const QString &name);
+
+    signals:
+        void eventRecorded(const MachineEvent &event);
+
+    public slots:
+
+    protected:
+
+    private:
+        // Entry of the index. Every entry describes a block of events
+        struct IndexEntry {
+            qint64 firstTimestamp;
+            qint64 lastTimestamp;
+            qint64 startOffset;
+            qint64 endOffset;
+            quint32 types;
+        };
+
+        QString m_directoryPath;
+
+        QFile m_segmentFile;
+        QFile m_indexFile;
+
+        IndexEntry m_block;
+        int m_blockEvents;
+        qint64 m_lastTimestamp;
+
+        // Methods
+        bool openSegment(qint64 timestamp);
+        void closeSegment();
+        void writeBlock();
+        void indexTail(qint64 startOffset);
+        void pruneSegments();
+
+        static QStringList segments(const QString &directoryPath);
+        static QString indexPath(const QString &segmentPath);
+        static qint64 segmentStart(const QString &segmentName);
+        static int indexCount(QFile &indexFile);
+        static IndexEntry readIndexEntry(QFile &indexFile, int position);
+        static bool writeIndexEntry(QFile &indexFile, const IndexEntry &entry);
+        static void readBlock(QFile &segmentFile, const IndexEntry &entry,
+                              qint64 from, qint64 to, quint32 types,
+                              QList<MachineEvent> &events);
+};
+
+Q_DECLARE_METATYPE(MachineEvent)
+
+#endif // MACHINEEVENTLOG_H
@@ -0,0 +1,571 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "mediacopier.h"
+
+// GNU
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#endif
+
+// Progress and cancellation are checked after every block
+static const qint64 COPY_BLOCK_SIZE = 64 * 1024 * 1024;
+static const qint64 COPY_BUFFER_SIZE = 4 * 1024 * 1024;
+static const int MAX_COPY_THREADS = 4;
+
+#ifdef Q_OS_LINUX
+/**
+ * @brief Copy a range of a file with a buffer
+ * @param sourceFd, source file
+ * @param destinationFd, destination file
+ * @param offset, start of the range
+ * @param length, length of the range
+ * @param buffer, buffer used to copy
+ * @param error, description of the problem
+ * @return true if the range is copied
+ *
+ * Copy a range of a file with read and write.
+ * The destination must already have the final size
+ */
+static bool copyRangeBuffered(int sourceFd, int destinationFd, qint64 offset, qint64 length,
+                              QByteArray &buffer, QString &error)
+{
+    if (buffer.isEmpty()) {
+        buffer.resize(COPY_BUFFER_SIZE);
+    }
+
+    while (length > 0) {
+        ssize_t readBytes = ::pread(sourceFd, buffer.data(), qMin<qint64>(buffer.size(), length), offset);
+        if (readBytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (readBytes < 0) {
+            error = qt_error_string(errno);
+            return false;
+        }
+        if (readBytes == 0) {
+            break;
+        }
+
+        if (!MediaCopier::isZeroBlock(buffer.constData(), readBytes)) {
+            qint64 written = 0;
+            while (written < readBytes) {
+                ssize_t writtenBytes = ::pwrite(destinationFd, buffer.constData() + written,
+                                                readBytes - written, offset + written);
+                if (writtenBytes < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (writtenBytes < 0) {
+                    error = qt_error_string(errno);
+                    return false;
+                }
+                written += writtenBytes;
+            }
+        }
+
+        offset += readBytes;
+        length -= readBytes;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copy the data regions of a file
+ * @param sourceFd, source file
+ * @param destinationFd, destination file
+ * @param size, size of the source file
+ * @param cancelled, true when the copy must stop
+ * @param progress, function called with the copied bytes
+ * @param method, method used to copy the file
+ * @param error, description of the problem
+ * @return true if the file is copied
+ *
+ * Try a reflink first. Otherwise only the data regions are
+ * copied, with copy_file_range or with a buffer when the
+ * kernel cannot copy between both filesystems
+ */
+static bool copyFileDescriptor(int sourceFd, int destinationFd, qint64 size,
+                               const std::atomic_bool &cancelled,
+                               MediaCopier::ProgressCallback progress,
+                               MediaCopyJob::Methods &method, QString &error)
+{
+#ifdef FICLONE
+    if (::ioctl(destinationFd, FICLONE, sourceFd) == 0) {
+        method = MediaCopyJob::Reflink;
+        progress(size);
+        return true;
+    }
+#endif
+
+    // The holes of the source stay as holes in the destination
+    if (::ftruncate(destinationFd, size) != 0) {
+        error = qt_error_string(errno);
+        return false;
+    }
+
+    method = MediaCopyJob::CopyRange;
+    QByteArray buffer;
+    qint64 offset = 0;
+
+    while (offset < size) {
+        if (cancelled) {
+            error = QObject::tr("The copy has been cancelled");
+            return false;
+        }
+
+        off_t dataStart = ::lseek(sourceFd, offset, SEEK_DATA);
+        off_t dataEnd = size;
+        if (dataStart < 0 && errno == ENXIO) {
+            // Only holes until the end of the file
+            break;
+        } else if (dataStart < 0) {
+            // The filesystem doesn't report the holes
+            dataStart = offset;
+        } else {
+            dataEnd = ::lseek(sourceFd, dataStart, SEEK_HOLE);
+            if (dataEnd < 0) {
+                dataEnd = size;
+            }
+        }
+
+        qint64 length = qMin<qint64>(dataEnd - dataStart, COPY_BLOCK_SIZE);
+        qint64 copied = 0;
+        bool endOfFile = false;
+
+        while (method == MediaCopyJob::CopyRange && copied < length) {
+            loff_t sourceOffset = dataStart + copied;
+            loff_t destinationOffset = dataStart + copied;
+            ssize_t copiedBytes = ::copy_file_range(sourceFd, &sourceOffset,
+                                                    destinationFd, &destinationOffset,
+                                                    length - copied, 0);
+            if (copiedBytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (copiedBytes < 0 && (errno == EXDEV || errno == ENOSYS ||
+                                    errno == EINVAL || errno == EOPNOTSUPP)) {
+                method = MediaCopyJob::Buffered;
+            } else if (copiedBytes < 0) {
+                error = qt_error_string(errno);
+                return false;
+            } else if (copiedBytes == 0) {
+                // The source is shorter than expected
+                length = copied;
+                endOfFile = true;
+            } else {
+                copied += copiedBytes;
+            }
+        }
+
+        if (copied < length &&
+            !copyRangeBuffered(sourceFd, destinationFd, dataStart + copied, length - copied, buffer, error)) {
+            return false;
+        }
+
+        if (endOfFile) {
+            break;
+        }
+
+        offset = dataStart + length;
+        progress(offset);
+    }
+
+    progress(size);
+
+    return true;
+}
+#endif
+
+/**
+ * @brief Media copy job
+ * @param source, path of the file to copy
+ * @param destination, path of the new file
+ * @param parent, parent object
+ *
+ * Copy of a media file. The copy runs in a thread
+ * of the pool and reports the progress with signals
+ */
+MediaCopyJob::MediaCopyJob(const QString &source,
+                           const QString &destination,
+                           QObject *parent) : QObject(parent)
+{
+    this->m_source = source;
+    this->m_destination = destination;
+    this->m_bytesCopied = 0;
+    this->m_totalBytes = QFileInfo(source).size();
+    this->m_method = MediaCopyJob::None;
+    this->m_cancelled = false;
+
+    qDebug() << "MediaCopyJob created";
+}
+
+MediaCopyJob::~MediaCopyJob()
+{
+    qDebug() << "MediaCopyJob destroyed";
+}
+
+/**
+ * @brief Get the source of the copy
+ * @return path of the file to copy
+ *
+ * Get the source of the copy
+ */
+QString MediaCopyJob::source() const
+{
+    return m_source;
+}
+
+/**
+ * @brief Get the destination of the copy
+ * @return path of the new file
+ *
+ * Get the destination of the copy
+ */
+QString MediaCopyJob::destination() const
+{
+    return m_destination;
+}
+
+/**
+ * @brief Get the copied bytes
+ * @return bytes copied, holes included
+ *
+ * Get the copied bytes
+ */
+qint64 MediaCopyJob::bytesCopied() const
+{
+    return m_bytesCopied;
+}
+
+/**
+ * @brief Get the size of the file
+ * @return size of the file to copy
+ *
+ * Get the size of the file
+ */
+qint64 MediaCopyJob::totalBytes() const
+{
+    return m_totalBytes;
+}
+
+/**
+ * @brief Get the method used to copy the file
+ * @return method used to copy the file
+ *
+ * Get the method used to copy the file
+ */
+MediaCopyJob::Methods MediaCopyJob::method() const
+{
+    return m_method;
+}
+
+/**
+ * @brief Get the error of the copy
+ * @return description of the problem
+ *
+ * Get the error of the copy
+ */
+QString MediaCopyJob::errorString() const
+{
+    return m_errorString;
+}
+
+/**
+ * @brief Get if the copy is cancelled
+ * @return true if the copy is cancelled
+ *
+ * Get if the copy is cancelled
+ */
+bool MediaCopyJob::isCancelled() const
+{
+    return m_cancelled;
+}
+
+/**
+ * @brief Cancel the copy
+ *
+ * Cancel the copy. The copy stops after the current
+ * block and the new file is removed
+ */
+void MediaCopyJob::cancel()
+{
+    this->m_cancelled = true;
+}
+
+/**
+ * @brief Update the progress of the copy
+ * @param bytesCopied, bytes copied
+ *
+ * Update the progress of the copy
+ */
+void MediaCopyJob::updateProgress(qint64 bytesCopied)
+{
+    this->m_bytesCopied = bytesCopied;
+
+    emit(progressChanged(this->m_bytesCopied, this->m_totalBytes));
+}
+
+/**
+ * @brief Finish the copy
+ * @param success, true if the file is copied
+ * @param method, method used to copy the file
+ * @param errorString, description of the problem
+ *
+ * Finish the copy. The job is deleted later
+ */
+void MediaCopyJob::finishCopy(bool success, int method, const QString &errorString)
+{
+    this->m_method = static_cast<MediaCopyJob::Methods>(method);
+    this->m_errorString = errorString;
+
+    qDebug() << "Media copied" << this->m_destination << success << this->m_method;
+
+    emit(finished(success));
+
+    this->deleteLater();
+}
+
+/**
+ * @brief Task of the pool that copies a file
+ * @param job, job of the copy
+ *
+ * Task of the pool that copies a file
+ */
+MediaCopyTask::MediaCopyTask(MediaCopyJob *job)
+{
+    this->m_job = job;
+    this->setAutoDelete(true);
+}
+
+MediaCopyTask::~MediaCopyTask()
+{
+}
+
+/**
+ * @brief Copy the file
+ *
+ * Copy the file in the thread of the pool.
+ * The job lives until the result is delivered
+ */
+void MediaCopyTask::run()
+{
+    MediaCopyJob *job = this->m_job;
+    MediaCopyJob::Methods method = MediaCopyJob::None;
+    QString error;
+
+    bool success = MediaCopier::copyFile(job->m_source, job->m_destination, job->m_cancelled,
+                                         [job](qint64 bytesCopied) {
+        QMetaObject::invokeMethod(job, "updateProgress", Qt::QueuedConnection,
+                                  Q_ARG(qint64, bytesCopied));
+    }, method, error);
+
+    QMetaObject::invokeMethod(job, "finishCopy", Qt::QueuedConnection,
+                              Q_ARG(bool, success),
+                              Q_ARG(int, static_cast<int>(method)),
+                              Q_ARG(QString, error));
+}
+
+MediaCopier::MediaCopier()
+{
+    qDebug() << "MediaCopier created";
+}
+
+MediaCopier::~MediaCopier()
+{
+    qDebug() << "MediaCopier destroyed";
+}
+
+/**
+ * @brief Copy a media file
+ * @param source, path of the file to copy
+ * @param destination, path of the new file
+ * @return job, deleted when the copy is finished
+ *
+ * Copy a media file in a thread of the pool.
+ * Several files are copied at the same time
+ */
+MediaCopyJob *MediaCopier::copy(const QString &source, const QString &destination)
+{
+    MediaCopyJob *job = new MediaCopyJob(source, destination);
+    MediaCopier::threadPool()->start(new MediaCopyTask(job));
+
+    return job;
+}
+
+/**
+ * @brief Copy a file keeping the holes
+ * @param source, path of the file to copy
+ * @param destination, path of the new file
+ * @param cancelled, true when the copy must stop
+ * @param progress, function called with the copied bytes
+ * @param method, method used to copy the file
+ * @param error, description of the problem
+ * @return true if the file is copied
+ *
+ * Copy a file. In Linux a reflink is tried first, then
+ * copy_file_range over the data regions and finally a
+ * buffered copy. The zero blocks aren't written, so
+ * sparse images stay sparse. If the copy fails the
+ * new file is removed
+ */
+bool MediaCopier::copyFile(const QString &source, const QString &destination,
+                           const std::atomic_bool &cancelled, ProgressCallback progress,
+                           MediaCopyJob::Methods &method, QString &error)
+{
+    bool copied = false;
+
+#ifdef Q_OS_LINUX
+    int sourceFd = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd < 0) {
+        error = QObject::tr("Cannot open %1: %2").arg(source, qt_error_string(errno));
+        return false;
+    }
+
+    struct stat sourceStat;
+    if (::fstat(sourceFd, &sourceStat) != 0) {
+        error = QObject::tr("Cannot read %1: %2").arg(source, qt_error_string(errno));
+        ::close(sourceFd);
+        return false;
+    }
+
+    int destinationFd = ::open(QFile::encodeName(destination).constData(),
+                               O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                               sourceStat.st_mode & 0777);
+    if (destinationFd < 0) {
+        error = QObject::tr("Cannot create %1: %2").arg(destination, qt_error_string(errno));
+        ::close(sourceFd);
+        return false;
+    }
+
+    copied = copyFileDescriptor(sourceFd, destinationFd, sourceStat.st_size,
+                                cancelled, progress, method, error);
+
+    if (::close(destinationFd) != 0 && copied) {
+        error = qt_error_string(errno);
+        copied = false;
+    }
+    ::close(sourceFd);
+#else
+    QFile sourceFile(source);
+    QFile destinationFile(destination);
+
+    if (!sourceFile.open(QFile::ReadOnly)) {
+        error = QObject::tr("Cannot open %1: %2").arg(source, sourceFile.errorString());
+        return false;
+    }
+
+    if (!destinationFile.open(QFile::WriteOnly | QFile::Truncate) ||
+        !destinationFile.resize(sourceFile.size())) {
+        error = QObject::tr("Cannot create %1: %2").arg(destination, destinationFile.errorString());
+        return false;
+    }
+
+    method = MediaCopyJob::Buffered;
+    copied = true;
+
+    QByteArray buffer(COPY_BUFFER_SIZE, Qt::Uninitialized);
+    qint64 offset = 0;
+    while (copied && !sourceFile.atEnd()) {
+        if (cancelled) {
+            error = QObject::tr("The copy has been cancelled");
+            copied = false;
+            break;
+        }
+
+        qint64 readBytes = sourceFile.read(buffer.data(), buffer.size());
+        if (readBytes <= 0) {
+            break;
+        }
+
+        // Zero blocks are left as holes
+        if (MediaCopier::isZeroBlock(buffer.constData(), readBytes)) {
+            copied = destinationFile.seek(offset + readBytes);
+        } else {
+            copied = destinationFile.write(buffer.constData(), readBytes) == readBytes;
+        }
+
+        if (!copied) {
+            error = destinationFile.errorString();
+        }
+
+        offset += readBytes;
+        if (offset % COPY_BLOCK_SIZE < readBytes) {
+            progress(offset);
+        }
+    }
+
+    destinationFile.close();
+    sourceFile.close();
+
+    if (copied) {
+        progress(offset);
+    }
+#endif
+
+    if (!copied) {
+        QFile::remove(destination);
+    }
+
+    return copied;
+}
+
+/**
+ * @brief Check if a block only contains zeros
+ * @param data, data of the block
+ * @param size, size of the block
+ * @return true if all the bytes are zero
+ *
+ * Zero blocks aren't written, they are left as holes
+ */
+bool MediaCopier::isZeroBlock(const char *data, qint64 size)
+{
+    if (size <= 0) {
+        return true;
+    }
+
+    // The block is zero if the first byte is zero and
+    // every byte is equal to the next one
+    return data[0] == 0 && std::memcmp(data, data + 1, size - 1) == 0;
+}
+
+/**
+ * @brief Get the pool of the copies
+ * @return thread pool
+ *
+ * Get the pool of the copies. The copies have their own pool
+ * to not block the rest of the tasks of the application
+ */
+QThreadPool *MediaCopier::threadPool()
+{
+    static QThreadPool *pool = nullptr;
+
+    if (pool == nullptr) {
+        pool = new QThreadPool();
+        pool->setMaxThreadCount(qBound(1, QThread::idealThreadCount(), MAX_COPY_THREADS));
+    }
+
+    return pool;
+}
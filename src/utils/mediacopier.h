@@ -0,0 +1,113 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MEDIACOPIER_H
+#define MEDIACOPIER_H
+
+// Qt
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QThread>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+// C++ standard library
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+class MediaCopyJob : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit MediaCopyJob(const QString &source,
+                              const QString &destination,
+                              QObject *parent = nullptr);
+        ~MediaCopyJob();
+
+        enum Methods {
+            None, Reflink, CopyRange, Buffered
+        };
+
+        QString source() const;
+        QString destination() const;
+        qint64 bytesCopied() const;
+        qint64 totalBytes() const;
+        MediaCopyJob::Methods method() const;
+        QString errorString() const;
+        bool isCancelled() const;
+
+        void cancel();
+
+    signals:
+        void progressChanged(qint64 bytesCopied, qint64 totalBytes);
+        void finished(bool success);
+
+    private slots:
+        void updateProgress(qint64 bytesCopied);
+        void finishCopy(bool success, int method, const QString &errorString);
+
+    private:
+        friend class MediaCopyTask;
+
+        QString m_source;
+        QString m_destination;
+        qint64 m_bytesCopied;
+        qint64 m_totalBytes;
+        Methods m_method;
+        QString m_errorString;
+        std::atomic_bool m_cancelled;
+};
+
+class MediaCopyTask : public QRunnable {
+
+    public:
+        explicit MediaCopyTask(MediaCopyJob *job);
+        ~MediaCopyTask();
+
+        void run() override;
+
+    private:
+        MediaCopyJob *m_job;
+};
+
+class MediaCopier {
+
+    public:
+        MediaCopier();
+        ~MediaCopier();
+
+        typedef std::function<void(qint64 bytesCopied)> ProgressCallback;
+
+        static MediaCopyJob *copy(const QString &source, const QString &destination);
+
+        static bool copyFile(const QString &source, const QString &destination,
+                             const std::atomic_bool &cancelled, ProgressCallback progress,
+                             MediaCopyJob::Methods &method, QString &error);
+
+        static bool isZeroBlock(const char *data, qint64 size);
+
+    private:
+        static QThreadPool *threadPool();
+};
+
+#endif // MEDIACOPIER_H
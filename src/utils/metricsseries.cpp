@@ -0,0 +1,165 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "metricsseries.h"
+
+/**
+ * @brief Get the sample in JSON format
+ * @return sample in JSON format
+ *
+ * Get the sample in JSON format
+ */
+QJsonObject MetricsSample::toJSON() const
+{
+    QJsonObject sample;
+    sample["cpu"] = this->CPUUsage;
+    sample["vcpu"] = this->vCPUUsage;
+    sample["steal"] = this->vCPUSteal;
+    sample["rss"] = static_cast<double>(this->residentMemory);
+    sample["readOps"] = this->readOperations;
+    sample["writeOps"] = this->writeOperations;
+    sample["readBytes"] = this->readBytes;
+    sample["writeBytes"] = this->writeBytes;
+
+    return sample;
+}
+
+/**
+ * @brief Series of samples
+ * @param capacity, number of samples kept
+ *
+ * Ring buffer with the last samples of a machine.
+ * The memory is reserved once, the oldest
+ * sample is replaced when the buffer is full
+ */
+MetricsSeries::MetricsSeries(int capacity)
+{
+    this->m_samples.resize(qMax(1, capacity));
+    this->m_first = 0;
+    this->m_count = 0;
+}
+
+/**
+ * @brief Add a sample
+ * @param sample, new sample
+ *
+ * Add a sample, replacing the oldest one if the buffer is full
+ */
+void MetricsSeries::append(const MetricsSample &sample)
+{
+    if (this->m_count < this->m_samples.size()) {
+        this->m_samples[(this->m_first + this->m_count) % this->m_samples.size()] = sample;
+        ++this->m_count;
+    } else {
+        this->m_samples[this->m_first] = sample;
+        this->m_first = (this->m_first + 1) % this->m_samples.size();
+    }
+}
+
+/**
+ * @brief Remove all the samples
+ *
+ * Remove all the samples and reset the counters
+ */
+void MetricsSeries::clear()
+{
+    this->m_first = 0;
+    this->m_count = 0;
+    this->m_counters = MetricsCounters();
+}
+
+/**
+ * @brief Get the number of samples
+ * @return number of samples
+ *
+ * Get the number of samples
+ */
+int MetricsSeries::size() const
+{
+    return m_count;
+}
+
+/**
+ * @brief Get the maximum number of samples
+ * @return maximum number of samples
+ *
+ * Get the maximum number of samples
+ */
+int MetricsSeries::capacity() const
+{
+    return this->m_samples.size();
+}
+
+/**
+ * @brief Get if there are samples
+ * @return true if there are no samples
+ *
+ * Get if there are samples
+ */
+bool MetricsSeries::isEmpty() const
+{
+    return m_count == 0;
+}
+
+/**
+ * @brief Get a sample
+ * @param index, position of the sample, 0 is the oldest
+ * @return sample
+ *
+ * Get a sample
+ */
+const MetricsSample &MetricsSeries::at(int index) const
+{
+    return this->m_samples.at((this->m_first + index) % this->m_samples.size());
+}
+
+/**
+ * @brief Get the newest sample
+ * @return newest sample
+ *
+ * Get the newest sample. The series can't be empty
+ */
+const MetricsSample &MetricsSeries::last() const
+{
+    return this->at(this->m_count - 1);
+}
+
+/**
+ * @brief Get the counters
+ * @return counters since the machine was started
+ *
+ * Get the cumulative counters of the machine
+ */
+const MetricsCounters &MetricsSeries::counters() const
+{
+    return m_counters;
+}
+
+/**
+ * @brief Get the counters
+ * @return counters since the machine was started
+ *
+ * Get the cumulative counters of the machine to update them
+ */
+MetricsCounters &MetricsSeries::counters()
+{
+    return this->m_counters;
+}
@@ -0,0 +1,92 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef METRICSSERIES_H
+#define METRICSSERIES_H
+
+// Qt
+#include <QVector>
+#include <QJsonObject>
+
+struct MetricsSample {
+    qint64 timestamp = 0;
+
+    // CPU usage of the whole process, 100 is one host CPU
+    double CPUUsage = 0;
+
+    // Average usage of the vCPUs and time they wait for a
+    // host CPU, 100 is the whole time of one vCPU
+    double vCPUUsage = 0;
+    double vCPUSteal = 0;
+
+    // Resident memory in bytes
+    qint64 residentMemory = 0;
+
+    // Disk operations and bytes per second
+    double readOperations = 0;
+    double writeOperations = 0;
+    double readBytes = 0;
+    double writeBytes = 0;
+
+    QJsonObject toJSON() const;
+};
+
+struct MetricsCounters {
+    // CPU time of the whole process and of the vCPUs, in seconds
+    double CPUTime = 0;
+    double vCPUTime = 0;
+
+    // Disk operations and bytes since the machine was started
+    qint64 readOperations = 0;
+    qint64 writeOperations = 0;
+    qint64 readBytes = 0;
+    qint64 writeBytes = 0;
+
+    // Bytes of the tap devices, seen from the host
+    qint64 receivedBytes = 0;
+    qint64 transmittedBytes = 0;
+};
+
+class MetricsSeries {
+
+    public:
+        explicit MetricsSeries(int capacity = 150);
+
+        void append(const MetricsSample &sample);
+        void clear();
+
+        int size() const;
+        int capacity() const;
+        bool isEmpty() const;
+
+        const MetricsSample &at(int index) const;
+        const MetricsSample &last() const;
+
+        const MetricsCounters &counters() const;
+        MetricsCounters &counters();
+
+    private:
+        QVector<MetricsSample> m_samples;
+        int m_first;
+        int m_count;
+        MetricsCounters m_counters;
+};
+
+#endif // METRICSSERIES_H
@@ -160,10 +160,18 @@ NewDiskPage::NewDiskPage(Machine *machine,
 
     m_fileTypeGroupBox->setLayout(m_diskTypeLayout);
 
+    this->m_diskJob = nullptr;
+    this->m_diskCreated = false;
+
+    m_diskProgressBar = new QProgressBar(this);
+    m_diskProgressBar->setRange(0, 0);
+    m_diskProgressBar->setVisible(false);
+
     m_newDiskLayout = new QVBoxLayout();
     m_newDiskLayout->addWidget(m_fileLocationGroupBox);
     m_newDiskLayout->addWidget(m_fileSizeGroupBox);
     m_newDiskLayout->addWidget(m_fileTypeGroupBox);
+    m_newDiskLayout->addWidget(m_diskProgressBar);
 
     this->setLayout(m_newDiskLayout);
 
@@ -172,6 +180,11 @@ NewDiskPage::NewDiskPage(Machine *machine,
 
 NewDiskPage::~NewDiskPage()
 {
+    // The wizard is closed while the disk is being created
+    if (this->m_diskJob != nullptr) {
+        this->m_diskJob->cancel();
+    }
+
     qDebug() << "NewDiskPage destroyed";
 }
 
@@ -228,24 +241,69 @@ QString NewDiskPage::getExtension()
  * @brief Validate the page
  * @return true if the disk is created
  *
- * Validate the page and create the disk
+ * The disk is created by a qemu-img job without
+ * blocking the UI. When the job finishes the wizard
+ * is accepted again and the page is validated
  */
 bool NewDiskPage::validatePage()
 {
-    bool isDiskCreated = SystemUtils::createDisk(this->m_qemuGlobalObject,
-                                                 this->m_diskPath,
-                                                 NewDiskPage::getExtension(),
-                                                 this->m_diskSpinBox->value(),
-                                                 false);
+    if (this->m_diskCreated) {
+        return true;
+    }
 
-    QFileInfo newDiskInfo(this->m_diskPath);
+    if (this->m_diskJob != nullptr) {
+        return false;
+    }
+
+    this->m_diskJob = this->m_qemuGlobalObject->QEMUImgJobs()->create(this->m_diskPath,
+                                                                     NewDiskPage::getExtension(),
+                                                                     QString::number(this->m_diskSpinBox->value()) + "G");
+    connect(this->m_diskJob, &QEMUImgJob::finished,
+            this, &NewDiskPage::diskJobFinished);
+
+    this->m_fileLocationGroupBox->setEnabled(false);
+    this->m_fileSizeGroupBox->setEnabled(false);
+    this->m_fileTypeGroupBox->setEnabled(false);
+    this->m_diskProgressBar->setVisible(true);
 
-    if (isDiskCreated) {
-        this->m_newMedia->setName(newDiskInfo.fileName());
-        this->m_newMedia->setPath(QDir::toNativeSeparators(newDiskInfo.absoluteFilePath()));
-        this->m_newMedia->setType("hdd");
-        this->m_newMedia->setUuid(QUuid::createUuid());
+    return false;
+}
+
+/**
+ * @brief The job that creates the disk is finished
+ * @param success, true if the disk is created
+ *
+ * Add the disk to the media and close the wizard,
+ * or show the error of qemu-img
+ */
+void NewDiskPage::diskJobFinished(bool success)
+{
+    QString errorString = this->m_diskJob->errorString();
+    this->m_diskJob = nullptr;
+
+    this->m_fileLocationGroupBox->setEnabled(true);
+    this->m_fileSizeGroupBox->setEnabled(true);
+    this->m_fileTypeGroupBox->setEnabled(true);
+    this->m_diskProgressBar->setVisible(false);
+
+    if (!success) {
+        SystemUtils::showMessage(tr("Qtemu - Critical error"),
+                                 tr("<p>Cannot finish qemu-img</p>"
+                                    "<p><strong>Image isn't created</strong></p>"
+                                    "<p>Error: %1</p>").arg(errorString),
+                                 QMessageBox::Critical);
+        return;
     }
 
-    return isDiskCreated;
+    QFileInfo newDiskInfo(this->m_diskPath);
+
+    this->m_newMedia->setName(newDiskInfo.fileName());
+    this->m_newMedia->setPath(QDir::toNativeSeparators(newDiskInfo.absoluteFilePath()));
+    this->m_newMedia->setType("hdd");
+    this->m_newMedia->setFormat(NewDiskPage::getExtension());
+    this->m_newMedia->setBus(Media::defaultBus("hdd", this->m_machineConfig->getOSType()));
+    this->m_newMedia->setUuid(QUuid::createUuid());
+
+    this->m_diskCreated = true;
+    this->wizard()->accept();
 }
@@ -33,6 +33,7 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QFileDialog>
+#include <QProgressBar>
 
 // Local
 #include "../machine.h"
@@ -75,6 +76,7 @@ class NewDiskPage: public QWizardPage {
 
     private slots:
         void selectNameNewDisk();
+        void diskJobFinished(bool success);
 
     protected:
 
@@ -100,6 +102,8 @@ class NewDiskPage: public QWizardPage {
 
         QPushButton *m_pathNewDiskPushButton;
 
+        QProgressBar *m_diskProgressBar;
+
         QRadioButton *m_rawRadioButton;
         QRadioButton *m_qcowRadioButton;
         QRadioButton *m_qcow2RadioButton;
@@ -110,6 +114,9 @@ class NewDiskPage: public QWizardPage {
         QString m_diskFormat;
         QString m_diskPath;
 
+        QEMUImgJob *m_diskJob;
+        bool m_diskCreated;
+
         Machine *m_machineConfig;
         Media *m_newMedia;
         QEMU *m_qemuGlobalObject;
@@ -0,0 +1,555 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "qemuimgjobrunner.h"
+#include "../qemu.h"
+
+// Time to wait for qemu-img after a cancellation before killing it
+static const int CANCEL_TIMEOUT = 3000;
+
+/**
+ * @brief qemu-img job
+ * @param parent, parent object
+ *
+ * Operation of qemu-img executed by the job runner
+ */
+QEMUImgJob::QEMUImgJob(QObject *parent) : QObject(parent)
+{
+    this->m_operation = QEMUImgJob::Create;
+    this->m_state = QEMUImgJob::Queued;
+    this->m_progress = -1;
+    this->m_process = nullptr;
+    this->m_outputCreated = false;
+
+    qDebug() << "QEMUImgJob created";
+}
+
+QEMUImgJob::~QEMUImgJob()
+{
+    qDebug() << "QEMUImgJob destroyed";
+}
+
+/**
+ * @brief Get the operation of the job
+ * @return operation of the job
+ *
+ * Get the operation of the job. Ex: create, convert...
+ */
+QEMUImgJob::Operations QEMUImgJob::operation() const
+{
+    return m_operation;
+}
+
+/**
+ * @brief Get the state of the job
+ * @return state of the job
+ *
+ * Get the state of the job
+ */
+QEMUImgJob::States QEMUImgJob::state() const
+{
+    return m_state;
+}
+
+/**
+ * @brief Get the arguments of qemu-img
+ * @return arguments of qemu-img
+ *
+ * Get the arguments of qemu-img
+ */
+QStringList QEMUImgJob::arguments() const
+{
+    return m_arguments;
+}
+
+/**
+ * @brief Get the image written by the job
+ * @return path of the image, empty if the job doesn't create one
+ *
+ * Get the image written by the job.
+ * The image is removed if the job fails
+ * and it didn't exist before the job
+ */
+QString QEMUImgJob::outputPath() const
+{
+    return m_outputPath;
+}
+
+/**
+ * @brief Get the progress of the job
+ * @return progress between 0 and 100, -1 if unknown
+ *
+ * Get the progress of the job. Only convert and
+ * commit report the progress
+ */
+double QEMUImgJob::progress() const
+{
+    return m_progress;
+}
+
+/**
+ * @brief Get the output of qemu-img
+ * @return standard output of qemu-img
+ *
+ * Get the output of qemu-img
+ */
+QString QEMUImgJob::output() const
+{
+    return m_output;
+}
+
+/**
+ * @brief Get the error of the job
+ * @return error of the job
+ *
+ * Get the error of the job
+ */
+QString QEMUImgJob::errorString() const
+{
+    return m_errorString;
+}
+
+/**
+ * @brief Get a description of the job
+ * @return description of the job
+ *
+ * Get a description of the job.
+ * Ex: Create /home/user/disk.qcow2
+ */
+QString QEMUImgJob::description() const
+{
+    QString target = this->m_outputPath.isEmpty() && !this->m_arguments.isEmpty() ? this->m_arguments.last()
+                                                                                : this->m_outputPath;
+
+    switch (this->m_operation) {
+        case QEMUImgJob::Create:
+            return tr("Create %1").arg(target);
+        case QEMUImgJob::Convert:
+            return tr("Convert %1").arg(target);
+        case QEMUImgJob::Resize:
+            return tr("Resize %1").arg(target);
+        case QEMUImgJob::Check:
+            return tr("Check %1").arg(target);
+        case QEMUImgJob::Commit:
+            return tr("Commit %1").arg(target);
+    }
+
+    return target;
+}
+
+/**
+ * @brief Get if the job is finished
+ * @return true if the job is finished, failed or cancelled
+ *
+ * Get if the job is finished
+ */
+bool QEMUImgJob::isFinished() const
+{
+    return m_state == QEMUImgJob::Finished ||
+           m_state == QEMUImgJob::Failed ||
+           m_state == QEMUImgJob::Cancelled;
+}
+
+/**
+ * @brief Cancel the job
+ *
+ * Cancel the job. A queued job is removed from the
+ * queue and a running job is terminated
+ */
+void QEMUImgJob::cancel()
+{
+    if (!this->isFinished()) {
+        emit(cancelRequested());
+    }
+}
+
+/**
+ * @brief qemu-img job runner
+ * @param QEMUObject, QEMU object with the path of qemu-img
+ * @param parent, parent object
+ *
+ * Queue of qemu-img jobs. The jobs are executed
+ * without blocking, several at the same time
+ * up to the configured limit
+ */
+QEMUImgJobRunner::QEMUImgJobRunner(QEMU *QEMUObject, QObject *parent) : QObject(parent)
+{
+    this->m_QEMUObject = QEMUObject;
+
+    QSettings settings;
+    settings.beginGroup("Configuration");
+    this->m_maxJobs = qMax(1, settings.value("qemuImgJobs", 2).toInt());
+    settings.endGroup();
+
+    qDebug() << "QEMUImgJobRunner created";
+}
+
+QEMUImgJobRunner::~QEMUImgJobRunner()
+{
+    qDebug() << "QEMUImgJobRunner destroyed";
+}
+
+/**
+ * @brief Create an image
+ * @param path, path of the image
+ * @param format, format of the image. Ex: qcow2, raw
+ * @param size, size of the image. Ex: 20G
+ * @param options, options of the format. Ex: preallocation=falloc
+ * @return job
+ *
+ * Create an image
+ */
+QEMUImgJob *QEMUImgJobRunner::create(const QString &path, const QString &format,
+                                     const QString &size, const QStringList &options)
+{
+    QStringList arguments;
+    arguments << "create" << "-f" << format;
+    if (!options.isEmpty()) {
+        arguments << "-o" << options.join(',');
+    }
+    arguments << QDir::toNativeSeparators(path) << size;
+
+    return this->enqueue(QEMUImgJob::Create, arguments, path);
+}
+
+/**
+ * @brief Create a qcow2 overlay
+ * @param path, path of the overlay
+ * @param backingPath, path of the backing image
+ * @param backingFormat, format of the backing image
+ * @return job
+ *
+ * Create a qcow2 image that stores only the changes made over
+ * the backing image. The size is taken from the backing image
+ */
+QEMUImgJob *QEMUImgJobRunner::createOverlay(const QString &path, const QString &backingPath,
+                                            const QString &backingFormat)
+{
+    QStringList arguments;
+    arguments << "create" << "-f" << "qcow2"
+              << "-b" << QDir::toNativeSeparators(QFileInfo(backingPath).absoluteFilePath())
+              << "-F" << backingFormat
+              << QDir::toNativeSeparators(path);
+
+    return this->enqueue(QEMUImgJob::Create, arguments, path);
+}
+
+/**
+ * @brief Convert an image
+ * @param source, path of the source image
+ * @param destination, path of the new image
+ * @param format, format of the new image
+ * @param compress, true to compress the new image
+ * @return job
+ *
+ * Convert an image to other format
+ */
+QEMUImgJob *QEMUImgJobRunner::convert(const QString &source, const QString &destination,
+                                      const QString &format, bool compress)
+{
+    QStringList arguments;
+    arguments << "convert" << "-p" << "-O" << format;
+    if (compress) {
+        arguments << "-c";
+    }
+    arguments << QDir::toNativeSeparators(source) << QDir::toNativeSeparators(destination);
+
+    return this->enqueue(QEMUImgJob::Convert, arguments, destination);
+}
+
+/**
+ * @brief Resize an image
+ * @param path, path of the image
+ * @param size, new size of the image. Ex: 40G, +10G
+ * @return job
+ *
+ * Resize an image
+ */
+QEMUImgJob *QEMUImgJobRunner::resize(const QString &path, const QString &size)
+{
+    QStringList arguments;
+    arguments << "resize" << QDir::toNativeSeparators(path) << size;
+
+    return this->enqueue(QEMUImgJob::Resize, arguments);
+}
+
+/**
+ * @brief Check an image
+ * @param path, path of the image
+ * @return job
+ *
+ * Check the consistency of an image
+ */
+QEMUImgJob *QEMUImgJobRunner::check(const QString &path)
+{
+    QStringList arguments;
+    arguments << "check" << QDir::toNativeSeparators(path);
+
+    return this->enqueue(QEMUImgJob::Check, arguments);
+}
+
+/**
+ * @brief Commit an image
+ * @param path, path of the image
+ * @return job
+ *
+ * Commit the changes of an image into its backing file
+ */
+QEMUImgJob *QEMUImgJobRunner::commit(const QString &path)
+{
+    QStringList arguments;
+    arguments << "commit" << "-p" << QDir::toNativeSeparators(path);
+
+    return this->enqueue(QEMUImgJob::Commit, arguments);
+}
+
+/**
+ * @brief Get the jobs
+ * @return queued and running jobs
+ *
+ * Get the queued and running jobs
+ */
+QList<QEMUImgJob *> QEMUImgJobRunner::jobs() const
+{
+    QList<QEMUImgJob *> jobs = this->m_runningJobs;
+    jobs.append(this->m_queuedJobs);
+
+    return jobs;
+}
+
+/**
+ * @brief Get the maximum number of parallel jobs
+ * @return maximum number of parallel jobs
+ *
+ * Get the maximum number of parallel jobs
+ */
+int QEMUImgJobRunner::maxJobs() const
+{
+    return m_maxJobs;
+}
+
+/**
+ * @brief Set the maximum number of parallel jobs
+ * @param maxJobs, maximum number of parallel jobs
+ *
+ * Set the maximum number of parallel jobs.
+ * The running jobs aren't stopped
+ */
+void QEMUImgJobRunner::setMaxJobs(const int maxJobs)
+{
+    this->m_maxJobs = qMax(1, maxJobs);
+    this->startJobs();
+}
+
+/**
+ * @brief Add a job to the queue
+ * @param operation, operation of the job
+ * @param arguments, arguments of qemu-img
+ * @param outputPath, image written by the job
+ * @return job
+ *
+ * Add a job to the queue. The job is started
+ * in the next iteration of the event loop, so the
+ * caller can connect the signals of the job
+ */
+QEMUImgJob *QEMUImgJobRunner::enqueue(QEMUImgJob::Operations operation,
+                                      const QStringList &arguments,
+                                      const QString &outputPath)
+{
+    QEMUImgJob *job = new QEMUImgJob(this);
+    job->m_operation = operation;
+    job->m_arguments = arguments;
+    job->m_outputPath = outputPath;
+
+    connect(job, &QEMUImgJob::cancelRequested,
+            this, [=]() {
+        this->cancelJob(job);
+    });
+
+    this->m_queuedJobs.enqueue(job);
+    emit(jobAdded(job));
+
+    QTimer::singleShot(0, this, &QEMUImgJobRunner::startJobs);
+
+    return job;
+}
+
+/**
+ * @brief Start the queued jobs
+ *
+ * Start the queued jobs until the limit
+ * of parallel jobs is reached
+ */
+void QEMUImgJobRunner::startJobs()
+{
+    while (!this->m_queuedJobs.isEmpty() && this->m_runningJobs.size() < this->m_maxJobs) {
+        this->startJob(this->m_queuedJobs.dequeue());
+    }
+}
+
+/**
+ * @brief Start a job
+ * @param job, job to start
+ *
+ * Start qemu-img. The progress is read from the
+ * standard output, qemu-img -p writes (xx.xx/100%)
+ */
+void QEMUImgJobRunner::startJob(QEMUImgJob *job)
+{
+    job->m_state = QEMUImgJob::Running;
+    this->m_runningJobs.append(job);
+
+    QString program = this->m_QEMUObject->QEMUImgPath();
+    if (program.isEmpty()) {
+        job->m_errorString = tr("Cannot find qemu-img. Ensure that you have installed "
+                                "qemu-img in your system and it's available");
+        this->finishJob(job, QEMUImgJob::Failed);
+        return;
+    }
+
+    // An image that already exists isn't removed if the job fails
+    job->m_outputCreated = !job->m_outputPath.isEmpty() && !QFileInfo::exists(job->m_outputPath);
+
+    job->m_process = new QProcess(job);
+
+    connect(job->m_process, &QProcess::readyReadStandardOutput,
+            this, [=]() {
+        this->readProgress(job);
+    });
+    connect(job->m_process, &QProcess::errorOccurred,
+            this, [=](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            job->m_errorString = tr("Cannot start qemu-img: %1").arg(job->m_process->errorString());
+            this->finishJob(job, QEMUImgJob::Failed);
+        }
+    });
+    connect(job->m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [=](int exitCode, QProcess::ExitStatus exitStatus) {
+        job->m_errorString.append(QString::fromLocal8Bit(job->m_process->readAllStandardError()).trimmed());
+
+        if (job->m_state == QEMUImgJob::Cancelled) {
+            this->finishJob(job, QEMUImgJob::Cancelled);
+        } else if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+            this->finishJob(job, QEMUImgJob::Finished);
+        } else {
+            if (job->m_errorString.isEmpty()) {
+                job->m_errorString = tr("qemu-img finished with exit code %1").arg(exitCode);
+            }
+            this->finishJob(job, QEMUImgJob::Failed);
+        }
+    });
+
+    qDebug() << "qemu-img" << job->m_arguments;
+    job->m_process->start(program, job->m_arguments);
+
+    emit(job->started());
+}
+
+/**
+ * @brief Read the progress of a job
+ * @param job, job with new output
+ *
+ * Read the progress of a job. The output that
+ * isn't progress is kept for the caller
+ */
+void QEMUImgJobRunner::readProgress(QEMUImgJob *job)
+{
+    static const QRegularExpression progressRegex("\\((\\d+(?:\\.\\d+)?)/100%\\)");
+
+    QString output = QString::fromLocal8Bit(job->m_process->readAllStandardOutput());
+
+    QRegularExpressionMatchIterator matches = progressRegex.globalMatch(output);
+    double progress = -1;
+    while (matches.hasNext()) {
+        progress = matches.next().captured(1).toDouble();
+    }
+
+    if (progress >= 0 && progress != job->m_progress) {
+        job->m_progress = progress;
+        emit(job->progressChanged(progress));
+    }
+
+    job->m_output.append(output.remove(progressRegex).remove('\r'));
+}
+
+/**
+ * @brief Finish a job
+ * @param job, finished job
+ * @param state, final state of the job
+ *
+ * Finish a job and start the next ones.
+ * The incomplete images created by the job are removed
+ */
+void QEMUImgJobRunner::finishJob(QEMUImgJob *job, QEMUImgJob::States state)
+{
+    // Already finished
+    if (!this->m_runningJobs.contains(job) && !this->m_queuedJobs.contains(job)) {
+        return;
+    }
+
+    job->m_state = state;
+    this->m_runningJobs.removeAll(job);
+    this->m_queuedJobs.removeAll(job);
+
+    if (state != QEMUImgJob::Finished && job->m_process != nullptr && job->m_outputCreated) {
+        QFile::remove(job->m_outputPath);
+    }
+
+    if (state == QEMUImgJob::Finished) {
+        job->m_progress = 100;
+    }
+
+    emit(job->finished(state == QEMUImgJob::Finished));
+    emit(jobFinished(job));
+
+    job->deleteLater();
+
+    this->startJobs();
+}
+
+/**
+ * @brief Cancel a job
+ * @param job, job to cancel
+ *
+ * Cancel a job. qemu-img is terminated
+ * and killed if it doesn't finish in time
+ */
+void QEMUImgJobRunner::cancelJob(QEMUImgJob *job)
+{
+    if (this->m_queuedJobs.contains(job)) {
+        this->finishJob(job, QEMUImgJob::Cancelled);
+        return;
+    }
+
+    if (!this->m_runningJobs.contains(job) || job->m_process == nullptr) {
+        return;
+    }
+
+    job->m_state = QEMUImgJob::Cancelled;
+    job->m_process->terminate();
+
+    QProcess *process = job->m_process;
+    QTimer::singleShot(CANCEL_TIMEOUT, process, [=]() {
+        if (process->state() != QProcess::NotRunning) {
+            process->kill();
+        }
+    });
+}
@@ -0,0 +1,130 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QEMUIMGJOBRUNNER_H
+#define QEMUIMGJOBRUNNER_H
+
+// Qt
+#include <QObject>
+#include <QProcess>
+#include <QQueue>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QTimer>
+#include <QDebug>
+
+class QEMU; // Forward declaration
+
+class QEMUImgJob : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit QEMUImgJob(QObject *parent = nullptr);
+        ~QEMUImgJob();
+
+        enum Operations {
+            Create, Convert, Resize, Check, Commit
+        };
+
+        enum States {
+            Queued, Running, Finished, Failed, Cancelled
+        };
+
+        QEMUImgJob::Operations operation() const;
+        QEMUImgJob::States state() const;
+        QStringList arguments() const;
+        QString outputPath() const;
+        double progress() const;
+        QString output() const;
+        QString errorString() const;
+        QString description() const;
+        bool isFinished() const;
+
+        void cancel();
+
+    signals:
+        void started();
+        void progressChanged(double progress);
+        void finished(bool success);
+        void cancelRequested();
+
+    private:
+        friend class QEMUImgJobRunner;
+
+        Operations m_operation;
+        States m_state;
+        QStringList m_arguments;
+        QString m_outputPath;
+        double m_progress;
+        QString m_output;
+        QString m_errorString;
+        QProcess *m_process;
+        bool m_outputCreated;
+};
+
+class QEMUImgJobRunner : public QObject {
+    Q_OBJECT
+
+    public:
+        explicit QEMUImgJobRunner(QEMU *QEMUObject, QObject *parent = nullptr);
+        ~QEMUImgJobRunner();
+
+        QEMUImgJob *create(const QString &path, const QString &format,
+                           const QString &size, const QStringList &options = QStringList());
+        QEMUImgJob *createOverlay(const QString &path, const QString &backingPath,
+                                  const QString &backingFormat);
+        QEMUImgJob *convert(const QString &source, const QString &destination,
+                            const QString &format, bool compress = false);
+        QEMUImgJob *resize(const QString &path, const QString &size);
+        QEMUImgJob *check(const QString &path);
+        QEMUImgJob *commit(const QString &path);
+
+        QList<QEMUImgJob *> jobs() const;
+
+        int maxJobs() const;
+        void setMaxJobs(const int maxJobs);
+
+    signals:
+        void jobAdded(QEMUImgJob *job);
+        void jobFinished(QEMUImgJob *job);
+
+    private slots:
+        void startJobs();
+
+    private:
+        QEMU *m_QEMUObject;
+        QQueue<QEMUImgJob *> m_queuedJobs;
+        QList<QEMUImgJob *> m_runningJobs;
+        int m_maxJobs;
+
+        // Methods
+        QEMUImgJob *enqueue(QEMUImgJob::Operations operation,
+                            const QStringList &arguments,
+                            const QString &outputPath = QString());
+        void startJob(QEMUImgJob *job);
+        void readProgress(QEMUImgJob *job);
+        void finishJob(QEMUImgJob *job, QEMUImgJob::States state);
+        void cancelJob(QEMUImgJob *job);
+};
+
+#endif // QEMUIMGJOBRUNNER_H
@@ -48,42 +48,6 @@ void SystemUtils::showMessage(QString title, QString text,
     qemuImgNotFoundMessageBox->exec();
 }
 
-/**
- * @brief Get the total RAM installed on the system
- * @param totalRAM, variable to store the total ram
- *
- * Get the total RAM installed on the system
- */
-void SystemUtils::getTotalMemory(int &totalRAM)
-{
-#ifdef Q_OS_LINUX
-    struct sysinfo sys_info;
-    if (sysinfo(&sys_info) != -1) {
-        totalRAM = static_cast<int>(((sys_info.totalram * sys_info.mem_unit) * 0.976562) / 1024 / 1024);
-    }
-#endif
-#ifdef Q_OS_WIN
-    MEMORYSTATUSEX statex;
-    statex.dwLength = sizeof (statex);
-    GlobalMemoryStatusEx (&statex);
-    totalRAM = static_cast<int>(statex.ullTotalPhys / (1024 * 1024));
-#endif
-#ifdef Q_OS_MACOS
-    size_t len;
-    unsigned long memory;
-    len = sizeof(memory);
-    sysctlbyname("hw.memsize", &memory, &len, NULL, 0);
-    totalRAM = static_cast<int>(((memory) * 0.976562) / 1024 / 1024);
-#endif
-#ifdef Q_OS_FREEBSD
-    size_t len;
-    unsigned long memory;
-    len = sizeof(memory);
-    sysctlbyname("hw.physmem", &memory, &len, NULL, 0);
-    totalRAM = static_cast<int>(((memory) * 0.976562) / 1024 / 1024);
-#endif
-}
-
 /**
  * @brief Get all the CPU types for x86
  * @param CPUType, combobox to insert all the CPU
@@ -108,7 +72,6 @@ void SystemUtils::setCPUTypesx86(QComboBox *CPUType)
     CPUType->addItem("Broadwell, IBRS",  QString("Broadwell-IBRS"));
     CPUType->addItem("Broadwell, no TSX, IBRS", QString("Broadwell-noTSX-IBRS"));
 
-
     CPUType->addItem("Intel Xeon Processor (Cascadelake)", QString("Cascadelake-Server"));
     CPUType->addItem("Intel Xeon Processor (Cascadelake) noTSX", QString("Cascadelake-Server-noTSX"));
     CPUType->addItem("Intel Xeon Processor (Cooperlake)", QString("Cooperlake"));
@@ -158,6 +121,20 @@ void SystemUtils::setCPUTypesx86(QComboBox *CPUType)
     CPUType->addItem("Base", QString("base"));
     CPUType->addItem("Host", QString("host"));
     CPUType->addItem("Max",  QString("max"));
+
+    // Offer only the models of the installed QEMU, when they're known
+    QStringList CPUModels = QEMUCapabilities::instance()->CPUModels(QEMUCapabilities::defaultBinary());
+    if (CPUModels.isEmpty()) {
+        return;
+    }
+
+    SystemUtils::removeUnavailableItems(CPUType, CPUModels);
+
+    foreach (const QString &CPUModel, CPUModels) {
+        if (CPUType->findData(CPUModel) == -1) {
+            CPUType->addItem(CPUModel, CPUModel);
+        }
+    }
 }
 
 /**
@@ -177,6 +154,27 @@ void SystemUtils::setGPUTypes(QComboBox *GPUType)
     GPUType->addItem("Sun Cgthree Framebuffer",      QString("cg3"));
     GPUType->addItem("Virtio VGA Card",              QString("virtio"));
     GPUType->addItem("Xen Framebuffer",              QString("xenfb"));
+
+    // Device of every card. Cards without device are always available
+    QHash<QString, QString> GPUDevices;
+    GPUDevices.insert("std",    "VGA");
+    GPUDevices.insert("cirrus", "cirrus-vga");
+    GPUDevices.insert("vmware", "vmware-svga");
+    GPUDevices.insert("qxl",    "qxl-vga");
+    GPUDevices.insert("tcx",    "SUNW,tcx");
+    GPUDevices.insert("cg3",    "cgthree");
+    GPUDevices.insert("virtio", "virtio-vga");
+
+    QStringList availableGPUs;
+    for (int i = 0; i < GPUType->count(); ++i) {
+        QString GPU = GPUType->itemData(i).toString();
+        if (!GPUDevices.contains(GPU) ||
+            QEMUCapabilities::instance()->hasDevice(QEMUCapabilities::defaultBinary(), GPUDevices.value(GPU))) {
+            availableGPUs.append(GPU);
+        }
+    }
+
+    SystemUtils::removeUnavailableItems(GPUType, availableGPUs);
 }
 
 /**
@@ -222,73 +220,6 @@ void SystemUtils::setKeyboardLayout(QComboBox *keyboardLayout)
     keyboardLayout->addItem("Turkish (tr)",                     QString("tr"));
 }
 
-/**
- * @brief Get all the audio cards
- * @return hash with all the audio cards
- *
- * Get all the audio cards
- */
-QHash<QString, QString> SystemUtils::getSoundCards()
-{
-    QHash<QString, QString> soundCardsHash;
-    soundCardsHash.insert("sb16", "Creative Sound Blaster 16");
-    soundCardsHash.insert("ac97", "Intel AC97(82801AA)");
-    soundCardsHash.insert("gus", "Gravis Ultrasound GF1");
-    soundCardsHash.insert("intel-hda", "Intel HD Audio");
-    soundCardsHash.insert("hda-duplex", "HDA Codec");
-    soundCardsHash.insert("es1370", "ENSONIQ AudioPCI ES1370");
-    soundCardsHash.insert("adlib", "Yamaha YM3812");
-    soundCardsHash.insert("cs4231a", "CS4231A");
-    soundCardsHash.insert("pcspk", "PC Speaker");
-
-    return soundCardsHash;
-}
-
-/**
- * @brief Get all the accelerators
- * @return hash with the accelerators
- *
- * Get all the accelerators
- */
-QHash<QString, QString> SystemUtils::getAccelerators()
-{
-    QHash<QString, QString> acceleratorsHash;
-#ifdef Q_OS_LINUX
-    acceleratorsHash.insert("kvm", "Kernel-based Virtual Machine (KVM)");
-    acceleratorsHash.insert("xen", "Xen Hypervisor");
-#endif
-#ifdef Q_OS_MACOS
-    acceleratorsHash.insert("hvf", "Hypervisor Framework (HVF)");
-#endif
-    acceleratorsHash.insert("tcg", "Tiny Code Generator (TCG)");
-#ifdef Q_OS_WIN
-    acceleratorsHash.insert("hax", "Hardware Accelerated Execution Manager (HAXM)");
-    acceleratorsHash.insert("whpx,kernel-irqchip=off", "Windows Hypervisor Platform (WHPX)");
-#endif
-
-    return acceleratorsHash;
-}
-
-/**
- * @brief Get the media devices
- *
- * @return map with the media devices
- *
- * Get the media devices
- */
-QMap<QString, QString> SystemUtils::getMediaDevices()
-{
-    QMap<QString, QString> mediaMap;
-    mediaMap.insert("a", "Floppy A");
-    mediaMap.insert("b", "Floppy B");
-    mediaMap.insert("c", "HDD");
-    mediaMap.insert("d", "CDROM");
-    mediaMap.insert("n-1", "Network 1");
-    mediaMap.insert("n-2", "Network 2");
-
-    return mediaMap;
-}
-
 /**
  * @brief Get Operating System icons
  * @param osVersion, version of the operating system
@@ -315,98 +246,60 @@ QString SystemUtils::getOsIcon(const QString &osVersion)
 }
 
 /**
- * @brief Create the a disk
+ * @brief Get the machine types of the installed QEMU
+ * @param model, model with the machine and description columns
+ * @return false if QEMU isn't probed yet
  *
- * @param qemuGlobalObject, QEMU global object with data about QEMU
- * @param diskName, name of the new disk
- * @param format, format of the new disk
- * @param size, size of the new disk
- * @param useEncryption, use encryption
- *
- * Create the a new disk
- *
- * @return true if the disk is successfully created
+ * Add the machine types of the default binary to the model.
+ * The aliases are added as their own machine
  */
-bool SystemUtils::createDisk(QEMU *qemuGlobalObject,
-                             const QString &diskName,
-                             const QString &format,
-                             const double size,
-                             bool useEncryption)
+bool SystemUtils::setMachineTypes(QAbstractItemModel *model)
 {
-    QProcess *qemuImgProcess = new QProcess();
-
-    QStringList args;
-    args << "create";
-
-    if(useEncryption) {
-        args << "-e";
-    }
-
-    args << "-f";
-    args << format;
-    args << QDir::toNativeSeparators(diskName);
-    args << QString::number(size) + "G"; // TODO: Implement other sizes, K, M, T
-
-    QString program;
-
-    program = qemuGlobalObject->QEMUImgPath();
-    qemuImgProcess->start(program, args);
-
-    if(!qemuImgProcess->waitForStarted(2000)) {
-        QMessageBox *qemuImgNotFoundMessageBox = new QMessageBox();
-        qemuImgNotFoundMessageBox->setWindowTitle(QObject::tr("Qtemu - Critical error"));
-        qemuImgNotFoundMessageBox->setIcon(QMessageBox::Critical);
-        qemuImgNotFoundMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-        qemuImgNotFoundMessageBox->setText(QObject::tr("<p>Cannot start qemu-img</p>"
-                                                         "<p><strong>Image isn't created</strong></p>"
-                                                         "<p>Ensure that you have installed qemu-img in your "
-                                                         "system and it's available</p>"));
-        qemuImgNotFoundMessageBox->exec();
-
+    QList<QJsonObject> machineTypes = QEMUCapabilities::instance()->machineTypes(QEMUCapabilities::defaultBinary());
+    if (machineTypes.isEmpty()) {
         return false;
     }
 
-    if (!qemuImgProcess->waitForFinished()) {
-        QMessageBox *qemuImgNotFinishedMessageBox = new QMessageBox();
-        qemuImgNotFinishedMessageBox->setWindowTitle(QObject::tr("Qtemu - Critical error"));
-        qemuImgNotFinishedMessageBox->setIcon(QMessageBox::Critical);
-        qemuImgNotFinishedMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-        qemuImgNotFinishedMessageBox->setText(QObject::tr("<p>Cannot finish qemu-img</p>"
-                                                            "<p><strong>Image isn't created</strong></p>"
-                                                            "<p>There's a problem with qemu-img, the process "
-                                                            "has not finished correctly</p>"));
-        qemuImgNotFinishedMessageBox->exec();
-
-        return false;
-    } else {
-        QByteArray err = qemuImgProcess->readAllStandardError();
-        QByteArray out = qemuImgProcess->readAllStandardOutput();
-
-        if (err.count() > 0) {
-            QMessageBox *qemuImgErrorMessageBox = new QMessageBox();
-            qemuImgErrorMessageBox->setWindowTitle(QObject::tr("Qtemu - Critical error"));
-            qemuImgErrorMessageBox->setIcon(QMessageBox::Critical);
-            qemuImgErrorMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-            qemuImgErrorMessageBox->setText(QObject::tr("<p>Cannot finish qemu-img</p>"
-                                                          "<p><strong>Image isn't created</strong></p>"
-                                                          "<p>Error: " + err + "</p>"));
-            qemuImgErrorMessageBox->exec();
+    // The machines are inserted at the top of the list
+    auto addMachine = [model](const QString &machine, const QString &description) {
+        model->insertRow(0);
+        model->setData(model->index(0, 0), machine);
+        model->setData(model->index(0, 1), description);
+    };
+
+    foreach (const QJsonObject &machineType, machineTypes) {
+        QString machineName = machineType["name"].toString();
+        QString description = machineType["description"].toString();
+        if (machineType["deprecated"].toBool()) {
+            description.append(" (deprecated)");
+        }
 
-            return false;
+        QString alias = machineType["alias"].toString();
+        if (!alias.isEmpty()) {
+            addMachine(alias, description + " (alias of " + machineName + ")");
+        }
+        if (machineType["default"].toBool()) {
+            description.append(" (default)");
         }
+        addMachine(machineName, description);
+    }
 
-        if (out.count() > 0) {
-            QMessageBox *qemuImgOkMessageBox = new QMessageBox();
-            qemuImgOkMessageBox->setWindowTitle(QObject::tr("Qtemu - Image created"));
-            qemuImgOkMessageBox->setIcon(QMessageBox::Information);
-            qemuImgOkMessageBox->setWindowIcon(QIcon::fromTheme("qtemu", QIcon(":/images/qtemu.png")));
-            qemuImgOkMessageBox->setText(QObject::tr("<p><strong>Image created</strong></p>"
-                                                       "<p>" + out + "</p>"));
-            qemuImgOkMessageBox->exec();
+    return true;
+}
 
-            return true;
+/**
+ * @brief Remove the items that aren't available
+ * @param comboBox, combobox with the items
+ * @param availableItems, data of the available items
+ *
+ * Remove the items of the combobox whose data
+ * isn't in the available items
+ */
+void SystemUtils::removeUnavailableItems(QComboBox *comboBox, const QStringList &availableItems)
+{
+    for (int i = comboBox->count() - 1; i >= 0; --i) {
+        if (!availableItems.contains(comboBox->itemData(i).toString())) {
+            comboBox->removeItem(i);
         }
-
-        return false;
     }
 }
@@ -24,6 +24,7 @@
 // Qt
 #include <QLabel>
 #include <QComboBox>
+#include <QAbstractItemModel>
 #include <QDir>
 #include <QFile>
 #include <QJsonObject>
@@ -37,29 +38,7 @@
 
 // Local
 #include "../qemu.h"
-
-// GNU
-#ifdef Q_OS_LINUX
-#include <sys/sysinfo.h>
-#endif
-
-// Windows
-#ifdef Q_OS_WIN
-#include <windows.h>
-#endif
-
-// FreeBSD
-#ifdef Q_OS_FREEBSD
-#include <sys/types.h>
-#include <sys/sysctl.h>
-#include <sys/utsname.h>
-#endif
-
-// MacOS
-#ifdef Q_OS_MAC
-#include <sys/types.h>
-#include <sys/sysctl.h>
-#endif
+#include "hostutils.h"
 
 class SystemUtils {
 
@@ -69,24 +48,15 @@ class SystemUtils {
 
         static void showMessage(QString title, QString text, QMessageBox::Icon severityLevel);
 
-        static void getTotalMemory(int &totalRAM);
-
         static void setCPUTypesx86(QComboBox *CPUType);
         static void setGPUTypes(QComboBox *GPUType);
         static void setKeyboardLayout(QComboBox *keyboardLayout);
-        static QHash<QString, QString> getSoundCards();
-        static QHash<QString, QString> getAccelerators();
-        static QMap<QString, QString> getMediaDevices();
+        static bool setMachineTypes(QAbstractItemModel *model);
 
         static QString getOsIcon(const QString &osVersion);
 
-        static bool createDisk(QEMU *qemuGlobalObject,
-                               const QString &diskName,
-                               const QString &format,
-                               const double size,
-                               bool useEncryption);
-
     private:
+        static void removeUnavailableItems(QComboBox *comboBox, const QStringList &availableItems);
 
 };
 
@@ -0,0 +1,276 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+// Local
+#include "templatelibrary.h"
+
+TemplateLibrary::TemplateLibrary()
+{
+    qDebug() << "TemplateLibrary created";
+}
+
+TemplateLibrary::~TemplateLibrary()
+{
+    qDebug() << "TemplateLibrary destroyed";
+}
+
+/**
+ * @brief Get the path of the template library
+ * @return path of the templates folder
+ *
+ * Get the path of the templates folder, inside the
+ * QtEmu data folder. The folder is created if needed
+ */
+QString TemplateLibrary::templatesPath()
+{
+    QSettings settings;
+    settings.beginGroup("DataFolder");
+    QString dataDirectoryPath = settings.value("QtEmuData",
+                                               QDir::toNativeSeparators(QDir::homePath() + "/.qtemu/")).toString();
+    settings.endGroup();
+
+    QString templatesPath = QDir::toNativeSeparators(dataDirectoryPath + "/templates/");
+    QDir().mkpath(templatesPath);
+
+    return templatesPath;
+}
+
+/**
+ * @brief Get the templates of the library
+ * @return templates whose image exists
+ *
+ * Get the templates of the library
+ */
+QList<TemplateImage> TemplateLibrary::getTemplates()
+{
+    QList<TemplateImage> templates;
+
+    QJsonArray index = TemplateLibrary::readIndex();
+    for (int i = 0; i < index.size(); ++i) {
+        QJsonObject templateObject = index[i].toObject();
+
+        TemplateImage image;
+        image.name    = templateObject["name"].toString();
+        image.path    = templateObject["path"].toString();
+        image.format  = templateObject["format"].toString();
+        image.origin  = templateObject["origin"].toString();
+        image.created = QDateTime::fromString(templateObject["created"].toString(), Qt::ISODate);
+
+        if (QFile::exists(image.path)) {
+            templates.append(image);
+        }
+    }
+
+    return templates;
+}
+
+/**
+ * @brief Get a template of the library
+ * @param path, path of the template image
+ * @return template, with an empty path if it isn't in the library
+ *
+ * Get a template of the library
+ */
+TemplateImage TemplateLibrary::getTemplate(const QString &path)
+{
+    QString canonicalPath = QFileInfo(path).canonicalFilePath();
+
+    foreach (const TemplateImage &image, TemplateLibrary::getTemplates()) {
+        if (QFileInfo(image.path).canonicalFilePath() == canonicalPath) {
+            return image;
+        }
+    }
+
+    return TemplateImage();
+}
+
+/**
+ * @brief Check if an image is a template
+ * @param path, path of the image
+ * @return true if the image is in the template library
+ *
+ * Check if an image is a template
+ */
+bool TemplateLibrary::isTemplate(const QString &path)
+{
+    return !TemplateLibrary::getTemplate(path).path.isEmpty();
+}
+
+/**
+ * @brief Add a disk to the template library
+ * @param diskPath, path of the disk
+ * @param format, format of the disk
+ * @param name, name of the template
+ * @param origin, name of the machine that owned the disk
+ * @param templatePath, path of the template image
+ * @param error, description of the problem
+ * @return true if the template is added
+ *
+ * Move the disk to the templates folder and make it read-only.
+ * The disk must not be used anymore, the machines use qcow2
+ * overlays that point to the template as backing file
+ */
+bool TemplateLibrary::addTemplate(const QString &diskPath, const QString &format,
+                                  const QString &name, const QString &origin,
+                                  QString &templatePath, QString &error)
+{
+    QFileInfo diskInfo(diskPath);
+    if (!diskInfo.exists()) {
+        error = QObject::tr("The disk %1 doesn't exist").arg(diskPath);
+        return false;
+    }
+
+    templatePath = QDir::toNativeSeparators(TemplateLibrary::templatesPath() +
+                                            diskInfo.completeBaseName() + "-" +
+                                            QUuid::createUuid().toString(QUuid::WithoutBraces).left(8) +
+                                            "." + diskInfo.suffix());
+
+    // In other file system the disk would be copied in the GUI thread
+    if (!TemplateLibrary::sameFileSystem(diskInfo.absolutePath(), TemplateLibrary::templatesPath())) {
+        error = QObject::tr("The disk %1 isn't in the file system of the template library, "
+                            "use a full clone").arg(diskPath);
+        return false;
+    }
+
+    if (!QFile::rename(diskPath, templatePath)) {
+        error = QObject::tr("Cannot move the disk %1 to the template library").arg(diskPath);
+        return false;
+    }
+
+    QFile::setPermissions(templatePath, QFile::ReadOwner | QFile::ReadGroup | QFile::ReadOther);
+
+    QJsonObject templateObject;
+    templateObject["name"]    = name;
+    templateObject["path"]    = templatePath;
+    templateObject["format"]  = format;
+    templateObject["origin"]  = origin;
+    templateObject["created"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    QJsonArray index = TemplateLibrary::readIndex();
+    index.append(templateObject);
+
+    if (!TemplateLibrary::writeIndex(index)) {
+        QString restoreError;
+        TemplateLibrary::removeTemplate(templatePath, diskPath, restoreError);
+        error = QObject::tr("Cannot write the index of the template library");
+        return false;
+    }
+
+    qDebug() << "Template added" << templatePath;
+
+    return true;
+}
+
+/**
+ * @brief Remove a template from the library
+ * @param templatePath, path of the template image
+ * @param restorePath, path where the image is moved
+ * @param error, description of the problem
+ * @return true if the template is removed
+ *
+ * Move the image out of the library and make it writable again.
+ * Used to undo addTemplate when the overlays cannot be created
+ */
+bool TemplateLibrary::removeTemplate(const QString &templatePath,
+                                     const QString &restorePath, QString &error)
+{
+    if (!TemplateLibrary::sameFileSystem(QFileInfo(restorePath).absolutePath(), templatePath)) {
+        error = QObject::tr("The template %1 cannot be moved to other file system").arg(templatePath);
+        return false;
+    }
+
+    QFile::setPermissions(templatePath, QFile::ReadOwner | QFile::WriteOwner |
+                                        QFile::ReadGroup | QFile::ReadOther);
+
+    if (!QFile::rename(templatePath, restorePath)) {
+        error = QObject::tr("Cannot move the template %1 to %2").arg(templatePath, restorePath);
+        return false;
+    }
+
+    QString canonicalPath = QFileInfo(restorePath).canonicalFilePath();
+    QJsonArray index = TemplateLibrary::readIndex();
+    for (int i = index.size() - 1; i >= 0; --i) {
+        QString path = index[i].toObject()["path"].toString();
+        if (path == templatePath || QFileInfo(path).canonicalFilePath() == canonicalPath) {
+            index.removeAt(i);
+        }
+    }
+
+    return TemplateLibrary::writeIndex(index);
+}
+
+/**
+ * @brief Check if two paths are in the same file system
+ * @param path, existing path
+ * @param otherPath, other existing path
+ * @return true if a file can be renamed from one to the other
+ *
+ * QFile::rename copies the file between file systems,
+ * a disk is moved only when the rename is immediate
+ */
+bool TemplateLibrary::sameFileSystem(const QString &path, const QString &otherPath)
+{
+    QStorageInfo storage(path);
+    QStorageInfo otherStorage(otherPath);
+
+    return storage.isValid() && otherStorage.isValid() &&
+           storage.device() == otherStorage.device();
+}
+
+/**
+ * @brief Read the index of the library
+ * @return templates stored in the templates.json file
+ *
+ * Read the index of the library
+ */
+QJsonArray TemplateLibrary::readIndex()
+{
+    QFile indexFile(TemplateLibrary::templatesPath() + "templates.json");
+    if (!indexFile.open(QFile::ReadOnly)) {
+        return QJsonArray();
+    }
+
+    QJsonDocument indexDocument(QJsonDocument::fromJson(indexFile.readAll()));
+
+    return indexDocument["templates"].toArray();
+}
+
+/**
+ * @brief Write the index of the library
+ * @param templates, templates of the library
+ * @return true if the index is written
+ *
+ * Write the index of the library.
+ * The old index is replaced only when the new one is complete
+ */
+bool TemplateLibrary::writeIndex(const QJsonArray &templates)
+{
+    QSaveFile indexFile(TemplateLibrary::templatesPath() + "templates.json");
+    if (!indexFile.open(QFile::WriteOnly)) {
+        return false;
+    }
+
+    QJsonObject indexObject;
+    indexObject["templates"] = templates;
+
+    indexFile.write(QJsonDocument(indexObject).toJson());
+
+    return indexFile.commit();
+}
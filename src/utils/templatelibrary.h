@@ -0,0 +1,69 @@
+/*
+ * This file is part of QtEmu project.
+ * Copyright (C) 2017-2020 Sergio Carlavilla <carlavilla @ mailbox.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEMPLATELIBRARY_H
+#define TEMPLATELIBRARY_H
+
+// Qt
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStorageInfo>
+#include <QSettings>
+#include <QDateTime>
+#include <QUuid>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+struct TemplateImage {
+    QString name;
+    QString path;
+    QString format;
+    QString origin;
+    QDateTime created;
+};
+
+class TemplateLibrary {
+
+    public:
+        TemplateLibrary();
+        ~TemplateLibrary();
+
+        static QString templatesPath();
+        static QList<TemplateImage> getTemplates();
+        static TemplateImage getTemplate(const QString &path);
+        static bool isTemplate(const QString &path);
+
+        static bool addTemplate(const QString &diskPath, const QString &format,
+                                const QString &name, const QString &origin,
+                                QString &templatePath, QString &error);
+        static bool removeTemplate(const QString &templatePath,
+                                   const QString &restorePath, QString &error);
+
+    private:
+        static QJsonArray readIndex();
+        static bool writeIndex(const QJsonArray &templates);
+        static bool sameFileSystem(const QString &path, const QString &otherPath);
+};
+
+#endif // TEMPLATELIBRARY_H